@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "MWLinkerMap.h"
+
+// Scans every linker map given at once and reports how each of them went.
+// Usage: mwlinkermap-batch [tloztp|smgalaxy] [-j threads] [-w] files...
+int main(const int argc, const char** argv)
+{
+  MWLinker::Map::ScanFlavor flavor = MWLinker::Map::ScanFlavor::Normal;
+  MWLinker::Map::Options options;
+  options.m_warnings = MWLinker::Map::Warnings::None;
+  options.m_thread_count = 1;
+  unsigned thread_count = 0;
+  std::vector<std::filesystem::path> paths;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string_view arg = argv[i];
+    if (arg == "tloztp")
+      flavor = MWLinker::Map::ScanFlavor::TLOZTP;
+    else if (arg == "smgalaxy")
+      flavor = MWLinker::Map::ScanFlavor::SMGalaxy;
+    else if (arg == "-w")
+      options.m_warnings = MWLinker::Map::Warnings::All;
+    else if (arg == "-j" && i + 1 < argc)
+      thread_count = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    else
+      paths.emplace_back(arg);
+  }
+  if (paths.empty())
+  {
+    fmt::println(std::cerr, "Provide the names");
+    return EXIT_FAILURE;
+  }
+
+  const auto time_start = std::chrono::high_resolution_clock::now();
+  const std::vector<MWLinker::Map::BatchResult> results =
+      MWLinker::Map::ScanFiles(paths, options, thread_count, flavor);
+  const auto time_end = std::chrono::high_resolution_clock::now();
+  const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start);
+
+  std::size_t failure_count = 0;
+  for (const MWLinker::Map::BatchResult& result : results)
+  {
+    if (result.m_error != MWLinker::Map::ScanError::None)
+      failure_count += 1;
+    fmt::println(std::cout, "{:s}   line: {:d}   err: {:d}", result.m_path.string(),
+                 result.m_line_number, static_cast<int>(result.m_error));
+    MWLinker::Map::Diagnostics::Print(std::cerr, result.m_map.GetDiagnostics().Get());
+  }
+  fmt::println(std::cout, "files: {:d}   failed: {:d}   time: {:d}ms", results.size(),
+               failure_count, time.count());
+
+  return failure_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
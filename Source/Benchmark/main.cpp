@@ -0,0 +1,377 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "FileUtil.h"
+#include "MWDemangler.h"
+#include "MWLinkerMap.h"
+#include "ProfileUtil.h"
+
+// Every allocation made by the process is counted, so each stage can be told apart by how many it
+// makes. Replacing the global allocation functions is the only way to see those made by the library
+// without it having to know about this. How much is asked for in total shows how memory use grows
+// with the size of the linker map. Allocations are also reported to the library, for its profiles
+// of each portion scanned.
+static std::atomic<std::size_t> s_allocation_count = 0;
+static std::atomic<std::size_t> s_allocated_size = 0;
+
+static void* Allocate(const std::size_t size)
+{
+  s_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  s_allocated_size.fetch_add(size, std::memory_order_relaxed);
+  Mijo::CountAllocation(size);
+  if (void* const ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+static void* Allocate(const std::size_t size, const std::align_val_t alignment)
+{
+  s_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  s_allocated_size.fetch_add(size, std::memory_order_relaxed);
+  Mijo::CountAllocation(size);
+  const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+  if (void* const ptr = _aligned_malloc(size == 0 ? 1 : size, align))
+    return ptr;
+#else
+  // std::aligned_alloc wants a size that is a multiple of the alignment.
+  if (void* const ptr = std::aligned_alloc(align, (std::max(size, std::size_t{1}) + align - 1) &
+                                                      ~(align - 1)))
+    return ptr;
+#endif
+  throw std::bad_alloc{};
+}
+
+static void Deallocate(void* const ptr, const std::align_val_t) noexcept
+{
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+void* operator new(const std::size_t size)
+{
+  return Allocate(size);
+}
+void* operator new[](const std::size_t size)
+{
+  return Allocate(size);
+}
+void* operator new(const std::size_t size, const std::align_val_t alignment)
+{
+  return Allocate(size, alignment);
+}
+void* operator new[](const std::size_t size, const std::align_val_t alignment)
+{
+  return Allocate(size, alignment);
+}
+void operator delete(void* const ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void* const ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* const ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void* const ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* const ptr, const std::align_val_t alignment) noexcept
+{
+  Deallocate(ptr, alignment);
+}
+void operator delete[](void* const ptr, const std::align_val_t alignment) noexcept
+{
+  Deallocate(ptr, alignment);
+}
+void operator delete(void* const ptr, std::size_t, const std::align_val_t alignment) noexcept
+{
+  Deallocate(ptr, alignment);
+}
+void operator delete[](void* const ptr, std::size_t, const std::align_val_t alignment) noexcept
+{
+  Deallocate(ptr, alignment);
+}
+
+// Each of the versions a linker map can be told to come from, in order.
+static constexpr std::array<std::pair<MWLinker::Version, std::string_view>, 14> s_versions = {{
+    {MWLinker::Version::version_2_3_3_build_126, "2.3.3 build 126"},
+    {MWLinker::Version::version_2_3_3_build_137, "2.3.3 build 137"},
+    {MWLinker::Version::version_2_4_1_build_47, "2.4.1 build 47"},
+    {MWLinker::Version::version_2_4_2_build_81, "2.4.2 build 81"},
+    {MWLinker::Version::version_2_4_7_build_92, "2.4.7 build 92"},
+    {MWLinker::Version::version_2_4_7_build_102, "2.4.7 build 102"},
+    {MWLinker::Version::version_2_4_7_build_107, "2.4.7 build 107"},
+    {MWLinker::Version::version_3_0_4, "3.0.4"},
+    {MWLinker::Version::version_4_1_build_51213, "4.1 build 51213"},
+    {MWLinker::Version::version_4_2_build_60320, "4.2 build 60320"},
+    {MWLinker::Version::version_4_2_build_142, "4.2 build 142"},
+    {MWLinker::Version::version_4_3_build_151, "4.3 build 151"},
+    {MWLinker::Version::version_4_3_build_172, "4.3 build 172"},
+    {MWLinker::Version::version_4_3_build_213, "4.3 build 213"},
+}};
+
+static std::string_view ToName(const MWLinker::Version version)
+{
+  if (version == MWLinker::Version::Unknown)
+    return "unknown";
+  if (version == MWLinker::Version::Latest)
+    return "latest";
+  return std::ranges::find(s_versions, version, &decltype(s_versions)::value_type::first)->second;
+}
+
+// The fastest and average time of one stage, and how many allocations it made each time and how
+// many bytes they added up to.
+struct StageResult
+{
+  std::chrono::nanoseconds m_best = std::chrono::nanoseconds::max();
+  std::chrono::nanoseconds m_total{};
+  std::size_t m_allocation_count = 0;
+  std::size_t m_allocated_size = 0;
+};
+
+template <class Func>
+static StageResult RunStage(const unsigned repetition_count, Func&& func)
+{
+  StageResult result;
+  for (unsigned i = 0; i < repetition_count; ++i)
+  {
+    const std::size_t allocation_count = s_allocation_count.load(std::memory_order_relaxed);
+    const std::size_t allocated_size = s_allocated_size.load(std::memory_order_relaxed);
+    const auto time_start = std::chrono::steady_clock::now();
+    func();
+    const auto time_end = std::chrono::steady_clock::now();
+    result.m_allocation_count = s_allocation_count.load(std::memory_order_relaxed) -
+                                allocation_count;
+    result.m_allocated_size = s_allocated_size.load(std::memory_order_relaxed) - allocated_size;
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(time_end - time_start);
+    result.m_best = std::min(result.m_best, time);
+    result.m_total += time;
+  }
+  return result;
+}
+
+static void PrintStage(const std::string_view stage_name, const StageResult& result,
+                       const unsigned repetition_count, const std::size_t byte_count,
+                       const std::size_t line_count)
+{
+  const double best_ms = std::chrono::duration<double, std::milli>(result.m_best).count();
+  const double mean_ms = std::chrono::duration<double, std::milli>(result.m_total).count() /
+                         static_cast<double>(repetition_count);
+  const double megabytes_per_second = best_ms == 0.0 ?
+                                          std::numeric_limits<double>::infinity() :
+                                          static_cast<double>(byte_count) / 1e3 / best_ms;
+  const double allocations_per_line =
+      line_count == 0 ? 0.0 :
+                        static_cast<double>(result.m_allocation_count) /
+                            static_cast<double>(line_count);
+  const double allocated_megabytes = static_cast<double>(result.m_allocated_size) / 1e6;
+  fmt::println(std::cout, "  {:<14s} {:>10.3f} {:>10.3f} {:>10.1f} {:>12.4f} {:>10.1f}", stage_name,
+               best_ms, mean_ms, megabytes_per_second, allocations_per_line, allocated_megabytes);
+}
+
+// Times scanning, printing, lookups, diffing, and demangling on their own for every linker map
+// given, so that a regression in one of them is not hidden behind the others. Each stage is run a
+// number of times, and its fastest time is what throughput is reckoned from. Every map is run with
+// the scan flavor last named before it. The versions each map could have come from are reported
+// along the way, so a corpus can be checked for covering all of them. With -p, the profile of each
+// portion from the last scan is printed as well, if the library was built with
+// MWLINKERMAP_PROFILING. With -l, symbol closures are scanned lazily, which leaves the first print
+// to scan them in full.
+// Usage: mwlinkermap-benchmark [-r repetitions] [-j threads] [-x] [-p] [-l]
+//                              [normal|tloztp|smgalaxy] files...
+int main(const int argc, const char** argv)
+{
+  using MWLinker::Map;
+
+  Map::Options options;
+  options.m_warnings = Map::Warnings::None;
+  unsigned repetition_count = 5;
+  bool is_profile_printed = false;
+  std::vector<std::pair<Map::ScanFlavor, std::filesystem::path>> files;
+  Map::ScanFlavor flavor = Map::ScanFlavor::Normal;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string_view arg = argv[i];
+    if (arg == "normal")
+      flavor = Map::ScanFlavor::Normal;
+    else if (arg == "tloztp")
+      flavor = Map::ScanFlavor::TLOZTP;
+    else if (arg == "smgalaxy")
+      flavor = Map::ScanFlavor::SMGalaxy;
+    else if (arg == "-x")
+      options.m_use_regex_fallback = true;
+    else if (arg == "-p")
+      is_profile_printed = true;
+    else if (arg == "-l")
+      options.m_lazy_symbol_closures = true;
+    else if (arg == "-r" && i + 1 < argc)
+      repetition_count =
+          std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+    else if (arg == "-j" && i + 1 < argc)
+      options.m_thread_count = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    else
+      files.emplace_back(flavor, arg);
+  }
+  if (files.empty())
+  {
+    fmt::println(std::cerr, "Provide the names");
+    return EXIT_FAILURE;
+  }
+  if (is_profile_printed && !Map::ScanProfile::is_enabled)
+    fmt::println(std::cerr, "Profiles are empty without MWLINKERMAP_PROFILING");
+
+  std::vector<bool> is_version_seen(s_versions.size(), false);
+  std::size_t failure_count = 0;
+  for (const auto& file : files)
+  {
+    const Map::ScanFlavor file_flavor = file.first;
+    const std::filesystem::path& path = file.second;
+    Mijo::MappedFile mapped_file;
+    if (!mapped_file.Open(path))
+    {
+      fmt::println(std::cerr, "{:s}   could not open", path.string());
+      failure_count += 1;
+      continue;
+    }
+    const std::span<const char> span = mapped_file.GetSpan();
+
+    Map map{options};
+    std::size_t line_count = 0;
+    Map::ScanError error = Map::ScanError::None;
+    const StageResult scan_result = RunStage(repetition_count, [&] {
+      map = Map{options};
+      switch (file_flavor)
+      {
+      case Map::ScanFlavor::Normal:
+        error = map.Scan(span, line_count);
+        break;
+      case Map::ScanFlavor::TLOZTP:
+        error = map.ScanTLOZTP(span, line_count);
+        break;
+      case Map::ScanFlavor::SMGalaxy:
+        error = map.ScanSMGalaxy(span, line_count);
+        break;
+      }
+    });
+    if (error != Map::ScanError::None)
+    {
+      fmt::println(std::cerr, "{:s}   line: {:d}   err: {:d}", path.string(), line_count,
+                   static_cast<int>(error));
+      failure_count += 1;
+      continue;
+    }
+
+    const MWLinker::Version min_version = map.GetMinVersion(),
+                            max_version = map.GetMaxVersion();
+    for (std::size_t i = 0; i < s_versions.size(); ++i)
+      if (min_version <= s_versions[i].first && s_versions[i].first <= max_version)
+        is_version_seen[i] = true;
+    fmt::println(std::cout, "{:s}   {:d} bytes   {:d} lines   versions: {:s} to {:s}",
+                 path.string(), span.size(), line_count, ToName(min_version),
+                 ToName(max_version));
+    fmt::println(std::cout, "  {:<14s} {:>10s} {:>10s} {:>10s} {:>12s} {:>10s}", "stage",
+                 "best ms", "mean ms", "MB/s", "allocs/line", "alloc MB");
+    PrintStage("scan", scan_result, repetition_count, span.size(), line_count);
+    if (is_profile_printed)
+      map.GetScanProfile().PrintJson(std::cout);
+
+    const StageResult print_result = RunStage(repetition_count, [&] {
+      std::string string;
+      std::size_t line_number = 0;
+      map.Print(string, line_number);
+    });
+    PrintStage("print", print_result, repetition_count, span.size(), line_count);
+
+    // Every address and name in the section layouts is looked up, as a report going over the
+    // whole map would.
+    std::vector<MWLinker::Elf32_Addr> addresses;
+    std::vector<std::string_view> names;
+    for (const Map::SectionLayout& section_layout : map.GetSectionLayouts())
+    {
+      for (const Map::SectionLayout::Unit& unit : section_layout.GetUnits())
+      {
+        if (unit.m_unit_kind == Map::SectionLayout::Unit::Kind::Unused)
+          continue;
+        addresses.push_back(unit.m_virtual_address);
+        if (!unit.m_name.empty())
+          names.push_back(unit.m_name);
+      }
+    }
+
+    std::optional<Map::AddressIndex> address_index;
+    const StageResult address_index_result =
+        RunStage(repetition_count, [&] { address_index.emplace(map); });
+    PrintStage("address index", address_index_result, repetition_count, span.size(), line_count);
+    std::vector<Map::AddressIndex::Match> matches(addresses.size());
+    const StageResult address_find_result =
+        RunStage(repetition_count, [&] { address_index->Find(addresses, matches); });
+    PrintStage("address find", address_find_result, repetition_count, span.size(), line_count);
+
+    std::optional<Map::SymbolIndex> symbol_index;
+    const StageResult symbol_index_result =
+        RunStage(repetition_count, [&] { symbol_index.emplace(map); });
+    PrintStage("symbol index", symbol_index_result, repetition_count, span.size(), line_count);
+    std::size_t occurrence_count = 0;
+    const StageResult symbol_find_result = RunStage(repetition_count, [&] {
+      occurrence_count = 0;
+      for (const std::string_view name : names)
+        occurrence_count += symbol_index->Find(name).size();
+    });
+    PrintStage("symbol find", symbol_find_result, repetition_count, span.size(), line_count);
+    fmt::println(std::cout, "  {:d} addresses and {:d} names looked up, {:d} occurrences found",
+                 addresses.size(), names.size(), occurrence_count);
+
+    // Against itself, every symbol is matched, which is the most work a diff of this map can be.
+    std::optional<Map::Diff> diff;
+    const StageResult diff_result =
+        RunStage(repetition_count, [&] { diff.emplace(map, map, options.m_thread_count); });
+    PrintStage("diff", diff_result, repetition_count, span.size(), line_count);
+
+    // A fresh Demangler each time, or else only the first would demangle anything.
+    std::size_t demangled_count = 0;
+    const StageResult demangle_result = RunStage(repetition_count, [&] {
+      MWLinker::Demangler demangler{Map::StringStorage::Borrowed};
+      demangler.DemangleAll(map, options.m_thread_count);
+      demangled_count = demangler.GetCachedCount();
+    });
+    PrintStage("demangle", demangle_result, repetition_count, span.size(), line_count);
+    fmt::println(std::cout, "  {:d} distinct names demangled", demangled_count);
+  }
+
+  std::string unseen_versions;
+  for (std::size_t i = 0; i < s_versions.size(); ++i)
+    if (!is_version_seen[i])
+      unseen_versions += fmt::format("{:s}{:s}", unseen_versions.empty() ? "" : ", ",
+                                     s_versions[i].second);
+  fmt::println(std::cout, "files: {:d}   failed: {:d}   versions not covered: {:s}", files.size(),
+               failure_count, unseen_versions.empty() ? "none" : unseen_versions);
+
+  return failure_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#include "FileUtil.h"
+
+#include <cstddef>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Mijo
+{
+// Empty files are given a valid pointer to nothing, as zero-length mappings are not allowed.
+static constexpr char empty_file[1] = {};
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+  Close();
+  const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    CloseHandle(file);
+    return false;
+  }
+  if (size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    m_data = empty_file;
+    return true;
+  }
+  // The view keeps the file mapping object alive, and the file mapping object keeps the file open.
+  const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr)
+    return false;
+  const void* const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == nullptr)
+    return false;
+  m_data = static_cast<const char*>(view);
+  m_size = static_cast<std::size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() noexcept
+{
+  if (m_size != 0)
+    UnmapViewOfFile(m_data);
+  m_data = nullptr;
+  m_size = 0;
+}
+#else
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+  {
+    close(fd);
+    return false;
+  }
+  if (st.st_size == 0)
+  {
+    close(fd);
+    m_data = empty_file;
+    return true;
+  }
+  // The mapping stays valid after the file descriptor is closed.
+  void* const view = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE,
+                          fd, 0);
+  close(fd);
+  if (view == MAP_FAILED)
+    return false;
+  // Scanning reads from front to back exactly once.
+  madvise(view, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+  m_data = static_cast<const char*>(view);
+  m_size = static_cast<std::size_t>(st.st_size);
+  return true;
+}
+
+void MappedFile::Close() noexcept
+{
+  if (m_size != 0)
+    munmap(const_cast<char*>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+#endif
+}  // namespace Mijo
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+namespace Mijo
+{
+// A read-only view of an entire file, memory-mapped so that its contents are never copied.
+class MappedFile
+{
+public:
+  MappedFile() noexcept = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&& other) noexcept
+  {
+    if (this != &other)
+    {
+      Close();
+      m_data = std::exchange(other.m_data, nullptr);
+      m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+  }
+  ~MappedFile() { Close(); }
+
+  // Empty files can be opened too, though there is nothing to map for them.
+  bool Open(const std::filesystem::path& path);
+  void Close() noexcept;
+
+  bool IsOpen() const noexcept { return m_data != nullptr; }
+  const char* GetData() const noexcept { return m_data; }
+  std::size_t GetSize() const noexcept { return m_size; }
+  std::span<const char> GetSpan() const noexcept { return {m_data, m_size}; }
+
+private:
+  const char* m_data = nullptr;
+  std::size_t m_size = 0;
+};
+}  // namespace Mijo
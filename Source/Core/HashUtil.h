@@ -0,0 +1,512 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Mijo
+{
+// Reads are in little-endian order, which is the byte order of most hosts anyway.
+constexpr std::uint64_t ReadLittleEndian64(const char* const data) noexcept
+{
+  std::uint64_t value = 0;
+  if (!std::is_constant_evaluated() && std::endian::native == std::endian::little)
+  {
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  for (std::size_t i = 0; i < 8; ++i)
+    value |= std::uint64_t{static_cast<std::uint8_t>(data[i])} << (i * 8);
+  return value;
+}
+constexpr std::uint32_t ReadLittleEndian32(const char* const data) noexcept
+{
+  std::uint32_t value = 0;
+  if (!std::is_constant_evaluated() && std::endian::native == std::endian::little)
+  {
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  for (std::size_t i = 0; i < 4; ++i)
+    value |= std::uint32_t{static_cast<std::uint8_t>(data[i])} << (i * 8);
+  return value;
+}
+
+// XXH64 by Yann Collet, which hashes at a good fraction of memory bandwidth. Results match those of
+// the reference implementation regardless of the host's byte order.
+class XXH64
+{
+public:
+  static constexpr std::uint64_t Hash(const std::span<const char> span,
+                                      const std::uint64_t seed = 0) noexcept
+  {
+    const char* head = span.data();
+    const char* const tail = head + span.size();
+    std::uint64_t hash;
+
+    if (span.size() >= 32)
+    {
+      std::uint64_t v1 = seed + prime_1 + prime_2, v2 = seed + prime_2, v3 = seed,
+                    v4 = seed - prime_1;
+      for (; tail - head >= 32; head += 32)
+      {
+        v1 = Round(v1, ReadLittleEndian64(head));
+        v2 = Round(v2, ReadLittleEndian64(head + 8));
+        v3 = Round(v3, ReadLittleEndian64(head + 16));
+        v4 = Round(v4, ReadLittleEndian64(head + 24));
+      }
+      hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+      hash = MergeRound(hash, v1);
+      hash = MergeRound(hash, v2);
+      hash = MergeRound(hash, v3);
+      hash = MergeRound(hash, v4);
+    }
+    else
+    {
+      hash = seed + prime_5;
+    }
+    hash += span.size();
+
+    for (; tail - head >= 8; head += 8)
+      hash = std::rotl(hash ^ Round(0, ReadLittleEndian64(head)), 27) * prime_1 + prime_4;
+    if (tail - head >= 4)
+    {
+      hash = std::rotl(hash ^ ReadLittleEndian32(head) * prime_1, 23) * prime_2 + prime_3;
+      head += 4;
+    }
+    for (; head != tail; ++head)
+      hash = std::rotl(hash ^ static_cast<std::uint8_t>(*head) * prime_5, 11) * prime_1;
+
+    hash ^= hash >> 33;
+    hash *= prime_2;
+    hash ^= hash >> 29;
+    hash *= prime_3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+
+private:
+  static constexpr std::uint64_t prime_1 = 0x9E3779B185EBCA87;
+  static constexpr std::uint64_t prime_2 = 0xC2B2AE3D27D4EB4F;
+  static constexpr std::uint64_t prime_3 = 0x165667B19E3779F9;
+  static constexpr std::uint64_t prime_4 = 0x85EBCA77C2B2AE63;
+  static constexpr std::uint64_t prime_5 = 0x27D4EB2F165667C5;
+
+  static constexpr std::uint64_t Round(std::uint64_t acc, const std::uint64_t input) noexcept
+  {
+    acc += input * prime_2;
+    return std::rotl(acc, 31) * prime_1;
+  }
+  static constexpr std::uint64_t MergeRound(const std::uint64_t acc,
+                                            const std::uint64_t val) noexcept
+  {
+    return (acc ^ Round(0, val)) * prime_1 + prime_4;
+  }
+};
+
+// Hashes whose every bit is as good as any other, as FlatHashTable makes use of both the low and
+// the high ones. Strings go through XXH64, and everything else through std::hash and a final mix.
+template <class Key>
+struct FlatHash
+{
+  std::uint64_t operator()(const Key& key) const noexcept
+  {
+    std::uint64_t hash = std::hash<Key>{}(key);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCD;
+    hash ^= hash >> 33;
+    return hash;
+  }
+};
+template <>
+struct FlatHash<std::string_view>
+{
+  std::uint64_t operator()(const std::string_view key) const noexcept { return XXH64::Hash(key); }
+};
+
+// A hash table in the style of Abseil's Swiss tables, only simpler, as nothing is ever erased from
+// it. Each slot has a control byte holding seven bits of the hash of its key, and the control bytes
+// of eight slots are checked at once, so keys are seldom compared for nothing. The entries are kept
+// apart from the slots, one after another in the order they were added, so iterating over them is
+// as quick as iterating over a std::vector. Unlike with std::unordered_map, adding an entry may
+// move every other one elsewhere in memory.
+// Multi tables allow more than one entry per key. Only the first entry of each key takes up a slot,
+// and the rest are linked behind it in the order they were added.
+template <class Key, class Value, bool IsMulti, class Hash = FlatHash<Key>,
+          class KeyEqual = std::equal_to<Key>>
+class FlatHashTable
+{
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<const Key, Value>;
+  using size_type = std::size_t;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  // Walks the entries of a single key.
+  template <bool IsConst>
+  class EqualIterator
+  {
+    using Table = std::conditional_t<IsConst, const FlatHashTable, FlatHashTable>;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FlatHashTable::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+    using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+
+    EqualIterator() = default;
+    explicit EqualIterator(Table& table, const std::uint32_t index) noexcept
+        : m_table(&table), m_index(index)
+    {
+    }
+
+    reference operator*() const noexcept { return m_table->m_entries[m_index]; }
+    pointer operator->() const noexcept { return &m_table->m_entries[m_index]; }
+    EqualIterator& operator++() noexcept
+    {
+      m_index = IsMulti ? m_table->m_next_equal[m_index] : no_entry;
+      return *this;
+    }
+    EqualIterator operator++(int) noexcept
+    {
+      const EqualIterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const EqualIterator& other) const noexcept { return m_index == other.m_index; }
+
+  private:
+    Table* m_table = nullptr;
+    std::uint32_t m_index = no_entry;
+  };
+  using equal_iterator = EqualIterator<false>;
+  using const_equal_iterator = EqualIterator<true>;
+
+  FlatHashTable() = default;
+
+  iterator begin() noexcept { return m_entries.begin(); }
+  iterator end() noexcept { return m_entries.end(); }
+  const_iterator begin() const noexcept { return m_entries.begin(); }
+  const_iterator end() const noexcept { return m_entries.end(); }
+  bool empty() const noexcept { return m_entries.empty(); }
+  size_type size() const noexcept { return m_entries.size(); }
+
+  void clear() noexcept
+  {
+    m_entries.clear();
+    m_next_equal.clear();
+    m_control.clear();
+    m_slots.clear();
+    m_slots_used = 0;
+  }
+  // Makes room for this many entries in all, so none of them have to move until there are more.
+  void reserve(const size_type count)
+  {
+    m_entries.reserve(count);
+    if constexpr (IsMulti)
+      m_next_equal.reserve(count);
+    if (count * max_load_denominator > m_control.size() * max_load_numerator)
+      Rehash(GetSlotCountFor(count));
+  }
+
+  iterator find(const Key& key) noexcept
+  {
+    const std::uint32_t index = FindIndex(key, m_hash(key));
+    return index == no_entry ? end() : begin() + index;
+  }
+  const_iterator find(const Key& key) const noexcept
+  {
+    const std::uint32_t index = FindIndex(key, m_hash(key));
+    return index == no_entry ? end() : begin() + index;
+  }
+  bool contains(const Key& key) const noexcept { return FindIndex(key, m_hash(key)) != no_entry; }
+  std::pair<equal_iterator, equal_iterator> equal_range(const Key& key) noexcept
+  {
+    return {equal_iterator{*this, FindIndex(key, m_hash(key))}, equal_iterator{*this, no_entry}};
+  }
+  std::pair<const_equal_iterator, const_equal_iterator> equal_range(const Key& key) const noexcept
+  {
+    return {const_equal_iterator{*this, FindIndex(key, m_hash(key))},
+            const_equal_iterator{*this, no_entry}};
+  }
+
+  // Adds an entry unless the key already has one, in which case that entry is given back instead.
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    requires(!IsMulti)
+  {
+    const std::uint64_t hash = m_hash(key);
+    if (const std::uint32_t index = FindIndex(key, hash); index != no_entry)
+      return {begin() + index, false};
+    return {begin() + AddFirstEntry(hash, key, std::forward<Args>(args)...), true};
+  }
+  Value& operator[](const Key& key)
+    requires(!IsMulti)
+  {
+    return try_emplace(key).first->second;
+  }
+  Value& at(const Key& key)
+    requires(!IsMulti)
+  {
+    const iterator iter = find(key);
+    if (iter == end())
+      throw std::out_of_range("FlatHashTable::at");
+    return iter->second;
+  }
+  const Value& at(const Key& key) const
+    requires(!IsMulti)
+  {
+    const const_iterator iter = find(key);
+    if (iter == end())
+      throw std::out_of_range("FlatHashTable::at");
+    return iter->second;
+  }
+  // Same as try_emplace for tables that are not multi tables. Multi tables always add an entry.
+  template <class... Args>
+  auto emplace(const Key& key, Args&&... args)
+  {
+    if constexpr (IsMulti)
+    {
+      const std::uint64_t hash = m_hash(key);
+      std::uint32_t index = FindIndex(key, hash);
+      if (index == no_entry)
+        return begin() + AddFirstEntry(hash, key, std::forward<Args>(args)...);
+      while (m_next_equal[index] != no_entry)
+        index = m_next_equal[index];
+      m_next_equal[index] = AddEntry(key, std::forward<Args>(args)...);
+      return begin() + m_next_equal[index];
+    }
+    else
+    {
+      return try_emplace(key, std::forward<Args>(args)...);
+    }
+  }
+  // Moves every entry of another multi table into this one, leaving the other one empty.
+  void merge(FlatHashTable& other)
+    requires IsMulti
+  {
+    reserve(size() + other.size());
+    for (auto& [key, value] : other.m_entries)
+      emplace(key, std::move(value));
+    other.clear();
+  }
+
+private:
+  static constexpr std::uint32_t no_entry = static_cast<std::uint32_t>(-1);
+  static constexpr std::size_t group_size = 8;
+  static constexpr std::uint8_t empty_control = 0x80;
+  static constexpr std::uint64_t control_lsbs = 0x0101010101010101;
+  static constexpr std::uint64_t control_msbs = 0x8080808080808080;
+  // Slots are never more than 7/8 full.
+  static constexpr std::size_t max_load_numerator = 7;
+  static constexpr std::size_t max_load_denominator = 8;
+
+  static constexpr std::size_t GetSlotCountFor(const std::size_t count) noexcept
+  {
+    const std::size_t min_slot_count =
+        (count * max_load_denominator + max_load_numerator - 1) / max_load_numerator;
+    return std::bit_ceil(std::max(group_size, min_slot_count));
+  }
+  // The low seven bits of a hash go in the control byte, and the rest choose the probe sequence.
+  static constexpr std::uint8_t GetControl(const std::uint64_t hash) noexcept
+  {
+    return static_cast<std::uint8_t>(hash & 0x7F);
+  }
+  std::uint64_t LoadGroup(const std::size_t group) const noexcept
+  {
+    return ReadLittleEndian64(reinterpret_cast<const char*>(m_control.data() + group * group_size));
+  }
+  // One bit is set in the most significant bit of each matching byte, though a byte that follows
+  // a true match can match falsely. It is only ever one that belongs to some other key, though.
+  static constexpr std::uint64_t MatchControl(const std::uint64_t group,
+                                              const std::uint8_t control) noexcept
+  {
+    const std::uint64_t bytes = group ^ (control_lsbs * control);
+    return (bytes - control_lsbs) & ~bytes & control_msbs;
+  }
+  static constexpr std::uint64_t MatchEmpty(const std::uint64_t group) noexcept
+  {
+    return group & control_msbs;
+  }
+
+  template <class Func>
+  void Probe(const std::uint64_t hash, Func&& func) const
+  {
+    const std::size_t group_mask = m_control.size() / group_size - 1;
+    std::size_t group = static_cast<std::size_t>(hash >> 7) & group_mask;
+    // Triangular steps visit every group once the group count is a power of two.
+    for (std::size_t step = 1; !func(group, LoadGroup(group)); ++step)
+      group = (group + step) & group_mask;
+  }
+  std::uint32_t FindIndex(const Key& key, const std::uint64_t hash) const noexcept
+  {
+    std::uint32_t found = no_entry;
+    if (m_control.empty())
+      return found;
+    const std::uint8_t control = GetControl(hash);
+    Probe(hash, [&](const std::size_t group, const std::uint64_t bytes) {
+      for (std::uint64_t matches = MatchControl(bytes, control); matches != 0;
+           matches &= matches - 1)
+      {
+        const std::uint32_t index =
+            m_slots[group * group_size + static_cast<std::size_t>(std::countr_zero(matches)) / 8];
+        if (m_key_equal(m_entries[index].first, key))
+        {
+          found = index;
+          return true;
+        }
+      }
+      return MatchEmpty(bytes) != 0;
+    });
+    return found;
+  }
+  void Place(const std::uint64_t hash, const std::uint32_t index) noexcept
+  {
+    Probe(hash, [&](const std::size_t group, const std::uint64_t bytes) {
+      const std::uint64_t empties = MatchEmpty(bytes);
+      if (empties == 0)
+        return false;
+      const std::size_t slot =
+          group * group_size + static_cast<std::size_t>(std::countr_zero(empties)) / 8;
+      m_control[slot] = GetControl(hash);
+      m_slots[slot] = index;
+      return true;
+    });
+    ++m_slots_used;
+  }
+  void Rehash(const std::size_t slot_count)
+  {
+    m_control.assign(slot_count, empty_control);
+    m_slots.assign(slot_count, no_entry);
+    m_slots_used = 0;
+    // Only the first entry of each key goes in a slot, and it is always the earliest of them.
+    std::vector<bool> is_linked;
+    if constexpr (IsMulti)
+    {
+      is_linked.resize(m_entries.size());
+      for (const std::uint32_t next : m_next_equal)
+        if (next != no_entry)
+          is_linked[next] = true;
+    }
+    for (std::uint32_t index = 0; index < m_entries.size(); ++index)
+      if (!IsMulti || !is_linked[index])
+        Place(m_hash(m_entries[index].first), index);
+  }
+  template <class... Args>
+  std::uint32_t AddEntry(const Key& key, Args&&... args)
+  {
+    assert(m_entries.size() < no_entry);
+    m_entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+    if constexpr (IsMulti)
+      m_next_equal.push_back(no_entry);
+    return static_cast<std::uint32_t>(m_entries.size() - 1);
+  }
+  template <class... Args>
+  std::uint32_t AddFirstEntry(const std::uint64_t hash, const Key& key, Args&&... args)
+  {
+    // Growing first, as Rehash places every entry there already is, so the new one is placed once.
+    if ((m_slots_used + 1) * max_load_denominator > m_control.size() * max_load_numerator)
+      Rehash(GetSlotCountFor(m_slots_used + 1) * 2);
+    const std::uint32_t index = AddEntry(key, std::forward<Args>(args)...);
+    Place(hash, index);
+    // Each slot holds the first entry of a different key.
+    assert(m_slots_used <= m_entries.size());
+    return index;
+  }
+
+  std::vector<value_type> m_entries;
+  // For multi tables, the next entry with the same key as each one.
+  std::vector<std::uint32_t> m_next_equal;
+  std::vector<std::uint8_t> m_control;
+  // Which entry each slot holds.
+  std::vector<std::uint32_t> m_slots;
+  std::size_t m_slots_used = 0;
+  [[no_unique_address]] Hash m_hash;
+  [[no_unique_address]] KeyEqual m_key_equal;
+};
+
+template <class Key, class Value, class Hash = FlatHash<Key>, class KeyEqual = std::equal_to<Key>>
+using FlatHashMap = FlatHashTable<Key, Value, false, Hash, KeyEqual>;
+template <class Key, class Value, class Hash = FlatHash<Key>, class KeyEqual = std::equal_to<Key>>
+using FlatHashMultiMap = FlatHashTable<Key, Value, true, Hash, KeyEqual>;
+
+// A table of keywords known at compile time, laid out so that each one has a slot to itself.
+// Finding a keyword takes a single hash and a single comparison, with no probing at all.
+template <class Value, std::size_t KeyCount>
+class PerfectHashMap
+{
+public:
+  consteval explicit PerfectHashMap(
+      const std::pair<std::string_view, Value> (&entries)[KeyCount])
+  {
+    // A seed that sends every keyword to a different slot is bound to turn up early on with as
+    // many slots as there are, though the compiler gives up if none does.
+    for (m_seed = 0;; ++m_seed)
+    {
+      std::array<bool, slot_count> is_used{};
+      const bool is_perfect = std::ranges::all_of(entries, [&](const auto& entry) {
+        return !std::exchange(is_used[Hash(entry.first, m_seed) % slot_count], true);
+      });
+      if (is_perfect)
+        break;
+    }
+    for (const auto& [key, value] : entries)
+    {
+      const std::size_t slot = Hash(key, m_seed) % slot_count;
+      m_keys[slot] = key;
+      m_values[slot] = value;
+      m_is_used[slot] = true;
+    }
+  }
+
+  constexpr const Value* Find(const std::string_view key) const noexcept
+  {
+    const std::size_t slot = Hash(key, m_seed) % slot_count;
+    return m_is_used[slot] && m_keys[slot] == key ? &m_values[slot] : nullptr;
+  }
+
+private:
+  static constexpr std::size_t slot_count = std::bit_ceil(KeyCount * 4);
+
+  // FNV-1a, which is plenty for a handful of short keywords.
+  static constexpr std::uint32_t Hash(const std::string_view key, const std::uint32_t seed) noexcept
+  {
+    std::uint32_t hash = 0x811C9DC5 ^ seed;
+    for (const char c : key)
+      hash = (hash ^ static_cast<std::uint8_t>(c)) * 0x01000193;
+    return hash ^ (hash >> 15);
+  }
+
+  std::uint32_t m_seed = 0;
+  std::array<std::string_view, slot_count> m_keys{};
+  std::array<Value, slot_count> m_values{};
+  std::array<bool, slot_count> m_is_used{};
+};
+
+// The type of the values has to be given, but the number of keywords can be left to the compiler.
+template <class Value, std::size_t KeyCount>
+consteval PerfectHashMap<Value, KeyCount>
+MakePerfectHashMap(const std::pair<std::string_view, Value> (&entries)[KeyCount])
+{
+  return PerfectHashMap<Value, KeyCount>{entries};
+}
+}  // namespace Mijo
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace Mijo
+{
+// Which of 64 bytes are line feeds and which are carriage returns, one bit per byte.
+struct LineBreakMasks
+{
+  std::uint64_t m_line_feeds;
+  std::uint64_t m_carriage_returns;
+};
+
+inline LineBreakMasks FindLineBreaks64(const char* const chunk) noexcept
+{
+#if defined(__AVX2__)
+  const __m256i line_feed = _mm256_set1_epi8('\n');
+  const __m256i carriage_return = _mm256_set1_epi8('\r');
+  const auto to_mask = [](const __m256i matches) noexcept {
+    return std::uint64_t{static_cast<std::uint32_t>(_mm256_movemask_epi8(matches))};
+  };
+  LineBreakMasks masks{0, 0};
+  for (int i = 0; i < 64; i += 32)
+  {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk + i));
+    masks.m_line_feeds |= to_mask(_mm256_cmpeq_epi8(bytes, line_feed)) << i;
+    masks.m_carriage_returns |= to_mask(_mm256_cmpeq_epi8(bytes, carriage_return)) << i;
+  }
+  return masks;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  const __m128i line_feed = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  const auto to_mask = [](const __m128i matches) noexcept {
+    return std::uint64_t{static_cast<std::uint32_t>(_mm_movemask_epi8(matches))};
+  };
+  LineBreakMasks masks{0, 0};
+  for (int i = 0; i < 64; i += 16)
+  {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk + i));
+    masks.m_line_feeds |= to_mask(_mm_cmpeq_epi8(bytes, line_feed)) << i;
+    masks.m_carriage_returns |= to_mask(_mm_cmpeq_epi8(bytes, carriage_return)) << i;
+  }
+  return masks;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  // NEON has no movemask, so each byte that matched is given the weight of its bit, then adjacent
+  // bytes are summed together until each of the 64 bits has found its place.
+  const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t bytes[4] = {
+      vld1q_u8(reinterpret_cast<const std::uint8_t*>(chunk)),
+      vld1q_u8(reinterpret_cast<const std::uint8_t*>(chunk + 16)),
+      vld1q_u8(reinterpret_cast<const std::uint8_t*>(chunk + 32)),
+      vld1q_u8(reinterpret_cast<const std::uint8_t*>(chunk + 48)),
+  };
+  const auto to_mask = [&](const std::uint8_t c) noexcept {
+    const uint8x16_t match = vdupq_n_u8(c);
+    const uint8x16_t sum_0 = vpaddq_u8(vandq_u8(vceqq_u8(bytes[0], match), weights),
+                                       vandq_u8(vceqq_u8(bytes[1], match), weights));
+    const uint8x16_t sum_1 = vpaddq_u8(vandq_u8(vceqq_u8(bytes[2], match), weights),
+                                       vandq_u8(vceqq_u8(bytes[3], match), weights));
+    const uint8x16_t sum_2 = vpaddq_u8(sum_0, sum_1);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(vpaddq_u8(sum_2, sum_2)), 0);
+  };
+  return {to_mask('\n'), to_mask('\r')};
+#else
+  LineBreakMasks masks{0, 0};
+  for (int i = 0; i < 64; ++i)
+  {
+    masks.m_line_feeds |= std::uint64_t{chunk[i] == '\n'} << i;
+    masks.m_carriage_returns |= std::uint64_t{chunk[i] == '\r'} << i;
+  }
+  return masks;
+#endif
+}
+
+// Where the lines of a text are, found in one sweep over it. Line feeds are counted a block at a
+// time, so the line any position is on can be told without looking through more than one block of
+// text. Every empty line is kept, as that is where each portion of a linker map after the first
+// begins. The text must outlive the index.
+class LineIndex
+{
+public:
+  static constexpr std::size_t chunk_size = 64;
+  static constexpr std::size_t block_size = 16 * chunk_size;
+
+  LineIndex(const char* const head, const char* const tail) : m_head(head), m_tail(tail)
+  {
+    m_block_line_feed_counts.reserve(static_cast<std::size_t>(tail - head) / block_size + 1);
+    // What is carried over from the last byte of the previous chunk. The beginning of the text
+    // counts as coming right after a line feed.
+    std::uint64_t line_feed_before = 1, carriage_return_before = 0, line_start_before = 0;
+    for (const char* chunk = head; chunk < tail; chunk += chunk_size)
+    {
+      if (static_cast<std::size_t>(chunk - head) % block_size == 0)
+        m_block_line_feed_counts.push_back(m_line_feed_count);
+      const auto [line_feeds, carriage_returns] = Load(chunk);
+      const std::uint64_t line_starts = (line_feeds << 1) | line_feed_before;
+      const std::uint64_t after_carriage_returns = (carriage_returns << 1) | carriage_return_before;
+      const std::uint64_t after_line_starts = (line_starts << 1) | line_start_before;
+      // A line is empty if its line feed either begins it or comes after a carriage return that
+      // begins it.
+      for (std::uint64_t empty_line_ends =
+               line_feeds & (line_starts | (after_carriage_returns & after_line_starts));
+           empty_line_ends != 0; empty_line_ends &= empty_line_ends - 1)
+      {
+        const int i = std::countr_zero(empty_line_ends);
+        m_empty_lines.push_back(chunk + (((line_starts >> i) & 1) != 0 ? i : i - 1));
+      }
+      m_line_feed_count += static_cast<std::size_t>(std::popcount(line_feeds));
+      line_feed_before = line_feeds >> 63;
+      carriage_return_before = carriage_returns >> 63;
+      line_start_before = line_starts >> 63;
+    }
+  }
+
+  // How many line feeds come before a position within the text, or at its end.
+  std::size_t CountLineFeeds(const char* const pos) const noexcept
+  {
+    const std::size_t offset = static_cast<std::size_t>(pos - m_head);
+    const std::size_t block = offset / block_size;
+    if (block == m_block_line_feed_counts.size())
+      return m_line_feed_count;
+    std::size_t count = m_block_line_feed_counts[block];
+    const char* chunk = m_head + block * block_size;
+    for (; pos - chunk >= static_cast<std::ptrdiff_t>(chunk_size); chunk += chunk_size)
+      count += static_cast<std::size_t>(std::popcount(Load(chunk).m_line_feeds));
+    if (const std::ptrdiff_t rest = pos - chunk; rest != 0)
+    {
+      const std::uint64_t before = (std::uint64_t{1} << rest) - 1;
+      count += static_cast<std::size_t>(std::popcount(Load(chunk).m_line_feeds & before));
+    }
+    return count;
+  }
+  std::size_t CountLineFeeds(const char* const head, const char* const tail) const noexcept
+  {
+    return CountLineFeeds(tail) - CountLineFeeds(head);
+  }
+  // Finds the first empty line that begins at or after a position within the text. If there is
+  // none, this is the end of the text.
+  const char* FindEmptyLine(const char* const pos) const noexcept
+  {
+    const auto iter = std::ranges::lower_bound(m_empty_lines, pos);
+    return iter != m_empty_lines.end() ? *iter : m_tail;
+  }
+
+  const std::vector<const char*>& GetEmptyLines() const noexcept { return m_empty_lines; }
+  std::size_t GetLineFeedCount() const noexcept { return m_line_feed_count; }
+
+private:
+  // Past the end of the text, reads as if there were nothing but null bytes.
+  LineBreakMasks Load(const char* const chunk) const noexcept
+  {
+    if (m_tail - chunk >= static_cast<std::ptrdiff_t>(chunk_size))
+      return FindLineBreaks64(chunk);
+    char padded[chunk_size]{};
+    std::copy(chunk, m_tail, padded);
+    return FindLineBreaks64(padded);
+  }
+
+  const char* m_head;
+  const char* m_tail;
+  std::size_t m_line_feed_count = 0;
+  // How many line feeds come before each block.
+  std::vector<std::size_t> m_block_line_feed_counts;
+  std::vector<const char*> m_empty_lines;
+};
+}  // namespace Mijo
@@ -0,0 +1,540 @@
+// Copyright 2023 Bradley G. (Minty Meeo)
+// SPDX-License-Identifier: MIT
+
+#include "MWDemangler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ThreadUtil.h"
+
+namespace MWLinker
+{
+// Every function here takes what it understands off the front of the text it is given. Any of them
+// returning false means the name is not what it seemed, so the whole name is left as it was.
+
+// How a type reads, which decides where the text of anything built on top of it goes. Functions
+// and arrays need parentheses around a declarator, where nothing else does.
+enum class TypeForm
+{
+  Plain,
+  Declarator,
+  Compound,
+};
+
+// The text of a type is split in two, with the declarator (were there one) going between.
+struct DemangledType
+{
+  std::string m_pre;
+  std::string m_post;
+  TypeForm m_form = TypeForm::Plain;
+};
+
+static bool DemangleType(std::string_view& str, DemangledType& type);
+
+static constexpr bool IsDigit(const char c) noexcept
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool DemangleCount(std::string_view& str, std::size_t& count)
+{
+  if (str.empty() || !IsDigit(str.front()))
+    return false;
+  count = 0;
+  while (!str.empty() && IsDigit(str.front()))
+  {
+    if (count > str.size())
+      return false;
+    count = count * 10 + static_cast<std::size_t>(str.front() - '0');
+    str.remove_prefix(1);
+  }
+  return true;
+}
+
+// Template arguments are written into the names they belong to, each mangled like any other type,
+// save for values, which are written out as they are.
+static bool DemangleTemplateArgs(const std::string_view name, std::string& out)
+{
+  const std::size_t open_pos = name.find('<');
+  if (open_pos == std::string_view::npos)
+  {
+    out += name;
+    return true;
+  }
+  if (open_pos == 0 || !name.ends_with('>'))
+    return false;
+  out += name.substr(0, open_pos + 1);
+  const std::string_view args = name.substr(open_pos + 1, name.size() - open_pos - 2);
+  std::size_t depth = 0;
+  std::size_t arg_begin = 0;
+  for (std::size_t i = 0; i <= args.size(); ++i)
+  {
+    if (i < args.size())
+    {
+      if (args[i] == '<')
+        ++depth;
+      else if (args[i] == '>' && depth > 0)
+        --depth;
+      if (args[i] != ',' || depth != 0)
+        continue;
+    }
+    const std::string_view arg = args.substr(arg_begin, i - arg_begin);
+    std::string_view rest = arg;
+    DemangledType type;
+    if (arg_begin != 0)
+      out += ", ";
+    if (DemangleType(rest, type) && rest.empty())
+      out.append(type.m_pre).append(type.m_post);
+    else
+      out += arg;
+    arg_begin = i + 1;
+  }
+  out += '>';
+  return true;
+}
+
+// "3Foo" or "Q23foo3Bar", giving "Foo" or "foo::Bar". The name of the innermost class, without its
+// template arguments, is what constructors and destructors are named after.
+static bool DemangleQualifiedName(std::string_view& str, std::string& out,
+                                  std::string_view* const class_name = nullptr)
+{
+  std::size_t part_count = 1;
+  if (str.starts_with('Q'))
+  {
+    if (str.size() < 2 || !IsDigit(str[1]))
+      return false;
+    part_count = static_cast<std::size_t>(str[1] - '0');
+    str.remove_prefix(2);
+    if (part_count == 0)
+      return false;
+  }
+  for (std::size_t i = 0; i < part_count; ++i)
+  {
+    std::size_t length;
+    if (!DemangleCount(str, length) || length == 0 || length > str.size())
+      return false;
+    const std::string_view part = str.substr(0, length);
+    str.remove_prefix(length);
+    if (i != 0)
+      out += "::";
+    if (!DemangleTemplateArgs(part, out))
+      return false;
+    if (class_name != nullptr)
+      *class_name = part.substr(0, part.find('<'));
+  }
+  return true;
+}
+
+// Parameters go on until the text ends or a function type's return type begins. A lone void means
+// there are none.
+static bool DemangleParameters(std::string_view& str, std::string& out)
+{
+  const std::size_t out_size = out.size();
+  while (!str.empty() && !str.starts_with('_'))
+  {
+    DemangledType type;
+    if (!DemangleType(str, type))
+      return false;
+    if (out.size() != out_size)
+      out += ", ";
+    out.append(type.m_pre).append(type.m_post);
+  }
+  if (out.size() == out_size)
+    return false;
+  if (std::string_view{out}.substr(out_size) == "void")
+    out.resize(out_size);
+  return true;
+}
+
+static constexpr std::array<std::pair<char, std::string_view>, 12> s_builtin_types{{
+    {'v', "void"},
+    {'b', "bool"},
+    {'c', "char"},
+    {'s', "short"},
+    {'i', "int"},
+    {'l', "long"},
+    {'x', "long long"},
+    {'f', "float"},
+    {'d', "double"},
+    {'r', "long double"},
+    {'w', "wchar_t"},
+    {'e', "..."},
+}};
+
+static bool DemangleBuiltinType(std::string_view& str, std::string& out)
+{
+  if (str.empty())
+    return false;
+  const auto iter = std::ranges::find(s_builtin_types, str.front(),
+                                      &std::pair<char, std::string_view>::first);
+  if (iter == s_builtin_types.end())
+    return false;
+  out += iter->second;
+  str.remove_prefix(1);
+  return true;
+}
+
+// "F<parameters>_<return type>", as found inside of other types.
+static bool DemangleFunctionType(std::string_view& str, DemangledType& type)
+{
+  std::string parameters = "(";
+  if (!DemangleParameters(str, parameters) || !str.starts_with('_'))
+    return false;
+  str.remove_prefix(1);
+  parameters += ')';
+  DemangledType return_type;
+  if (!DemangleType(str, return_type))
+    return false;
+  type.m_pre = std::move(return_type.m_pre);
+  type.m_post = std::move(parameters) + return_type.m_post;
+  type.m_form = TypeForm::Compound;
+  return true;
+}
+
+// Pointers and references are given in the order they are read out loud, so applying one means
+// building upon the type that follows it.
+static void ApplyDeclarator(DemangledType& type, const std::string_view declarator)
+{
+  if (type.m_form == TypeForm::Compound)
+  {
+    if (!type.m_pre.ends_with('*') && !type.m_pre.ends_with('&'))
+      type.m_pre += ' ';
+    type.m_pre.append("(").append(declarator);
+    type.m_post.insert(0, 1, ')');
+  }
+  else
+  {
+    type.m_pre += declarator;
+  }
+  type.m_form = TypeForm::Declarator;
+}
+
+static bool DemangleType(std::string_view& str, DemangledType& type)
+{
+  if (str.empty())
+    return false;
+  switch (str.front())
+  {
+  case 'C':
+  case 'V':
+  {
+    const std::string_view qualifier = str.front() == 'C' ? "const" : "volatile";
+    str.remove_prefix(1);
+    if (!DemangleType(str, type))
+      return false;
+    if (type.m_form == TypeForm::Plain)
+      type.m_pre.insert(0, std::string{qualifier} + ' ');
+    else
+      type.m_pre.append(" ").append(qualifier);
+    return true;
+  }
+  case 'U':
+  case 'S':
+    type.m_pre = str.front() == 'U' ? "unsigned " : "signed ";
+    str.remove_prefix(1);
+    return DemangleBuiltinType(str, type.m_pre);
+  case 'P':
+  case 'R':
+  {
+    const std::string_view declarator = str.front() == 'P' ? "*" : "&";
+    str.remove_prefix(1);
+    if (!DemangleType(str, type))
+      return false;
+    ApplyDeclarator(type, declarator);
+    return true;
+  }
+  case 'A':
+  {
+    str.remove_prefix(1);
+    std::size_t extent;
+    if (!DemangleCount(str, extent) || !str.starts_with('_'))
+      return false;
+    str.remove_prefix(1);
+    if (!DemangleType(str, type))
+      return false;
+    type.m_post.insert(0, '[' + std::to_string(extent) + ']');
+    type.m_form = TypeForm::Compound;
+    return true;
+  }
+  case 'F':
+    str.remove_prefix(1);
+    return DemangleFunctionType(str, type);
+  case 'M':
+  {
+    // "M<class>[C]F<parameters>_<return type>" for member functions, or "M<class><type>"
+    str.remove_prefix(1);
+    std::string class_name;
+    if (!DemangleQualifiedName(str, class_name))
+      return false;
+    const bool is_const = str.starts_with("CF");
+    if (is_const)
+      str.remove_prefix(1);
+    if (!DemangleType(str, type))
+      return false;
+    if (is_const)
+      type.m_post += " const";
+    if (type.m_form != TypeForm::Compound)
+      type.m_pre += ' ';
+    ApplyDeclarator(type, class_name + "::*");
+    return true;
+  }
+  case 'Q':
+  case '0':
+  case '1':
+  case '2':
+  case '3':
+  case '4':
+  case '5':
+  case '6':
+  case '7':
+  case '8':
+  case '9':
+    return DemangleQualifiedName(str, type.m_pre);
+  default:
+    return DemangleBuiltinType(str, type.m_pre);
+  }
+}
+
+using OperatorName = std::pair<std::string_view, std::string_view>;
+static constexpr std::array<OperatorName, 42> s_operator_names{{
+    {"nw", "operator new"},      {"nwa", "operator new[]"},  {"dl", "operator delete"},
+    {"dla", "operator delete[]"}, {"pl", "operator+"},       {"mi", "operator-"},
+    {"ml", "operator*"},         {"dv", "operator/"},        {"md", "operator%"},
+    {"er", "operator^"},         {"ad", "operator&"},        {"or", "operator|"},
+    {"co", "operator~"},         {"nt", "operator!"},        {"as", "operator="},
+    {"lt", "operator<"},         {"gt", "operator>"},        {"apl", "operator+="},
+    {"ami", "operator-="},       {"amu", "operator*="},      {"adv", "operator/="},
+    {"amd", "operator%="},       {"aer", "operator^="},      {"aad", "operator&="},
+    {"aor", "operator|="},       {"ls", "operator<<"},       {"rs", "operator>>"},
+    {"ars", "operator>>="},      {"als", "operator<<="},     {"eq", "operator=="},
+    {"ne", "operator!="},        {"le", "operator<="},       {"ge", "operator>="},
+    {"aa", "operator&&"},        {"oo", "operator||"},       {"pp", "operator++"},
+    {"mm", "operator--"},        {"cm", "operator,"},        {"rm", "operator->*"},
+    {"rf", "operator->"},        {"cl", "operator()"},       {"vc", "operator[]"},
+}};
+
+// The name and whatever it belongs to are split by the first "__" to be followed by what could
+// only come after one. For the names of special functions, the leading "__" is already gone.
+static std::size_t FindSplit(const std::string_view str)
+{
+  std::size_t depth = 0;
+  for (std::size_t i = 0; i + 2 < str.size(); ++i)
+  {
+    if (str[i] == '<')
+      ++depth;
+    else if (str[i] == '>' && depth > 0)
+      --depth;
+    if (i == 0 || depth != 0 || str[i] != '_' || str[i + 1] != '_')
+      continue;
+    const char next = str[i + 2];
+    if (next == 'F' || next == 'Q' || IsDigit(next) || (next == 'C' && i + 3 < str.size() &&
+                                                          str[i + 3] == 'F'))
+      return i;
+  }
+  return std::string_view::npos;
+}
+
+// "<name>__[<class>][[C]F<parameters>][_<return type>]"
+static bool DemangleFunction(std::string_view str, std::string& out)
+{
+  const bool is_special = str.starts_with("__");
+  if (is_special)
+    str.remove_prefix(2);
+  const std::size_t split_pos = FindSplit(str);
+  if (split_pos == std::string_view::npos)
+    return false;
+  const std::string_view name = str.substr(0, split_pos);
+  str.remove_prefix(split_pos + 2);
+
+  std::string qualified_name;
+  std::string_view class_name;
+  if (!str.starts_with('F') && !str.starts_with("CF") &&
+      !DemangleQualifiedName(str, qualified_name, &class_name))
+    return false;
+
+  std::string function_name;
+  if (!is_special)
+  {
+    if (!DemangleTemplateArgs(name, function_name))
+      return false;
+  }
+  else if (name == "ct" || name == "dt")
+  {
+    if (class_name.empty())
+      return false;
+    function_name.append(name == "dt" ? "~" : "").append(class_name);
+  }
+  else if (const auto iter = std::ranges::find(s_operator_names, name, &OperatorName::first);
+           iter != s_operator_names.end())
+  {
+    function_name = iter->second;
+  }
+  else if (name.starts_with("op"))
+  {
+    // Conversion operators are named after the type they convert to.
+    std::string_view type_str = name.substr(2);
+    DemangledType type;
+    if (!DemangleType(type_str, type) || !type_str.empty())
+      return false;
+    function_name.append("operator ").append(type.m_pre).append(type.m_post);
+  }
+  else
+  {
+    function_name.append("__").append(name);
+  }
+
+  const bool is_const = str.starts_with("CF");
+  if (is_const)
+    str.remove_prefix(1);
+  std::string parameters;
+  const bool is_function = str.starts_with('F');
+  if (is_function)
+  {
+    str.remove_prefix(1);
+    parameters = "(";
+    if (!DemangleParameters(str, parameters))
+      return false;
+    parameters += ')';
+  }
+  // Only template functions have their return types mangled.
+  DemangledType return_type;
+  if (str.starts_with('_'))
+  {
+    str.remove_prefix(1);
+    if (!is_function || !DemangleType(str, return_type))
+      return false;
+  }
+  if (!str.empty())
+    return false;
+
+  if (!return_type.m_pre.empty())
+    out.append(return_type.m_pre).append(" ");
+  if (!qualified_name.empty())
+    out.append(qualified_name).append("::");
+  out.append(function_name).append(parameters).append(return_type.m_post);
+  if (is_const)
+    out += " const";
+  return true;
+}
+
+// "@<offset>@" or "@<offset>@<offset>@", which begins the name of a thunk to a virtual function
+// that finds the object it belongs to with those offsets.
+static bool DemangleThunkOffsets(std::string_view& str, std::string& offsets)
+{
+  for (std::size_t count = 0; count < 2 && str.starts_with('@'); ++count)
+  {
+    std::size_t end = 1;
+    while (end < str.size() && IsDigit(str[end]))
+      ++end;
+    if (end == 1 || end == str.size() || str[end] != '@')
+      break;
+    offsets.append(count == 0 ? "" : ", ").append(str.substr(1, end - 1));
+    str.remove_prefix(end);
+  }
+  if (offsets.empty())
+    return false;
+  str.remove_prefix(1);
+  return true;
+}
+
+bool Demangler::Demangle(std::string_view name, std::string& demangled)
+{
+  demangled.clear();
+  if (std::ranges::any_of(name, [](const char c) { return static_cast<unsigned char>(c) > 0x7F; }))
+    return false;
+  // CodeWarrior for Wii names the static variables of functions like this:
+  // "@LOCAL@<function>@<variable>" and "@GUARD@<function>@<variable>"
+  std::string_view variable_name;
+  const bool is_guard = name.starts_with("@GUARD@");
+  if (is_guard || name.starts_with("@LOCAL@"))
+  {
+    name.remove_prefix(7);
+    const std::size_t at_pos = name.rfind('@');
+    if (at_pos == std::string_view::npos || at_pos + 1 == name.size())
+      return false;
+    variable_name = name.substr(at_pos + 1);
+    name = name.substr(0, at_pos);
+  }
+  // Whereas CodeWarrior for GCN names them like this: "<variable>$localstatic<n>$<function>"
+  else if (const std::size_t dollar_pos = name.find("$localstatic");
+           dollar_pos != std::string_view::npos && dollar_pos != 0)
+  {
+    const std::size_t function_pos = name.find('$', dollar_pos + 1);
+    if (function_pos == std::string_view::npos)
+      return false;
+    variable_name = name.substr(0, dollar_pos);
+    name = name.substr(function_pos + 1);
+  }
+  // Thunks are named after the function they lead to: "@<offset>@<function>"
+  else if (name.starts_with('@'))
+  {
+    std::string offsets;
+    if (!DemangleThunkOffsets(name, offsets))
+      return false;
+    demangled.append("thunk [").append(offsets).append("] to ");
+  }
+  // Nothing else that begins with '@', such as "@stringBase0", is mangled.
+  if (name.starts_with('@') || !DemangleFunction(name, demangled))
+    return false;
+  if (!variable_name.empty())
+    demangled.append("::").append(variable_name).append(is_guard ? " guard" : "");
+  return true;
+}
+
+std::string_view Demangler::Demangle(const std::string_view name)
+{
+  if (const auto iter = m_cache.find(name); iter != m_cache.end())
+    return iter->second;
+  const std::string_view key = m_key_pool.Store(name);
+  const std::string_view demangled =
+      Demangle(name, m_buffer) ? m_string_pool.Store(m_buffer) : key;
+  m_cache.try_emplace(key, demangled);
+  return demangled;
+}
+
+void Demangler::DemangleAll(const Map& map, const unsigned thread_count)
+{
+  std::vector<std::string_view> names;
+  for (const std::string_view name : map.GetSymbolIndex().GetNames())
+    if (!m_cache.contains(name))
+      names.push_back(name);
+  m_cache.reserve(m_cache.size() + names.size());
+
+  // Each chunk demangles into a pool of its own, and the pools are all taken in afterward.
+  struct Task
+  {
+    std::size_t m_first;
+    std::size_t m_last;
+    std::vector<std::string_view> m_demangled;
+    Mijo::StringPool m_string_pool;
+  };
+  static constexpr std::size_t chunk_size = 0x1000;
+  std::vector<Task> tasks;
+  for (std::size_t first = 0; first < names.size(); first += chunk_size)
+    tasks.push_back({first, std::min(first + chunk_size, names.size()), {}, Mijo::StringPool{}});
+  Mijo::ParallelFor(tasks.size(), thread_count, [&](const std::size_t i) {
+    Task& task = tasks[i];
+    std::string buffer;
+    task.m_demangled.reserve(task.m_last - task.m_first);
+    for (std::size_t j = task.m_first; j < task.m_last; ++j)
+      task.m_demangled.push_back(Demangle(names[j], buffer) ? task.m_string_pool.Store(buffer) :
+                                                              std::string_view{});
+  });
+  for (Task& task : tasks)
+  {
+    for (std::size_t j = task.m_first; j < task.m_last; ++j)
+    {
+      const std::string_view key = m_key_pool.Store(names[j]);
+      const std::string_view demangled = task.m_demangled[j - task.m_first];
+      m_cache.try_emplace(key, demangled.empty() ? key : demangled);
+    }
+    m_string_pool.Merge(std::move(task.m_string_pool));
+  }
+}
+}  // namespace MWLinker
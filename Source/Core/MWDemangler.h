@@ -0,0 +1,50 @@
+// Copyright 2023 Bradley G. (Minty Meeo)
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "HashUtil.h"
+#include "MWLinkerMap.h"
+#include "StringUtil.h"
+
+namespace MWLinker
+{
+// Turns names mangled by CodeWarrior back into what they were in the source, such as
+// "GetInstance__Q23foo3BarFv" into "foo::Bar::GetInstance()". The same names turn up thousands of
+// times in a linker map, in the symbol closures and the section layouts alike, so each one is only
+// ever demangled once. Demangled names are kept in an arena for as long as the Demangler lives.
+class Demangler
+{
+public:
+  // Names are remembered by a copy made in the storage given. With StringStorage::Borrowed, they
+  // are remembered by the very views given instead, which must then outlive the Demangler. Names
+  // from a Map that outlives the Demangler are a good fit for that.
+  explicit Demangler(const Map::StringStorage key_storage = Map::StringStorage::Arena) noexcept
+      : m_key_pool(key_storage)
+  {
+  }
+
+  // Names that are not mangled, or are mangled in a way not understood, are given back as is.
+  // Thunks come out with the offsets they were named with, such as "thunk [12] to Foo::~Foo()" for
+  // "@12@__dt__3FooFv".
+  std::string_view Demangle(std::string_view name);
+  // Demangles every name a Map has at once, on as many threads as given, so that Demangle only has
+  // to look them up afterward. The names are found with Map::GetSymbolIndex.
+  void DemangleAll(const Map& map, unsigned thread_count = 1);
+  std::size_t GetCachedCount() const noexcept { return m_cache.size(); }
+
+  // Demangles without remembering anything. False means the name is not mangled, or not in a way
+  // that is understood, and leaves 'demangled' unspecified.
+  static bool Demangle(std::string_view name, std::string& demangled);
+
+private:
+  Mijo::StringPool m_key_pool;
+  Mijo::StringPool m_string_pool;
+  Mijo::FlatHashMap<std::string_view, std::string_view> m_cache;
+  std::string m_buffer;
+};
+}  // namespace MWLinker
@@ -3,25 +3,48 @@
 
 #include "MWLinkerMap.h"
 
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <new>
+#include <numeric>
 #include <ostream>
+#include <random>
 #include <ranges>
 #include <regex>
 #include <span>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <variant>
+#include <vector>
 
+#include <fmt/compile.h>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
-#include "PointerUtil.h"
+#include "PatternUtil.h"
+#include "ProfileUtil.h"
 #include "RegexUtil.h"
+#include "ThreadUtil.h"
 
 // Metrowerks linker maps should be considered binary files containing text with CRLF line endings.
 // To account for outside factors, though, this program can support both CRLF and LF line endings.
@@ -32,163 +55,425 @@
 
 namespace MWLinker
 {
-bool Map::SymbolClosure::Warn::do_warn_odr_violation = true;
+void Map::Diagnostics::Add(const Warnings kind, const std::size_t line_number,
+                           const std::string_view symbol_name,
+                           const std::string_view compilation_unit_name,
+                           const std::string_view section_name)
+{
+  if (!IsEnabled(kind))
+    return;
+  m_diagnostics.push_back({kind, line_number, m_names.Store(symbol_name),
+                           m_names.Store(compilation_unit_name), m_names.Store(section_name)});
+}
+
+void Map::Diagnostics::Merge(Diagnostics&& other)
+{
+  m_names.Merge(std::move(other.m_names));
+  m_diagnostics.insert(m_diagnostics.end(), other.m_diagnostics.begin(),
+                       other.m_diagnostics.end());
+  other.m_diagnostics.clear();
+}
+
+void Map::Diagnostics::Print(std::ostream& stream, const std::span<const Diagnostic> diagnostics)
+{
+  fmt::memory_buffer buffer;
+  const auto out = std::back_inserter(buffer);
+  for (const auto& [kind, line_number, symbol_name, compilation_unit_name, section_name] :
+       diagnostics)
+  {
+    switch (kind)
+    {
+    case Warnings::SymbolClosureOdrViolation:
+    case Warnings::FoldingOdrViolation:
+      fmt::format_to(out, "Line {:d}] \"{:s}\" seen again in \"{:s}\"\n", line_number, symbol_name,
+                     compilation_unit_name);
+      break;
+    case Warnings::SymbolClosureSymOnFlag:
+      fmt::format_to(out, "Line {:d}] Detected '-sym on' flag in \"{:s}\" (.text)\n", line_number,
+                     compilation_unit_name);
+      break;
+    case Warnings::MergingOdrViolation:
+      fmt::format_to(out, "Line {:d}] \"{:s}\" seen again\n", line_number, symbol_name);
+      break;
+    case Warnings::FoldingRepeatObject:
+      fmt::format_to(out, "Line {:d}] Detected repeat-name object \"{:s}\"\n", line_number,
+                     compilation_unit_name);
+      break;
+    case Warnings::SectionLayoutRepeatCompilationUnit:
+      fmt::format_to(out, "Line {:d}] Detected repeat-name compilation unit \"{:s}\" ({:s})\n",
+                     line_number, compilation_unit_name, section_name);
+      break;
+    case Warnings::SectionLayoutOdrViolation:
+      fmt::format_to(out, "Line {:d}] \"{:s}\" seen again in \"{:s}\" ({:s})\n", line_number,
+                     symbol_name, compilation_unit_name, section_name);
+      break;
+    case Warnings::SectionLayoutSymOnFlag:
+      fmt::format_to(out, "Line {:d}] Detected '-sym on' flag in \"{:s}\" ({:s})\n", line_number,
+                     compilation_unit_name, section_name);
+      break;
+    case Warnings::SectionLayoutCommonOnFlag:
+      fmt::format_to(out, "Line {:d}] Detected '-common on' flag in \"{:s}\" ({:s})\n", line_number,
+                     compilation_unit_name, section_name);
+      break;
+    case Warnings::SectionLayoutLCommAfterComm:
+      fmt::format_to(out, "Line {:d}] .lcomm symbols found after .comm symbols\n", line_number);
+      break;
+    default:
+      break;
+    }
+  }
+  stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+void Map::ScanProfile::Add(const PortionProfile& portion_profile)
+{
+  PortionProfile& added = m_portion_profiles.emplace_back(portion_profile);
+  added.m_section_name = m_names.Store(portion_profile.m_section_name);
+}
+
+void Map::ScanProfile::Merge(ScanProfile&& other)
+{
+  m_names.Merge(std::move(other.m_names));
+  m_portion_profiles.insert(m_portion_profiles.end(), other.m_portion_profiles.begin(),
+                            other.m_portion_profiles.end());
+  other.m_portion_profiles.clear();
+}
+
+static std::string_view GetPortionName(const Map::Portions portion) noexcept
+{
+  switch (portion)
+  {
+  case Map::Portions::NormalSymbolClosure:
+    return "NormalSymbolClosure";
+  case Map::Portions::EPPC_PatternMatching:
+    return "EPPC_PatternMatching";
+  case Map::Portions::DwarfSymbolClosure:
+    return "DwarfSymbolClosure";
+  case Map::Portions::LinkerOpts:
+    return "LinkerOpts";
+  case Map::Portions::MixedModeIslands:
+    return "MixedModeIslands";
+  case Map::Portions::BranchIslands:
+    return "BranchIslands";
+  case Map::Portions::LinktimeSizeDecreasingOptimizations:
+    return "LinktimeSizeDecreasingOptimizations";
+  case Map::Portions::LinktimeSizeIncreasingOptimizations:
+    return "LinktimeSizeIncreasingOptimizations";
+  case Map::Portions::SectionLayouts:
+    return "SectionLayout";
+  case Map::Portions::MemoryMap:
+    return "MemoryMap";
+  case Map::Portions::LinkerGeneratedSymbols:
+    return "LinkerGeneratedSymbols";
+  default:
+    return "Unknown";
+  }
+}
+
+// Section names come from the linker map, so anything JSON does not allow in a string is escaped.
+static void AppendJsonString(fmt::memory_buffer& buffer, const std::string_view str)
+{
+  const auto out = std::back_inserter(buffer);
+  buffer.push_back('"');
+  for (const char c : str)
+  {
+    if (c == '"' || c == '\\')
+      fmt::format_to(out, "\\{:c}", c);
+    else if (static_cast<unsigned char>(c) < 0x20)
+      fmt::format_to(out, "\\u{:04x}", static_cast<unsigned>(c));
+    else
+      buffer.push_back(c);
+  }
+  buffer.push_back('"');
+}
+
+void Map::ScanProfile::PrintJson(std::ostream& stream) const
+{
+  fmt::memory_buffer buffer;
+  const auto out = std::back_inserter(buffer);
+  buffer.push_back('[');
+  for (const PortionProfile& portion_profile : m_portion_profiles)
+  {
+    fmt::format_to(out, "{:s}\n  {{\"portion\": \"{:s}\", \"section\": ",
+                   &portion_profile == m_portion_profiles.data() ? "" : ",",
+                   GetPortionName(portion_profile.m_portion));
+    AppendJsonString(buffer, portion_profile.m_section_name);
+    fmt::format_to(out,
+                   ", \"time_ns\": {:d}, \"bytes\": {:d}, \"lines\": {:d}, "
+                   "\"pattern_attempts\": {:d}, \"pattern_hits\": {:d}, \"allocations\": {:d}, "
+                   "\"allocated_bytes\": {:d}}}",
+                   portion_profile.m_time.count(), portion_profile.m_byte_count,
+                   portion_profile.m_line_count, portion_profile.m_pattern_attempt_count,
+                   portion_profile.m_pattern_hit_count, portion_profile.m_allocation_count,
+                   portion_profile.m_allocated_size);
+  }
+  fmt::format_to(out, "{:s}]\n", m_portion_profiles.empty() ? "" : "\n");
+  stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+// Measures the scan of one portion, from when this is made to when it is destroyed, and adds it to
+// a profile whether or not the scan succeeded. Does nothing unless profiling is compiled in.
+class PortionProfiler
+{
+public:
+  PortionProfiler(Map::ScanProfile& scan_profile, const Map::Portions portion,
+                  const std::string_view section_name, const char* const& head,
+                  const std::size_t& line_number) noexcept
+      : m_scan_profile(scan_profile), m_portion(portion), m_section_name(section_name),
+        m_head(head), m_line_number(line_number), m_start_head(head),
+        m_start_line_number(line_number)
+  {
+    if constexpr (Map::ScanProfile::is_enabled)
+    {
+      m_start_counters = Mijo::GetProfileCounters();
+      m_start_time = std::chrono::steady_clock::now();
+    }
+  }
+  PortionProfiler(const PortionProfiler&) = delete;
+  PortionProfiler& operator=(const PortionProfiler&) = delete;
+  ~PortionProfiler()
+  {
+    if constexpr (Map::ScanProfile::is_enabled)
+    {
+      const auto time = std::chrono::steady_clock::now() - m_start_time;
+      const Mijo::ProfileCounters counters = Mijo::GetProfileCounters() - m_start_counters;
+      m_scan_profile.Add({m_portion, m_section_name,
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(time),
+                          static_cast<std::size_t>(m_head - m_start_head),
+                          m_line_number - m_start_line_number, counters.m_pattern_attempt_count,
+                          counters.m_pattern_hit_count, counters.m_allocation_count,
+                          counters.m_allocated_size});
+    }
+  }
+
+private:
+  Map::ScanProfile& m_scan_profile;
+  Map::Portions m_portion;
+  std::string_view m_section_name;
+  const char* const& m_head;
+  const std::size_t& m_line_number;
+  const char* m_start_head;
+  std::size_t m_start_line_number;
+  Mijo::ProfileCounters m_start_counters;
+  std::chrono::steady_clock::time_point m_start_time;
+};
+
+// Like Mijo::ParallelFor, but what the work is counted as doing lands on the calling thread, as if
+// it had all been done there. This keeps profiles whole for portions that scan parts of themselves
+// in parallel.
+template <class Func>
+static void ParallelForProfiled(const std::size_t count, const unsigned thread_count, Func&& func)
+{
+  if constexpr (!Map::ScanProfile::is_enabled)
+  {
+    Mijo::ParallelFor(count, thread_count, func);
+  }
+  else
+  {
+    const std::thread::id calling_thread_id = std::this_thread::get_id();
+    std::mutex mutex;
+    Mijo::ProfileCounters elsewhere_counters;
+    Mijo::ParallelFor(count, thread_count, [&](const std::size_t i) {
+      if (std::this_thread::get_id() == calling_thread_id)
+      {
+        func(i);
+        return;
+      }
+      const Mijo::ProfileCounters start_counters = Mijo::GetProfileCounters();
+      func(i);
+      const Mijo::ProfileCounters counters = Mijo::GetProfileCounters() - start_counters;
+      const std::scoped_lock lock{mutex};
+      elsewhere_counters += counters;
+    });
+    Mijo::GetProfileCounters() += elsewhere_counters;
+  }
+}
 
 void Map::SymbolClosure::Warn::OneDefinitionRuleViolation(
-    const std::size_t line_number, const std::string_view symbol_name,
+    Diagnostics& diagnostics, const std::size_t line_number, const std::string_view symbol_name,
     const std::string_view compilation_unit_name)
 {
   // For legal linker maps, this should only ever happen in repeat-name compilation units.
-  if (!do_warn_odr_violation)
-    return;
-  fmt::println(std::cerr, "Line {:d}] \"{:s}\" seen again in \"{:s}\"", line_number, symbol_name,
-               compilation_unit_name);
+  diagnostics.Add(Warnings::SymbolClosureOdrViolation, line_number, symbol_name,
+                  compilation_unit_name);
 }
 
-bool Map::SymbolClosure::Warn::do_warn_sym_on_flag_detected = true;
-
-void Map::SymbolClosure::Warn::SymOnFlagDetected(const std::size_t line_number,
+void Map::SymbolClosure::Warn::SymOnFlagDetected(Diagnostics& diagnostics,
+                                                 const std::size_t line_number,
                                                  const std::string_view compilation_unit_name)
 {
   // Multiple STT_SECTION symbols were seen in an uninterrupted compilation unit.  This could be
   // a false positive, and in turn would be a false negative for a RepeatCompilationUnit warning.
-  if (!do_warn_sym_on_flag_detected)
-    return;
-  fmt::println(std::cerr, "Line {:d}] Detected '-sym on' flag in \"{:s}\" (.text)", line_number,
-               compilation_unit_name);
+  diagnostics.Add(Warnings::SymbolClosureSymOnFlag, line_number, {}, compilation_unit_name);
 }
 
-bool Map::EPPC_PatternMatching::Warn::do_warn_merging_odr_violation = true;
-
 void Map::EPPC_PatternMatching::Warn::MergingOneDefinitionRuleViolation(
-    const std::size_t line_number, const std::string_view symbol_name)
+    Diagnostics& diagnostics, const std::size_t line_number, const std::string_view symbol_name)
 {
   // Could be a false positive, as code merging has no information about where the symbol came from.
-  if (!do_warn_merging_odr_violation)
-    return;
-  fmt::println(std::cerr, "Line {:d}] \"{:s}\" seen again", line_number, symbol_name);
+  diagnostics.Add(Warnings::MergingOdrViolation, line_number, symbol_name);
 }
 
-bool Map::EPPC_PatternMatching::Warn::do_warn_folding_repeat_object = true;
-
-void Map::EPPC_PatternMatching::Warn::FoldingRepeatObject(const std::size_t line_number,
+void Map::EPPC_PatternMatching::Warn::FoldingRepeatObject(Diagnostics& diagnostics,
+                                                          const std::size_t line_number,
                                                           const std::string_view object_name)
 {
   // This warning is pretty much the only one guaranteed to not produce false positives.
-  if (!do_warn_folding_repeat_object)
-    fmt::println(std::cerr, "Line {:d}] Detected repeat-name object \"{:s}\"", line_number,
-                 object_name);
+  diagnostics.Add(Warnings::FoldingRepeatObject, line_number, {}, object_name);
 }
 
-bool Map::EPPC_PatternMatching::Warn::do_warn_folding_odr_violation = true;
-
 void Map::EPPC_PatternMatching::Warn::FoldingOneDefinitionRuleViolation(
-    const std::size_t line_number, const std::string_view symbol_name,
+    Diagnostics& diagnostics, const std::size_t line_number, const std::string_view symbol_name,
     const std::string_view object_name)
 {
   // For legal linker maps, this should only ever happen in repeat-name objects.
-  if (!do_warn_folding_odr_violation)
-    return;
-  fmt::println(std::cerr, "Line {:d}] \"{:s}\" seen again in \"{:s}\"", line_number, symbol_name,
-               object_name);
+  diagnostics.Add(Warnings::FoldingOdrViolation, line_number, symbol_name, object_name);
 }
 
-bool Map::SectionLayout::Warn::do_warn_repeat_compilation_unit = true;
-
-void Map::SectionLayout::Warn::RepeatCompilationUnit(const std::size_t line_number,
+void Map::SectionLayout::Warn::RepeatCompilationUnit(Diagnostics& diagnostics,
+                                                     const std::size_t line_number,
                                                      const std::string_view compilation_unit_name,
                                                      const std::string_view section_name)
 {
-  if (!do_warn_repeat_compilation_unit)
-    return;
-  fmt::println(std::cerr, "Line {:d}] Detected repeat-name compilation unit \"{:s}\" ({:s})",
-               line_number, compilation_unit_name, section_name);
+  diagnostics.Add(Warnings::SectionLayoutRepeatCompilationUnit, line_number, {},
+                  compilation_unit_name, section_name);
 }
 
-bool Map::SectionLayout::Warn::do_warn_odr_violation = true;
-
 void Map::SectionLayout::Warn::OneDefinitionRuleViolation(
-    const std::size_t line_number, const std::string_view symbol_name,
+    Diagnostics& diagnostics, const std::size_t line_number, const std::string_view symbol_name,
     const std::string_view compilation_unit_name, const std::string_view section_name)
 {
   // For legal linker maps, this should only ever happen in repeat-name compilation units.
-  if (!do_warn_odr_violation)
-    return;
-  fmt::println(std::cerr, "Line {:d}] \"{:s}\" seen again in \"{:s}\" ({:s})", line_number,
-               symbol_name, compilation_unit_name, section_name);
+  diagnostics.Add(Warnings::SectionLayoutOdrViolation, line_number, symbol_name,
+                  compilation_unit_name, section_name);
 }
 
-bool Map::SectionLayout::Warn::do_warn_sym_on_flag_detected = true;
-
-void Map::SectionLayout::Warn::SymOnFlagDetected(const std::size_t line_number,
+void Map::SectionLayout::Warn::SymOnFlagDetected(Diagnostics& diagnostics,
+                                                 const std::size_t line_number,
                                                  const std::string_view compilation_unit_name,
                                                  const std::string_view section_name)
 {
   // Multiple STT_SECTION symbols were seen in an uninterrupted compilation unit.  This could be
   // a false positive, and in turn would be a false negative for a RepeatCompilationUnit warning.
-  if (!do_warn_sym_on_flag_detected)
-    return;
-  fmt::println(std::cerr, "Line {:d}] Detected '-sym on' flag in \"{:s}\" ({:s})", line_number,
-               compilation_unit_name, section_name);
+  diagnostics.Add(Warnings::SectionLayoutSymOnFlag, line_number, {}, compilation_unit_name,
+                  section_name);
 }
 
-bool Map::SectionLayout::Warn::do_warn_common_on_flag_detected = true;
-
-void Map::SectionLayout::Warn::CommonOnFlagDetected(const std::size_t line_number,
+void Map::SectionLayout::Warn::CommonOnFlagDetected(Diagnostics& diagnostics,
+                                                    const std::size_t line_number,
                                                     const std::string_view compilation_unit_name,
                                                     const std::string_view section_name)
 {
-  if (!do_warn_common_on_flag_detected)
-    return;
-  fmt::println(std::cerr, "Line {:d}] Detected '-common on' flag in \"{:s}\" ({:s})", line_number,
-               compilation_unit_name, section_name);
+  diagnostics.Add(Warnings::SectionLayoutCommonOnFlag, line_number, {}, compilation_unit_name,
+                  section_name);
 }
 
-bool Map::SectionLayout::Warn::do_warn_lcomm_after_comm = true;
-
-void Map::SectionLayout::Warn::LCommAfterComm(const std::size_t line_number)
+void Map::SectionLayout::Warn::LCommAfterComm(Diagnostics& diagnostics,
+                                              const std::size_t line_number)
 {
-  if (!do_warn_lcomm_after_comm)
-    return;
-  fmt::println(std::cerr, "Line {:d}] .lcomm symbols found after .comm symbols", line_number);
+  diagnostics.Add(Warnings::SectionLayoutLCommAfterComm, line_number);
 }
 
-static constexpr std::string_view GetCompilationUnitName(const std::string& module_name,
-                                                         const std::string& source_name)
+static constexpr std::string_view GetCompilationUnitName(const std::string_view module_name,
+                                                         const std::string_view source_name)
 {
   return source_name.empty() ? module_name : source_name;
 }
 
+// Every pattern tried on the text counts toward the profile of the portion being scanned.
+static void CountPatternAttempt(const bool is_hit) noexcept
+{
+  if constexpr (Map::ScanProfile::is_enabled)
+  {
+    Mijo::ProfileCounters& counters = Mijo::GetProfileCounters();
+    counters.m_pattern_attempt_count += 1;
+    counters.m_pattern_hit_count += is_hit;
+  }
+}
+
+static bool MatchRegex(const char* const head, const char* const tail, std::cmatch& match,
+                       const std::regex& regex)
+{
+  const bool is_hit =
+      std::regex_search(head, tail, match, regex, std::regex_constants::match_continuous);
+  CountPatternAttempt(is_hit);
+  return is_hit;
+}
+
+using Mijo::Pattern::Any;
+using Mijo::Pattern::Digits;
+using Mijo::Pattern::Hex;
+using Mijo::Pattern::Literal;
+using Mijo::Pattern::Spaces;
+
+// Enough room for the captures of any LinePattern in this file.
+using LineMatch = std::array<Mijo::CSubMatch, 10>;
+
+// The fixed-width rows of the Section Layout, Memory Map, and Linker Generated Symbols portions are
+// matched with compile-time patterns. Each one is paired with the std::regex it was derived from,
+// which is only ever compiled if the regex fallback is requested.
+template <class... Elements>
+class LinePattern
+{
+public:
+  constexpr explicit LinePattern(const char* regex) noexcept : m_regex(regex) {}
+
+  bool Match(const char* const head, const char* const tail, LineMatch& match,
+             const bool use_regex) const
+  {
+    const bool is_hit = MatchUncounted(head, tail, match, use_regex);
+    CountPatternAttempt(is_hit);
+    return is_hit;
+  }
+
+private:
+  bool MatchUncounted(const char* const head, const char* const tail, LineMatch& match,
+                      const bool use_regex) const
+  {
+    if (!use_regex)
+      return Mijo::StaticPattern<Elements...>::Match(head, tail, match);
+    Mijo::CMatchResults regex_match;
+    if (!std::regex_search(head, tail, regex_match, *m_regex,
+                           std::regex_constants::match_continuous))
+      return false;
+    for (std::size_t i = 0; i < regex_match.size(); ++i)
+      static_cast<std::csub_match&>(match[i]) = regex_match[i];
+    return true;
+  }
+
+  Mijo::LazyRegex m_regex;
+};
+
 // clang-format off
-static const std::regex re_entry_point_name{
+static const Mijo::LazyRegex re_entry_point_name{
 //  "Link map of %s\r\n"
     "Link map of (.*)\r?\n"};
-static const std::regex re_unresolved_symbol{
+static const Mijo::LazyRegex re_unresolved_symbol{
 //  ">>> SYMBOL NOT FOUND: %s\r\n"
     ">>> SYMBOL NOT FOUND: (.*)\r?\n"};
-static const std::regex re_mixed_mode_islands_header{
+static const Mijo::LazyRegex re_mixed_mode_islands_header{
 //  "\r\nMixed Mode Islands\r\n"
     "\r?\nMixed Mode Islands\r?\n"};
-static const std::regex re_branch_islands_header{
+static const Mijo::LazyRegex re_branch_islands_header{
 //  "\r\nBranch Islands\r\n"
     "\r?\nBranch Islands\r?\n"};
-static const std::regex re_linktime_size_decreasing_optimizations_header{
+static const Mijo::LazyRegex re_linktime_size_decreasing_optimizations_header{
 //  "\r\nLinktime size-decreasing optimizations\r\n"
     "\r?\nLinktime size-decreasing optimizations\r?\n"};
-static const std::regex re_linktime_size_increasing_optimizations_header{
+static const Mijo::LazyRegex re_linktime_size_increasing_optimizations_header{
 //  "\r\nLinktime size-increasing optimizations\r\n"
     "\r?\nLinktime size-increasing optimizations\r?\n"};
-static const std::regex re_section_layout_header{
+static const Mijo::LazyRegex re_section_layout_header{
 //  "\r\n\r\n%s section layout\r\n"
     "\r?\n\r?\n(.*) section layout\r?\n"};
-static const std::regex re_section_layout_header_modified_a{
+static const Mijo::LazyRegex re_section_layout_header_modified_a{
     "\r?\n(.*) section layout\r?\n"};
-static const std::regex re_section_layout_header_modified_b{
+static const Mijo::LazyRegex re_section_layout_header_modified_b{
     "(.*) section layout\r?\n"};
-static const std::regex re_memory_map_header{
+static const Mijo::LazyRegex re_memory_map_header{
 //  "\r\n\r\nMemory map:\r\n"
     "\r?\n\r?\nMemory map:\r?\n"};
-static const std::regex re_linker_generated_symbols_header{
+static const Mijo::LazyRegex re_linker_generated_symbols_header{
 //  "\r\n\r\nLinker generated symbols:\r\n"
     "\r?\n\r?\nLinker generated symbols:\r?\n"};
 // clang-format on
@@ -199,7 +484,7 @@ static const std::regex re_linker_generated_symbols_header{
 // ".gnu.version" ".gnu.version_r" ".gnu.warning" ".gnu.version_d"
 // ".BINARY" ".rela" ".dynsym" ".rel" ".symtab" ".interp" ".dynstr" ".hash" ".dynamic" ".plt" ".got"
 // ".note.ABI-tag" ".line" ".shstrtab" ".strtab" ".comment" ".stab"
-static const std::unordered_map<std::string_view, Map::SectionLayout::Kind> map_section_layout_kind{
+static constexpr auto map_section_layout_kind = Mijo::MakePerfectHashMap<Map::SectionLayout::Kind>({
     {".init", Map::SectionLayout::Kind::Code},
     {".text", Map::SectionLayout::Kind::Code},
     {".fini", Map::SectionLayout::Kind::Code},
@@ -236,14 +521,14 @@ static const std::unordered_map<std::string_view, Map::SectionLayout::Kind> map_
     {".debug_loc", Map::SectionLayout::Kind::Debug},
     {".debug_macinfo", Map::SectionLayout::Kind::Debug},
     {".debug_pubnames", Map::SectionLayout::Kind::Debug},
-};
+});
 
 Map::SectionLayout::Kind Map::SectionLayout::ToSectionKind(const std::string_view section_name)
 {
-  const auto iter = map_section_layout_kind.find(section_name);
-  if (iter == map_section_layout_kind.end())
+  const Map::SectionLayout::Kind* const kind = map_section_layout_kind.Find(section_name);
+  if (kind == nullptr)
     return Map::SectionLayout::Kind::Unknown;
-  return iter->second;
+  return *kind;
 }
 
 Map::ScanError Map::Scan(const std::span<const char> span, std::size_t& line_number)
@@ -258,17 +543,26 @@ Map::ScanError Map::Scan(const char* head, const char* const tail, std::size_t&
 
   Mijo::CMatchResults match;
   line_number = 1u;
+  // Jumping over text instead of scanning it, or splitting it up to be scanned in parallel, is done
+  // with an index of the lines of the whole text. It is only made once something needs it.
+  Mijo::LazyValue<Mijo::LineIndex> line_index;
+  const auto get_line_index = [&line_index, text_head = head, tail]() -> const Mijo::LineIndex& {
+    return line_index.Get([&] { return Mijo::LineIndex{text_head, tail}; });
+  };
 
   // Linker maps from Animal Crossing (foresta.map and static.map) and Doubutsu no Mori e+
   // (foresta.map, forestd.map, foresti.map, foresto.map, and static.map) appear to have been
   // modified to strip out the Link Map portion and UNUSED symbols, though the way it was done
   // also removed one of the Section Layout header's preceding newlines.
-  if (std::regex_search(head, tail, match, re_section_layout_header_modified_a,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_section_layout_header_modified_a))
   {
     line_number += 2u;
     head = match[0].second;
-    const ScanError error = ScanPrologue_SectionLayout(head, tail, line_number, match[1].view());
+    const ScanError error =
+        IsScanned(Portions::SectionLayouts) ?
+            ScanPrologue_SectionLayout(head, tail, line_number, match[1].view(), m_section_layouts,
+                                       m_string_pool, m_diagnostics, m_scan_profile) :
+            SkipSectionLayout(head, tail, line_number, get_line_index());
     if (error != ScanError::None)
       return error;
     goto NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE;
@@ -279,34 +573,62 @@ Map::ScanError Map::Scan(const char* head, const char* const tail, std::size_t&
   // Similarly modified linker maps:
   //   The Legend of Zelda - Ocarina of Time & Master Quest
   //   The Legend of Zelda - The Wind Waker (framework.map)
-  if (std::regex_search(head, tail, match, re_section_layout_header_modified_b,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_section_layout_header_modified_b))
   {
     line_number += 1u;
     head = match[0].second;
-    const ScanError error = ScanPrologue_SectionLayout(head, tail, line_number, match[1].view());
+    const ScanError error =
+        IsScanned(Portions::SectionLayouts) ?
+            ScanPrologue_SectionLayout(head, tail, line_number, match[1].view(), m_section_layouts,
+                                       m_string_pool, m_diagnostics, m_scan_profile) :
+            SkipSectionLayout(head, tail, line_number, get_line_index());
     if (error != ScanError::None)
       return error;
     goto NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE;
   }
-  if (std::regex_search(head, tail, match, re_entry_point_name,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_entry_point_name))
   {
     line_number += 1u;
     head = match[0].second;
-    m_entry_point_name = match.str(1);
+    m_entry_point_name = m_string_pool.Store(match[1].view());
   }
   else
   {
     // If this is not present, the file must not be a Metrowerks linker map.
     return ScanError::EntryPointNameMissing;
   }
+  if (!IsScanned(Portions::NormalSymbolClosure | Portions::EPPC_PatternMatching |
+                 Portions::DwarfSymbolClosure | Portions::LinkerOpts |
+                 Portions::MixedModeIslands | Portions::BranchIslands |
+                 Portions::LinktimeSizeDecreasingOptimizations |
+                 Portions::LinktimeSizeIncreasingOptimizations))
+  {
+    SkipToTrailingPortions(head, tail, line_number, get_line_index());
+    goto NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE;
+  }
+  if (!IsScanned(Portions::NormalSymbolClosure))
+  {
+    SkipSymbolClosure(head, tail, line_number, false);
+  }
+  else if (m_options.m_lazy_symbol_closures)
+  {
+    const PortionProfiler profiler{m_scan_profile, Portions::NormalSymbolClosure, {}, head,
+                                   line_number};
+    const ScanError error =
+        LookOverSymbolClosure(head, tail, line_number, false, m_lazy_normal_symbol_closure);
+    if (error != ScanError::None)
+      return error;
+  }
+  else
   {
     // libc++ bug: When checking if SymbolClosure is default constructable in
     // std::optional::emplace, it fails the requirement std::is_constructable_v because
     // it is not yet a complete class due to it being nested in Map.
+    const PortionProfiler profiler{m_scan_profile, Portions::NormalSymbolClosure, {}, head,
+                                   line_number};
     auto& portion = m_normal_symbol_closure.emplace(SymbolClosure());
-    const ScanError error = portion.Scan(head, tail, line_number, m_unresolved_symbols);
+    const ScanError error = portion.Scan(head, tail, line_number, m_unresolved_symbols, m_options,
+                                         m_string_pool, m_diagnostics);
     if (error != ScanError::None)
     {
       m_normal_symbol_closure.reset();
@@ -314,24 +636,45 @@ Map::ScanError Map::Scan(const char* head, const char* const tail, std::size_t&
     }
   }
   {
+    const PortionProfiler profiler{m_scan_profile, Portions::EPPC_PatternMatching, {}, head,
+                                   line_number};
     auto& portion = m_eppc_pattern_matching.emplace();
-    const ScanError error = portion.Scan(head, tail, line_number);
+    const ScanError error = portion.Scan(head, tail, line_number, m_string_pool, m_diagnostics);
     if (error != ScanError::None)
     {
       m_eppc_pattern_matching.reset();
       return error;
     }
+    if (!IsScanned(Portions::EPPC_PatternMatching))
+      DiscardPortion(m_eppc_pattern_matching);
   }
   // With '-listdwarf' and DWARF debugging information enabled, a second symbol closure
   // containing info about the .dwarf and .debug sections will appear. Note that, without an
   // EPPC_PatternMatching in the middle, this will blend into the prior symbol closure in the
   // eyes of this scan function.
+  if (!IsScanned(Portions::DwarfSymbolClosure))
+  {
+    SkipSymbolClosure(head, tail, line_number, true);
+  }
+  else if (m_options.m_lazy_symbol_closures)
+  {
+    const PortionProfiler profiler{m_scan_profile, Portions::DwarfSymbolClosure, {}, head,
+                                   line_number};
+    const ScanError error =
+        LookOverSymbolClosure(head, tail, line_number, true, m_lazy_dwarf_symbol_closure);
+    if (error != ScanError::None)
+      return error;
+  }
+  else
   {
     // libc++ bug: When checking if SymbolClosure is default constructable in
     // std::optional::emplace, it fails the requirement std::is_constructable_v because
     // it is not yet a complete class due to it being nested in Map.
+    const PortionProfiler profiler{m_scan_profile, Portions::DwarfSymbolClosure, {}, head,
+                                   line_number};
     auto& portion = m_dwarf_symbol_closure.emplace(SymbolClosure());
-    const ScanError error = portion.Scan(head, tail, line_number, m_unresolved_symbols);
+    const ScanError error = portion.Scan(head, tail, line_number, m_unresolved_symbols, m_options,
+                                         m_string_pool, m_diagnostics);
     if (error != ScanError::None)
     {
       m_dwarf_symbol_closure.reset();
@@ -343,45 +686,55 @@ Map::ScanError Map::Scan(const char* head, const char* const tail, std::size_t&
   // Unresolved symbol post-prints probably belong here (I have not confirmed if they preceed
   // LinkerOpts), but the Symbol Closure scanning code that just happened handles them well enough.
   {
+    const PortionProfiler profiler{m_scan_profile, Portions::LinkerOpts, {}, head, line_number};
     auto& portion = m_linker_opts.emplace();
-    const ScanError error = portion.Scan(head, tail, line_number);
+    const ScanError error = portion.Scan(head, tail, line_number, m_string_pool);
     if (error != ScanError::None)
     {
       m_linker_opts.reset();
       return error;
     }
+    if (!IsScanned(Portions::LinkerOpts))
+      DiscardPortion(m_linker_opts);
   }
-  if (std::regex_search(head, tail, match, re_mixed_mode_islands_header,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_mixed_mode_islands_header))
   {
     line_number += 2u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile, Portions::MixedModeIslands, {}, head,
+                                   line_number};
     auto& portion = m_mixed_mode_islands.emplace();
-    const ScanError error = portion.Scan(head, tail, line_number);
+    const ScanError error = portion.Scan(head, tail, line_number, m_string_pool);
     if (error != ScanError::None)
     {
       m_mixed_mode_islands.reset();
       return error;
     }
+    if (!IsScanned(Portions::MixedModeIslands))
+      DiscardPortion(m_mixed_mode_islands);
   }
-  if (std::regex_search(head, tail, match, re_branch_islands_header,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_branch_islands_header))
   {
     line_number += 2u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile, Portions::BranchIslands, {}, head, line_number};
     auto& portion = m_branch_islands.emplace();
-    const ScanError error = portion.Scan(head, tail, line_number);
+    const ScanError error = portion.Scan(head, tail, line_number, m_string_pool);
     if (error != ScanError::None)
     {
       m_branch_islands.reset();
       return error;
     }
+    if (!IsScanned(Portions::BranchIslands))
+      DiscardPortion(m_branch_islands);
   }
-  if (std::regex_search(head, tail, match, re_linktime_size_decreasing_optimizations_header,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_linktime_size_decreasing_optimizations_header))
   {
     line_number += 2u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile,
+                                   Portions::LinktimeSizeDecreasingOptimizations, {}, head,
+                                   line_number};
     auto& portion = m_linktime_size_decreasing_optimizations.emplace();
     const ScanError error = portion.Scan(head, tail, line_number);
     if (error != ScanError::None)
@@ -389,12 +742,16 @@ Map::ScanError Map::Scan(const char* head, const char* const tail, std::size_t&
       m_linktime_size_decreasing_optimizations.reset();
       return error;
     }
+    if (!IsScanned(Portions::LinktimeSizeDecreasingOptimizations))
+      DiscardPortion(m_linktime_size_decreasing_optimizations);
   }
-  if (std::regex_search(head, tail, match, re_linktime_size_increasing_optimizations_header,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_linktime_size_increasing_optimizations_header))
   {
     line_number += 2u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile,
+                                   Portions::LinktimeSizeIncreasingOptimizations, {}, head,
+                                   line_number};
     auto& portion = m_linktime_size_increasing_optimizations.emplace();
     const ScanError error = portion.Scan(head, tail, line_number);
     if (error != ScanError::None)
@@ -402,38 +759,55 @@ Map::ScanError Map::Scan(const char* head, const char* const tail, std::size_t&
       m_linktime_size_increasing_optimizations.reset();
       return error;
     }
+    if (!IsScanned(Portions::LinktimeSizeIncreasingOptimizations))
+      DiscardPortion(m_linktime_size_increasing_optimizations);
   }
 NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE:
-  while (std::regex_search(head, tail, match, re_section_layout_header,
-                           std::regex_constants::match_continuous))
+  if (IsScanned(Portions::SectionLayouts) && Mijo::ResolveThreadCount(m_options.m_thread_count) > 1)
+  {
+    const ScanError error = ScanSectionLayoutsParallel(head, tail, line_number, get_line_index());
+    if (error != ScanError::None)
+      return error;
+  }
+  // Whatever was not already scanned in parallel is scanned here.
+  while (MatchRegex(head, tail, match, *re_section_layout_header))
   {
     line_number += 3u;
     head = match[0].second;
-    const ScanError error = ScanPrologue_SectionLayout(head, tail, line_number, match[1].view());
+    const ScanError error =
+        IsScanned(Portions::SectionLayouts) ?
+            ScanPrologue_SectionLayout(head, tail, line_number, match[1].view(), m_section_layouts,
+                                       m_string_pool, m_diagnostics, m_scan_profile) :
+            SkipSectionLayout(head, tail, line_number, get_line_index());
     if (error != ScanError::None)
       return error;
   }
-  if (std::regex_search(head, tail, match, re_memory_map_header,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_memory_map_header))
   {
     line_number += 3u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile, Portions::MemoryMap, {}, head, line_number};
     const ScanError error = ScanPrologue_MemoryMap(head, tail, line_number);
     if (error != ScanError::None)
       return error;
+    if (!IsScanned(Portions::MemoryMap))
+      DiscardPortion(m_memory_map);
   }
-  if (std::regex_search(head, tail, match, re_linker_generated_symbols_header,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_linker_generated_symbols_header))
   {
     line_number += 3u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile, Portions::LinkerGeneratedSymbols, {}, head,
+                                   line_number};
     auto& portion = m_linker_generated_symbols.emplace();
-    const ScanError error = portion.Scan(head, tail, line_number);
+    const ScanError error = portion.Scan(head, tail, line_number, m_options, m_string_pool);
     if (error != ScanError::None)
     {
       m_linker_generated_symbols.reset();
       return error;
     }
+    if (!IsScanned(Portions::LinkerGeneratedSymbols))
+      DiscardPortion(m_linker_generated_symbols);
   }
   return ScanForGarbage(head, tail);
 }
@@ -457,15 +831,17 @@ Map::ScanError Map::ScanTLOZTP(const char* head, const char* const tail, std::si
   // procrastinate updating the JUTException library. These linker maps contain prologue-free,
   // three-column section layout portions, and nothing else. Also, not that it matters to this
   // scan function, the line endings of the linker maps left on disc were Unix style (LF).
-  while (std::regex_search(head, tail, match, re_section_layout_header_modified_b,
-                           std::regex_constants::match_continuous))
+  while (MatchRegex(head, tail, match, *re_section_layout_header_modified_b))
   {
-    const std::string_view section_name = match[1].view();
+    const std::string_view section_name = m_string_pool.Store(match[1].view());
     line_number += 1u;
     head = match[0].second;
+    const PortionProfiler profiler{m_scan_profile, Portions::SectionLayouts, section_name, head,
+                                   line_number};
     SectionLayout portion{SectionLayout::ToSectionKind(section_name), section_name};
     portion.SetVersionRange(Version::version_3_0_4, Version::version_3_0_4);
-    const ScanError error = portion.ScanTLOZTP(head, tail, line_number);
+    const ScanError error =
+        portion.ScanTLOZTP(head, tail, line_number, m_options, m_string_pool, m_diagnostics);
     if (error != ScanError::None)
       return error;
     m_section_layouts.push_back(std::move(portion));
@@ -487,15 +863,17 @@ Map::ScanError Map::ScanSMGalaxy(const char* head, const char* const tail, std::
   line_number = 1;
 
   // We only see this header once, as every symbol is mashed into an imaginary ".text" section.
-  if (std::regex_search(head, tail, match, re_section_layout_header_modified_a,
-                        std::regex_constants::match_continuous))
+  if (MatchRegex(head, tail, match, *re_section_layout_header_modified_a))
   {
     line_number += 2u;
     head = match[0].second;
     // TODO: detect and split Section Layout subtext by observing the Starting Address
-    SectionLayout portion{SectionLayout::Kind::Code, match[1].view()};
+    const PortionProfiler profiler{m_scan_profile, Portions::SectionLayouts, match[1].view(), head,
+                                   line_number};
+    SectionLayout portion{SectionLayout::Kind::Code, m_string_pool.Store(match[1].view())};
     portion.SetVersionRange(Version::version_3_0_4, Version::Latest);
-    const ScanError error = portion.Scan4Column(head, tail, line_number);
+    const ScanError error =
+        portion.Scan4Column(head, tail, line_number, m_options, m_string_pool, m_diagnostics);
     if (error != ScanError::None)
       return error;
     m_section_layouts.push_back(std::move(portion));
@@ -507,8 +885,9 @@ Map::ScanError Map::ScanSMGalaxy(const char* head, const char* const tail, std::
   // It seems like a mistake, but for a few examples, a tiny bit of simple-style,
   // headerless, CodeWarrior for Wii 1.0 (at minimum) Memory Map can be found.
   {
+    const PortionProfiler profiler{m_scan_profile, Portions::MemoryMap, {}, head, line_number};
     auto& portion = m_memory_map.emplace(false, false, false);
-    const ScanError error = portion.ScanSimple(head, tail, line_number);
+    const ScanError error = portion.ScanSimple(head, tail, line_number, m_options, m_string_pool);
     if (error != ScanError::None)
     {
       m_memory_map.reset();
@@ -518,99 +897,272 @@ Map::ScanError Map::ScanSMGalaxy(const char* head, const char* const tail, std::
   return ScanForGarbage(head, tail);
 }
 
+Map::ScanError Map::ScanFile(const std::filesystem::path& path, std::size_t& line_number,
+                             const ScanFlavor flavor)
+{
+  line_number = 0;
+  Mijo::MappedFile mapped_file;
+  if (!mapped_file.Open(path))
+    return ScanError::FileUnreadable;
+  const ScanError error = ScanFlavored(mapped_file.GetSpan(), line_number, flavor);
+  if (m_string_pool.GetMode() == StringStorage::Borrowed)
+    m_mapped_file = std::move(mapped_file);
+  return error;
+}
+
+std::vector<Map::BatchResult> Map::ScanFiles(const std::span<const std::filesystem::path> paths,
+                                             const Options& options, const unsigned thread_count,
+                                             const ScanFlavor flavor)
+{
+  std::vector<BatchResult> results;
+  results.reserve(paths.size());
+  std::vector<std::pair<std::uintmax_t, std::size_t>> sizes;
+  sizes.reserve(paths.size());
+  for (const std::filesystem::path& path : paths)
+  {
+    // Files that cannot be measured are left for last, where they should fail to open quickly.
+    std::error_code error_code;
+    const std::uintmax_t size = std::filesystem::file_size(path, error_code);
+    sizes.emplace_back(error_code ? 0 : size, results.size());
+    results.push_back({path, Map{options}, ScanError::None, 0});
+  }
+  std::ranges::stable_sort(sizes, std::ranges::greater{},
+                           [](const auto& size_and_index) { return size_and_index.first; });
+  Mijo::ParallelForStealing(sizes.size(), thread_count, [&](const std::size_t i) {
+    BatchResult& result = results[sizes[i].second];
+    result.m_error = result.m_map.ScanFile(result.m_path, result.m_line_number, flavor);
+  });
+  return results;
+}
+
+Map::ScanError Map::ScanFlavored(const std::span<const char> span, std::size_t& line_number,
+                                 const ScanFlavor flavor)
+{
+  switch (flavor)
+  {
+  case ScanFlavor::Normal:
+    return Scan(span, line_number);
+  case ScanFlavor::TLOZTP:
+    return ScanTLOZTP(span, line_number);
+  case ScanFlavor::SMGalaxy:
+    return ScanSMGalaxy(span, line_number);
+  }
+  return ScanError::Fail;
+}
+
+// Text is formatted into a buffer of its own, which is handed off in large chunks to wherever the
+// text is headed. With nowhere to hand it off to, the text is only measured.
+class Map::Printer
+{
+public:
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  Printer() = default;
+  explicit Printer(std::ostream& stream) : m_sink(&stream) {}
+  explicit Printer(std::string& string) : m_sink(&string) {}
+  explicit Printer(const std::span<char> span) : m_sink(span) {}
+
+  // Formats are compiled with FMT_COMPILE, which spares parsing each one over again every line.
+  template <class Format, class... Args>
+  void Print(const Format& format, const Args&... args)
+  {
+    fmt::format_to(fmt::appender(m_buffer), format, args...);
+    if (m_buffer.size() >= chunk_size)
+      Flush();
+  }
+  void Put(const char c) { m_buffer.push_back(c); }
+  // Hands off text that was printed elsewhere, right after everything printed so far.
+  void Write(const std::string_view text)
+  {
+    Flush();
+    HandOff(text);
+  }
+  // Hands off whatever is left and gives back how much text there was in all.
+  std::size_t Finish()
+  {
+    Flush();
+    return m_size;
+  }
+
+private:
+  void Flush()
+  {
+    HandOff({m_buffer.data(), m_buffer.size()});
+    m_buffer.clear();
+  }
+  void HandOff(const std::string_view text)
+  {
+    if (std::ostream* const* const stream = std::get_if<std::ostream*>(&m_sink))
+      (*stream)->write(text.data(), static_cast<std::streamsize>(text.size()));
+    else if (std::string* const* const string = std::get_if<std::string*>(&m_sink))
+      (*string)->append(text);
+    else if (const std::span<char>* const span = std::get_if<std::span<char>>(&m_sink))
+      std::copy_n(text.data(), std::min(text.size(), span->size() - std::min(span->size(), m_size)),
+                  span->data() + std::min(span->size(), m_size));
+    m_size += text.size();
+  }
+
+  fmt::memory_buffer m_buffer;
+  std::variant<std::monostate, std::ostream*, std::string*, std::span<char>> m_sink;
+  std::size_t m_size = 0;
+};
+
 void Map::Print(std::ostream& stream, std::size_t& line_number) const
 {
-  auto unresolved_head = m_unresolved_symbols.cbegin(),
-       unresolved_tail = m_unresolved_symbols.cend();
+  Printer printer{stream};
+  Print(printer, line_number);
+  printer.Finish();
+}
+
+void Map::Print(std::string& string, std::size_t& line_number) const
+{
+  Printer printer{string};
+  Print(printer, line_number);
+  printer.Finish();
+}
+
+std::size_t Map::Print(const std::span<char> span, std::size_t& line_number) const
+{
+  Printer printer{span};
+  Print(printer, line_number);
+  return printer.Finish();
+}
+
+std::size_t Map::GetPrintSize() const
+{
+  Printer printer;
+  std::size_t line_number = 0;
+  Print(printer, line_number);
+  return printer.Finish();
+}
+
+void Map::Print(Printer& printer, std::size_t& line_number) const
+{
   // "Link map of %s\r\n"
-  fmt::print(stream, "Link map of {:s}\r\n", m_entry_point_name);
+  printer.Print(FMT_COMPILE("Link map of {:s}\r\n"), m_entry_point_name);
   line_number = 2;
-  if (m_normal_symbol_closure)
-    m_normal_symbol_closure->Print(stream, unresolved_head, unresolved_tail, line_number);
-  if (m_eppc_pattern_matching)
-    m_eppc_pattern_matching->Print(stream, line_number);
-  if (m_dwarf_symbol_closure)
-    m_dwarf_symbol_closure->Print(stream, unresolved_head, unresolved_tail, line_number);
-  // This handles post-print unresolved symbols as well as when no symbol closure(s) exist.
-  PrintUnresolvedSymbols(stream, unresolved_head, unresolved_tail, line_number);
+
+  // Only the symbol closures ever look at the line number, to know where unresolved symbols go,
+  // and they come first. Every other portion only counts its lines, so all of them can be printed
+  // on their own as long as they are put back together in order.
+  std::vector<std::function<void(Printer&, std::size_t&)>> parts;
+  parts.emplace_back([this](Printer& printer, std::size_t& line_number) {
+    auto unresolved_head = m_unresolved_symbols.cbegin(),
+         unresolved_tail = m_unresolved_symbols.cend();
+    if (const auto& normal_symbol_closure = GetNormalSymbolClosure())
+      normal_symbol_closure->Print(printer, unresolved_head, unresolved_tail, line_number);
+    if (m_eppc_pattern_matching)
+      m_eppc_pattern_matching->Print(printer, line_number);
+    if (const auto& dwarf_symbol_closure = GetDwarfSymbolClosure())
+      dwarf_symbol_closure->Print(printer, unresolved_head, unresolved_tail, line_number);
+    // This handles post-print unresolved symbols as well as when no symbol closure(s) exist.
+    PrintUnresolvedSymbols(printer, unresolved_head, unresolved_tail, line_number);
+  });
+  const auto add_part = [&parts](const auto& portion) {
+    parts.emplace_back([&portion](Printer& printer, std::size_t& line_number) {
+      portion.Print(printer, line_number);
+    });
+  };
   if (m_linker_opts)
-    m_linker_opts->Print(stream, line_number);
+    add_part(*m_linker_opts);
   if (m_mixed_mode_islands)
-    m_mixed_mode_islands->Print(stream, line_number);
+    add_part(*m_mixed_mode_islands);
   if (m_branch_islands)
-    m_branch_islands->Print(stream, line_number);
+    add_part(*m_branch_islands);
   if (m_linktime_size_decreasing_optimizations)
-    m_linktime_size_decreasing_optimizations->Print(stream, line_number);
+    add_part(*m_linktime_size_decreasing_optimizations);
   if (m_linktime_size_increasing_optimizations)
-    m_linktime_size_increasing_optimizations->Print(stream, line_number);
+    add_part(*m_linktime_size_increasing_optimizations);
   for (const auto& section_layout : m_section_layouts)
-    section_layout.Print(stream, line_number);
+    add_part(section_layout);
   if (m_memory_map)
-    m_memory_map->Print(stream, line_number);
+    add_part(*m_memory_map);
   if (m_linker_generated_symbols)
-    m_linker_generated_symbols->Print(stream, line_number);
+    add_part(*m_linker_generated_symbols);
+
+  if (Mijo::ResolveThreadCount(m_options.m_thread_count) < 2)
+  {
+    for (const auto& part : parts)
+      part(printer, line_number);
+    return;
+  }
+  struct PartText
+  {
+    std::string m_text;
+    std::size_t m_line_number;
+  };
+  std::vector<PartText> part_texts(parts.size(), PartText{{}, line_number});
+  Mijo::ParallelFor(parts.size(), m_options.m_thread_count, [&](const std::size_t i) {
+    Printer part_printer{part_texts[i].m_text};
+    parts[i](part_printer, part_texts[i].m_line_number);
+    part_printer.Finish();
+  });
+  const std::size_t first_line_number = line_number;
+  for (const PartText& part_text : part_texts)
+  {
+    printer.Write(part_text.m_text);
+    line_number += part_text.m_line_number - first_line_number;
+  }
 }
 
 void Map::PrintUnresolvedSymbols(  //
-    std::ostream& stream, UnresolvedSymbols::const_iterator& head,
+    Printer& printer, UnresolvedSymbols::const_iterator& head,
     const UnresolvedSymbols::const_iterator tail, std::size_t& line_number)
 {
   while (head != tail && head->first == line_number)
   {
     // ">>> SYMBOL NOT FOUND: %s\r\n"
-    fmt::print(stream, ">>> SYMBOL NOT FOUND: {:s}\r\n", (head++)->second);
+    printer.Print(FMT_COMPILE(">>> SYMBOL NOT FOUND: {:s}\r\n"), (head++)->second);
     line_number += 1u;
   }
 }
 
 // clang-format off
-static const std::regex re_section_layout_3column_prologue_1{
+static const LinePattern<Literal<"  Starting        Virtual">> re_section_layout_3column_prologue_1{
 //  "  Starting        Virtual\r\n"
     "  Starting        Virtual\r?\n"};
-static const std::regex re_section_layout_3column_prologue_2{
+static const LinePattern<Literal<"  address  Size   address">> re_section_layout_3column_prologue_2{
 //  "  address  Size   address\r\n"
     "  address  Size   address\r?\n"};
-static const std::regex re_section_layout_3column_prologue_3{
+static const LinePattern<Literal<"  -----------------------">> re_section_layout_3column_prologue_3{
 //  "  -----------------------\r\n"
     "  -----------------------\r?\n"};
-static const std::regex re_section_layout_4column_prologue_1{
+static const LinePattern<Literal<"  Starting        Virtual  File">>
+    re_section_layout_4column_prologue_1{
 //  "  Starting        Virtual  File\r\n"
     "  Starting        Virtual  File\r?\n"};
-static const std::regex re_section_layout_4column_prologue_2{
+static const LinePattern<Literal<"  address  Size   address  offset">>
+    re_section_layout_4column_prologue_2{
 //  "  address  Size   address  offset\r\n"
     "  address  Size   address  offset\r?\n"};
-static const std::regex re_section_layout_4column_prologue_3{
+static const LinePattern<Literal<"  ---------------------------------">>
+    re_section_layout_4column_prologue_3{
 //  "  ---------------------------------\r\n"
     "  ---------------------------------\r?\n"};
 // clang-format on
 
-Map::ScanError Map::ScanPrologue_SectionLayout(const char*& head, const char* const tail,
-                                               std::size_t& line_number,
-                                               const std::string_view name)
+// Only the prologue tells apart the section layouts of old and new linkers, as the units of both
+// can look alike.
+Map::ScanError Map::ScanSectionLayoutPrologue(const char*& head, const char* const tail,
+                                              std::size_t& line_number,
+                                              SectionLayout& section_layout) const
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = m_options.m_use_regex_fallback;
+  LineMatch match;
 
-  if (std::regex_search(head, tail, match, re_section_layout_3column_prologue_1,
-                        std::regex_constants::match_continuous))
+  if (re_section_layout_3column_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_section_layout_3column_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_section_layout_3column_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
-      if (std::regex_search(head, tail, match, re_section_layout_3column_prologue_3,
-                            std::regex_constants::match_continuous))
+      if (re_section_layout_3column_prologue_3.Match(head, tail, match, use_regex))
       {
         line_number += 1u;
         head = match[0].second;
-        SectionLayout portion{SectionLayout::ToSectionKind(name), name};
-        portion.SetVersionRange(Version::Unknown, Version::version_2_4_7_build_107);
-        const ScanError error = portion.Scan3Column(head, tail, line_number);
-        if (error != ScanError::None)
-          return error;
-        m_section_layouts.push_back(std::move(portion));
+        section_layout.SetVersionRange(Version::Unknown, Version::version_2_4_7_build_107);
       }
       else
       {
@@ -622,27 +1174,19 @@ Map::ScanError Map::ScanPrologue_SectionLayout(const char*& head, const char* co
       return ScanError::SectionLayoutBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_section_layout_4column_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_section_layout_4column_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_section_layout_4column_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_section_layout_4column_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
-      if (std::regex_search(head, tail, match, re_section_layout_4column_prologue_3,
-                            std::regex_constants::match_continuous))
+      if (re_section_layout_4column_prologue_3.Match(head, tail, match, use_regex))
       {
         line_number += 1u;
         head = match[0].second;
-        SectionLayout portion{SectionLayout::ToSectionKind(name), name};
-        portion.SetVersionRange(Version::version_3_0_4, Version::Latest);
-        const ScanError error = portion.Scan4Column(head, tail, line_number);
-        if (error != ScanError::None)
-          return error;
-        m_section_layouts.push_back(std::move(portion));
+        section_layout.SetVersionRange(Version::version_3_0_4, Version::Latest);
       }
       else
       {
@@ -661,65 +1205,243 @@ Map::ScanError Map::ScanPrologue_SectionLayout(const char*& head, const char* co
   return ScanError::None;
 }
 
+Map::ScanError Map::ScanPrologue_SectionLayout(const char*& head, const char* const tail,
+                                               std::size_t& line_number,
+                                               const std::string_view name,
+                                               std::deque<SectionLayout>& section_layouts,
+                                               Mijo::StringPool& string_pool,
+                                               Diagnostics& diagnostics,
+                                               ScanProfile& scan_profile) const
+{
+  const PortionProfiler profiler{scan_profile, Portions::SectionLayouts, name, head, line_number};
+  SectionLayout portion{SectionLayout::ToSectionKind(name), string_pool.Store(name)};
+  ScanError error = ScanSectionLayoutPrologue(head, tail, line_number, portion);
+  if (error != ScanError::None)
+    return error;
+  if (portion.GetMinVersion() < Version::version_3_0_4)
+    error = portion.Scan3Column(head, tail, line_number, m_options, string_pool, diagnostics);
+  else
+    error = portion.Scan4Column(head, tail, line_number, m_options, string_pool, diagnostics);
+  if (error != ScanError::None)
+    return error;
+  section_layouts.push_back(std::move(portion));
+  return ScanError::None;
+}
+
+// Finds the first empty line at or after head, counting the lines skipped along the way. Lines in
+// the body of a section layout are never empty, and every portion header begins with one. Both
+// come straight from the line index, so none of the text in between is looked at again.
+static const char* FindEmptyLine(const Mijo::LineIndex& line_index, const char* const head,
+                                 std::size_t& line_count) noexcept
+{
+  const char* const empty_line = line_index.FindEmptyLine(head);
+  line_count += line_index.CountLineFeeds(head, empty_line);
+  return empty_line;
+}
+
+// A section layout that is not wanted still has its prologue checked for the version clue it
+// gives, but its body is only searched for the empty line that ends it.
+Map::ScanError Map::SkipSectionLayout(const char*& head, const char* const tail,
+                                      std::size_t& line_number,
+                                      const Mijo::LineIndex& line_index)
+{
+  SectionLayout portion{SectionLayout::Kind::Unknown, {}};
+  const ScanError error = ScanSectionLayoutPrologue(head, tail, line_number, portion);
+  if (error != ScanError::None)
+    return error;
+  m_skipped_portions.SetVersionRange(portion.GetMinVersion(), portion.GetMaxVersion());
+  head = FindEmptyLine(line_index, head, line_number);
+  return ScanError::None;
+}
+
+// When none of the portions before the section layouts are wanted, they can be jumped over in one
+// go, as the section layouts, memory map, and linker generated symbols each begin with an empty
+// line followed by a header. What little the skipped text says about the linker version is found
+// with a plain search rather than a scan.
+void Map::SkipToTrailingPortions(const char*& head, const char* const tail,
+                                 std::size_t& line_number, const Mijo::LineIndex& line_index)
+{
+  const auto skip_portion = [this](const PortionBase& portion) {
+    m_skipped_portions.SetVersionRange(portion.GetMinVersion(), portion.GetMaxVersion());
+  };
+  // A scan always comes away with these two, even if they turn out to be empty.
+  skip_portion(EPPC_PatternMatching());
+  skip_portion(LinkerOpts());
+
+  const char* const skipped_head = head;
+  std::cmatch match;
+  while ((head = FindEmptyLine(line_index, head, line_number)) != tail)
+  {
+    if (MatchRegex(head, tail, match, *re_mixed_mode_islands_header))
+      skip_portion(MixedModeIslands());
+    else if (MatchRegex(head, tail, match, *re_branch_islands_header))
+      skip_portion(BranchIslands());
+    else if (MatchRegex(head, tail, match, *re_section_layout_header) ||
+             MatchRegex(head, tail, match, *re_memory_map_header) ||
+             MatchRegex(head, tail, match, *re_linker_generated_symbols_header))
+      break;
+    head += (*head == '\r') ? 2 : 1;
+    line_number += 1u;
+  }
+  const std::string_view skipped{skipped_head, head};
+  if (skipped.find("] >>> UNREFERENCED DUPLICATE ") != std::string_view::npos)
+    m_skipped_portions.SetVersionRange(Version::version_2_3_3_build_137, Version::Latest);
+  for (std::size_t pos = skipped.find("] _dtors$99 ("); pos != std::string_view::npos;
+       pos = skipped.find("] _dtors$99 (", pos + 1))
+  {
+    const std::string_view line = skipped.substr(pos, skipped.find('\n', pos) - pos);
+    if (line.find(") found in Linker Generated Symbol File ") != std::string_view::npos)
+    {
+      m_skipped_portions.SetVersionRange(Version::version_3_0_4, Version::Latest);
+      break;
+    }
+  }
+}
+
+Map::ScanError Map::ScanSectionLayoutsParallel(const char*& head, const char* const tail,
+                                               std::size_t& line_number,
+                                               const Mijo::LineIndex& line_index)
+{
+  struct Task
+  {
+    const char* m_head;
+    const char* m_tail;
+    std::size_t m_line_number;
+    std::string_view m_name;
+    Mijo::StringPool m_string_pool;
+    std::deque<SectionLayout> m_section_layouts;
+    Diagnostics m_diagnostics;
+    ScanProfile m_scan_profile;
+    ScanError m_error;
+  };
+  std::vector<Task> tasks;
+
+  // Splitting the section layouts apart only takes a quick search for the empty lines between
+  // them, and counting lines along the way gives each one its starting line number.
+  Mijo::CMatchResults match;
+  const char* split_head = head;
+  std::size_t split_line_number = line_number;
+  while (MatchRegex(split_head, tail, match, *re_section_layout_header))
+  {
+    const char* const task_head = match[0].second;
+    const std::size_t task_line_number = split_line_number + 3u;
+    std::size_t line_count = 0;
+    split_head = FindEmptyLine(line_index, task_head, line_count);
+    split_line_number = task_line_number + line_count;
+    tasks.push_back({task_head, split_head, task_line_number, match[1].view(),
+                     Mijo::StringPool{m_options.m_string_storage}, {},
+                     Diagnostics{m_options.m_warnings}, {}, ScanError::None});
+  }
+  if (tasks.size() < 2)
+    return ScanError::None;
+
+  Mijo::ParallelFor(tasks.size(), m_options.m_thread_count, [this, &tasks](const std::size_t i) {
+    Task& task = tasks[i];
+    task.m_error = ScanPrologue_SectionLayout(task.m_head, task.m_tail, task.m_line_number,
+                                              task.m_name, task.m_section_layouts,
+                                              task.m_string_pool, task.m_diagnostics,
+                                              task.m_scan_profile);
+  });
+
+  // Merging in file order reproduces exactly what scanning one after another would have done.
+  for (Task& task : tasks)
+  {
+    m_string_pool.Merge(std::move(task.m_string_pool));
+    m_diagnostics.Merge(std::move(task.m_diagnostics));
+    m_scan_profile.Merge(std::move(task.m_scan_profile));
+    head = task.m_head;
+    line_number = task.m_line_number;
+    if (task.m_error != ScanError::None)
+      return task.m_error;
+    for (SectionLayout& section_layout : task.m_section_layouts)
+      m_section_layouts.push_back(std::move(section_layout));
+    // A section layout that stopped short of the next empty line would have ended the loop back
+    // in Map::Scan, which now resumes from where it stopped. Anything after it is thrown away.
+    if (task.m_head != task.m_tail)
+      break;
+  }
+  return ScanError::None;
+}
+
 // clang-format off
-static const std::regex re_memory_map_simple_prologue_1_old{
+static const LinePattern<Literal<"                   Starting Size     File">>
+    re_memory_map_simple_prologue_1_old{
 //  "                   Starting Size     File\r\n"
     "                   Starting Size     File\r?\n"};
-static const std::regex re_memory_map_simple_prologue_2_old{
+static const LinePattern<Literal<"                   address           Offset">>
+    re_memory_map_simple_prologue_2_old{
 //  "                   address           Offset\r\n"
     "                   address           Offset\r?\n"};
-static const std::regex re_memory_map_romram_prologue_1_old{
+static const LinePattern<Literal<"                   Starting Size     File     ROM      RAM Buffer">>
+    re_memory_map_romram_prologue_1_old{
 //  "                   Starting Size     File     ROM      RAM Buffer\r\n"
     "                   Starting Size     File     ROM      RAM Buffer\r?\n"};
-static const std::regex re_memory_map_romram_prologue_2_old{
+static const LinePattern<Literal<"                   address           Offset   Address  Address">>
+    re_memory_map_romram_prologue_2_old{
 //  "                   address           Offset   Address  Address\r\n"
     "                   address           Offset   Address  Address\r?\n"};
-static const std::regex re_memory_map_simple_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File">>
+    re_memory_map_simple_prologue_1{
 //  "                       Starting Size     File\r\n"
     "                       Starting Size     File\r?\n"};
-static const std::regex re_memory_map_simple_prologue_2{
+static const LinePattern<Literal<"                       address           Offset">>
+    re_memory_map_simple_prologue_2{
 //  "                       address           Offset\r\n"
     "                       address           Offset\r?\n"};
-static const std::regex re_memory_map_romram_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File     ROM      RAM Buffer">>
+    re_memory_map_romram_prologue_1{
 //  "                       Starting Size     File     ROM      RAM Buffer\r\n"
     "                       Starting Size     File     ROM      RAM Buffer\r?\n"};
-static const std::regex re_memory_map_romram_prologue_2{
+static const LinePattern<Literal<"                       address           Offset   Address  Address">>
+    re_memory_map_romram_prologue_2{
 //  "                       address           Offset   Address  Address\r\n"
     "                       address           Offset   Address  Address\r?\n"};
-static const std::regex re_memory_map_srecord_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File       S-Record">>
+    re_memory_map_srecord_prologue_1{
 //  "                       Starting Size     File       S-Record\r\n"
     "                       Starting Size     File       S-Record\r?\n"};
-static const std::regex re_memory_map_srecord_prologue_2{
+static const LinePattern<Literal<"                       address           Offset     Line">>
+    re_memory_map_srecord_prologue_2{
 //  "                       address           Offset     Line\r\n"
     "                       address           Offset     Line\r?\n"};
-static const std::regex re_memory_map_binfile_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File     Bin File Bin File">>
+    re_memory_map_binfile_prologue_1{
 //  "                       Starting Size     File     Bin File Bin File\r\n"
     "                       Starting Size     File     Bin File Bin File\r?\n"};
-static const std::regex re_memory_map_binfile_prologue_2{
+static const LinePattern<Literal<"                       address           Offset   Offset   Name">>
+    re_memory_map_binfile_prologue_2{
 //  "                       address           Offset   Offset   Name\r\n"
     "                       address           Offset   Offset   Name\r?\n"};
-static const std::regex re_memory_map_romram_srecord_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File     ROM      RAM Buffer  S-Record">>
+    re_memory_map_romram_srecord_prologue_1{
 //  "                       Starting Size     File     ROM      RAM Buffer  S-Record\r\n"
     "                       Starting Size     File     ROM      RAM Buffer  S-Record\r?\n"};
-static const std::regex re_memory_map_romram_srecord_prologue_2{
+static const LinePattern<Literal<"                       address           Offset   Address  Address     Line">>
+    re_memory_map_romram_srecord_prologue_2{
 //  "                       address           Offset   Address  Address     Line\r\n"
     "                       address           Offset   Address  Address     Line\r?\n"};
-static const std::regex re_memory_map_romram_binfile_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File     ROM      RAM Buffer Bin File Bin File">>
+    re_memory_map_romram_binfile_prologue_1{
 //  "                       Starting Size     File     ROM      RAM Buffer Bin File Bin File\r\n"
     "                       Starting Size     File     ROM      RAM Buffer Bin File Bin File\r?\n"};
-static const std::regex re_memory_map_romram_binfile_prologue_2{
+static const LinePattern<Literal<"                       address           Offset   Address  Address    Offset   Name">>
+    re_memory_map_romram_binfile_prologue_2{
 //  "                       address           Offset   Address  Address    Offset   Name\r\n"
     "                       address           Offset   Address  Address    Offset   Name\r?\n"};
-static const std::regex re_memory_map_srecord_binfile_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File        S-Record Bin File Bin File">>
+    re_memory_map_srecord_binfile_prologue_1{
 //  "                       Starting Size     File        S-Record Bin File Bin File\r\n"
     "                       Starting Size     File        S-Record Bin File Bin File\r?\n"};
-static const std::regex re_memory_map_srecord_binfile_prologue_2{
+static const LinePattern<Literal<"                       address           Offset      Line     Offset   Name">>
+    re_memory_map_srecord_binfile_prologue_2{
 //  "                       address           Offset      Line     Offset   Name\r\n"
     "                       address           Offset      Line     Offset   Name\r?\n"};
-static const std::regex re_memory_map_romram_srecord_binfile_prologue_1{
+static const LinePattern<Literal<"                       Starting Size     File     ROM      RAM Buffer    S-Record Bin File Bin File">>
+    re_memory_map_romram_srecord_binfile_prologue_1{
 //  "                       Starting Size     File     ROM      RAM Buffer    S-Record Bin File Bin File\r\n"
     "                       Starting Size     File     ROM      RAM Buffer    S-Record Bin File Bin File\r?\n"};
-static const std::regex re_memory_map_romram_srecord_binfile_prologue_2{
+static const LinePattern<Literal<"                       address           Offset   Address  Address       Line     Offset   Name">>
+    re_memory_map_romram_srecord_binfile_prologue_2{
 //  "                       address           Offset   Address  Address       Line     Offset   Name\r\n"
     "                       address           Offset   Address  Address       Line     Offset   Name\r?\n"};
 // clang-format on
@@ -727,20 +1449,20 @@ static const std::regex re_memory_map_romram_srecord_binfile_prologue_2{
 Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const tail,
                                            std::size_t& line_number)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = m_options.m_use_regex_fallback;
+  LineMatch match;
 
-  if (std::regex_search(head, tail, match, re_memory_map_simple_prologue_1_old,
-                        std::regex_constants::match_continuous))
+  if (re_memory_map_simple_prologue_1_old.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_simple_prologue_2_old,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_simple_prologue_2_old.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(false);
-      const ScanError error = portion.ScanSimple_old(head, tail, line_number);
+      const ScanError error =
+          portion.ScanSimple_old(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -752,18 +1474,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_romram_prologue_1_old,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_romram_prologue_1_old.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_romram_prologue_2_old,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_romram_prologue_2_old.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(true);
-      const ScanError error = portion.ScanRomRam_old(head, tail, line_number);
+      const ScanError error =
+          portion.ScanRomRam_old(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -775,18 +1496,16 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_simple_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_simple_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_simple_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_simple_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(false, false, false);
-      const ScanError error = portion.ScanSimple(head, tail, line_number);
+      const ScanError error = portion.ScanSimple(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -798,18 +1517,16 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_romram_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_romram_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_romram_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_romram_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(true, false, false);
-      const ScanError error = portion.ScanRomRam(head, tail, line_number);
+      const ScanError error = portion.ScanRomRam(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -821,18 +1538,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_srecord_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_srecord_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_srecord_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_srecord_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(false, true, false);
-      const ScanError error = portion.ScanSRecord(head, tail, line_number);
+      const ScanError error =
+          portion.ScanSRecord(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -844,18 +1560,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_binfile_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_binfile_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_binfile_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_binfile_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(false, false, true);
-      const ScanError error = portion.ScanBinFile(head, tail, line_number);
+      const ScanError error =
+          portion.ScanBinFile(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -867,18 +1582,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_romram_srecord_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_romram_srecord_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_romram_srecord_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_romram_srecord_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(true, true, false);
-      const ScanError error = portion.ScanRomRamSRecord(head, tail, line_number);
+      const ScanError error =
+          portion.ScanRomRamSRecord(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -890,18 +1604,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_romram_binfile_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_romram_binfile_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_romram_binfile_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_romram_binfile_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(true, false, true);
-      const ScanError error = portion.ScanRomRamBinFile(head, tail, line_number);
+      const ScanError error =
+          portion.ScanRomRamBinFile(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -913,18 +1626,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_srecord_binfile_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_srecord_binfile_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_srecord_binfile_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_srecord_binfile_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(false, true, true);
-      const ScanError error = portion.ScanSRecordBinFile(head, tail, line_number);
+      const ScanError error =
+          portion.ScanSRecordBinFile(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -936,18 +1648,17 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
       return ScanError::MemoryMapBadPrologue;
     }
   }
-  else if (std::regex_search(head, tail, match, re_memory_map_romram_srecord_binfile_prologue_1,
-                             std::regex_constants::match_continuous))
+  else if (re_memory_map_romram_srecord_binfile_prologue_1.Match(head, tail, match, use_regex))
   {
     line_number += 1u;
     head = match[0].second;
-    if (std::regex_search(head, tail, match, re_memory_map_romram_srecord_binfile_prologue_2,
-                          std::regex_constants::match_continuous))
+    if (re_memory_map_romram_srecord_binfile_prologue_2.Match(head, tail, match, use_regex))
     {
       line_number += 1u;
       head = match[0].second;
       auto& portion = m_memory_map.emplace(true, true, true);
-      const ScanError error = portion.ScanRomRamSRecordBinFile(head, tail, line_number);
+      const ScanError error =
+          portion.ScanRomRamSRecordBinFile(head, tail, line_number, m_options, m_string_pool);
       if (error != ScanError::None)
       {
         m_memory_map.reset();
@@ -967,37 +1678,37 @@ Map::ScanError Map::ScanPrologue_MemoryMap(const char*& head, const char* const
 }
 
 // clang-format off
-static const std::regex re_excluded_symbol{
+static const Mijo::LazyRegex re_excluded_symbol{
 //  ">>> EXCLUDED SYMBOL %s (%s,%s) found in %s %s\r\n"
     ">>> EXCLUDED SYMBOL (.*) \\((.*),(.*)\\) found in (.*) (.*)\r\n"};
-static const std::regex re_wasnt_passed_section{
+static const Mijo::LazyRegex re_wasnt_passed_section{
 //  ">>> %s wasn't passed a section\r\n"
     ">>> (.*) wasn't passed a section\r\n"};
-static const std::regex re_dynamic_symbol_referenced{
+static const Mijo::LazyRegex re_dynamic_symbol_referenced{
 //  ">>> DYNAMIC SYMBOL: %s referenced\r\n"
     ">>> DYNAMIC SYMBOL: (.*) referenced\r\n"};
-static const std::regex re_module_symbol_name_too_large{
+static const Mijo::LazyRegex re_module_symbol_name_too_large{
 //  ">>> MODULE SYMBOL NAME TOO LARGE: %s\r\n"
     ">>> MODULE SYMBOL NAME TOO LARGE: (.*)\r\n"};
-static const std::regex re_nonmodule_symbol_name_too_large{
+static const Mijo::LazyRegex re_nonmodule_symbol_name_too_large{
 //  ">>> NONMODULE SYMBOL NAME TOO LARGE: %s\r\n"
     ">>> NONMODULE SYMBOL NAME TOO LARGE: (.*)\r\n"};
-static const std::regex re_ComputeSizeETI_section_header_size_failure{
+static const Mijo::LazyRegex re_ComputeSizeETI_section_header_size_failure{
 //  "<<< Failure in ComputeSizeETI: section->Header->sh_size was %x, rel_size should be %x\r\n"
     "<<< Failure in ComputeSizeETI: section->Header->sh_size was ([0-9a-f]+), rel_size should be ([0-9a-f]+)\r\n"};
-static const std::regex re_ComputeSizeETI_st_size_failure{
+static const Mijo::LazyRegex re_ComputeSizeETI_st_size_failure{
 //  "<<< Failure in ComputeSizeETI: st_size was %x, st_size should be %x\r\n"
     "<<< Failure in ComputeSizeETI: st_size was ([0-9a-f]+), st_size should be ([0-9a-f]+)\r\n"};
-static const std::regex re_PreCalculateETI_section_header_size_failure{
+static const Mijo::LazyRegex re_PreCalculateETI_section_header_size_failure{
 //  "<<< Failure in PreCalculateETI: section->Header->sh_size was %x, rel_size should be %x\r\n"
     "<<< Failure in PreCalculateETI: section->Header->sh_size was ([0-9a-f]+), rel_size should be ([0-9a-f]+)\r\n"};
-static const std::regex re_PreCalculateETI_st_size_failure{
+static const Mijo::LazyRegex re_PreCalculateETI_st_size_failure{
 //  "<<< Failure in PreCalculateETI: st_size was %x, st_size should be %x\r\n"
     "<<< Failure in PreCalculateETI: st_size was ([0-9a-f]+), st_size should be ([0-9a-f]+)\r\n"};
-static const std::regex re_GetFilePos_calc_offset_failure{
+static const Mijo::LazyRegex re_GetFilePos_calc_offset_failure{
 //  "<<< Failure in %s: GetFilePos is %x, sect->calc_offset is %x\r\n"
     "<<< Failure in (.*): GetFilePos is ([0-9a-f]+), sect->calc_offset is ([0-9a-f]+)\r\n"};
-static const std::regex re_GetFilePos_bin_offset_failure{
+static const Mijo::LazyRegex re_GetFilePos_bin_offset_failure{
 //  "<<< Failure in %s: GetFilePos is %x, sect->bin_offset is %x\r\n"
     "<<< Failure in (.*): GetFilePos is ([0-9a-f]+), sect->bin_offset is ([0-9a-f]+)\r\n"};
 // clang-format on
@@ -1009,38 +1720,27 @@ Map::ScanError Map::ScanForGarbage(const char* const head, const char* const tai
     Mijo::CMatchResults match;
 
     // These linker map prints are known to exist, but I have never seen them.
-    if (std::regex_search(head, tail, match, re_excluded_symbol,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_excluded_symbol))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_wasnt_passed_section,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_wasnt_passed_section))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_dynamic_symbol_referenced,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_dynamic_symbol_referenced))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_module_symbol_name_too_large,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_module_symbol_name_too_large))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_nonmodule_symbol_name_too_large,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_nonmodule_symbol_name_too_large))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_ComputeSizeETI_section_header_size_failure,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_ComputeSizeETI_section_header_size_failure))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_ComputeSizeETI_st_size_failure,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_ComputeSizeETI_st_size_failure))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_PreCalculateETI_section_header_size_failure,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_PreCalculateETI_section_header_size_failure))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_PreCalculateETI_st_size_failure,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_PreCalculateETI_st_size_failure))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_GetFilePos_calc_offset_failure,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_GetFilePos_calc_offset_failure))
       return ScanError::Unimplemented;
-    if (std::regex_search(head, tail, match, re_GetFilePos_bin_offset_failure,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_GetFilePos_bin_offset_failure))
       return ScanError::Unimplemented;
 
     // Gamecube ISO Tool (http://www.wiibackupmanager.co.uk/gcit.html) has a bug that appends null
@@ -1054,145 +1754,354 @@ Map::ScanError Map::ScanForGarbage(const char* const head, const char* const tai
 }
 
 // clang-format off
-static const std::regex re_symbol_closure_node_normal{
+static const Mijo::LazyRegex re_symbol_closure_node_normal{
 //  "%i] " and "%s (%s,%s) found in %s %s\r\n"
     "   *(\\d+)\\] (.*) \\((.*),(.*)\\) found in (.*) (.*)\r?\n"};
-static const std::regex re_symbol_closure_node_normal_unref_dup_header{
+static const Mijo::LazyRegex re_symbol_closure_node_normal_unref_dup_header{
 //  "%i] " and ">>> UNREFERENCED DUPLICATE %s\r\n"
     "   *(\\d+)\\] >>> UNREFERENCED DUPLICATE (.*)\r?\n"};
-static const std::regex re_symbol_closure_node_normal_unref_dups{
+static const Mijo::LazyRegex re_symbol_closure_node_normal_unref_dups{
 //  "%i] " and ">>> (%s,%s) found in %s %s\r\n"
     "   *(\\d+)\\] >>> \\((.*),(.*)\\) found in (.*) (.*)\r?\n"};
-static const std::regex re_symbol_closure_node_linker_generated{
+static const Mijo::LazyRegex re_symbol_closure_node_linker_generated{
 //  "%i] " and "%s found as linker generated symbol\r\n"
     "   *(\\d+)\\] (.*) found as linker generated symbol\r?\n"};
 // clang-format on
 
-static const std::unordered_map<std::string_view, Type> map_symbol_closure_st_type{
+static constexpr auto map_symbol_closure_st_type = Mijo::MakePerfectHashMap<Type>({
     {"notype", Type::notype},   {"object", Type::object}, {"func", Type::func},
     {"section", Type::section}, {"file", Type::file},     {"unknown", Type::unknown},
-};
-static const std::unordered_map<std::string_view, Bind> map_symbol_closure_st_bind{
+});
+static constexpr auto map_symbol_closure_st_bind = Mijo::MakePerfectHashMap<Bind>({
     {"local", Bind::local},       {"global", Bind::global},     {"weak", Bind::weak},
     {"multidef", Bind::multidef}, {"overload", Bind::overload}, {"unknown", Bind::unknown},
-};
+});
 
-Map::ScanError Map::SymbolClosure::Scan(  //
-    const char*& head, const char* const tail, std::size_t& line_number,
-    UnresolvedSymbols& unresolved_symbols)
+// The hand-written symbol closure scanner splits lines with std::string_view and std::from_chars.
+// It is meant to be indistinguishable from the std::regex scanner, so every ambiguity is resolved
+// the same way std::regex would resolve it, with each greedy "(.*)" taking as much as it can from
+// left to right while still allowing the rest of the pattern to match. Only what comes after that counts as a pattern attempt.
+struct SymbolClosureCaptures
 {
-  Mijo::CMatchResults match;
+  const char* m_next;
+  int m_hierarchy_level;
+  std::string_view m_name;
+  std::string_view m_type;
+  std::string_view m_bind;
+  std::string_view m_module_name;
+  std::string_view m_source_name;
+};
 
-  NodeBase* curr_node = &m_root;
-  int curr_hierarchy_level = 0;
+// "   *(\\d+)\\] "
+static bool ScanSymbolClosurePrefix(std::string_view& content, int& hierarchy_level)
+{
+  const std::size_t digits_pos = content.find_first_not_of(' ');
+  if (digits_pos < 2 || digits_pos == std::string_view::npos)
+    return false;
+  std::size_t digits_end = digits_pos;
+  while (digits_end < content.size() && content[digits_end] >= '0' && content[digits_end] <= '9')
+    ++digits_end;
+  if (digits_end == digits_pos || !content.substr(digits_end).starts_with("] "))
+    return false;
+  // Like Mijo::SubMatch::to, an out-of-range value is left as zero.
+  hierarchy_level = 0;
+  static_cast<void>(
+      std::from_chars(content.data() + digits_pos, content.data() + digits_end, hierarchy_level));
+  content.remove_prefix(digits_end + 2);
+  return true;
+}
 
-  while (true)
+// "(.*),(.*)\\) found in (.*) (.*)", where the first capture must begin at or after 'min_pos'.
+static bool ScanSymbolClosureFoundIn(const std::string_view content, const std::size_t min_pos,
+                                     std::size_t& comma_pos, SymbolClosureCaptures& captures)
+{
+  static constexpr std::string_view found_in = ") found in ";
+  // The rightmost ") found in " whose remainder has room for "(.*) (.*)".  Only the two rightmost
+  // candidates need to be considered, as the remainder of the second contains the first.
+  std::size_t found_in_pos = content.rfind(found_in);
+  while (found_in_pos != std::string_view::npos &&
+         content.find(' ', found_in_pos + found_in.size()) == std::string_view::npos)
   {
-    if (std::regex_search(head, tail, match, re_symbol_closure_node_normal,
-                          std::regex_constants::match_continuous))
-    {
-      const int next_hierarchy_level = match[1].to<int>();
-      if (next_hierarchy_level <= 0)
-        return ScanError::SymbolClosureInvalidHierarchy;
-      if (curr_hierarchy_level + 1 < next_hierarchy_level)
-        return ScanError::SymbolClosureHierarchySkip;
-      const std::string_view type = match[3].view(), bind = match[4].view();
-      if (!map_symbol_closure_st_type.contains(type))
-        return ScanError::SymbolClosureInvalidSymbolType;
-      if (!map_symbol_closure_st_bind.contains(bind))
-        return ScanError::SymbolClosureInvalidSymbolBind;
-      const std::string_view symbol_name = match[2].view(), module_name = match[5].view(),
-                             source_name = match[6].view();
-
-      for (int i = curr_hierarchy_level + 1; i > next_hierarchy_level; --i)
-        curr_node = curr_node->GetParent();
-      curr_hierarchy_level = next_hierarchy_level;
+    if (found_in_pos == 0)
+      return false;
+    found_in_pos = content.rfind(found_in, found_in_pos - 1);
+  }
+  if (found_in_pos == std::string_view::npos || found_in_pos == 0)
+    return false;
+  comma_pos = content.rfind(',', found_in_pos - 1);
+  if (comma_pos == std::string_view::npos || comma_pos < min_pos)
+    return false;
+  const std::string_view remainder = content.substr(found_in_pos + found_in.size());
+  const std::size_t space_pos = remainder.rfind(' ');
+  captures.m_bind = content.substr(comma_pos + 1, found_in_pos - comma_pos - 1);
+  captures.m_module_name = remainder.substr(0, space_pos);
+  captures.m_source_name = remainder.substr(space_pos + 1);
+  return true;
+}
 
-      const std::size_t line_number_backup = line_number;  // unfortunate
-      line_number += 1u;
-      head = match[0].second;
+static bool ScanSymbolClosureNodeNormal(const char* const head, const char* const tail,
+                                        SymbolClosureCaptures& captures, const bool use_regex)
+{
+  if (use_regex)
+  {
+    Mijo::CMatchResults match;
+    if (!MatchRegex(head, tail, match, *re_symbol_closure_node_normal))
+      return false;
+    captures.m_next = match[0].second;
+    captures.m_hierarchy_level = match[1].to<int>();
+    captures.m_name = match[2].view();
+    captures.m_type = match[3].view();
+    captures.m_bind = match[4].view();
+    captures.m_module_name = match[5].view();
+    captures.m_source_name = match[6].view();
+    return true;
+  }
+  std::string_view content;
+  if (!Mijo::ScanLine(head, tail, content, captures.m_next))
+    return false;
+  if (!ScanSymbolClosurePrefix(content, captures.m_hierarchy_level))
+    return false;
+  std::size_t comma_pos;
+  if (!ScanSymbolClosureFoundIn(content, 2, comma_pos, captures))
+  {
+    CountPatternAttempt(false);
+    return false;
+  }
+  const std::size_t paren_pos = content.rfind(" (", comma_pos - 2);
+  CountPatternAttempt(paren_pos != std::string_view::npos);
+  if (paren_pos == std::string_view::npos)
+    return false;
+  captures.m_name = content.substr(0, paren_pos);
+  captures.m_type = content.substr(paren_pos + 2, comma_pos - paren_pos - 2);
+  return true;
+}
+
+static bool ScanSymbolClosureNodeNormalUnrefDupHeader(const char* const head,
+                                                      const char* const tail,
+                                                      SymbolClosureCaptures& captures,
+                                                      const bool use_regex)
+{
+  if (use_regex)
+  {
+    Mijo::CMatchResults match;
+    if (!MatchRegex(head, tail, match, *re_symbol_closure_node_normal_unref_dup_header))
+      return false;
+    captures.m_next = match[0].second;
+    captures.m_hierarchy_level = match[1].to<int>();
+    captures.m_name = match[2].view();
+    return true;
+  }
+  static constexpr std::string_view unref_dup_header = ">>> UNREFERENCED DUPLICATE ";
+  std::string_view content;
+  if (!Mijo::ScanLine(head, tail, content, captures.m_next))
+    return false;
+  if (!ScanSymbolClosurePrefix(content, captures.m_hierarchy_level))
+    return false;
+  if (!content.starts_with(unref_dup_header))
+    return false;
+  CountPatternAttempt(true);
+  captures.m_name = content.substr(unref_dup_header.size());
+  return true;
+}
+
+static bool ScanSymbolClosureNodeNormalUnrefDups(const char* const head, const char* const tail,
+                                                 SymbolClosureCaptures& captures,
+                                                 const bool use_regex)
+{
+  if (use_regex)
+  {
+    Mijo::CMatchResults match;
+    if (!MatchRegex(head, tail, match, *re_symbol_closure_node_normal_unref_dups))
+      return false;
+    captures.m_next = match[0].second;
+    captures.m_hierarchy_level = match[1].to<int>();
+    captures.m_type = match[2].view();
+    captures.m_bind = match[3].view();
+    captures.m_module_name = match[4].view();
+    captures.m_source_name = match[5].view();
+    return true;
+  }
+  static constexpr std::string_view unref_dups = ">>> (";
+  std::string_view content;
+  if (!Mijo::ScanLine(head, tail, content, captures.m_next))
+    return false;
+  if (!ScanSymbolClosurePrefix(content, captures.m_hierarchy_level))
+    return false;
+  if (!content.starts_with(unref_dups))
+    return false;
+  std::size_t comma_pos;
+  const bool is_hit = ScanSymbolClosureFoundIn(content, unref_dups.size(), comma_pos, captures);
+  CountPatternAttempt(is_hit);
+  if (!is_hit)
+    return false;
+  captures.m_type = content.substr(unref_dups.size(), comma_pos - unref_dups.size());
+  return true;
+}
+
+static bool ScanSymbolClosureNodeLinkerGenerated(const char* const head, const char* const tail,
+                                                 SymbolClosureCaptures& captures,
+                                                 const bool use_regex)
+{
+  if (use_regex)
+  {
+    Mijo::CMatchResults match;
+    if (!MatchRegex(head, tail, match, *re_symbol_closure_node_linker_generated))
+      return false;
+    captures.m_next = match[0].second;
+    captures.m_hierarchy_level = match[1].to<int>();
+    captures.m_name = match[2].view();
+    return true;
+  }
+  static constexpr std::string_view linker_generated = " found as linker generated symbol";
+  std::string_view content;
+  if (!Mijo::ScanLine(head, tail, content, captures.m_next))
+    return false;
+  if (!ScanSymbolClosurePrefix(content, captures.m_hierarchy_level))
+    return false;
+  if (!content.ends_with(linker_generated))
+    return false;
+  CountPatternAttempt(true);
+  content.remove_suffix(linker_generated.size());
+  captures.m_name = content;
+  return true;
+}
+
+static bool ScanUnresolvedSymbol(const char* const head, const char* const tail,
+                                 SymbolClosureCaptures& captures, const bool use_regex)
+{
+  if (use_regex)
+  {
+    Mijo::CMatchResults match;
+    if (!MatchRegex(head, tail, match, *re_unresolved_symbol))
+      return false;
+    captures.m_next = match[0].second;
+    captures.m_name = match[1].view();
+    return true;
+  }
+  static constexpr std::string_view unresolved_symbol = ">>> SYMBOL NOT FOUND: ";
+  std::string_view content;
+  if (!Mijo::ScanLine(head, tail, content, captures.m_next))
+    return false;
+  if (!content.starts_with(unresolved_symbol))
+    return false;
+  CountPatternAttempt(true);
+  captures.m_name = content.substr(unresolved_symbol.size());
+  return true;
+}
+
+Map::ScanError Map::SymbolClosure::Scan(  //
+    const char*& head, const char* const tail, std::size_t& line_number,
+    UnresolvedSymbols& unresolved_symbols, const Options& options, Mijo::StringPool& string_pool,
+    Diagnostics& diagnostics)
+{
+  if (Mijo::ResolveThreadCount(options.m_thread_count) > 1)
+    return ScanParallel(head, tail, line_number, unresolved_symbols, options, string_pool,
+                        diagnostics);
+  return ScanSerial(head, tail, line_number, unresolved_symbols, options, string_pool,
+                    diagnostics);
+}
+
+Map::ScanError Map::SymbolClosure::ScanSerial(  //
+    const char*& head, const char* const tail, std::size_t& line_number,
+    UnresolvedSymbols& unresolved_symbols, const Options& options, Mijo::StringPool& string_pool,
+    Diagnostics& diagnostics)
+{
+  ScanState state;
+  const ScanError error = ScanNodes(head, tail, line_number, unresolved_symbols, options,
+                                    string_pool, diagnostics, state, nullptr);
+  CloseSubtrees(state.m_ancestors, 0);
+  return error;
+}
+
+// The one scanner of symbol closure nodes, which hands what it finds to a sink. The sink used by
+// Map::SymbolClosure::ScanNodes builds the tree, while the one used by Map::Visit passes it on.
+template <class Sink>
+static Map::ScanError ScanSymbolClosureNodes(const char*& head, const char* const tail,
+                                             std::size_t& line_number, int& curr_hierarchy_level,
+                                             const bool use_regex, Sink& sink)
+{
+  using ScanError = Map::ScanError;
+  SymbolClosureCaptures captures{};
+
+  while (true)
+  {
+    if (ScanSymbolClosureNodeNormal(head, tail, captures, use_regex))
+    {
+      const int next_hierarchy_level = captures.m_hierarchy_level;
+      if (next_hierarchy_level <= 0)
+        return ScanError::SymbolClosureInvalidHierarchy;
+      if (curr_hierarchy_level + 1 < next_hierarchy_level)
+        return ScanError::SymbolClosureHierarchySkip;
+      const Type* const type = map_symbol_closure_st_type.Find(captures.m_type);
+      if (type == nullptr)
+        return ScanError::SymbolClosureInvalidSymbolType;
+      const Bind* const bind = map_symbol_closure_st_bind.Find(captures.m_bind);
+      if (bind == nullptr)
+        return ScanError::SymbolClosureInvalidSymbolBind;
+      const std::string_view symbol_name = captures.m_name, module_name = captures.m_module_name,
+                             source_name = captures.m_source_name;
+      curr_hierarchy_level = next_hierarchy_level;
 
-      std::list<NodeReal::UnreferencedDuplicate> unref_dups;
+      const std::size_t line_number_backup = line_number;  // unfortunate
+      line_number += 1u;
+      head = captures.m_next;
 
-      if (std::regex_search(head, tail, match, re_symbol_closure_node_normal_unref_dup_header,
-                            std::regex_constants::match_continuous))
+      if (ScanSymbolClosureNodeNormalUnrefDupHeader(head, tail, captures, use_regex))
       {
-        if (match[1].to<int>() != curr_hierarchy_level)
+        if (captures.m_hierarchy_level != curr_hierarchy_level)
           return ScanError::SymbolClosureUnrefDupsHierarchyMismatch;
-        if (match[2].view() != symbol_name)
+        if (captures.m_name != symbol_name)
           return ScanError::SymbolClosureUnrefDupsNameMismatch;
         line_number += 1u;
-        head = match[0].second;
-        while (std::regex_search(head, tail, match, re_symbol_closure_node_normal_unref_dups,
-                                 std::regex_constants::match_continuous))
+        head = captures.m_next;
+        bool has_unref_dups = false;
+        while (ScanSymbolClosureNodeNormalUnrefDups(head, tail, captures, use_regex))
         {
-          if (match[1].to<int>() != curr_hierarchy_level)
+          if (captures.m_hierarchy_level != curr_hierarchy_level)
             return ScanError::SymbolClosureUnrefDupsHierarchyMismatch;
-          const std::string_view unref_dup_type = match[2].view(), unref_dup_bind = match[3].view();
-          if (!map_symbol_closure_st_type.contains(unref_dup_type))
+          const Type* const unref_dup_type = map_symbol_closure_st_type.Find(captures.m_type);
+          if (unref_dup_type == nullptr)
             return ScanError::SymbolClosureInvalidSymbolType;
-          if (!map_symbol_closure_st_bind.contains(unref_dup_bind))
+          const Bind* const unref_dup_bind = map_symbol_closure_st_bind.Find(captures.m_bind);
+          if (unref_dup_bind == nullptr)
             return ScanError::SymbolClosureInvalidSymbolBind;
-          unref_dups.emplace_back(map_symbol_closure_st_type.at(unref_dup_type),
-                                  map_symbol_closure_st_bind.at(unref_dup_bind), match[4].view(),
-                                  match[5].view());
+          sink.AddUnreferencedDuplicate(*unref_dup_type, *unref_dup_bind, captures.m_module_name,
+                                        captures.m_source_name);
+          has_unref_dups = true;
           line_number += 1u;
-          head = match[0].second;
+          head = captures.m_next;
         }
-        if (unref_dups.empty())
+        if (!has_unref_dups)
           return ScanError::SymbolClosureUnrefDupsEmpty;
-        SetVersionRange(Version::version_2_3_3_build_137, Version::Latest);
       }
 
-      // clang-format off
-      curr_node = curr_node->GetChildren().emplace_back(std::make_unique<NodeReal>(
-          curr_node, symbol_name, map_symbol_closure_st_type.at(type),
-          map_symbol_closure_st_bind.at(bind), module_name, source_name, std::move(unref_dups))).get();
-      // clang-format on
-      const NodeReal& curr_node_real = *static_cast<NodeReal*>(curr_node);
-
-      const std::string_view compilation_unit_name =
-          GetCompilationUnitName(curr_node_real.m_module_name, curr_node_real.m_source_name);
-      NodeLookup& curr_node_lookup = m_lookup[compilation_unit_name];
-      if (curr_node_lookup.contains(symbol_name))
-      {
-        // TODO: restore sym on detection (it was flawed)
-        Warn::OneDefinitionRuleViolation(line_number_backup, symbol_name, compilation_unit_name);
-      }
-      curr_node_lookup.emplace(curr_node_real.m_name, curr_node_real);
+      sink.AddNode(line_number_backup, curr_hierarchy_level, symbol_name, *type, *bind,
+                   module_name, source_name);
 
       // Though I do not understand it, the following is a normal occurrence for _dtors$99:
       // "  1] _dtors$99 (object,global) found in Linker Generated Symbol File "
       // "    3] .text (section,local) found in xyz.cpp lib.a"
       if (symbol_name == "_dtors$99" && module_name == "Linker Generated Symbol File")
       {
-        // Create a dummy node for hierarchy level 2.
-        curr_node =
-            curr_node->GetChildren().emplace_back(std::make_unique<NodeBase>(curr_node)).get();
+        // Make room for a dummy node at hierarchy level 2.
         ++curr_hierarchy_level;
-        SetVersionRange(Version::version_3_0_4, Version::Latest);
+        sink.AddDummyNode(line_number_backup, curr_hierarchy_level);
       }
       continue;
     }
-    if (std::regex_search(head, tail, match, re_symbol_closure_node_linker_generated,
-                          std::regex_constants::match_continuous))
+    if (ScanSymbolClosureNodeLinkerGenerated(head, tail, captures, use_regex))
     {
-      const int next_hierarchy_level = match[1].to<int>();
+      const int next_hierarchy_level = captures.m_hierarchy_level;
       if (next_hierarchy_level <= 0)
         return ScanError::SymbolClosureInvalidHierarchy;
       if (curr_hierarchy_level + 1 < next_hierarchy_level)
         return ScanError::SymbolClosureHierarchySkip;
-
-      for (int i = curr_hierarchy_level + 1; i > next_hierarchy_level; --i)
-        curr_node = curr_node->GetParent();
       curr_hierarchy_level = next_hierarchy_level;
 
-      // clang-format off
-      curr_node = curr_node->GetChildren().emplace_back(std::make_unique<NodeLinkerGenerated>(curr_node, match[2].view())).get();
-      // clang-format on
+      sink.AddLinkerGeneratedNode(line_number, curr_hierarchy_level, captures.m_name);
 
       line_number += 1u;
-      head = match[0].second;
+      head = captures.m_next;
       continue;
     }
     // Up until CodeWarrior for GCN 3.0a3 (at the earliest), unresolved symbols were printed as the
@@ -1206,12 +2115,11 @@ Map::ScanError Map::SymbolClosure::Scan(  //
     // pre-printed before the first symbol closure. Wouldn't you know it, this scanning code also
     // handles that. The line number is stored so the Map::Print method can accurately reproduce any
     // of the aeformentioned arrangements, though if you find another use for it, good for you.
-    if (std::regex_search(head, tail, match, re_unresolved_symbol,
-                          std::regex_constants::match_continuous))
+    if (ScanUnresolvedSymbol(head, tail, captures, use_regex))
     {
-      unresolved_symbols.emplace_back(line_number, match.str(1));
+      sink.AddUnresolvedSymbol(line_number, captures.m_name);
       line_number += 1u;
-      head = match[0].second;
+      head = captures.m_next;
       continue;
     }
     break;
@@ -1219,24 +2127,506 @@ Map::ScanError Map::SymbolClosure::Scan(  //
   return ScanError::None;
 }
 
-void Map::SymbolClosure::Print(std::ostream& stream,
-                               UnresolvedSymbols::const_iterator& unresolved_head,
+struct Map::SymbolClosure::NodeBuilder
+{
+  void AddUnreferencedDuplicate(const Type type, const Bind bind,
+                                const std::string_view module_name,
+                                const std::string_view source_name)
+  {
+    m_symbol_closure.m_unref_dups.emplace_back(type, bind, m_string_pool.Store(module_name),
+                                               m_string_pool.Store(source_name));
+    m_symbol_closure.SetVersionRange(Version::version_2_3_3_build_137, Version::Latest);
+  }
+
+  void AddNode(const std::size_t line_number, const int hierarchy_level,
+               const std::string_view name, const Type type, const Bind bind,
+               const std::string_view module_name, const std::string_view source_name)
+  {
+    const std::string_view symbol_name = m_string_pool.Store(name),
+                           stored_module_name = m_string_pool.Store(module_name),
+                           stored_source_name = m_string_pool.Store(source_name);
+    const NodeId node_id = m_symbol_closure.AddNode(
+        m_state.m_ancestors, hierarchy_level, NodeKind::Real,
+        m_symbol_closure.AddString(symbol_name), type, bind,
+        m_symbol_closure.AddString(stored_module_name, m_state.m_string_ids),
+        m_symbol_closure.AddString(stored_source_name, m_state.m_string_ids));
+    if (m_chunk_info != nullptr)
+      m_chunk_info->m_line_numbers.push_back(line_number);
+
+    const std::string_view compilation_unit_name =
+        GetCompilationUnitName(stored_module_name, stored_source_name);
+    NodeLookup& curr_node_lookup = m_symbol_closure.m_lookup[compilation_unit_name];
+    if (curr_node_lookup.contains(symbol_name))
+    {
+      // TODO: restore sym on detection (it was flawed)
+      if (m_chunk_info != nullptr)
+        m_chunk_info->m_odr_violations.push_back(node_id);
+      else
+        Warn::OneDefinitionRuleViolation(m_diagnostics, line_number, symbol_name,
+                                         compilation_unit_name);
+    }
+    curr_node_lookup.emplace(symbol_name, node_id);
+  }
+
+  // See ScanSymbolClosureNodes about _dtors$99.
+  void AddDummyNode(const std::size_t line_number, const int hierarchy_level)
+  {
+    m_symbol_closure.AddNode(m_state.m_ancestors, hierarchy_level, NodeKind::Dummy, 0,
+                             Type::notype, Bind::local, 0, 0);
+    if (m_chunk_info != nullptr)
+      m_chunk_info->m_line_numbers.push_back(line_number);
+    m_symbol_closure.SetVersionRange(Version::version_3_0_4, Version::Latest);
+  }
+
+  void AddLinkerGeneratedNode(const std::size_t line_number, const int hierarchy_level,
+                              const std::string_view name)
+  {
+    m_symbol_closure.AddNode(m_state.m_ancestors, hierarchy_level, NodeKind::LinkerGenerated,
+                             m_symbol_closure.AddString(m_string_pool.Store(name)), Type::notype,
+                             Bind::local, 0, 0);
+    if (m_chunk_info != nullptr)
+      m_chunk_info->m_line_numbers.push_back(line_number);
+  }
+
+  void AddUnresolvedSymbol(const std::size_t line_number, const std::string_view name)
+  {
+    m_unresolved_symbols.emplace_back(line_number, m_string_pool.Store(name));
+  }
+
+  SymbolClosure& m_symbol_closure;
+  ScanState& m_state;
+  UnresolvedSymbols& m_unresolved_symbols;
+  Mijo::StringPool& m_string_pool;
+  Diagnostics& m_diagnostics;
+  ChunkInfo* m_chunk_info;
+};
+
+Map::ScanError Map::SymbolClosure::ScanNodes(  //
+    const char*& head, const char* const tail, std::size_t& line_number,
+    UnresolvedSymbols& unresolved_symbols, const Options& options, Mijo::StringPool& string_pool,
+    Diagnostics& diagnostics, ScanState& state, ChunkInfo* const chunk_info)
+{
+  NodeBuilder sink{*this, state, unresolved_symbols, string_pool, diagnostics, chunk_info};
+  return ScanSymbolClosureNodes(head, tail, line_number, state.m_curr_hierarchy_level,
+                                options.m_use_regex_fallback, sink);
+}
+
+// Whether what follows the prefix of a line is the _dtors$99 that is given a dummy child. See
+// ScanSymbolClosureNodes.
+static bool IsDtors99DummyParent(const std::string_view content) noexcept
+{
+  return content.starts_with("_dtors$99 (") &&
+         content.find(") found in Linker Generated Symbol File ") != std::string_view::npos;
+}
+
+// Each line of a symbol closure has a hierarchy level, save for unresolved symbols.
+static bool IsSymbolClosureLine(std::string_view content, int& hierarchy_level)
+{
+  hierarchy_level = 0;
+  return content.starts_with(">>> SYMBOL NOT FOUND: ") ||
+         ScanSymbolClosurePrefix(content, hierarchy_level);
+}
+
+// The earliest version a line of a symbol closure could have come from, going by what follows its
+// prefix, as far as can be told without scanning it.
+static Version GetSymbolClosureLineMinVersion(const std::string_view content) noexcept
+{
+  if (content.starts_with(">>> UNREFERENCED DUPLICATE "))
+    return Version::version_2_3_3_build_137;
+  if (IsDtors99DummyParent(content))
+    return Version::version_3_0_4;
+  return Version::Unknown;
+}
+
+// A symbol closure that is not wanted is only walked one line at a time to find where it ends,
+// picking up the same version clues a scan would.
+void Map::SkipSymbolClosure(const char*& head, const char* const tail, std::size_t& line_number,
+                            const bool is_dwarf)
+{
+  std::string_view content;
+  const char* next;
+  int hierarchy_level;
+  bool has_nodes = false;
+  while (Mijo::ScanLine(head, tail, content, next) && IsSymbolClosureLine(content, hierarchy_level))
+  {
+    if (hierarchy_level > 0)
+    {
+      has_nodes = true;
+      ScanSymbolClosurePrefix(content, hierarchy_level);
+      m_skipped_portions.SetVersionRange(GetSymbolClosureLineMinVersion(content), Version::Latest);
+    }
+    head = next;
+    line_number += 1u;
+  }
+  if (is_dwarf && has_nodes)
+    m_skipped_portions.SetVersionRange(Version::version_3_0_4, Version::Latest);
+}
+
+// Looking a symbol closure over only goes as far as each line's prefix, which is enough to find
+// its roots and catch a broken hierarchy. Unresolved symbols are taken as they would be by a scan.
+// The text is kept for later, copied into the string pool unless it is borrowed anyway.
+Map::ScanError Map::LookOverSymbolClosure(const char*& head, const char* const tail,
+                                          std::size_t& line_number, const bool is_dwarf,
+                                          std::optional<LazySymbolClosure>& portion)
+{
+  // libc++ bug: When checking if LazySymbolClosure is default constructable in
+  // std::optional::emplace, it fails the requirement std::is_constructable_v because
+  // it is not yet a complete class due to it being nested in Map.
+  LazySymbolClosure& lazy_symbol_closure = portion.emplace(LazySymbolClosure());
+  lazy_symbol_closure.m_options = m_options;
+  lazy_symbol_closure.m_is_dwarf = is_dwarf;
+  lazy_symbol_closure.m_line_number = line_number;
+
+  const char* const text_head = head;
+  SymbolClosureCaptures captures{};
+  std::string_view content;
+  const char* next;
+  int curr_hierarchy_level = 0;
+  while (Mijo::ScanLine(head, tail, content, next))
+  {
+    if (ScanUnresolvedSymbol(head, tail, captures, m_options.m_use_regex_fallback))
+    {
+      m_unresolved_symbols.emplace_back(line_number, m_string_pool.Store(captures.m_name));
+      line_number += 1u;
+      head = captures.m_next;
+      continue;
+    }
+    int next_hierarchy_level;
+    if (!ScanSymbolClosurePrefix(content, next_hierarchy_level))
+      break;
+    if (next_hierarchy_level <= 0)
+      return ScanError::SymbolClosureInvalidHierarchy;
+    if (curr_hierarchy_level + 1 < next_hierarchy_level)
+      return ScanError::SymbolClosureHierarchySkip;
+    if (next_hierarchy_level == 1)
+      lazy_symbol_closure.m_roots.push_back(
+          {static_cast<std::size_t>(head - text_head), line_number});
+    curr_hierarchy_level = next_hierarchy_level;
+    lazy_symbol_closure.SetVersionRange(GetSymbolClosureLineMinVersion(content), Version::Latest);
+    // See the dummy node it is given in ScanSymbolClosureNodes.
+    if (IsDtors99DummyParent(content))
+      ++curr_hierarchy_level;
+    line_number += 1u;
+    head = next;
+  }
+  if (is_dwarf && !lazy_symbol_closure.m_roots.empty())
+    lazy_symbol_closure.SetVersionRange(Version::version_3_0_4, Version::Latest);
+  lazy_symbol_closure.m_text =
+      m_string_pool.Store({text_head, static_cast<std::size_t>(head - text_head)});
+  return ScanError::None;
+}
+
+const Map::LazySymbolClosure::Scanned& Map::LazySymbolClosure::GetScanned() const
+{
+  return m_scanned.Get([this] {
+    Scanned scanned{std::nullopt, ScanError::None, Diagnostics{m_options.m_warnings}};
+    // The text already lives as long as the Map, and its unresolved symbols were taken from it
+    // when it was looked over.
+    Mijo::StringPool string_pool{StringStorage::Borrowed};
+    UnresolvedSymbols unresolved_symbols;
+    const char* head = m_text.data();
+    const char* const tail = m_text.data() + m_text.size();
+    std::size_t line_number = m_line_number;
+    // libc++ bug: When checking if SymbolClosure is default constructable in
+    // std::optional::emplace, it fails the requirement std::is_constructable_v because
+    // it is not yet a complete class due to it being nested in Map.
+    SymbolClosure& symbol_closure = scanned.m_symbol_closure.emplace(SymbolClosure());
+    scanned.m_error = symbol_closure.Scan(head, tail, line_number, unresolved_symbols, m_options,
+                                          string_pool, scanned.m_diagnostics);
+    // Whatever looked like part of the symbol closure must turn out to be.
+    if (scanned.m_error == ScanError::None && head != tail)
+      scanned.m_error = ScanError::GarbageFound;
+    if (scanned.m_error != ScanError::None)
+      scanned.m_symbol_closure.reset();
+    else if (m_is_dwarf && !symbol_closure.IsEmpty())
+      symbol_closure.SetVersionRange(Version::version_3_0_4, Version::Latest);
+    return scanned;
+  });
+}
+
+Map::ScanError Map::LazySymbolClosure::ScanRoot(const std::size_t index,
+                                                SymbolClosure& symbol_closure,
+                                                Diagnostics& diagnostics) const
+{
+  if (index >= m_roots.size())
+    return ScanError::Fail;
+  const Root& root = m_roots[index];
+  const std::size_t end_offset =
+      index + 1 < m_roots.size() ? m_roots[index + 1].m_offset : m_text.size();
+  Mijo::StringPool string_pool{StringStorage::Borrowed};
+  UnresolvedSymbols unresolved_symbols;
+  const char* head = m_text.data() + root.m_offset;
+  const char* const tail = m_text.data() + end_offset;
+  std::size_t line_number = root.m_line_number;
+  symbol_closure = SymbolClosure();
+  const ScanError error = symbol_closure.ScanSerial(head, tail, line_number, unresolved_symbols,
+                                                    m_options, string_pool, diagnostics);
+  if (error == ScanError::None && head != tail)
+    return ScanError::GarbageFound;
+  return error;
+}
+
+Map::ScanError Map::SymbolClosure::ScanParallel(  //
+    const char*& head, const char* const tail, std::size_t& line_number,
+    UnresolvedSymbols& unresolved_symbols, const Options& options, Mijo::StringPool& string_pool,
+    Diagnostics& diagnostics)
+{
+  struct Task
+  {
+    const char* m_head;
+    const char* m_tail;
+    std::size_t m_line_number;
+    SymbolClosure m_portion;
+    ChunkInfo m_chunk_info;
+    UnresolvedSymbols m_unresolved_symbols;
+    Mijo::StringPool m_string_pool;
+    ScanError m_error;
+  };
+
+  // Every line at hierarchy level 1 begins an independent subtree, so the closure can be split
+  // before any of them. Finding them only takes a quick look at the beginning of each line.
+  std::vector<std::pair<const char*, std::size_t>> split_points;
+  {
+    const char* line_head = head;
+    std::size_t curr_line_number = line_number;
+    std::string_view content;
+    const char* next;
+    int hierarchy_level;
+    while (Mijo::ScanLine(line_head, tail, content, next) &&
+           IsSymbolClosureLine(content, hierarchy_level))
+    {
+      if (hierarchy_level == 1)
+        split_points.emplace_back(line_head, curr_line_number);
+      line_head = next;
+      curr_line_number += 1u;
+    }
+    if (split_points.empty())
+      return ScanSerial(head, tail, line_number, unresolved_symbols, options, string_pool,
+                        diagnostics);
+    split_points.emplace_back(line_head, curr_line_number);
+  }
+
+  // Chunks are made large enough for the work to outweigh the bookkeeping.
+  const unsigned thread_count = Mijo::ResolveThreadCount(options.m_thread_count);
+  const auto total_size = static_cast<std::size_t>(split_points.back().first - head);
+  const std::size_t chunk_size = std::max<std::size_t>(total_size / (thread_count * 4u), 0x10000);
+  std::vector<Task> tasks;
+  {
+    const char* task_head = head;
+    std::size_t task_line_number = line_number;
+    for (const auto& [split_head, split_line_number] : split_points)
+    {
+      if (static_cast<std::size_t>(split_head - task_head) < chunk_size)
+        continue;
+      tasks.push_back({task_head, split_head, task_line_number, SymbolClosure(), {}, {},
+                       Mijo::StringPool{string_pool.GetMode()}, ScanError::None});
+      task_head = split_head;
+      task_line_number = split_line_number;
+    }
+    // The final chunk takes the rest of the text, as scanning it is what finds the real end.
+    tasks.push_back({task_head, tail, task_line_number, SymbolClosure(), {}, {},
+                     Mijo::StringPool{string_pool.GetMode()}, ScanError::None});
+  }
+  if (tasks.size() < 2)
+    return ScanSerial(head, tail, line_number, unresolved_symbols, options, string_pool,
+                      diagnostics);
+
+  // Chunks only note their One Definition Rule violations, never touching the diagnostics.
+  ParallelForProfiled(tasks.size(), thread_count, [&](const std::size_t i) {
+    Task& task = tasks[i];
+    ScanState state;
+    task.m_error = task.m_portion.ScanNodes(task.m_head, task.m_tail, task.m_line_number,
+                                            task.m_unresolved_symbols, options, task.m_string_pool,
+                                            diagnostics, state, &task.m_chunk_info);
+    task.m_portion.CloseSubtrees(state.m_ancestors, 0);
+  });
+
+  // Appending in file order reproduces exactly what scanning all at once would have done. One
+  // Definition Rule violations are reported afterward, in the order they were found in.
+  OdrViolations odr_violations;
+  ScanError error = ScanError::None;
+  for (Task& task : tasks)
+  {
+    string_pool.Merge(std::move(task.m_string_pool));
+    head = task.m_head;
+    line_number = task.m_line_number;
+    error = task.m_error;
+    if (error != ScanError::None)
+      break;
+    Append(std::move(task.m_portion), task.m_chunk_info, odr_violations);
+    unresolved_symbols.insert(unresolved_symbols.end(), task.m_unresolved_symbols.begin(),
+                              task.m_unresolved_symbols.end());
+    // A chunk that stopped short means the symbol closure ended early. Anything after it is thrown
+    // away, leaving the next portion to pick up from where it stopped.
+    if (task.m_head != task.m_tail)
+      break;
+  }
+  std::ranges::sort(odr_violations);
+  for (const auto& [odr_line_number, node_id] : odr_violations)
+  {
+    const Node node = GetNode(node_id);
+    Warn::OneDefinitionRuleViolation(
+        diagnostics, odr_line_number, node.GetName(),
+        GetCompilationUnitName(node.GetModuleName(), node.GetSourceName()));
+  }
+  return error;
+}
+
+void Map::SymbolClosure::Append(SymbolClosure&& chunk, const ChunkInfo& chunk_info,
+                                OdrViolations& odr_violations)
+{
+  const auto node_offset = static_cast<NodeId>(m_kinds.size());
+  // The empty string stays where it is, and every other string is moved over after the ones here.
+  const auto string_offset = static_cast<std::uint32_t>(m_strings.size() - 1);
+  const auto unref_dup_offset = static_cast<std::uint32_t>(m_unref_dups.size());
+  const auto offset_string_id = [string_offset](const std::uint32_t id) {
+    return id == 0 ? id : id + string_offset;
+  };
+  const auto offset_node_id = [node_offset](const NodeId id) {
+    return id == no_node ? id : id + node_offset;
+  };
+
+  m_hierarchy_levels.insert(m_hierarchy_levels.end(), chunk.m_hierarchy_levels.begin(),
+                            chunk.m_hierarchy_levels.end());
+  m_kinds.insert(m_kinds.end(), chunk.m_kinds.begin(), chunk.m_kinds.end());
+  std::ranges::transform(chunk.m_name_ids, std::back_inserter(m_name_ids), offset_string_id);
+  m_types.insert(m_types.end(), chunk.m_types.begin(), chunk.m_types.end());
+  m_binds.insert(m_binds.end(), chunk.m_binds.begin(), chunk.m_binds.end());
+  std::ranges::transform(chunk.m_module_ids, std::back_inserter(m_module_ids), offset_string_id);
+  std::ranges::transform(chunk.m_source_ids, std::back_inserter(m_source_ids), offset_string_id);
+  std::ranges::transform(chunk.m_parents, std::back_inserter(m_parents), offset_node_id);
+  std::ranges::transform(chunk.m_subtree_ends, std::back_inserter(m_subtree_ends), offset_node_id);
+  std::ranges::transform(chunk.m_unref_dup_begins | std::views::drop(1),
+                         std::back_inserter(m_unref_dup_begins),
+                         [unref_dup_offset](const std::uint32_t begin) {
+                           return begin + unref_dup_offset;
+                         });
+  m_unref_dups.insert(m_unref_dups.end(), chunk.m_unref_dups.begin(), chunk.m_unref_dups.end());
+  m_strings.insert(m_strings.end(), chunk.m_strings.begin() + 1, chunk.m_strings.end());
+
+  for (const NodeId id : chunk_info.m_odr_violations)
+    odr_violations.emplace_back(chunk_info.m_line_numbers[id], id + node_offset);
+  for (auto& [compilation_unit_name, chunk_node_lookup] : chunk.m_lookup)
+  {
+    NodeLookup& node_lookup = m_lookup[compilation_unit_name];
+    for (auto& [symbol_name, id] : chunk_node_lookup)
+    {
+      // Only the first sighting within the chunk is new, as the chunk already noticed the rest.
+      if (!node_lookup.contains(symbol_name))
+        continue;
+      const auto [first, last] = chunk_node_lookup.equal_range(symbol_name);
+      if (std::none_of(first, last, [id](const auto& pair) { return pair.second < id; }))
+        odr_violations.emplace_back(chunk_info.m_line_numbers[id], id + node_offset);
+    }
+    for (auto& [symbol_name, id] : chunk_node_lookup)
+      id += node_offset;
+    node_lookup.merge(chunk_node_lookup);
+  }
+  SetVersionRange(chunk.GetMinVersion(), chunk.GetMaxVersion());
+}
+
+Map::SymbolClosure::NodeId
+Map::SymbolClosure::AddNode(std::vector<NodeId>& ancestors, const int hierarchy_level,
+                            const NodeKind kind, const std::uint32_t name_id, const Type type,
+                            const Bind bind, const std::uint32_t module_id,
+                            const std::uint32_t source_id)
+{
+  // Adding a node at some hierarchy level ends the subtrees of every node at or below it.
+  CloseSubtrees(ancestors, static_cast<std::size_t>(hierarchy_level - 1));
+  const auto node_id = static_cast<NodeId>(m_kinds.size());
+  m_hierarchy_levels.push_back(hierarchy_level);
+  m_kinds.push_back(kind);
+  m_name_ids.push_back(name_id);
+  m_types.push_back(type);
+  m_binds.push_back(bind);
+  m_module_ids.push_back(module_id);
+  m_source_ids.push_back(source_id);
+  m_parents.push_back(ancestors.empty() ? no_node : ancestors.back());
+  m_subtree_ends.push_back(node_id + 1);
+  m_unref_dup_begins.push_back(static_cast<std::uint32_t>(m_unref_dups.size()));
+  ancestors.push_back(node_id);
+  return node_id;
+}
+
+void Map::SymbolClosure::CloseSubtrees(std::vector<NodeId>& ancestors,
+                                       const std::size_t hierarchy_level) noexcept
+{
+  const auto node_count = static_cast<NodeId>(m_kinds.size());
+  for (; ancestors.size() > hierarchy_level; ancestors.pop_back())
+    m_subtree_ends[ancestors.back()] = node_count;
+}
+
+std::uint32_t Map::SymbolClosure::AddString(const std::string_view str)
+{
+  m_strings.push_back(str);
+  return static_cast<std::uint32_t>(m_strings.size() - 1);
+}
+
+std::uint32_t Map::SymbolClosure::AddString(const std::string_view str, StringIds& string_ids)
+{
+  // Module and source names repeat for nearly every node, so they are only added once.
+  const auto [iter, inserted] =
+      string_ids.try_emplace(str, static_cast<std::uint32_t>(m_strings.size()));
+  if (inserted)
+    m_strings.push_back(str);
+  return iter->second;
+}
+
+void Map::SymbolClosure::Print(Printer& printer, UnresolvedSymbols::const_iterator& unresolved_head,
                                const UnresolvedSymbols::const_iterator unresolved_tail,
                                std::size_t& line_number) const
 {
-  m_root.Print(stream, 0, unresolved_head, unresolved_tail, line_number);
+  // This handles pre-print and mid-print unresolved symbols. Assuming the symbol closure exists at
+  // the right time, this will also handle post-print unresolved symbols.
+  Map::PrintUnresolvedSymbols(printer, unresolved_head, unresolved_tail, line_number);
+  for (const Node node : GetNodes())
+  {
+    const int hierarchy_level = node.GetHierarchyLevel();
+    switch (node.GetKind())
+    {
+    case NodeKind::Real:
+    {
+      PrintPrefix(printer, hierarchy_level);
+      // "%s (%s,%s) found in %s %s\r\n"
+      printer.Print(FMT_COMPILE("{:s} ({:s},{:s}) found in {:s} {:s}\r\n"), node.GetName(),
+                    ToName(node.GetType()), ToName(node.GetBind()), node.GetModuleName(),
+                    node.GetSourceName());
+      line_number += 1u;
+      const auto unref_dups = node.GetUnreferencedDuplicates();
+      if (!unref_dups.empty())
+      {
+        PrintPrefix(printer, hierarchy_level);
+        // ">>> UNREFERENCED DUPLICATE %s\r\n"
+        printer.Print(FMT_COMPILE(">>> UNREFERENCED DUPLICATE {:s}\r\n"), node.GetName());
+        line_number += 1u;
+        for (const auto& unref_dup : unref_dups)
+          unref_dup.Print(printer, hierarchy_level, line_number);
+      }
+      break;
+    }
+    case NodeKind::LinkerGenerated:
+      PrintPrefix(printer, hierarchy_level);
+      // "%s found as linker generated symbol\r\n"
+      printer.Print(FMT_COMPILE("{:s} found as linker generated symbol\r\n"), node.GetName());
+      line_number += 1u;
+      break;
+    case NodeKind::Dummy:
+      break;
+    }
+    Map::PrintUnresolvedSymbols(printer, unresolved_head, unresolved_tail, line_number);
+  }
 }
 
-void Map::SymbolClosure::NodeBase::PrintPrefix(std::ostream& stream, const int hierarchy_level)
+void Map::SymbolClosure::PrintPrefix(Printer& printer, const int hierarchy_level)
 {
   if (hierarchy_level >= 0)
     for (int i = 0; i <= hierarchy_level; ++i)
-      stream.put(' ');
+      printer.Put(' ');
   // "%i] "
-  fmt::print(stream, "{:d}] ", hierarchy_level);
+  printer.Print(FMT_COMPILE("{:d}] "), hierarchy_level);
 }
 
-constexpr std::string_view Map::SymbolClosure::NodeBase::ToName(const Type st_type) noexcept
+constexpr std::string_view Map::SymbolClosure::ToName(const Type st_type) noexcept
 {
   switch (st_type)
   {
@@ -1255,7 +2645,7 @@ constexpr std::string_view Map::SymbolClosure::NodeBase::ToName(const Type st_ty
   }
 }
 
-constexpr std::string_view Map::SymbolClosure::NodeBase::ToName(const Bind st_bind) noexcept
+constexpr std::string_view Map::SymbolClosure::ToName(const Bind st_bind) noexcept
 {
   switch (st_bind)
   {
@@ -1274,85 +2664,95 @@ constexpr std::string_view Map::SymbolClosure::NodeBase::ToName(const Bind st_bi
   }
 }
 
-void Map::SymbolClosure::NodeBase::Print(std::ostream& stream, const int hierarchy_level,
-                                         UnresolvedSymbols::const_iterator& unresolved_head,
-                                         const UnresolvedSymbols::const_iterator unresolved_tail,
-                                         std::size_t& line_number) const
-{
-  // This handles pre-print and mid-print unresolved symbols. Assuming the symbol closure exists at
-  // the right time, this will also handle post-print unresolved symbols.
-  Map::PrintUnresolvedSymbols(stream, unresolved_head, unresolved_tail, line_number);
-  for (const auto& node : GetChildren())
-    node->Print(stream, hierarchy_level + 1, unresolved_head, unresolved_tail, line_number);
-}
-
-void Map::SymbolClosure::NodeReal::Print(std::ostream& stream, const int hierarchy_level,
-                                         UnresolvedSymbols::const_iterator& unresolved_head,
-                                         const UnresolvedSymbols::const_iterator unresolved_tail,
-                                         std::size_t& line_number) const
-{
-  PrintPrefix(stream, hierarchy_level);
-  // "%s (%s,%s) found in %s %s\r\n"
-  fmt::print(stream, "{:s} ({:s},{:s}) found in {:s} {:s}\r\n", m_name, ToName(m_type),
-             ToName(m_bind), m_module_name, m_source_name);
-  line_number += 1u;
-  if (!m_unref_dups.empty())
-  {
-    PrintPrefix(stream, hierarchy_level);
-    // ">>> UNREFERENCED DUPLICATE %s\r\n"
-    fmt::print(stream, ">>> UNREFERENCED DUPLICATE {:s}\r\n", m_name);
-    line_number += 1u;
-    for (const auto& unref_dup : m_unref_dups)
-      unref_dup.Print(stream, hierarchy_level, line_number);
-  }
-  NodeBase::Print(stream, hierarchy_level, unresolved_head, unresolved_tail, line_number);
-}
-
-void Map::SymbolClosure::NodeLinkerGenerated::Print(
-    std::ostream& stream, const int hierarchy_level,
-    UnresolvedSymbols::const_iterator& unresolved_head,
-    const UnresolvedSymbols::const_iterator unresolved_tail, std::size_t& line_number) const
-{
-  PrintPrefix(stream, hierarchy_level);
-  // "%s found as linker generated symbol\r\n"
-  fmt::print(stream, "{:s} found as linker generated symbol\r\n", m_name);
-  line_number += 1u;
-  NodeBase::Print(stream, hierarchy_level, unresolved_head, unresolved_tail, line_number);
-}
-
-void Map::SymbolClosure::NodeReal::UnreferencedDuplicate::Print(  //
-    std::ostream& stream, const int hierarchy_level, std::size_t& line_number) const
+void Map::SymbolClosure::UnreferencedDuplicate::Print(  //
+    Printer& printer, const int hierarchy_level, std::size_t& line_number) const
 {
-  PrintPrefix(stream, hierarchy_level);
+  PrintPrefix(printer, hierarchy_level);
   // ">>> (%s,%s) found in %s %s\r\n"
-  fmt::print(stream, ">>> ({:s},{:s}) found in {:s} {:s}\r\n", ToName(m_type), ToName(m_bind),
-             m_module_name, m_source_name);
+  printer.Print(FMT_COMPILE(">>> ({:s},{:s}) found in {:s} {:s}\r\n"), ToName(m_type),
+                ToName(m_bind), m_module_name, m_source_name);
   line_number += 1u;
 }
 
 // clang-format off
-static const std::regex re_code_merging_is_duplicated{
+static const Mijo::LazyRegex re_code_merging_is_duplicated{
 //  "--> duplicated code: symbol %s is duplicated by %s, size = %d \r\n\r\n"
     "--> duplicated code: symbol (.*) is duplicated by (.*), size = (\\d+) \r?\n\r?\n"};
-static const std::regex re_code_merging_will_be_replaced{
+static const Mijo::LazyRegex re_code_merging_will_be_replaced{
 //  "--> the function %s will be replaced by a branch to %s\r\n\r\n\r\n"
     "--> the function (.*) will be replaced by a branch to (.*)\r?\n\r?\n\r?\n"};
-static const std::regex re_code_merging_was_interchanged{
+static const Mijo::LazyRegex re_code_merging_was_interchanged{
 //  "--> the function %s was interchanged with %s, size=%d \r\n"
     "--> the function (.*) was interchanged with (.*), size=(\\d+) \r?\n"};
-static const std::regex re_code_folding_header{
+static const Mijo::LazyRegex re_code_folding_header{
 //  "\r\n\r\n\r\nCode folded in file: %s \r\n"
     "\r?\n\r?\n\r?\nCode folded in file: (.*) \r?\n"};
-static const std::regex re_code_folding_is_duplicated{
+static const Mijo::LazyRegex re_code_folding_is_duplicated{
 //  "--> %s is duplicated by %s, size = %d \r\n\r\n"
     "--> (.*) is duplicated by (.*), size = (\\d+) \r?\n\r?\n"};
-static const std::regex re_code_folding_is_duplicated_new_branch{
+static const Mijo::LazyRegex re_code_folding_is_duplicated_new_branch{
 //  "--> %s is duplicated by %s, size = %d, new branch function %s \r\n\r\n"
     "--> (.*) is duplicated by (.*), size = (\\d+), new branch function (.*) \r?\n\r?\n"};
 // clang-format on
 
+// Each of the above patterns is only searched for on a line that begins and ends the way it would
+// and has the text it would in between, which turns almost every other line away for the cost of
+// looking over it once.
+static std::string_view PeekLine(const char* const head, const char* const tail) noexcept
+{
+  std::string_view content;
+  const char* next;
+  return Mijo::ScanLine(head, tail, content, next) ? content : std::string_view{};
+}
+
+// ", size = %d "
+static bool EndsWithSize(std::string_view line) noexcept
+{
+  if (!line.ends_with(' '))
+    return false;
+  line.remove_suffix(1);
+  const std::size_t digit_count = line.size() - (line.find_last_not_of("0123456789") + 1);
+  line.remove_suffix(digit_count);
+  return digit_count != 0 && line.ends_with(", size = ");
+}
+
+static bool Contains(const std::string_view line, const std::string_view text) noexcept
+{
+  return line.find(text) != std::string_view::npos;
+}
+
+static bool CouldBeCodeMergingIsDuplicated(const std::string_view line) noexcept
+{
+  return line.starts_with("--> duplicated code: symbol ") && EndsWithSize(line);
+}
+
+static bool CouldBeCodeMergingWillBeReplaced(const std::string_view line) noexcept
+{
+  return line.starts_with("--> the function ") &&
+         Contains(line, " will be replaced by a branch to ");
+}
+
+static bool CouldBeCodeMergingWasInterchanged(const std::string_view line) noexcept
+{
+  return line.starts_with("--> the function ") && Contains(line, " was interchanged with ") &&
+         line.ends_with(' ');
+}
+
+static bool CouldBeCodeFoldingIsDuplicated(const std::string_view line) noexcept
+{
+  return line.starts_with("--> ") && Contains(line, " is duplicated by ") && EndsWithSize(line);
+}
+
+static bool CouldBeCodeFoldingIsDuplicatedNewBranch(const std::string_view line) noexcept
+{
+  return line.starts_with("--> ") && Contains(line, ", new branch function ") &&
+         line.ends_with(' ');
+}
+
 Map::ScanError Map::EPPC_PatternMatching::Scan(const char*& head, const char* const tail,
-                                               std::size_t& line_number)
+                                               std::size_t& line_number,
+                                               Mijo::StringPool& string_pool,
+                                               Diagnostics& diagnostics)
 {
   Mijo::CMatchResults match;
 
@@ -1361,15 +2761,16 @@ Map::ScanError Map::EPPC_PatternMatching::Scan(const char*& head, const char* co
     bool will_be_replaced = false, was_interchanged = false;
     // EPPC_PatternMatching looks for functions that are duplicates of one another and prints what
     // it has changed in real-time to the linker map.
-    if (std::regex_search(head, tail, match, re_code_merging_is_duplicated,
-                          std::regex_constants::match_continuous))
+    const std::string_view line = PeekLine(head, tail);
+    if (CouldBeCodeMergingIsDuplicated(line) &&
+        MatchRegex(head, tail, match, *re_code_merging_is_duplicated))
     {
       const std::string_view first_name = match[1].view(), second_name = match[2].view();
       const Elf32_Word size = match[3].to<Elf32_Word>();
       line_number += 2u;
       head = match[0].second;
-      if (std::regex_search(head, tail, match, re_code_merging_will_be_replaced,
-                            std::regex_constants::match_continuous))
+      if (CouldBeCodeMergingWillBeReplaced(PeekLine(head, tail)) &&
+          MatchRegex(head, tail, match, *re_code_merging_will_be_replaced))
       {
         if (match[1].view() != first_name)
           return ScanError::EPPC_PatternMatchingMergingFirstNameMismatch;
@@ -1379,23 +2780,24 @@ Map::ScanError Map::EPPC_PatternMatching::Scan(const char*& head, const char* co
         line_number += 3u;
         head = match[0].second;
       }
-      const MergingUnit& unit = m_merging_units.emplace_back(first_name, second_name, size,
-                                                             will_be_replaced, was_interchanged);
+      const MergingUnit& unit = m_merging_units.emplace_back(
+          string_pool.Store(first_name), string_pool.Store(second_name), size, will_be_replaced,
+          was_interchanged);
       if (m_merging_lookup.contains(first_name))
-        Warn::MergingOneDefinitionRuleViolation(line_number - 5u, first_name);
+        Warn::MergingOneDefinitionRuleViolation(diagnostics, line_number - 5u, first_name);
       m_merging_lookup.emplace(unit.m_first_name, unit);
       continue;
     }
-    if (std::regex_search(head, tail, match, re_code_merging_was_interchanged,
-                          std::regex_constants::match_continuous))
+    if (CouldBeCodeMergingWasInterchanged(line) &&
+        MatchRegex(head, tail, match, *re_code_merging_was_interchanged))
     {
       const std::string_view first_name = match[1].view(), second_name = match[2].view();
       const Elf32_Word size = match[3].to<Elf32_Word>();
       was_interchanged = true;
       line_number += 1u;
       head = match[0].second;
-      if (std::regex_search(head, tail, match, re_code_merging_will_be_replaced,
-                            std::regex_constants::match_continuous))
+      if (CouldBeCodeMergingWillBeReplaced(PeekLine(head, tail)) &&
+          MatchRegex(head, tail, match, *re_code_merging_will_be_replaced))
       {
         if (match[1].view() != first_name)
           return ScanError::EPPC_PatternMatchingMergingFirstNameMismatch;
@@ -1405,8 +2807,8 @@ Map::ScanError Map::EPPC_PatternMatching::Scan(const char*& head, const char* co
         line_number += 3u;
         head = match[0].second;
       }
-      if (std::regex_search(head, tail, match, re_code_merging_is_duplicated,
-                            std::regex_constants::match_continuous))
+      if (CouldBeCodeMergingIsDuplicated(PeekLine(head, tail)) &&
+          MatchRegex(head, tail, match, *re_code_merging_is_duplicated))
       {
         if (match[1].view() != first_name)
           return ScanError::EPPC_PatternMatchingMergingFirstNameMismatch;
@@ -1421,53 +2823,59 @@ Map::ScanError Map::EPPC_PatternMatching::Scan(const char*& head, const char* co
       {
         return ScanError::EPPC_PatternMatchingMergingInterchangeMissingEpilogue;
       }
-      const MergingUnit& unit = m_merging_units.emplace_back(first_name, second_name, size,
-                                                             will_be_replaced, was_interchanged);
+      const MergingUnit& unit = m_merging_units.emplace_back(
+          string_pool.Store(first_name), string_pool.Store(second_name), size, will_be_replaced,
+          was_interchanged);
       if (m_merging_lookup.contains(first_name))
-        Warn::MergingOneDefinitionRuleViolation(line_number - 5u, first_name);
+        Warn::MergingOneDefinitionRuleViolation(diagnostics, line_number - 5u, first_name);
       m_merging_lookup.emplace(unit.m_first_name, unit);
       continue;
     }
     break;
   }
   // After analysis concludes, a redundant summary of changes per file is printed.
-  while (std::regex_search(head, tail, match, re_code_folding_header,
-                           std::regex_constants::match_continuous))
+  while (head != tail && (*head == '\r' || *head == '\n') &&
+         MatchRegex(head, tail, match, *re_code_folding_header))
   {
     const std::string_view object_name = match[1].view();
     if (m_folding_lookup.contains(object_name))
-      Warn::FoldingRepeatObject(line_number + 3u, object_name);
-    FoldingUnit& folding_unit = m_folding_units.emplace_back(object_name);
+      Warn::FoldingRepeatObject(diagnostics, line_number + 3u, object_name);
+    FoldingUnit& folding_unit = m_folding_units.emplace_back(string_pool.Store(object_name));
 
     FoldingUnit::UnitLookup& curr_unit_lookup = m_folding_lookup[folding_unit.m_object_name];
     line_number += 4u;
     head = match[0].second;
     while (true)
     {
-      if (std::regex_search(head, tail, match, re_code_folding_is_duplicated,
-                            std::regex_constants::match_continuous))
+      const std::string_view line = PeekLine(head, tail);
+      if (CouldBeCodeFoldingIsDuplicated(line) &&
+          MatchRegex(head, tail, match, *re_code_folding_is_duplicated))
       {
         const std::string_view first_name = match[1].view();
         if (curr_unit_lookup.contains(first_name))
-          Warn::FoldingOneDefinitionRuleViolation(line_number, first_name, object_name);
+          Warn::FoldingOneDefinitionRuleViolation(diagnostics, line_number, first_name,
+                                                  object_name);
         const FoldingUnit::Unit& unit = folding_unit.m_units.emplace_back(
-            first_name, match[2].view(), match[3].to<Elf32_Word>(), false);
+            string_pool.Store(first_name), string_pool.Store(match[2].view()),
+            match[3].to<Elf32_Word>(), false);
         curr_unit_lookup.emplace(unit.m_first_name, unit);
         line_number += 2u;
         head = match[0].second;
         continue;
       }
-      if (std::regex_search(head, tail, match, re_code_folding_is_duplicated_new_branch,
-                            std::regex_constants::match_continuous))
+      if (CouldBeCodeFoldingIsDuplicatedNewBranch(line) &&
+          MatchRegex(head, tail, match, *re_code_folding_is_duplicated_new_branch))
       {
         const std::string_view first_name = match[1].view();
         // It is my assumption that these will always match.
         if (first_name != match[4].view())
           return ScanError::EPPC_PatternMatchingFoldingNewBranchFunctionNameMismatch;
         if (curr_unit_lookup.contains(first_name))
-          Warn::FoldingOneDefinitionRuleViolation(line_number, first_name, object_name);
+          Warn::FoldingOneDefinitionRuleViolation(diagnostics, line_number, first_name,
+                                                  object_name);
         const FoldingUnit::Unit& unit = folding_unit.m_units.emplace_back(
-            first_name, match[2].view(), match[3].to<Elf32_Word>(), true);
+            string_pool.Store(first_name), string_pool.Store(match[2].view()),
+            match[3].to<Elf32_Word>(), true);
         curr_unit_lookup.emplace(unit.m_first_name, unit);
         line_number += 2u;
         head = match[0].second;
@@ -1479,137 +2887,133 @@ Map::ScanError Map::EPPC_PatternMatching::Scan(const char*& head, const char* co
   return ScanError::None;
 }
 
-void Map::EPPC_PatternMatching::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::EPPC_PatternMatching::Print(Printer& printer, std::size_t& line_number) const
 {
   for (const auto& unit : m_merging_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
   for (const auto& unit : m_folding_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
 
-void Map::EPPC_PatternMatching::MergingUnit::Print(std::ostream& stream,
-                                                   std::size_t& line_number) const
+void Map::EPPC_PatternMatching::MergingUnit::Print(Printer& printer, std::size_t& line_number) const
 {
   if (m_was_interchanged)
   {
     // "--> the function %s was interchanged with %s, size=%d \r\n"
-    fmt::print(stream, "--> the function {:s} was interchanged with {:s}, size={:d} \r\n",
-               m_first_name, m_second_name, m_size);
+    printer.Print(FMT_COMPILE("--> the function {:s} was interchanged with {:s}, size={:d} \r\n"),
+                  m_first_name, m_second_name, m_size);
     line_number += 1u;
     if (m_will_be_replaced)
     {
       // "--> the function %s will be replaced by a branch to %s\r\n\r\n\r\n"
-      fmt::print(stream, "--> the function {:s} will be replaced by a branch to {:s}\r\n\r\n\r\n",
-                 m_first_name, m_second_name);
+      printer.Print(
+          FMT_COMPILE("--> the function {:s} will be replaced by a branch to {:s}\r\n\r\n\r\n"),
+          m_first_name, m_second_name);
       line_number += 3u;
     }
     // "--> duplicated code: symbol %s is duplicated by %s, size = %d \r\n\r\n"
-    fmt::print(stream,
-               "--> duplicated code: symbol {:s} is duplicated by {:s}, size = {:d} \r\n\r\n",
-               m_first_name, m_second_name, m_size);
+    printer.Print(
+        FMT_COMPILE("--> duplicated code: symbol {:s} is duplicated by {:s}, size = {:d} \r\n\r\n"),
+        m_first_name, m_second_name, m_size);
     line_number += 2u;
   }
   else
   {
     // "--> duplicated code: symbol %s is duplicated by %s, size = %d \r\n\r\n"
-    fmt::print(stream,
-               "--> duplicated code: symbol {:s} is duplicated by {:s}, size = {:d} \r\n\r\n",
-               m_first_name, m_second_name, m_size);
+    printer.Print(
+        FMT_COMPILE("--> duplicated code: symbol {:s} is duplicated by {:s}, size = {:d} \r\n\r\n"),
+        m_first_name, m_second_name, m_size);
     line_number += 2u;
     if (m_will_be_replaced)
     {
       // "--> the function %s will be replaced by a branch to %s\r\n\r\n\r\n"
-      fmt::print(stream, "--> the function {:s} will be replaced by a branch to {:s}\r\n\r\n\r\n",
-                 m_first_name, m_second_name);
+      printer.Print(
+          FMT_COMPILE("--> the function {:s} will be replaced by a branch to {:s}\r\n\r\n\r\n"),
+          m_first_name, m_second_name);
       line_number += 3u;
     }
   }
 }
 
-void Map::EPPC_PatternMatching::FoldingUnit::Print(std::ostream& stream,
-                                                   std::size_t& line_number) const
+void Map::EPPC_PatternMatching::FoldingUnit::Print(Printer& printer, std::size_t& line_number) const
 {
   // "\r\n\r\n\r\nCode folded in file: %s \r\n"
-  fmt::print(stream, "\r\n\r\n\r\nCode folded in file: {:s} \r\n", m_object_name);
+  printer.Print(FMT_COMPILE("\r\n\r\n\r\nCode folded in file: {:s} \r\n"), m_object_name);
   line_number += 4u;
   for (const auto& unit : m_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
 
-void Map::EPPC_PatternMatching::FoldingUnit::Unit::Print(std::ostream& stream,
+void Map::EPPC_PatternMatching::FoldingUnit::Unit::Print(Printer& printer,
                                                          std::size_t& line_number) const
 {
   if (m_new_branch_function)
   {
     // "--> %s is duplicated by %s, size = %d, new branch function %s \r\n\r\n"
-    fmt::print(stream,
-               "--> {:s} is duplicated by {:s}, size = {:d}, new branch function {:s} \r\n\r\n",
-               m_first_name, m_second_name, m_size, m_first_name);
+    printer.Print(FMT_COMPILE("--> {:s} is duplicated by {:s}, size = {:d}, "
+                              "new branch function {:s} \r\n\r\n"),
+                  m_first_name, m_second_name, m_size, m_first_name);
     line_number += 2u;
   }
   else
   {
     // "--> %s is duplicated by %s, size = %d \r\n\r\n"
-    fmt::print(stream, "--> {:s} is duplicated by {:s}, size = {:d} \r\n\r\n", m_first_name,
-               m_second_name, m_size);
+    printer.Print(FMT_COMPILE("--> {:s} is duplicated by {:s}, size = {:d} \r\n\r\n"), m_first_name,
+                  m_second_name, m_size);
     line_number += 2u;
   }
 }
 
 // clang-format off
-static const std::regex re_linker_opts_unit_not_near{
+static const Mijo::LazyRegex re_linker_opts_unit_not_near{
 //  "  %s/ %s()/ %s - address not in near addressing range \r\n"
     "  (.*)/ (.*)\\(\\)/ (.*) - address not in near addressing range \r?\n"};
-static const std::regex re_linker_opts_unit_address_not_computed{
+static const Mijo::LazyRegex re_linker_opts_unit_address_not_computed{
 //  "  %s/ %s()/ %s - final address not yet computed \r\n"
     "  (.*)/ (.*)\\(\\)/ (.*) - final address not yet computed \r?\n"};
-static const std::regex re_linker_opts_unit_optimized{
+static const Mijo::LazyRegex re_linker_opts_unit_optimized{
 //  "! %s/ %s()/ %s - optimized addressing \r\n"
     "! (.*)/ (.*)\\(\\)/ (.*) - optimized addressing \r?\n"};
-static const std::regex re_linker_opts_unit_disassemble_error{
+static const Mijo::LazyRegex re_linker_opts_unit_disassemble_error{
 //  "  %s/ %s() - error disassembling function \r\n"
     "  (.*)/ (.*)\\(\\) - error disassembling function \r?\n"};
 // clang-format on
 
 Map::ScanError Map::LinkerOpts::Scan(const char*& head, const char* const tail,
-                                     std::size_t& line_number)
-
+                                     std::size_t& line_number, Mijo::StringPool& string_pool)
 {
   Mijo::CMatchResults match;
 
   while (true)
   {
-    if (std::regex_search(head, tail, match, re_linker_opts_unit_not_near,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_linker_opts_unit_not_near))
     {
-      m_units.emplace_back(Unit::Kind::NotNear, match[1].view(), match[2].view(), match[3].view());
+      m_units.emplace_back(Unit::Kind::NotNear, string_pool.Store(match[1].view()),
+                           string_pool.Store(match[2].view()), string_pool.Store(match[3].view()));
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_linker_opts_unit_disassemble_error,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_linker_opts_unit_disassemble_error))
     {
-      m_units.emplace_back(match[1].view(), match[2].view());
+      m_units.emplace_back(string_pool.Store(match[1].view()), string_pool.Store(match[2].view()));
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_linker_opts_unit_address_not_computed,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_linker_opts_unit_address_not_computed))
     {
-      m_units.emplace_back(Unit::Kind::NotComputed, match[1].view(), match[2].view(),
-                           match[3].view());
+      m_units.emplace_back(Unit::Kind::NotComputed, string_pool.Store(match[1].view()),
+                           string_pool.Store(match[2].view()), string_pool.Store(match[3].view()));
       line_number += 1u;
       head = match[0].second;
       continue;
     }
     // I have not seen a single linker map with this
-    if (std::regex_search(head, tail, match, re_linker_opts_unit_optimized,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_linker_opts_unit_optimized))
     {
-      m_units.emplace_back(Unit::Kind::Optimized, match[1].view(), match[2].view(),
-                           match[3].view());
+      m_units.emplace_back(Unit::Kind::Optimized, string_pool.Store(match[1].view()),
+                           string_pool.Store(match[2].view()), string_pool.Store(match[3].view()));
       line_number += 1u;
       head = match[0].second;
       continue;
@@ -1619,53 +3023,54 @@ Map::ScanError Map::LinkerOpts::Scan(const char*& head, const char* const tail,
   return ScanError::None;
 }
 
-void Map::LinkerOpts::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::LinkerOpts::Print(Printer& printer, std::size_t& line_number) const
 {
   for (const auto& unit : m_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
 
-void Map::LinkerOpts::Unit::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::LinkerOpts::Unit::Print(Printer& printer, std::size_t& line_number) const
 {
   switch (m_unit_kind)
   {
   case Kind::NotNear:
     // "  %s/ %s()/ %s - address not in near addressing range \r\n"
-    fmt::print(stream, "  {:s}/ {:s}()/ {:s} - address not in near addressing range \r\n",
-               m_module_name, m_name, m_reference_name);
+    printer.Print(FMT_COMPILE("  {:s}/ {:s}()/ {:s} - address not in near addressing range \r\n"),
+                  m_module_name, m_name, m_reference_name);
     line_number += 1u;
     return;
   case Kind::NotComputed:
     // "  %s/ %s()/ %s - final address not yet computed \r\n"
-    fmt::print(stream, "  {:s}/ {:s}()/ {:s} - final address not yet computed \r\n", m_module_name,
-               m_name, m_reference_name);
+    printer.Print(FMT_COMPILE("  {:s}/ {:s}()/ {:s} - final address not yet computed \r\n"),
+                  m_module_name, m_name, m_reference_name);
     line_number += 1u;
     return;
   case Kind::Optimized:
     // "! %s/ %s()/ %s - optimized addressing \r\n"
-    fmt::print(stream, "! {:s}/ {:s}()/ {:s} - optimized addressing \r\n", m_module_name, m_name,
-               m_reference_name);
+    printer.Print(FMT_COMPILE("! {:s}/ {:s}()/ {:s} - optimized addressing \r\n"), m_module_name,
+                  m_name, m_reference_name);
     line_number += 1u;
     return;
   case Kind::DisassembleError:
     // "  %s/ %s() - error disassembling function \r\n"
-    fmt::print(stream, "  {:s}/ {:s}() - error disassembling function \r\n", m_module_name, m_name);
+    printer.Print(FMT_COMPILE("  {:s}/ {:s}() - error disassembling function \r\n"), m_module_name,
+                  m_name);
     line_number += 1u;
     return;
   }
 }
 
 // clang-format off
-static const std::regex re_mixed_mode_islands_created{
+static const Mijo::LazyRegex re_mixed_mode_islands_created{
 //  "  mixed mode island %s created for %s\r\n"
     "  mixed mode island (.*) created for (.*)\r?\n"};
-static const std::regex re_mixed_mode_islands_created_safe{
+static const Mijo::LazyRegex re_mixed_mode_islands_created_safe{
 //  "  safe mixed mode island %s created for %s\r\n"
     "  safe mixed mode island (.*) created for (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MixedModeIslands::Scan(const char*& head, const char* const tail,
-                                           std::size_t& line_number)
+                                           std::size_t& line_number, Mijo::StringPool& string_pool)
 {
   Mijo::CMatchResults match;
 
@@ -1673,18 +3078,18 @@ Map::ScanError Map::MixedModeIslands::Scan(const char*& head, const char* const
   // Similar to Branch Islands, this is conjecture.
   while (true)
   {
-    if (std::regex_search(head, tail, match, re_mixed_mode_islands_created,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_mixed_mode_islands_created))
     {
-      m_units.emplace_back(match[1].view(), match[2].view(), false);
+      m_units.emplace_back(string_pool.Store(match[1].view()), string_pool.Store(match[2].view()),
+                           false);
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_mixed_mode_islands_created_safe,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_mixed_mode_islands_created_safe))
     {
-      m_units.emplace_back(match[1].view(), match[2].view(), true);
+      m_units.emplace_back(string_pool.Store(match[1].view()), string_pool.Store(match[2].view()),
+                           true);
       line_number += 1u;
       head = match[0].second;
       continue;
@@ -1694,42 +3099,42 @@ Map::ScanError Map::MixedModeIslands::Scan(const char*& head, const char* const
   return ScanError::None;
 }
 
-void Map::MixedModeIslands::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::MixedModeIslands::Print(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "\r\nMixed Mode Islands\r\n");
+  printer.Print(FMT_COMPILE("\r\nMixed Mode Islands\r\n"));
   line_number += 2u;
   for (const auto& unit : m_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
-void Map::MixedModeIslands::Unit::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::MixedModeIslands::Unit::Print(Printer& printer, std::size_t& line_number) const
 {
   if (m_is_safe)
   {
     // "  safe mixed mode island %s created for %s\r\n"
-    fmt::print(stream, "  safe mixed mode island {:s} created for {:s}\r\n", m_first_name,
-               m_second_name);
+    printer.Print(FMT_COMPILE("  safe mixed mode island {:s} created for {:s}\r\n"), m_first_name,
+                  m_second_name);
     line_number += 1u;
   }
   else
   {
     // "  mixed mode island %s created for %s\r\n"
-    fmt::print(stream, "  mixed mode island {:s} created for {:s}\r\n", m_first_name,
-               m_second_name);
+    printer.Print(FMT_COMPILE("  mixed mode island {:s} created for {:s}\r\n"), m_first_name,
+                  m_second_name);
     line_number += 1u;
   }
 }
 
 // clang-format off
-static const std::regex re_branch_islands_created{
+static const Mijo::LazyRegex re_branch_islands_created{
 //  "  branch island %s created for %s\r\n"
     "  branch island (.*) created for (.*)\r?\n"};
-static const std::regex re_branch_islands_created_safe{
+static const Mijo::LazyRegex re_branch_islands_created_safe{
 //  "  safe branch island %s created for %s\r\n"
     "  safe branch island (.*) created for (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::BranchIslands::Scan(const char*& head, const char* const tail,
-                                        std::size_t& line_number)
+                                        std::size_t& line_number, Mijo::StringPool& string_pool)
 {
   Mijo::CMatchResults match;
 
@@ -1737,18 +3142,18 @@ Map::ScanError Map::BranchIslands::Scan(const char*& head, const char* const tai
   // was an empty portion. From datamining MWLDEPPC, I can only assume it goes something like this.
   while (true)
   {
-    if (std::regex_search(head, tail, match, re_branch_islands_created,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_branch_islands_created))
     {
-      m_units.emplace_back(match[1].view(), match[2].view(), false);
+      m_units.emplace_back(string_pool.Store(match[1].view()), string_pool.Store(match[2].view()),
+                           false);
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_branch_islands_created_safe,
-                          std::regex_constants::match_continuous))
+    if (MatchRegex(head, tail, match, *re_branch_islands_created_safe))
     {
-      m_units.emplace_back(match[1].view(), match[2].view(), true);
+      m_units.emplace_back(string_pool.Store(match[1].view()), string_pool.Store(match[2].view()),
+                           true);
       line_number += 1u;
       head = match[0].second;
       continue;
@@ -1758,26 +3163,27 @@ Map::ScanError Map::BranchIslands::Scan(const char*& head, const char* const tai
   return ScanError::None;
 }
 
-void Map::BranchIslands::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::BranchIslands::Print(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "\r\nBranch Islands\r\n");
+  printer.Print(FMT_COMPILE("\r\nBranch Islands\r\n"));
   line_number += 2u;
   for (const auto& unit : m_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
-void Map::BranchIslands::Unit::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::BranchIslands::Unit::Print(Printer& printer, std::size_t& line_number) const
 {
   if (m_is_safe)
   {
     //  "  safe branch island %s created for %s\r\n"
-    fmt::print(stream, "  safe branch island {:s} created for {:s}\r\n", m_first_name,
-               m_second_name);
+    printer.Print(FMT_COMPILE("  safe branch island {:s} created for {:s}\r\n"), m_first_name,
+                  m_second_name);
     line_number += 1u;
   }
   else
   {
     //  "  branch island %s created for %s\r\n"
-    fmt::print(stream, "  branch island {:s} created for {:s}\r\n", m_first_name, m_second_name);
+    printer.Print(FMT_COMPILE("  branch island {:s} created for {:s}\r\n"), m_first_name,
+                  m_second_name);
     line_number += 1u;
   }
 }
@@ -1789,10 +3195,10 @@ Map::ScanError Map::LinktimeSizeDecreasingOptimizations::Scan(const char*&, cons
   return ScanError::None;
 }
 
-void Map::LinktimeSizeDecreasingOptimizations::Print(std::ostream& stream,
+void Map::LinktimeSizeDecreasingOptimizations::Print(Printer& printer,
                                                      std::size_t& line_number) const
 {
-  fmt::print(stream, "\r\nLinktime size-decreasing optimizations\r\n");
+  printer.Print(FMT_COMPILE("\r\nLinktime size-decreasing optimizations\r\n"));
   line_number += 2u;
 }
 
@@ -1803,18 +3209,18 @@ Map::ScanError Map::LinktimeSizeIncreasingOptimizations::Scan(const char*&, cons
   return ScanError::None;
 }
 
-void Map::LinktimeSizeIncreasingOptimizations::Print(std::ostream& stream,
+void Map::LinktimeSizeIncreasingOptimizations::Print(Printer& printer,
                                                      std::size_t& line_number) const
 {
-  fmt::print(stream, "\r\nLinktime size-increasing optimizations\r\n");
+  printer.Print(FMT_COMPILE("\r\nLinktime size-increasing optimizations\r\n"));
   line_number += 2u;
 }
 
 Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  //
     ScanningContext& scanning_context)
 {
-  auto& [section_layout, line_number, is_second_lap, is_multi_stt_section, curr_unit_lookup,
-         curr_module_name, curr_source_name] = scanning_context;
+  auto& [diagnostics, section_layout, line_number, is_second_lap, is_multi_stt_section,
+         curr_unit_lookup, curr_module_name, curr_source_name] = scanning_context;
 
   const bool is_symbol_stt_section = (m_name == section_layout.m_name);
 
@@ -1838,14 +3244,15 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
         // STT_SECTION symbols, making them indistinguishable from a repeat-name compilation unit
         // without further heuristics.  In other words, false positives ahoy.
         // TODO: What version?
-        Map::SectionLayout::Warn::RepeatCompilationUnit(line_number, compilation_unit_name,
+        Map::SectionLayout::Warn::RepeatCompilationUnit(diagnostics, line_number,
+                                                        compilation_unit_name,
                                                         section_layout.m_name);
       }
       if (is_second_lap)
       {
         // This should never happen if my heuristics are accurate, but they tend to have edge cases.
         if (section_layout.m_section_kind == Map::SectionLayout::Kind::BSS)
-          Map::SectionLayout::Warn::LCommAfterComm(line_number);
+          Map::SectionLayout::Warn::LCommAfterComm(diagnostics, line_number);
         // Should probably warn about extabindex's second lap here as well, but that would be doubly
         // weird since extabindex should never have STT_SECTION symbols in the first place.
         is_second_lap = false;
@@ -1854,8 +3261,8 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
     }
     if (section_layout.m_section_kind == Map::SectionLayout::Kind::BSS)
     {
-      Map::SectionLayout::Warn::CommonOnFlagDetected(line_number, compilation_unit_name,
-                                                     section_layout.m_name);
+      Map::SectionLayout::Warn::CommonOnFlagDetected(diagnostics, line_number,
+                                                     compilation_unit_name, section_layout.m_name);
       // TODO: There is currently no clean way to detect repeat-name compilation units during
       // a BSS section's second lap for printing .lcomm symbols.
       is_second_lap = true;
@@ -1865,7 +3272,8 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
     {
       if (is_repeat_compilation_unit_detected)
       {
-        Map::SectionLayout::Warn::RepeatCompilationUnit(line_number, compilation_unit_name,
+        Map::SectionLayout::Warn::RepeatCompilationUnit(diagnostics, line_number,
+                                                        compilation_unit_name,
                                                         section_layout.m_name);
       }
       return Unit::Trait::ExTab;
@@ -1883,7 +3291,8 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
       // an extabindex section's second lap for printing UNUSED symbols after _eti_init_info.
       else if (is_repeat_compilation_unit_detected && !is_second_lap)
       {
-        Map::SectionLayout::Warn::RepeatCompilationUnit(line_number, compilation_unit_name,
+        Map::SectionLayout::Warn::RepeatCompilationUnit(diagnostics, line_number,
+                                                        compilation_unit_name,
                                                         section_layout.m_name);
       }
       return Unit::Trait::ExTabIndex;
@@ -1897,7 +3306,8 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
     {
       const std::string_view compilation_unit_name =
           GetCompilationUnitName(m_module_name, m_source_name);
-      Warn::RepeatCompilationUnit(line_number, compilation_unit_name, section_layout.m_name);
+      Warn::RepeatCompilationUnit(diagnostics, line_number, compilation_unit_name,
+                                  section_layout.m_name);
     }
     else if (!is_multi_stt_section)
     {
@@ -1905,7 +3315,8 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
       // units are adjacent to one another.
       const std::string_view compilation_unit_name =
           GetCompilationUnitName(m_module_name, m_source_name);
-      Warn::SymOnFlagDetected(line_number, compilation_unit_name, section_layout.m_name);
+      Warn::SymOnFlagDetected(diagnostics, line_number, compilation_unit_name,
+                              section_layout.m_name);
       is_multi_stt_section = true;
     }
     return Unit::Trait::Section;
@@ -1918,7 +3329,7 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
     // This can be a strong hint that there are two or more repeat-name compilation units in your
     // linker map, assuming it's not messed up in any way.  Note that this does not detect symbols
     // with identical names across section layouts.
-    Warn::OneDefinitionRuleViolation(line_number, m_name, compilation_unit_name,
+    Warn::OneDefinitionRuleViolation(diagnostics, line_number, m_name, compilation_unit_name,
                                      section_layout.m_name);
   }
 
@@ -1943,8 +3354,8 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceUsualSubtext(  /
 Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceEntrySubtext(  //
     ScanningContext& scanning_context)
 {
-  auto& [section_layout, line_number, is_second_lap, is_multi_stt_section, curr_unit_lookup,
-         curr_module_name, curr_source_name] = scanning_context;
+  auto& [diagnostics, section_layout, line_number, is_second_lap, is_multi_stt_section,
+         curr_unit_lookup, curr_module_name, curr_source_name] = scanning_context;
 
   // Should never be the STT_SECTION symbol. Also, this can never belong to a new compilation
   // unit (a new curr_unit_lookup) since that would inherently be an orphaned entry symbol.
@@ -1952,76 +3363,112 @@ Map::SectionLayout::Unit::Trait Map::SectionLayout::Unit::DeduceEntrySubtext(  /
   {
     const std::string_view compilation_unit_name =
         GetCompilationUnitName(m_module_name, m_source_name);
-    Warn::OneDefinitionRuleViolation(line_number, m_name, compilation_unit_name,
+    Warn::OneDefinitionRuleViolation(diagnostics, line_number, m_name, compilation_unit_name,
                                      section_layout.m_name);
   }
   return Trait::NoType;
 }
 
+// Every row of a Section Layout begins with either "  UNUSED   " or an address, and whether what
+// follows the address columns could be an alignment tells most of the rest apart. Classifying a
+// row once means only the patterns it could match are tried on it. The regex fallback is left to
+// try every pattern on every row, so that it stays a check on the classifying as well.
+struct SectionLayoutRow
+{
+  bool m_may_be_unused;
+  bool m_may_be_aligned;
+  bool m_may_be_unaligned;
+};
+
+static SectionLayoutRow ClassifySectionLayoutRow(const char* const head, const char* const tail,
+                                                 const std::size_t alignment_column,
+                                                 const bool use_regex) noexcept
+{
+  if (use_regex)
+    return {true, true, true};
+  const std::string_view row{head, tail};
+  const auto is_hex = [&](const std::size_t i) {
+    return i < row.size() && ((row[i] >= '0' && row[i] <= '9') || (row[i] >= 'a' && row[i] <= 'f'));
+  };
+  const auto is_digit = [&](const std::size_t i) {
+    return i < row.size() && row[i] >= '0' && row[i] <= '9';
+  };
+  if (row.starts_with("  UNUSED   "))
+    return {true, false, false};
+  if (!row.starts_with("  ") || !is_hex(2))
+    return {false, false, false};
+  // " ?\\d+" is where every unit but an entry has its alignment.
+  if (is_digit(alignment_column) ||
+      (alignment_column < row.size() && row[alignment_column] == ' ' &&
+       is_digit(alignment_column + 1)))
+    return {false, true, false};
+  return {false, false, true};
+}
+
 // clang-format off
-static const std::regex re_section_layout_3column_unit_normal{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Spaces<0, 1>, Digits, Literal<" ">, Any, Literal<" \t">, Any,
+                         Literal<" ">, Any>
+    re_section_layout_3column_unit_normal{
 //  "  %08x %06x %08x %2i %s \t%s %s\r\n"
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8})  ?(\\d+) (.*) \t(.*) (.*)\r?\n"};
-static const std::regex re_section_layout_3column_unit_unused{
+static const LinePattern<Literal<"  UNUSED   ">, Hex<6>, Literal<" ........ ">, Any, Literal<" ">,
+                         Any, Literal<" ">, Any>
+    re_section_layout_3column_unit_unused{
 //  "  UNUSED   %06x ........ %s %s %s\r\n"
     "  UNUSED   ([0-9a-f]{6}) \\.{8} (.*) (.*) (.*)\r?\n"};
-static const std::regex re_section_layout_3column_unit_entry{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Any, Literal<" (entry of ">, Any, Literal<") \t">, Any,
+                         Literal<" ">, Any>
+    re_section_layout_3column_unit_entry{
 //  "  %08lx %06lx %08lx %s (entry of %s) \t%s %s\r\n"
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8}) (.*) \\(entry of (.*)\\) \t(.*) (.*)\r?\n"};
 // clang-format on
 
-Map::ScanError Map::SectionLayout::Scan3Column(const char*& head, const char* const tail,
-                                               std::size_t& line_number)
+// The one scanner of 3-column section layout units, which hands what it finds to a sink. The sink
+// used by Map::SectionLayout::Scan3Column builds the units, while the one used by Map::Visit passes
+// them on.
+template <class Sink>
+static Map::ScanError ScanSectionLayout3Column(const char*& head, const char* const tail,
+                                               std::size_t& line_number, const bool use_regex,
+                                               Sink& sink)
 {
-  Mijo::CMatchResults match;
-  ScanningContext scanning_context{*this, line_number, false, false, nullptr, {}, {}};
+  using ScanError = Map::ScanError;
+  LineMatch match;
 
   while (true)
   {
-    if (std::regex_search(head, tail, match, re_section_layout_3column_unit_normal,
-                          std::regex_constants::match_continuous))
+    const SectionLayoutRow row = ClassifySectionLayoutRow(head, tail, 27, use_regex);
+    if (row.m_may_be_aligned &&
+        re_section_layout_3column_unit_normal.Match(head, tail, match, use_regex))
     {
-      const Unit& unit = m_units.emplace_back(
-          match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16), match[3].to<Elf32_Addr>(16),
-          match[4].to<int>(), match[5].view(), match[6].view(), match[7].view(), scanning_context);
-      scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+      sink.AddNormal(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
+                     match[3].to<Elf32_Addr>(16), std::uint32_t{0}, match[4].to<int>(),
+                     match[5].view(), match[6].view(), match[7].view());
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_3column_unit_unused,
-                          std::regex_constants::match_continuous))
+    if (row.m_may_be_unused &&
+        re_section_layout_3column_unit_unused.Match(head, tail, match, use_regex))
     {
-      const Unit& unit = m_units.emplace_back(match[1].to<Elf32_Word>(16), match[2].view(),
-                                              match[3].view(), match[4].view(), scanning_context);
-      scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+      sink.AddUnused(match[1].to<Elf32_Word>(16), match[2].view(), match[3].view(),
+                     match[4].view());
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_3column_unit_entry,
-                          std::regex_constants::match_continuous))
+    // The symbol name of an entry could begin with what looks like an alignment.
+    if ((row.m_may_be_aligned || row.m_may_be_unaligned) &&
+        re_section_layout_3column_unit_entry.Match(head, tail, match, use_regex))
     {
-      const std::string_view symbol_name = match[4].view(), entry_parent_name = match[5].view(),
-                             module_name = match[6].view(), source_name = match[7].view();
-      for (auto parent_unit = m_units.rbegin(), iter_end = m_units.rend();; ++parent_unit)
-      {
-        if (parent_unit == iter_end)
-          return ScanError::SectionLayoutOrphanedEntry;
-        if (source_name != parent_unit->m_source_name || module_name != parent_unit->m_module_name)
-          return ScanError::SectionLayoutOrphanedEntry;
-        if (entry_parent_name != parent_unit->m_name)
-          continue;
-        const Unit& unit = m_units.emplace_back(
-            match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
-            match[3].to<Elf32_Addr>(16), symbol_name, Mijo::ToPointer(parent_unit), module_name,
-            source_name, scanning_context);
-        scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
-        parent_unit->m_entry_children.push_back(&unit);
-        line_number += 1u;
-        head = match[0].second;
-        break;
-      }
+      auto* const parent = sink.FindEntryParent(match[5].view(), match[6].view(), match[7].view());
+      if (parent == nullptr)
+        return ScanError::SectionLayoutOrphanedEntry;
+      sink.AddEntry(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
+                    match[3].to<Elf32_Addr>(16), std::uint32_t{0}, match[4].view(), *parent);
+      line_number += 1u;
+      head = match[0].second;
       continue;
     }
     break;
@@ -2029,135 +3476,245 @@ Map::ScanError Map::SectionLayout::Scan3Column(const char*& head, const char* co
   return ScanError::None;
 }
 
+struct Map::SectionLayout::UnitBuilder
+{
+  void AddNormal(const std::uint32_t starting_address, const Elf32_Word size,
+                 const Elf32_Addr virtual_address, const std::uint32_t file_offset,
+                 const int alignment, const std::string_view name,
+                 const std::string_view module_name, const std::string_view source_name)
+  {
+    const Unit& unit = m_section_layout.m_units.emplace_back(
+        starting_address, size, virtual_address, file_offset, alignment, m_string_pool.Store(name),
+        m_string_pool.Store(module_name), m_string_pool.Store(source_name), m_scanning_context);
+    m_scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+  }
+
+  void AddUnused(const Elf32_Word size, const std::string_view name,
+                 const std::string_view module_name, const std::string_view source_name)
+  {
+    const Unit& unit = m_section_layout.m_units.emplace_back(
+        size, m_string_pool.Store(name), m_string_pool.Store(module_name),
+        m_string_pool.Store(source_name), m_scanning_context);
+    m_scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+  }
+
+  Unit* FindEntryParent(const std::string_view entry_parent_name,
+                        const std::string_view module_name, const std::string_view source_name)
+  {
+    // The host of an entry symbol can only ever be an earlier unit from the same compilation
+    // unit, without any other compilation unit in between.
+    std::deque<Unit>& units = m_section_layout.m_units;
+    for (auto parent_unit = units.rbegin(), iter_end = units.rend(); parent_unit != iter_end;
+         ++parent_unit)
+    {
+      if (source_name != parent_unit->m_source_name || module_name != parent_unit->m_module_name)
+        return nullptr;
+      if (entry_parent_name == parent_unit->m_name)
+        return &*parent_unit;
+    }
+    return nullptr;
+  }
+
+  void AddEntry(const std::uint32_t starting_address, const Elf32_Word size,
+                const Elf32_Addr virtual_address, const std::uint32_t file_offset,
+                const std::string_view name, Unit& parent)
+  {
+    // Growing a std::deque invalidates its iterators, but not references to its elements.
+    // The entry's module and source names were already compared equal to those of its parent.
+    const Unit& unit = m_section_layout.m_units.emplace_back(
+        starting_address, size, virtual_address, file_offset, m_string_pool.Store(name), &parent,
+        parent.m_module_name, parent.m_source_name, m_scanning_context);
+    m_scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+    parent.m_entry_children.push_back(&unit);
+  }
+
+  void AddSpecial(const std::uint32_t starting_address, const Elf32_Word size,
+                  const Elf32_Addr virtual_address, const std::uint32_t file_offset,
+                  const int alignment, const Unit::Trait unit_trait)
+  {
+    // Special symbols don't belong to any compilation unit, so they don't go in any lookup.
+    m_section_layout.m_units.emplace_back(starting_address, size, virtual_address, file_offset,
+                                          alignment, unit_trait);
+  }
+
+  SectionLayout& m_section_layout;
+  Mijo::StringPool& m_string_pool;
+  ScanningContext& m_scanning_context;
+};
+
+Map::ScanError Map::SectionLayout::Scan3Column(const char*& head, const char* const tail,
+                                               std::size_t& line_number, const Options& options,
+                                               Mijo::StringPool& string_pool,
+                                               Diagnostics& diagnostics)
+{
+  ScanningContext scanning_context{diagnostics, *this, line_number, false, false, nullptr, {},
+                                   {}};
+  return Scan3Column(head, tail, line_number, options, string_pool, scanning_context);
+}
+
+Map::ScanError Map::SectionLayout::Scan3Column(const char*& head, const char* const tail,
+                                               std::size_t& line_number, const Options& options,
+                                               Mijo::StringPool& string_pool,
+                                               ScanningContext& scanning_context)
+{
+  UnitBuilder sink{*this, string_pool, scanning_context};
+  return ScanSectionLayout3Column(head, tail, line_number, options.m_use_regex_fallback, sink);
+}
+
 // clang-format off
-static const std::regex re_section_layout_4column_unit_normal{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Hex<8>, Literal<" ">, Spaces<0, 1>, Digits, Literal<" ">,
+                         Any, Literal<" \t">, Any, Literal<" ">, Any>
+    re_section_layout_4column_unit_normal{
 //  "  %08x %06x %08x %08x %2i %s \t%s %s\r\n"
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8}) ([0-9a-f]{8})  ?(\\d+) (.*) \t(.*) (.*)\r?\n"};
-static const std::regex re_section_layout_4column_unit_unused{
+static const LinePattern<Literal<"  UNUSED   ">, Hex<6>, Literal<" ........ ........    ">, Any,
+                         Literal<" ">, Any, Literal<" ">, Any>
+    re_section_layout_4column_unit_unused{
 //  "  UNUSED   %06x ........ ........    %s %s %s\r\n"
     "  UNUSED   ([0-9a-f]{6}) \\.{8} \\.{8}    (.*) (.*) (.*)\r?\n"};
-static const std::regex re_section_layout_4column_unit_entry{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Hex<8>, Literal<"    ">, Any, Literal<" (entry of ">, Any,
+                         Literal<") \t">, Any, Literal<" ">, Any>
+    re_section_layout_4column_unit_entry{
 //  "  %08lx %06lx %08lx %08lx    %s (entry of %s) \t%s %s\r\n"
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8}) ([0-9a-f]{8})    (.*) \\(entry of (.*)\\) \t(.*) (.*)\r?\n"};
-static const std::regex re_section_layout_4column_unit_special{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Hex<8>, Literal<" ">, Spaces<0, 1>, Digits, Literal<" ">,
+                         Any>
+    re_section_layout_4column_unit_special{
 //  "  %08x %06x %08x %08x %2i %s\r\n"
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8}) ([0-9a-f]{8})  ?(\\d+) (.*)\r?\n"};
 // clang-format on
 
-Map::ScanError Map::SectionLayout::Scan4Column(const char*& head, const char* const tail,
-                                               std::size_t& line_number)
+// The one scanner of 4-column section layout units. See ScanSectionLayout3Column.
+template <class Sink>
+static Map::ScanError ScanSectionLayout4Column(const char*& head, const char* const tail,
+                                               std::size_t& line_number, const bool use_regex,
+                                               Sink& sink)
 {
-  Mijo::CMatchResults match;
-  ScanningContext scanning_context{*this, line_number, false, false, nullptr, {}, {}};
+  using ScanError = Map::ScanError;
+  using Trait = Map::SectionLayout::Unit::Trait;
+  LineMatch match;
 
   while (true)
   {
-    if (std::regex_search(head, tail, match, re_section_layout_4column_unit_normal,
-                          std::regex_constants::match_continuous))
+    const SectionLayoutRow row = ClassifySectionLayoutRow(head, tail, 36, use_regex);
+    if (row.m_may_be_aligned &&
+        re_section_layout_4column_unit_normal.Match(head, tail, match, use_regex))
     {
-      const Unit& unit = m_units.emplace_back(
-          match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16), match[3].to<Elf32_Addr>(16),
-          match[4].to<std::uint32_t>(16), match[5].to<int>(), match[6].view(), match[7].view(),
-          match[8].view(), scanning_context);
-      scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+      sink.AddNormal(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
+                     match[3].to<Elf32_Addr>(16), match[4].to<std::uint32_t>(16),
+                     match[5].to<int>(), match[6].view(), match[7].view(), match[8].view());
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_4column_unit_unused,
-                          std::regex_constants::match_continuous))
+    if (row.m_may_be_unused &&
+        re_section_layout_4column_unit_unused.Match(head, tail, match, use_regex))
     {
-      const Unit& unit = m_units.emplace_back(match[1].to<Elf32_Word>(16), match[2].view(),
-                                              match[3].view(), match[4].view(), scanning_context);
-      scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
+      sink.AddUnused(match[1].to<Elf32_Word>(16), match[2].view(), match[3].view(),
+                     match[4].view());
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_4column_unit_entry,
-                          std::regex_constants::match_continuous))
+    if (row.m_may_be_unaligned &&
+        re_section_layout_4column_unit_entry.Match(head, tail, match, use_regex))
     {
-      const std::string_view symbol_name = match[5].view(), entry_parent_name = match[6].view(),
-                             module_name = match[7].view(), source_name = match[8].view();
-      for (auto parent_unit = m_units.rbegin(), iter_end = m_units.rend();; ++parent_unit)
-      {
-        if (parent_unit == iter_end)
-          return ScanError::SectionLayoutOrphanedEntry;
-        if (source_name != parent_unit->m_source_name || module_name != parent_unit->m_module_name)
-          return ScanError::SectionLayoutOrphanedEntry;
-        if (entry_parent_name != parent_unit->m_name)
-          continue;
-        const Unit& unit = m_units.emplace_back(
-            match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
-            match[3].to<Elf32_Addr>(16), match[4].to<std::uint32_t>(16), symbol_name,
-            Mijo::ToPointer(parent_unit), module_name, source_name, scanning_context);
-        scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
-        parent_unit->m_entry_children.push_back(&unit);
-        line_number += 1u;
-        head = match[0].second;
-        break;
-      }
+      auto* const parent = sink.FindEntryParent(match[6].view(), match[7].view(), match[8].view());
+      if (parent == nullptr)
+        return ScanError::SectionLayoutOrphanedEntry;
+      sink.AddEntry(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
+                    match[3].to<Elf32_Addr>(16), match[4].to<std::uint32_t>(16), match[5].view(),
+                    *parent);
+      line_number += 1u;
+      head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_4column_unit_special,
-                          std::regex_constants::match_continuous))
+    if (row.m_may_be_aligned &&
+        re_section_layout_4column_unit_special.Match(head, tail, match, use_regex))
     {
-      // Special symbols don't belong to any compilation unit, so they don't go in any lookup.
       const std::string_view special_name = match[6].view();
+      Trait unit_trait;
       if (special_name == "*fill*")
-      {
-        m_units.emplace_back(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
-                             match[3].to<Elf32_Addr>(16), match[4].to<std::uint32_t>(16),
-                             match[5].to<int>(), Unit::Trait::Fill1);
-        line_number += 1u;
-        head = match[0].second;
-        continue;
-      }
-      if (special_name == "**fill**")
-      {
-        m_units.emplace_back(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
-                             match[3].to<Elf32_Addr>(16), match[4].to<std::uint32_t>(16),
-                             match[5].to<int>(), Unit::Trait::Fill2);
-        line_number += 1u;
-        head = match[0].second;
-        continue;
-      }
-      return ScanError::SectionLayoutSpecialNotFill;
+        unit_trait = Trait::Fill1;
+      else if (special_name == "**fill**")
+        unit_trait = Trait::Fill2;
+      else
+        return ScanError::SectionLayoutSpecialNotFill;
+      sink.AddSpecial(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
+                      match[3].to<Elf32_Addr>(16), match[4].to<std::uint32_t>(16),
+                      match[5].to<int>(), unit_trait);
+      line_number += 1u;
+      head = match[0].second;
+      continue;
     }
     break;
   }
   return ScanError::None;
 }
 
+Map::ScanError Map::SectionLayout::Scan4Column(const char*& head, const char* const tail,
+                                               std::size_t& line_number, const Options& options,
+                                               Mijo::StringPool& string_pool,
+                                               Diagnostics& diagnostics)
+{
+  ScanningContext scanning_context{diagnostics, *this, line_number, false, false, nullptr, {},
+                                   {}};
+  return Scan4Column(head, tail, line_number, options, string_pool, scanning_context);
+}
+
+Map::ScanError Map::SectionLayout::Scan4Column(const char*& head, const char* const tail,
+                                               std::size_t& line_number, const Options& options,
+                                               Mijo::StringPool& string_pool,
+                                               ScanningContext& scanning_context)
+{
+  UnitBuilder sink{*this, string_pool, scanning_context};
+  return ScanSectionLayout4Column(head, tail, line_number, options.m_use_regex_fallback, sink);
+}
+
 // clang-format off
-static const std::regex re_section_layout_tloztp_unit_entry{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<"    ">, Any, Literal<" (entry of ">, Any, Literal<") \t">, Any,
+                         Literal<" ">, Any>
+    re_section_layout_tloztp_unit_entry{
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8})    (.*) \\(entry of (.*)\\) \t(.*) (.*)\r?\n"};
-static const std::regex re_section_layout_tloztp_unit_special{
+static const LinePattern<Literal<"  ">, Hex<8>, Literal<" ">, Hex<6>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Spaces<0, 1>, Digits, Literal<" ">, Any>
+    re_section_layout_tloztp_unit_special{
     "  ([0-9a-f]{8}) ([0-9a-f]{6}) ([0-9a-f]{8})  ?(\\d+) (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::SectionLayout::ScanTLOZTP(const char*& head, const char* const tail,
-                                              std::size_t& line_number)
+                                              std::size_t& line_number, const Options& options,
+                                              Mijo::StringPool& string_pool,
+                                              Diagnostics& diagnostics)
 {
-  Mijo::CMatchResults match;
-  ScanningContext scanning_context{*this, line_number, false, false, nullptr, {}, {}};
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
+  ScanningContext scanning_context{diagnostics, *this, line_number, false, false, nullptr, {},
+                                   {}};
 
   while (true)
   {
-    if (std::regex_search(head, tail, match, re_section_layout_3column_unit_normal,
-                          std::regex_constants::match_continuous))
+    const SectionLayoutRow row = ClassifySectionLayoutRow(head, tail, 27, use_regex);
+    if (row.m_may_be_aligned &&
+        re_section_layout_3column_unit_normal.Match(head, tail, match, use_regex))
     {
       const Unit& unit =
           m_units.emplace_back(match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
                                match[3].to<Elf32_Addr>(16), std::uint32_t{0}, match[4].to<int>(),
-                               match[5].view(), match[6].view(), match[7].view(), scanning_context);
+                               string_pool.Store(match[5].view()),
+                               string_pool.Store(match[6].view()),
+                               string_pool.Store(match[7].view()), scanning_context);
       scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
       line_number += 1u;
       head = match[0].second;
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_tloztp_unit_entry,
-                          std::regex_constants::match_continuous))
+    if (row.m_may_be_unaligned &&
+        re_section_layout_tloztp_unit_entry.Match(head, tail, match, use_regex))
     {
       std::string_view symbol_name = match[4].view(), entry_parent_name = match[5].view(),
                        module_name = match[6].view(), source_name = match[7].view();
@@ -2169,20 +3726,23 @@ Map::ScanError Map::SectionLayout::ScanTLOZTP(const char*& head, const char* con
           return ScanError::SectionLayoutOrphanedEntry;
         if (entry_parent_name != parent_unit->m_name)
           continue;
+        // Growing a std::deque invalidates its iterators, but not references to its elements.
+        Unit& parent = *parent_unit;
+        // The entry's module and source names were just compared equal to those of its parent.
         const Unit& unit = m_units.emplace_back(
             match[1].to<std::uint32_t>(16), match[2].to<Elf32_Word>(16),
-            match[3].to<Elf32_Addr>(16), std::uint32_t{0}, symbol_name,
-            Mijo::ToPointer(parent_unit), module_name, source_name, scanning_context);
+            match[3].to<Elf32_Addr>(16), std::uint32_t{0}, string_pool.Store(symbol_name),
+            &parent, parent.m_module_name, parent.m_source_name, scanning_context);
         scanning_context.m_curr_unit_lookup->emplace(unit.m_name, unit);
-        parent_unit->m_entry_children.push_back(&unit);
+        parent.m_entry_children.push_back(&unit);
         line_number += 1u;
         head = match[0].second;
         break;
       }
       continue;
     }
-    if (std::regex_search(head, tail, match, re_section_layout_tloztp_unit_special,
-                          std::regex_constants::match_continuous))
+    if (row.m_may_be_aligned &&
+        re_section_layout_tloztp_unit_special.Match(head, tail, match, use_regex))
     {
       // Special symbols don't belong to any compilation unit, so they don't go in any lookup.
       std::string_view special_name = match[5].view();
@@ -2211,51 +3771,52 @@ Map::ScanError Map::SectionLayout::ScanTLOZTP(const char*& head, const char* con
   return ScanError::None;
 }
 
-void Map::SectionLayout::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::SectionLayout::Print(Printer& printer, std::size_t& line_number) const
 {
   // "\r\n\r\n%s section layout\r\n"
-  fmt::print(stream, "\r\n\r\n{:s} section layout\r\n", m_name);
+  printer.Print(FMT_COMPILE("\r\n\r\n{:s} section layout\r\n"), m_name);
   if (GetMinVersion() < Version::version_3_0_4)
   {
-    fmt::print(stream, "  Starting        Virtual\r\n"
-                       "  address  Size   address\r\n"
-                       "  -----------------------\r\n");
+    printer.Print(FMT_COMPILE("  Starting        Virtual\r\n"
+                              "  address  Size   address\r\n"
+                              "  -----------------------\r\n"));
     line_number += 6u;
     for (const auto& unit : m_units)
-      unit.Print3Column(stream, line_number);
+      unit.Print3Column(printer, line_number);
   }
   else
   {
-    fmt::print(stream, "  Starting        Virtual  File\r\n"
-                       "  address  Size   address  offset\r\n"
-                       "  ---------------------------------\r\n");
+    printer.Print(FMT_COMPILE("  Starting        Virtual  File\r\n"
+                              "  address  Size   address  offset\r\n"
+                              "  ---------------------------------\r\n"));
     line_number += 6u;
     for (const auto& unit : m_units)
-      unit.Print4Column(stream, line_number);
+      unit.Print4Column(printer, line_number);
   }
 }
 
-void Map::SectionLayout::Unit::Print3Column(std::ostream& stream, std::size_t& line_number) const
+void Map::SectionLayout::Unit::Print3Column(Printer& printer, std::size_t& line_number) const
 {
   switch (m_unit_kind)
   {
   case Kind::Normal:
     // "  %08x %06x %08x %2i %s \t%s %s\r\n"
-    fmt::print(stream, "  {:08x} {:06x} {:08x} {:2d} {:s} \t{:s} {:s}\r\n", m_starting_address,
-               m_size, m_virtual_address, m_alignment, m_name, m_module_name, m_source_name);
+    printer.Print(FMT_COMPILE("  {:08x} {:06x} {:08x} {:2d} {:s} \t{:s} {:s}\r\n"),
+                  m_starting_address, m_size, m_virtual_address, m_alignment, m_name, m_module_name,
+                  m_source_name);
     line_number += 1u;
     return;
   case Kind::Unused:
     // "  UNUSED   %06x ........ %s %s %s\r\n"
-    fmt::print(stream, "  UNUSED   {:06x} ........ {:s} {:s} {:s}\r\n", m_size, m_name,
-               m_module_name, m_source_name);
+    printer.Print(FMT_COMPILE("  UNUSED   {:06x} ........ {:s} {:s} {:s}\r\n"), m_size, m_name,
+                  m_module_name, m_source_name);
     line_number += 1u;
     return;
   case Kind::Entry:
     // "  %08lx %06lx %08lx %s (entry of %s) \t%s %s\r\n"
-    fmt::print(stream, "  {:08x} {:06x} {:08x} {:s} (entry of {:s}) \t{:s} {:s}\r\n",
-               m_starting_address, m_size, m_virtual_address, m_name, m_entry_parent->m_name,
-               m_module_name, m_source_name);
+    printer.Print(FMT_COMPILE("  {:08x} {:06x} {:08x} {:s} (entry of {:s}) \t{:s} {:s}\r\n"),
+                  m_starting_address, m_size, m_virtual_address, m_name, m_entry_parent->m_name,
+                  m_module_name, m_source_name);
     line_number += 1u;
     return;
   case Kind::Special:
@@ -2264,34 +3825,36 @@ void Map::SectionLayout::Unit::Print3Column(std::ostream& stream, std::size_t& l
   }
 }
 
-void Map::SectionLayout::Unit::Print4Column(std::ostream& stream, std::size_t& line_number) const
+void Map::SectionLayout::Unit::Print4Column(Printer& printer, std::size_t& line_number) const
 {
   switch (m_unit_kind)
   {
   case Kind::Normal:
     // "  %08x %06x %08x %08x %2i %s \t%s %s\r\n"
-    fmt::print(stream, "  {:08x} {:06x} {:08x} {:08x} {:2d} {:s} \t{:s} {:s}\r\n",
-               m_starting_address, m_size, m_virtual_address, m_file_offset, m_alignment, m_name,
-               m_module_name, m_source_name);
+    printer.Print(FMT_COMPILE("  {:08x} {:06x} {:08x} {:08x} {:2d} {:s} \t{:s} {:s}\r\n"),
+                  m_starting_address, m_size, m_virtual_address, m_file_offset, m_alignment, m_name,
+                  m_module_name, m_source_name);
     line_number += 1u;
     return;
   case Kind::Unused:
     // "  UNUSED   %06x ........ ........    %s %s %s\r\n"
-    fmt::print(stream, "  UNUSED   {:06x} ........ ........    {:s} {:s} {:s}\r\n", m_size, m_name,
-               m_module_name, m_source_name);
+    printer.Print(FMT_COMPILE("  UNUSED   {:06x} ........ ........    {:s} {:s} {:s}\r\n"), m_size,
+                  m_name, m_module_name, m_source_name);
     line_number += 1u;
     return;
   case Kind::Entry:
     // "  %08lx %06lx %08lx %08lx    %s (entry of %s) \t%s %s\r\n"
-    fmt::print(stream, "  {:08x} {:06x} {:08x} {:08x}    {:s} (entry of {:s}) \t{:s} {:s}\r\n",
-               m_starting_address, m_size, m_virtual_address, m_file_offset, m_name,
-               m_entry_parent->m_name, m_module_name, m_source_name);
+    printer.Print(
+        FMT_COMPILE("  {:08x} {:06x} {:08x} {:08x}    {:s} (entry of {:s}) \t{:s} {:s}\r\n"),
+        m_starting_address, m_size, m_virtual_address, m_file_offset, m_name,
+        m_entry_parent->m_name, m_module_name, m_source_name);
     line_number += 1u;
     return;
   case Kind::Special:
     // "  %08x %06x %08x %08x %2i %s\r\n"
-    fmt::print(stream, "  {:08x} {:06x} {:08x} {:08x} {:2d} {:s}\r\n", m_starting_address, m_size,
-               m_virtual_address, m_file_offset, m_alignment, ToSpecialName(m_unit_trait));
+    printer.Print(FMT_COMPILE("  {:08x} {:06x} {:08x} {:08x} {:2d} {:s}\r\n"), m_starting_address,
+                  m_size, m_virtual_address, m_file_offset, m_alignment,
+                  ToSpecialName(m_unit_trait));
     line_number += 1u;
     return;
   }
@@ -2308,69 +3871,78 @@ constexpr std::string_view Map::SectionLayout::Unit::ToSpecialName(const Trait u
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_simple_old{
+static const LinePattern<Literal<"  ">, Spaces<0, 15>, Any, Literal<"  ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>>
+    re_memory_map_unit_normal_simple_old{
 //  "  %15s  %08x %08x %08x\r\n"
     "   {0,15}(.*)  ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanSimple_old(const char*& head, const char* const tail,
-                                              std::size_t& line_number)
+                                              std::size_t& line_number, const Options& options,
+                                              Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_simple_old,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_simple_old.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug_old(head, tail, line_number);
+  return ScanDebug_old(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_romram_old{
+static const LinePattern<Literal<"  ">, Spaces<0, 15>, Any, Literal<"  ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>>
+    re_memory_map_unit_normal_romram_old{
 //  "  %15s  %08x %08x %08x %08x %08x\r\n"
     "   {0,15}(.*)  ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanRomRam_old(const char*& head, const char* const tail,
-                                              std::size_t& line_number)
+                                              std::size_t& line_number, const Options& options,
+                                              Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_romram_old,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_romram_old.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<std::uint32_t>(16), match[6].to<std::uint32_t>(16));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug_old(head, tail, line_number);
+  return ScanDebug_old(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_debug_old{
+static const LinePattern<Literal<"  ">, Spaces<0, 15>, Any, Literal<"           ">, Hex<6, 8>,
+                         Literal<" ">, Hex<8>>
+    re_memory_map_unit_debug_old{
 //  "  %15s           %06x %08x\r\n" <-- Sometimes the size can overflow six digits
 //  "  %15s           %08x %08x\r\n" <-- Starting with CodeWarrior for GCN 2.7
     "   {0,15}(.*)           ([0-9a-f]{6,8}) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanDebug_old(const char*& head, const char* const tail,
-                                             std::size_t& line_number)
+                                             std::size_t& line_number, const Options& options,
+                                             Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_debug_old,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_debug_old.Match(head, tail, match, use_regex))
   {
     const Mijo::CSubMatch& size = match[2];
     if (size.length() == 8 && *size.first == '0')  // Make sure it's not just an overflowed value
       SetVersionRange(Version::version_3_0_4, Version::Latest);
-    m_debug_units.emplace_back(match[1].view(), size.to<Elf32_Word>(16),
+    m_debug_units.emplace_back(string_pool.Store(match[1].view()), size.to<Elf32_Word>(16),
                                match[3].to<std::uint32_t>(16));
     line_number += 1u;
     head = match[0].second;
@@ -2379,208 +3951,241 @@ Map::ScanError Map::MemoryMap::ScanDebug_old(const char*& head, const char* cons
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_simple{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>>
+    re_memory_map_unit_normal_simple{
 //  "  %20s %08x %08x %08x\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanSimple(const char*& head, const char* const tail,
-                                          std::size_t& line_number)
+                                          std::size_t& line_number, const Options& options,
+                                          Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_simple,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_simple.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_romram{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>>
+    re_memory_map_unit_normal_romram{
 //  "  %20s %08x %08x %08x %08x %08x\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanRomRam(const char*& head, const char* const tail,
-                                          std::size_t& line_number)
+                                          std::size_t& line_number, const Options& options,
+                                          Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_romram,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_romram.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<std::uint32_t>(16), match[6].to<std::uint32_t>(16));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_srecord{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Spaces<0, 9>, Digits>
+    re_memory_map_unit_normal_srecord{
 //  "  %20s %08x %08x %08x %10i\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})  {0,9}(\\d+)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanSRecord(const char*& head, const char* const tail,
-                                           std::size_t& line_number)
+                                           std::size_t& line_number, const Options& options,
+                                           Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_srecord,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_srecord.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<int>());
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_binfile{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Any>
+    re_memory_map_unit_normal_binfile{
 //  "  %20s %08x %08x %08x %08x %s\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanBinFile(const char*& head, const char* const tail,
-                                           std::size_t& line_number)
+                                           std::size_t& line_number, const Options& options,
+                                           Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_binfile,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_binfile.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
-                                match[5].to<std::uint32_t>(16), match[6].view());
+                                match[5].to<std::uint32_t>(16), string_pool.Store(match[6].view()));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_romram_srecord{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>,
+                         Literal<" ">, Spaces<0, 9>, Digits>
+    re_memory_map_unit_normal_romram_srecord{
 //  "  %20s %08x %08x %08x %08x %08x %10i\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})  {0,9}(\\d+)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanRomRamSRecord(const char*& head, const char* const tail,
-                                                 std::size_t& line_number)
+                                                 std::size_t& line_number, const Options& options,
+                                                 Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_romram_srecord,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_romram_srecord.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<std::uint32_t>(16), match[6].to<std::uint32_t>(16),
                                 match[7].to<int>());
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_romram_binfile{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>,
+                         Literal<"   ">, Hex<8>, Literal<" ">, Any>
+    re_memory_map_unit_normal_romram_binfile{
 //  "  %20s %08x %08x %08x %08x %08x   %08x %s\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})   ([0-9a-f]{8}) (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanRomRamBinFile(const char*& head, const char* const tail,
-                                                 std::size_t& line_number)
+                                                 std::size_t& line_number, const Options& options,
+                                                 Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_romram_binfile,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_romram_binfile.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<std::uint32_t>(16), match[6].to<std::uint32_t>(16),
-                                match[7].to<std::uint32_t>(16), match[8].view());
+                                match[7].to<std::uint32_t>(16), string_pool.Store(match[8].view()));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_srecord_binfile{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<"  ">, Spaces<0, 9>, Digits,
+                         Literal<" ">, Hex<8>, Literal<" ">, Any>
+    re_memory_map_unit_normal_srecord_binfile{
 //  "  %20s %08x %08x %08x  %10i %08x %s\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})   {0,9}(\\d+) ([0-9a-f]{8}) (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanSRecordBinFile(const char*& head, const char* const tail,
-                                                  std::size_t& line_number)
+                                                  std::size_t& line_number, const Options& options,
+                                                  Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_srecord_binfile,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_srecord_binfile.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<int>(), match[6].to<std::uint32_t>(16),
-                                match[7].view());
+                                string_pool.Store(match[7].view()));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_normal_romram_srecord_binfile{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<" ">, Hex<8>, Literal<" ">,
+                         Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>, Literal<" ">, Hex<8>,
+                         Literal<"    ">, Spaces<0, 9>, Digits, Literal<" ">, Hex<8>, Literal<" ">,
+                         Any>
+    re_memory_map_unit_normal_romram_srecord_binfile{
 //  "  %20s %08x %08x %08x %08x %08x    %10i %08x %s\r\n"
     "   {0,20}(.*) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})     {0,9}(\\d+) ([0-9a-f]{8}) (.*)\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanRomRamSRecordBinFile(const char*& head, const char* const tail,
-                                                        std::size_t& line_number)
+                                                        std::size_t& line_number,
+                                                        const Options& options,
+                                                        Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_normal_romram_srecord_binfile,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_normal_romram_srecord_binfile.Match(head, tail, match, use_regex))
   {
-    m_normal_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16),
+    m_normal_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16),
                                 match[3].to<Elf32_Word>(16), match[4].to<std::uint32_t>(16),
                                 match[5].to<std::uint32_t>(16), match[6].to<std::uint32_t>(16),
                                 match[7].to<int>(), match[8].to<std::uint32_t>(16),
-                                match[9].view());
+                                string_pool.Store(match[9].view()));
     line_number += 1u;
     head = match[0].second;
   }
-  return ScanDebug(head, tail, line_number);
+  return ScanDebug(head, tail, line_number, options, string_pool);
 }
 
 // clang-format off
-static const std::regex re_memory_map_unit_debug{
+static const LinePattern<Literal<"  ">, Spaces<0, 20>, Any, Literal<"          ">, Hex<8>,
+                         Literal<" ">, Hex<8>>
+    re_memory_map_unit_debug{
 //  "  %20s          %08x %08x\r\n"
     "   {0,20}(.*)          ([0-9a-f]{8}) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::MemoryMap::ScanDebug(const char*& head, const char* const tail,
-                                         std::size_t& line_number)
+                                         std::size_t& line_number, const Options& options,
+                                         Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_memory_map_unit_debug,
-                           std::regex_constants::match_continuous))
+  while (re_memory_map_unit_debug.Match(head, tail, match, use_regex))
   {
-    m_debug_units.emplace_back(match[1].view(), match[2].to<Elf32_Word>(16),
+    m_debug_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Word>(16),
                                match[3].to<std::uint32_t>(16));
     line_number += 1u;
     head = match[0].second;
@@ -2588,288 +4193,2527 @@ Map::ScanError Map::MemoryMap::ScanDebug(const char*& head, const char* const ta
   return ScanError::None;
 }
 
-void Map::MemoryMap::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::Print(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "\r\n\r\nMemory map:\r\n");
+  printer.Print(FMT_COMPILE("\r\n\r\nMemory map:\r\n"));
   line_number += 3u;
   if (GetMinVersion() < Version::version_4_2_build_142)
   {
     if (m_has_rom_ram)
-      PrintRomRam_old(stream, line_number);
+      PrintRomRam_old(printer, line_number);
     else
-      PrintSimple_old(stream, line_number);
-    PrintDebug_old(stream, line_number);
+      PrintSimple_old(printer, line_number);
+    PrintDebug_old(printer, line_number);
   }
   else
   {
     if (m_has_rom_ram)
       if (m_has_s_record)
         if (m_has_bin_file)
-          PrintRomRamSRecordBinFile(stream, line_number);
+          PrintRomRamSRecordBinFile(printer, line_number);
         else
-          PrintRomRamSRecord(stream, line_number);
+          PrintRomRamSRecord(printer, line_number);
       else if (m_has_bin_file)
-        PrintRomRamBinFile(stream, line_number);
+        PrintRomRamBinFile(printer, line_number);
       else
-        PrintRomRam(stream, line_number);
+        PrintRomRam(printer, line_number);
     else if (m_has_s_record)
       if (m_has_bin_file)
-        PrintSRecordBinFile(stream, line_number);
+        PrintSRecordBinFile(printer, line_number);
       else
-        PrintSRecord(stream, line_number);
+        PrintSRecord(printer, line_number);
     else if (m_has_bin_file)
-      PrintBinFile(stream, line_number);
+      PrintBinFile(printer, line_number);
     else
-      PrintSimple(stream, line_number);
-    PrintDebug(stream, line_number);
+      PrintSimple(printer, line_number);
+    PrintDebug(printer, line_number);
   }
 }
 
-void Map::MemoryMap::PrintSimple_old(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintSimple_old(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "                   Starting Size     File\r\n"
-                     "                   address           Offset\r\n");
+  printer.Print(FMT_COMPILE("                   Starting Size     File\r\n"
+                            "                   address           Offset\r\n"));
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintSimple_old(stream, line_number);
+    unit.PrintSimple_old(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintSimple_old(std::ostream& stream,
-                                                 std::size_t& line_number) const
+void Map::MemoryMap::UnitNormal::PrintSimple_old(Printer& printer, std::size_t& line_number) const
 {
   // "  %15s  %08x %08x %08x\r\n"
-  fmt::print(stream, "  {:>15s}  {:08x} {:08x} {:08x}\r\n", m_name, m_starting_address, m_size,
-             m_file_offset);
+  printer.Print(FMT_COMPILE("  {:>15s}  {:08x} {:08x} {:08x}\r\n"), m_name, m_starting_address,
+                m_size, m_file_offset);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintRomRam_old(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintRomRam_old(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "                   Starting Size     File     ROM      RAM Buffer\r\n"
-                     "                   address           Offset   Address  Address\r\n");
+  printer.Print(FMT_COMPILE("                   Starting Size     File     ROM      RAM Buffer\r\n"
+                            "                   address           Offset   Address  Address\r\n"));
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintRomRam_old(stream, line_number);
+    unit.PrintRomRam_old(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintRomRam_old(std::ostream& stream,
-                                                 std::size_t& line_number) const
+void Map::MemoryMap::UnitNormal::PrintRomRam_old(Printer& printer, std::size_t& line_number) const
 {
   // "  %15s  %08x %08x %08x %08x %08x\r\n"
-  fmt::print(stream, "  {:>15s}  {:08x} {:08x} {:08x} {:08x} {:08x}\r\n", m_name,
-             m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address);
+  printer.Print(FMT_COMPILE("  {:>15s}  {:08x} {:08x} {:08x} {:08x} {:08x}\r\n"), m_name,
+                m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintDebug_old(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintDebug_old(Printer& printer, std::size_t& line_number) const
 {
   if (GetMinVersion() < Version::version_3_0_4)
     for (const auto& unit : m_debug_units)
-      unit.Print_older(stream, line_number);
+      unit.Print_older(printer, line_number);
   else
     for (const auto& unit : m_debug_units)
-      unit.Print_old(stream, line_number);
+      unit.Print_old(printer, line_number);
 }
-void Map::MemoryMap::UnitDebug::Print_older(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitDebug::Print_older(Printer& printer, std::size_t& line_number) const
 {
   // "  %15s           %06x %08x\r\n"
-  fmt::print(stream, "  {:>15s}           {:06x} {:08x}\r\n", m_name, m_size, m_file_offset);
+  printer.Print(FMT_COMPILE("  {:>15s}           {:06x} {:08x}\r\n"), m_name, m_size,
+                m_file_offset);
   line_number += 1u;
 }
-void Map::MemoryMap::UnitDebug::Print_old(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitDebug::Print_old(Printer& printer, std::size_t& line_number) const
 {
   // "  %15s           %08x %08x\r\n"
-  fmt::print(stream, "  {:>15s}           {:08x} {:08x}\r\n", m_name, m_size, m_file_offset);
+  printer.Print(FMT_COMPILE("  {:>15s}           {:08x} {:08x}\r\n"), m_name, m_size,
+                m_file_offset);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintSimple(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintSimple(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "                       Starting Size     File\r\n"
-                     "                       address           Offset\r\n");
+  printer.Print(FMT_COMPILE("                       Starting Size     File\r\n"
+                            "                       address           Offset\r\n"));
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintSimple(stream, line_number);
+    unit.PrintSimple(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintSimple(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitNormal::PrintSimple(Printer& printer, std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x}\r\n", m_name, m_starting_address, m_size,
-             m_file_offset);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x}\r\n"), m_name, m_starting_address,
+                m_size, m_file_offset);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintRomRam(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintRomRam(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "                       Starting Size     File     ROM      RAM Buffer\r\n"
-                     "                       address           Offset   Address  Address\r\n");
+  printer.Print(
+      FMT_COMPILE("                       Starting Size     File     ROM      RAM Buffer\r\n"
+                  "                       address           Offset   Address  Address\r\n"));
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintRomRam(stream, line_number);
+    unit.PrintRomRam(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintRomRam(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitNormal::PrintRomRam(Printer& printer, std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x %08x %08x\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}\r\n", m_name, m_starting_address,
-             m_size, m_file_offset, m_rom_address, m_ram_buffer_address);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}\r\n"), m_name,
+                m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintSRecord(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintSRecord(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "                       Starting Size     File       S-Record\r\n"
-                     "                       address           Offset     Line\r\n");
+  printer.Print(FMT_COMPILE("                       Starting Size     File       S-Record\r\n"
+                            "                       address           Offset     Line\r\n"));
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintSRecord(stream, line_number);
+    unit.PrintSRecord(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintSRecord(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitNormal::PrintSRecord(Printer& printer, std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x %10i\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x} {:10d}\r\n", m_name, m_starting_address,
-             m_size, m_file_offset, m_srecord_line);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x} {:10d}\r\n"), m_name,
+                m_starting_address, m_size, m_file_offset, m_srecord_line);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintBinFile(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintBinFile(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "                       Starting Size     File     Bin File Bin File\r\n"
-                     "                       address           Offset   Offset   Name\r\n");
+  printer.Print(
+      FMT_COMPILE("                       Starting Size     File     Bin File Bin File\r\n"
+                  "                       address           Offset   Offset   Name\r\n"));
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintBinFile(stream, line_number);
+    unit.PrintBinFile(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintBinFile(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitNormal::PrintBinFile(Printer& printer, std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x %08x %s\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:s}\r\n", m_name, m_starting_address,
-             m_size, m_file_offset, m_bin_file_offset, m_bin_file_name);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x} {:08x} {:s}\r\n"), m_name,
+                m_starting_address, m_size, m_file_offset, m_bin_file_offset, m_bin_file_name);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintRomRamSRecord(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintRomRamSRecord(Printer& printer, std::size_t& line_number) const
 {
   // clang-format off
-  fmt::print(stream, "                       Starting Size     File     ROM      RAM Buffer  S-Record\r\n"
-                     "                       address           Offset   Address  Address     Line\r\n");
+  printer.Print(FMT_COMPILE("                       Starting Size     File     ROM      RAM Buffer  S-Record\r\n"
+                            "                       address           Offset   Address  Address     Line\r\n"));
   // clang-format on
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintRomRamSRecord(stream, line_number);
+    unit.PrintRomRamSRecord(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintRomRamSRecord(std::ostream& stream,
+void Map::MemoryMap::UnitNormal::PrintRomRamSRecord(Printer& printer,
                                                     std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x %08x %08x %10i\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x} {:10d}\r\n", m_name,
-             m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address,
-             m_srecord_line);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x} {:10d}\r\n"), m_name,
+                m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address,
+                m_srecord_line);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintRomRamBinFile(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintRomRamBinFile(Printer& printer, std::size_t& line_number) const
 {
   // clang-format off
-  fmt::print(stream, "                       Starting Size     File     ROM      RAM Buffer Bin File Bin File\r\n"
-                     "                       address           Offset   Address  Address    Offset   Name\r\n");
+  printer.Print(FMT_COMPILE("                       Starting Size     File     ROM      RAM Buffer Bin File Bin File\r\n"
+                            "                       address           Offset   Address  Address    Offset   Name\r\n"));
   // clang-format on
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintRomRamBinFile(stream, line_number);
+    unit.PrintRomRamBinFile(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintRomRamBinFile(std::ostream& stream,
+void Map::MemoryMap::UnitNormal::PrintRomRamBinFile(Printer& printer,
                                                     std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x %08x %08x   %08x %s\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}   {:08x} {:s}\r\n", m_name,
-             m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address,
-             m_bin_file_offset, m_bin_file_name);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}   {:08x} {:s}\r\n"),
+                m_name, m_starting_address, m_size, m_file_offset, m_rom_address,
+                m_ram_buffer_address, m_bin_file_offset, m_bin_file_name);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintSRecordBinFile(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintSRecordBinFile(Printer& printer, std::size_t& line_number) const
 {
   // clang-format off
-  fmt::print(stream, "                       Starting Size     File        S-Record Bin File Bin File\r\n"
-                     "                       address           Offset      Line     Offset   Name\r\n");
+  printer.Print(FMT_COMPILE("                       Starting Size     File        S-Record Bin File Bin File\r\n"
+                            "                       address           Offset      Line     Offset   Name\r\n"));
   // clang-format on
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintSRecordBinFile(stream, line_number);
+    unit.PrintSRecordBinFile(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintSRecordBinFile(std::ostream& stream,
+void Map::MemoryMap::UnitNormal::PrintSRecordBinFile(Printer& printer,
                                                      std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x  %10i %08x %s\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x}  {:10d} {:08x} {:s}\r\n", m_name,
-             m_starting_address, m_size, m_file_offset, m_srecord_line, m_bin_file_offset,
-             m_bin_file_name);
+  printer.Print(FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x}  {:10d} {:08x} {:s}\r\n"), m_name,
+                m_starting_address, m_size, m_file_offset, m_srecord_line, m_bin_file_offset,
+                m_bin_file_name);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintRomRamSRecordBinFile(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintRomRamSRecordBinFile(Printer& printer, std::size_t& line_number) const
 {
   // clang-format off
-  fmt::print(stream, "                       Starting Size     File     ROM      RAM Buffer    S-Record Bin File Bin File\r\n"
-                     "                       address           Offset   Address  Address       Line     Offset   Name\r\n");
+  printer.Print(FMT_COMPILE("                       Starting Size     File     ROM      RAM Buffer    S-Record Bin File Bin File\r\n"
+                            "                       address           Offset   Address  Address       Line     Offset   Name\r\n"));
   // clang-format on
   line_number += 2u;
   for (const auto& unit : m_normal_units)
-    unit.PrintRomRamSRecordBinFile(stream, line_number);
+    unit.PrintRomRamSRecordBinFile(printer, line_number);
 }
-void Map::MemoryMap::UnitNormal::PrintRomRamSRecordBinFile(std::ostream& stream,
+void Map::MemoryMap::UnitNormal::PrintRomRamSRecordBinFile(Printer& printer,
                                                            std::size_t& line_number) const
 {
   // "  %20s %08x %08x %08x %08x %08x    %10i %08x %s\r\n"
-  fmt::print(stream, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}    {:10d} {:08x} {:s}\r\n",
-             m_name, m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address,
-             m_srecord_line, m_bin_file_offset, m_bin_file_name);
+  printer.Print(
+      FMT_COMPILE("  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}    {:10d} {:08x} {:s}\r\n"), m_name,
+      m_starting_address, m_size, m_file_offset, m_rom_address, m_ram_buffer_address,
+      m_srecord_line, m_bin_file_offset, m_bin_file_name);
   line_number += 1u;
 }
 
-void Map::MemoryMap::PrintDebug(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::PrintDebug(Printer& printer, std::size_t& line_number) const
 {
   for (const auto& unit : m_debug_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
-void Map::MemoryMap::UnitDebug::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::MemoryMap::UnitDebug::Print(Printer& printer, std::size_t& line_number) const
 {
   // "  %20s          %08x %08x\r\n"
-  fmt::print(stream, "  {:>20s}          {:08x} {:08x}\r\n", m_name, m_size, m_file_offset);
+  printer.Print(FMT_COMPILE("  {:>20s}          {:08x} {:08x}\r\n"), m_name, m_size, m_file_offset);
   line_number += 1u;
 }
 
 // clang-format off
-static const std::regex re_linker_generated_symbols_unit{
+static const LinePattern<Spaces<0, 25>, Any, Literal<" ">, Hex<8>> re_linker_generated_symbols_unit{
 //  "%25s %08x\r\n"
     " {0,25}(.*) ([0-9a-f]{8})\r?\n"};
 // clang-format on
 
 Map::ScanError Map::LinkerGeneratedSymbols::Scan(const char*& head, const char* const tail,
-                                                 std::size_t& line_number)
+                                                 std::size_t& line_number, const Options& options,
+                                                 Mijo::StringPool& string_pool)
 {
-  Mijo::CMatchResults match;
+  const bool use_regex = options.m_use_regex_fallback;
+  LineMatch match;
 
-  while (std::regex_search(head, tail, match, re_linker_generated_symbols_unit,
-                           std::regex_constants::match_continuous))
+  while (re_linker_generated_symbols_unit.Match(head, tail, match, use_regex))
   {
-    m_units.emplace_back(match[1].view(), match[2].to<Elf32_Addr>(16));
+    m_units.emplace_back(string_pool.Store(match[1].view()), match[2].to<Elf32_Addr>(16));
     line_number += 1u;
     head = match[0].second;
   }
   return ScanError::None;
 }
 
-void Map::LinkerGeneratedSymbols::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::LinkerGeneratedSymbols::Print(Printer& printer, std::size_t& line_number) const
 {
-  fmt::print(stream, "\r\n\r\nLinker generated symbols:\r\n");
+  printer.Print(FMT_COMPILE("\r\n\r\nLinker generated symbols:\r\n"));
   line_number += 3u;
   for (const auto& unit : m_units)
-    unit.Print(stream, line_number);
+    unit.Print(printer, line_number);
 }
 
-void Map::LinkerGeneratedSymbols::Unit::Print(std::ostream& stream, std::size_t& line_number) const
+void Map::LinkerGeneratedSymbols::Unit::Print(Printer& printer, std::size_t& line_number) const
 {
   // "%25s %08x\r\n"
-  fmt::print(stream, "{:>25s} {:08x}\r\n", m_name, m_value);
+  printer.Print(FMT_COMPILE("{:>25s} {:08x}\r\n"), m_name, m_value);
   line_number += 1u;
 }
+
+// The sink Map::Visit scans symbol closures with, which hands each node to the visitor as soon as
+// it is found. Nothing is looked up, so no warnings are given about repeat names.
+struct SymbolClosureVisitorSink
+{
+  void AddUnreferencedDuplicate(const Type type, const Bind bind,
+                                const std::string_view module_name,
+                                const std::string_view source_name)
+  {
+    m_unref_dups.emplace_back(type, bind, module_name, source_name);
+  }
+
+  void AddNode(const std::size_t line_number, const int hierarchy_level,
+               const std::string_view name, const Type type, const Bind bind,
+               const std::string_view module_name, const std::string_view source_name)
+  {
+    m_visitor.OnClosureNode({line_number, m_is_dwarf, Map::SymbolClosure::NodeKind::Real,
+                             hierarchy_level, name, type, bind, module_name, source_name,
+                             m_unref_dups});
+    m_unref_dups.clear();
+  }
+
+  // Dummy nodes are only there to hold the tree together.
+  void AddDummyNode(std::size_t, int) {}
+
+  void AddLinkerGeneratedNode(const std::size_t line_number, const int hierarchy_level,
+                              const std::string_view name)
+  {
+    m_visitor.OnClosureNode({line_number, m_is_dwarf,
+                             Map::SymbolClosure::NodeKind::LinkerGenerated, hierarchy_level, name,
+                             Type::notype, Bind::local, {}, {}, {}});
+  }
+
+  void AddUnresolvedSymbol(const std::size_t line_number, const std::string_view name)
+  {
+    m_visitor.OnUnresolvedSymbol(line_number, name);
+  }
+
+  Map::Visitor& m_visitor;
+  bool m_is_dwarf;
+  std::vector<Map::SymbolClosure::UnreferencedDuplicate> m_unref_dups;
+};
+
+// The sink Map::Visit scans section layouts with, which hands each unit to the visitor as soon as
+// it is found. Only the names of the current compilation unit are kept, which is all it takes to
+// find the host of an entry symbol. Without a lookup, no warnings are given about repeat names,
+// nor are the traits of units deduced.
+struct SectionLayoutVisitorSink
+{
+  using UnitKind = Map::SectionLayout::Unit::Kind;
+  using Trait = Map::SectionLayout::Unit::Trait;
+
+  void AddNormal(const std::uint32_t starting_address, const Elf32_Word size,
+                 const Elf32_Addr virtual_address, const std::uint32_t file_offset,
+                 const int alignment, const std::string_view name,
+                 const std::string_view module_name, const std::string_view source_name)
+  {
+    AddUnitName(module_name, source_name, name);
+    m_visitor.OnSectionLayoutUnit({m_line_number, m_section_name, m_section_kind,
+                                   UnitKind::Normal, starting_address, size, virtual_address,
+                                   file_offset, alignment, name, {}, module_name, source_name,
+                                   Trait::None});
+  }
+
+  void AddUnused(const Elf32_Word size, const std::string_view name,
+                 const std::string_view module_name, const std::string_view source_name)
+  {
+    AddUnitName(module_name, source_name, name);
+    m_visitor.OnSectionLayoutUnit({m_line_number, m_section_name, m_section_kind,
+                                   UnitKind::Unused, 0, size, 0, 0, 0, name, {}, module_name,
+                                   source_name, Trait::None});
+  }
+
+  const std::string_view* FindEntryParent(const std::string_view entry_parent_name,
+                                          const std::string_view module_name,
+                                          const std::string_view source_name) const
+  {
+    if (m_unit_names.empty() || module_name != m_module_name || source_name != m_source_name)
+      return nullptr;
+    const auto iter = std::ranges::find(m_unit_names, entry_parent_name);
+    return iter != m_unit_names.end() ? &*iter : nullptr;
+  }
+
+  void AddEntry(const std::uint32_t starting_address, const Elf32_Word size,
+                const Elf32_Addr virtual_address, const std::uint32_t file_offset,
+                const std::string_view name, const std::string_view entry_parent_name)
+  {
+    AddUnitName(m_module_name, m_source_name, name);
+    m_visitor.OnSectionLayoutUnit({m_line_number, m_section_name, m_section_kind,
+                                   UnitKind::Entry, starting_address, size, virtual_address,
+                                   file_offset, 0, name, entry_parent_name, m_module_name,
+                                   m_source_name, Trait::None});
+  }
+
+  void AddSpecial(const std::uint32_t starting_address, const Elf32_Word size,
+                  const Elf32_Addr virtual_address, const std::uint32_t file_offset,
+                  const int alignment, const Trait unit_trait)
+  {
+    // Special symbols don't belong to any compilation unit, so no entry symbol can follow one.
+    AddUnitName({}, {}, {});
+    m_visitor.OnSectionLayoutUnit({m_line_number, m_section_name, m_section_kind,
+                                   UnitKind::Special, starting_address, size, virtual_address,
+                                   file_offset, alignment, {}, {}, {}, {}, unit_trait});
+  }
+
+  void AddUnitName(const std::string_view module_name, const std::string_view source_name,
+                   const std::string_view unit_name)
+  {
+    if (module_name != m_module_name || source_name != m_source_name)
+    {
+      m_module_name = module_name;
+      m_source_name = source_name;
+      m_unit_names.clear();
+    }
+    m_unit_names.push_back(unit_name);
+  }
+
+  Map::Visitor& m_visitor;
+  const std::size_t& m_line_number;
+  std::string_view m_section_name;
+  Map::SectionLayout::Kind m_section_kind;
+  std::string_view m_module_name;
+  std::string_view m_source_name;
+  std::vector<std::string_view> m_unit_names;
+};
+
+Map::ScanError Map::Visit(const std::span<const char> span, std::size_t& line_number,
+                          Visitor& visitor, const Options& options)
+{
+  return Visit(span.data(), span.data() + span.size(), line_number, visitor, options);
+}
+
+// Follows along with Map::Scan. The symbol closures and section layouts are scanned with sinks that
+// hand everything to the visitor. The smaller portions are still scanned as usual, into a Map that
+// is thrown away afterward, though borrowing their names from the text keeps that from copying
+// them.
+Map::ScanError Map::Visit(const char* head, const char* const tail, std::size_t& line_number,
+                          Visitor& visitor, const Options& options)
+{
+  if (head == nullptr || tail == nullptr || head > tail)
+    return ScanError::Fail;
+
+  Options scratch_options = options;
+  scratch_options.m_string_storage = StringStorage::Borrowed;
+  scratch_options.m_thread_count = 1;
+  Map scratch{scratch_options};
+  const bool use_regex = options.m_use_regex_fallback;
+  Mijo::CMatchResults match;
+  line_number = 1u;
+
+  const auto visit_section_layout = [&](const std::string_view name) {
+    SectionLayout portion{SectionLayout::ToSectionKind(name), name};
+    const ScanError error = scratch.ScanSectionLayoutPrologue(head, tail, line_number, portion);
+    if (error != ScanError::None)
+      return error;
+    SectionLayoutVisitorSink sink{visitor, line_number, name, portion.m_section_kind, {}, {}, {}};
+    if (portion.GetMinVersion() < Version::version_3_0_4)
+      return ScanSectionLayout3Column(head, tail, line_number, use_regex, sink);
+    return ScanSectionLayout4Column(head, tail, line_number, use_regex, sink);
+  };
+
+  // See Map::Scan about these.
+  if (MatchRegex(head, tail, match, *re_section_layout_header_modified_a))
+  {
+    line_number += 2u;
+    head = match[0].second;
+    const ScanError error = visit_section_layout(match[1].view());
+    if (error != ScanError::None)
+      return error;
+    goto NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE;
+  }
+  if (MatchRegex(head, tail, match, *re_section_layout_header_modified_b))
+  {
+    line_number += 1u;
+    head = match[0].second;
+    const ScanError error = visit_section_layout(match[1].view());
+    if (error != ScanError::None)
+      return error;
+    goto NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE;
+  }
+  if (MatchRegex(head, tail, match, *re_entry_point_name))
+  {
+    line_number += 1u;
+    head = match[0].second;
+  }
+  else
+  {
+    return ScanError::EntryPointNameMissing;
+  }
+  {
+    SymbolClosureVisitorSink sink{visitor, false, {}};
+    int hierarchy_level = 0;
+    const ScanError error =
+        ScanSymbolClosureNodes(head, tail, line_number, hierarchy_level, use_regex, sink);
+    if (error != ScanError::None)
+      return error;
+  }
+  {
+    const ScanError error = scratch.m_eppc_pattern_matching.emplace().Scan(
+        head, tail, line_number, scratch.m_string_pool, scratch.m_diagnostics);
+    if (error != ScanError::None)
+      return error;
+  }
+  {
+    SymbolClosureVisitorSink sink{visitor, true, {}};
+    int hierarchy_level = 0;
+    const ScanError error =
+        ScanSymbolClosureNodes(head, tail, line_number, hierarchy_level, use_regex, sink);
+    if (error != ScanError::None)
+      return error;
+  }
+  {
+    const ScanError error =
+        scratch.m_linker_opts.emplace().Scan(head, tail, line_number, scratch.m_string_pool);
+    if (error != ScanError::None)
+      return error;
+  }
+  if (MatchRegex(head, tail, match, *re_mixed_mode_islands_header))
+  {
+    line_number += 2u;
+    head = match[0].second;
+    const ScanError error = scratch.m_mixed_mode_islands.emplace().Scan(head, tail, line_number,
+                                                                        scratch.m_string_pool);
+    if (error != ScanError::None)
+      return error;
+  }
+  if (MatchRegex(head, tail, match, *re_branch_islands_header))
+  {
+    line_number += 2u;
+    head = match[0].second;
+    const ScanError error =
+        scratch.m_branch_islands.emplace().Scan(head, tail, line_number, scratch.m_string_pool);
+    if (error != ScanError::None)
+      return error;
+  }
+  if (MatchRegex(head, tail, match, *re_linktime_size_decreasing_optimizations_header))
+  {
+    line_number += 2u;
+    head = match[0].second;
+    const ScanError error =
+        scratch.m_linktime_size_decreasing_optimizations.emplace().Scan(head, tail, line_number);
+    if (error != ScanError::None)
+      return error;
+  }
+  if (MatchRegex(head, tail, match, *re_linktime_size_increasing_optimizations_header))
+  {
+    line_number += 2u;
+    head = match[0].second;
+    const ScanError error =
+        scratch.m_linktime_size_increasing_optimizations.emplace().Scan(head, tail, line_number);
+    if (error != ScanError::None)
+      return error;
+  }
+NINTENDO_EAD_TRIMMED_LINKER_MAPS_GOTO_HERE:
+  while (MatchRegex(head, tail, match, *re_section_layout_header))
+  {
+    line_number += 3u;
+    head = match[0].second;
+    const ScanError error = visit_section_layout(match[1].view());
+    if (error != ScanError::None)
+      return error;
+  }
+  // A memory map only ever has a unit for each section, so there is little to gain from not
+  // keeping them around for a moment.
+  if (MatchRegex(head, tail, match, *re_memory_map_header))
+  {
+    line_number += 3u;
+    head = match[0].second;
+    const ScanError error = scratch.ScanPrologue_MemoryMap(head, tail, line_number);
+    if (error != ScanError::None)
+      return error;
+    for (const MemoryMap::UnitNormal& unit : scratch.m_memory_map->GetNormalUnits())
+      visitor.OnMemoryMapUnit(unit);
+    for (const MemoryMap::UnitDebug& unit : scratch.m_memory_map->GetDebugUnits())
+      visitor.OnMemoryMapUnit(unit);
+  }
+  if (MatchRegex(head, tail, match, *re_linker_generated_symbols_header))
+  {
+    line_number += 3u;
+    head = match[0].second;
+    const ScanError error = scratch.m_linker_generated_symbols.emplace().Scan(
+        head, tail, line_number, scratch.m_options, scratch.m_string_pool);
+    if (error != ScanError::None)
+      return error;
+  }
+  return scratch.ScanForGarbage(head, tail);
+}
+
+// No pattern looks further ahead than this many lines, so once they follow where scanning of a
+// portion stopped, the text pushed after them could not have changed where or why it stopped.
+static constexpr std::size_t stream_lookahead_lines = 8;
+
+static bool HasLines(const char* head, const char* const tail, std::size_t line_count) noexcept
+{
+  for (; line_count != 0; --line_count)
+  {
+    const void* const line_feed = std::memchr(head, '\n', static_cast<std::size_t>(tail - head));
+    if (line_feed == nullptr)
+      return false;
+    head = static_cast<const char*>(line_feed) + 1;
+  }
+  return true;
+}
+
+// Finds how far a symbol closure can be scanned without separating a node from its unreferenced
+// duplicates, as those lines are only looked for right after it. If a line that cannot belong to
+// the symbol closure is found, that is where it ends.
+static const char* FindSymbolClosurePieceEnd(const char* head, const char* const tail,
+                                             bool& is_over)
+{
+  const char* piece_end = head;
+  std::string_view content;
+  const char* next;
+  is_over = false;
+  while (Mijo::ScanLine(head, tail, content, next))
+  {
+    int hierarchy_level;
+    if (content.starts_with(">>> SYMBOL NOT FOUND: "))
+    {
+      piece_end = head;
+    }
+    else if (ScanSymbolClosurePrefix(content, hierarchy_level))
+    {
+      if (!content.starts_with(">>> "))
+        piece_end = head;
+    }
+    else
+    {
+      is_over = true;
+      return head;
+    }
+    head = next;
+  }
+  return piece_end;
+}
+
+// Every line of EPPC_PatternMatching is either empty or begins with one of a few prefixes, which
+// makes it easy to tell when the text goes past its end. It warns as it goes, so it is not worth
+// scanning before then only to have to scan it again.
+static bool IsPastEPPC_PatternMatching(const char* head, const char* const tail)
+{
+  std::string_view content;
+  const char* next;
+  while (Mijo::ScanLine(head, tail, content, next))
+  {
+    if (!content.empty() && !content.starts_with("--> ") &&
+        !content.starts_with("Code folded in file: "))
+      return HasLines(head, tail, stream_lookahead_lines);
+    head = next;
+  }
+  return false;
+}
+
+static Map::Options GetStreamScannerOptions(Map::Options options) noexcept
+{
+  if (options.m_string_storage == Map::StringStorage::Borrowed)
+    options.m_string_storage = Map::StringStorage::Arena;
+  return options;
+}
+
+Map::StreamScanner::StreamScanner(const Options& options) : m_map(GetStreamScannerOptions(options))
+{
+}
+
+Map::ScanError Map::StreamScanner::Push(const std::span<const char> span)
+{
+  if (m_error != ScanError::None || m_stage == Stage::Finished)
+    return m_error;
+  m_buffer.append(span.data(), span.size());
+  // Nothing can be scanned before a line is complete.
+  if (std::find(span.begin(), span.end(), '\n') != span.end())
+    Advance(false);
+  return m_error;
+}
+
+Map::ScanError Map::StreamScanner::Finish()
+{
+  if (m_error != ScanError::None || m_stage == Stage::Finished)
+    return m_error;
+  Advance(true);
+  m_stage = Stage::Finished;
+  m_buffer = {};
+  return m_error;
+}
+
+void Map::StreamScanner::Advance(const bool is_final)
+{
+  while (m_error == ScanError::None)
+  {
+    const char* const buffer_tail = m_buffer.data() + m_buffer.size();
+    const char* head = m_buffer.data() + m_buffer_head;
+    // Lines still being pushed are left out, unless nothing more is coming.
+    const char* tail = buffer_tail;
+    if (!is_final)
+    {
+      const std::size_t line_feed_pos = std::string_view{head, buffer_tail}.rfind('\n');
+      tail = line_feed_pos == std::string_view::npos ? head : head + line_feed_pos + 1;
+    }
+    const bool has_advanced = Step(head, tail, is_final);
+    m_buffer_head = static_cast<std::size_t>(head - m_buffer.data());
+    if (!has_advanced)
+      break;
+  }
+  // Text that was scanned is thrown away, though only once that frees up enough of the buffer to
+  // be worth moving the rest.
+  if (m_stage != Stage::WholeText && m_buffer_head >= m_buffer.size() / 2)
+  {
+    m_buffer.erase(0, m_buffer_head);
+    m_buffer_head = 0;
+  }
+}
+
+// Returns whether the stage changed. Otherwise, it is waiting on more text or an error was found.
+bool Map::StreamScanner::Step(const char*& head, const char* const tail, const bool is_final)
+{
+  switch (m_stage)
+  {
+  case Stage::EntryPointName:
+  {
+    if (head == tail && !is_final)
+      return false;
+    Mijo::CMatchResults match;
+    // Trimmed linker maps are only recognizable from their first lines, and being so rare, it is
+    // not worth doing more than handing them to Map::Scan.
+    if (MatchRegex(head, tail, match, *re_section_layout_header_modified_b) ||
+        !MatchRegex(head, tail, match, *re_entry_point_name))
+    {
+      m_stage = Stage::WholeText;
+      return true;
+    }
+    m_line_number += 1u;
+    head = match[0].second;
+    m_map.m_entry_point_name = m_map.m_string_pool.Store(match[1].view());
+    // libc++ bug: When checking if SymbolClosure is default constructable in
+    // std::optional::emplace, it fails the requirement std::is_constructable_v because
+    // it is not yet a complete class due to it being nested in Map.
+    m_map.m_normal_symbol_closure.emplace(SymbolClosure());
+    m_stage = Stage::NormalSymbolClosure;
+    return true;
+  }
+  case Stage::NormalSymbolClosure:
+    return StepSymbolClosure(head, tail, is_final, m_map.m_normal_symbol_closure,
+                             Stage::EPPC_PatternMatching);
+  case Stage::EPPC_PatternMatching:
+    if (!is_final && !IsPastEPPC_PatternMatching(head, tail))
+      return false;
+    return StepPortion(head, tail, is_final, Stage::DwarfSymbolClosure,
+                       [this](const char*& head_, const char* const tail_,
+                              std::size_t& line_number) {
+                         auto& portion = m_map.m_eppc_pattern_matching.emplace();
+                         const ScanError error =
+                             portion.Scan(head_, tail_, line_number, m_map.m_string_pool,
+                                          m_map.m_diagnostics);
+                         if (error != ScanError::None)
+                           m_map.m_eppc_pattern_matching.reset();
+                         return error;
+                       });
+  case Stage::DwarfSymbolClosure:
+    // libc++ bug: When checking if SymbolClosure is default constructable in
+    // std::optional::emplace, it fails the requirement std::is_constructable_v because
+    // it is not yet a complete class due to it being nested in Map.
+    if (!m_map.m_dwarf_symbol_closure)
+      m_map.m_dwarf_symbol_closure.emplace(SymbolClosure());
+    return StepSymbolClosure(head, tail, is_final, m_map.m_dwarf_symbol_closure,
+                             Stage::LinkerOpts);
+  case Stage::LinkerOpts:
+    return StepPortion(head, tail, is_final, Stage::MixedModeIslands,
+                       [this](const char*& head_, const char* const tail_,
+                              std::size_t& line_number) {
+                         auto& portion = m_map.m_linker_opts.emplace();
+                         const ScanError error =
+                             portion.Scan(head_, tail_, line_number, m_map.m_string_pool);
+                         if (error != ScanError::None)
+                           m_map.m_linker_opts.reset();
+                         return error;
+                       });
+  case Stage::MixedModeIslands:
+    return StepPortion(head, tail, is_final, Stage::BranchIslands,
+                       [this](const char*& head_, const char* const tail_,
+                              std::size_t& line_number) {
+                         Mijo::CMatchResults match;
+                         if (!MatchRegex(head_, tail_, match, *re_mixed_mode_islands_header))
+                           return ScanError::None;
+                         line_number += 2u;
+                         head_ = match[0].second;
+                         auto& portion = m_map.m_mixed_mode_islands.emplace();
+                         const ScanError error =
+                             portion.Scan(head_, tail_, line_number, m_map.m_string_pool);
+                         if (error != ScanError::None)
+                           m_map.m_mixed_mode_islands.reset();
+                         return error;
+                       });
+  case Stage::BranchIslands:
+    return StepPortion(head, tail, is_final, Stage::LinktimeSizeDecreasingOptimizations,
+                       [this](const char*& head_, const char* const tail_,
+                              std::size_t& line_number) {
+                         Mijo::CMatchResults match;
+                         if (!MatchRegex(head_, tail_, match, *re_branch_islands_header))
+                           return ScanError::None;
+                         line_number += 2u;
+                         head_ = match[0].second;
+                         auto& portion = m_map.m_branch_islands.emplace();
+                         const ScanError error =
+                             portion.Scan(head_, tail_, line_number, m_map.m_string_pool);
+                         if (error != ScanError::None)
+                           m_map.m_branch_islands.reset();
+                         return error;
+                       });
+  case Stage::LinktimeSizeDecreasingOptimizations:
+    return StepPortion(
+        head, tail, is_final, Stage::LinktimeSizeIncreasingOptimizations,
+        [this](const char*& head_, const char* const tail_, std::size_t& line_number) {
+          Mijo::CMatchResults match;
+          if (!MatchRegex(head_, tail_, match, *re_linktime_size_decreasing_optimizations_header))
+            return ScanError::None;
+          line_number += 2u;
+          head_ = match[0].second;
+          auto& portion = m_map.m_linktime_size_decreasing_optimizations.emplace();
+          const ScanError error = portion.Scan(head_, tail_, line_number);
+          if (error != ScanError::None)
+            m_map.m_linktime_size_decreasing_optimizations.reset();
+          return error;
+        });
+  case Stage::LinktimeSizeIncreasingOptimizations:
+    return StepPortion(
+        head, tail, is_final, Stage::SectionLayoutHeader,
+        [this](const char*& head_, const char* const tail_, std::size_t& line_number) {
+          Mijo::CMatchResults match;
+          if (!MatchRegex(head_, tail_, match, *re_linktime_size_increasing_optimizations_header))
+            return ScanError::None;
+          line_number += 2u;
+          head_ = match[0].second;
+          auto& portion = m_map.m_linktime_size_increasing_optimizations.emplace();
+          const ScanError error = portion.Scan(head_, tail_, line_number);
+          if (error != ScanError::None)
+            m_map.m_linktime_size_increasing_optimizations.reset();
+          return error;
+        });
+  case Stage::SectionLayoutHeader:
+    return StepSectionLayoutHeader(head, tail, is_final);
+  case Stage::SectionLayoutUnits:
+    return StepSectionLayoutUnits(head, tail, is_final);
+  case Stage::MemoryMap:
+    return StepPortion(head, tail, is_final, Stage::LinkerGeneratedSymbols,
+                       [this](const char*& head_, const char* const tail_,
+                              std::size_t& line_number) {
+                         Mijo::CMatchResults match;
+                         if (!MatchRegex(head_, tail_, match, *re_memory_map_header))
+                           return ScanError::None;
+                         line_number += 3u;
+                         head_ = match[0].second;
+                         return m_map.ScanPrologue_MemoryMap(head_, tail_, line_number);
+                       });
+  case Stage::LinkerGeneratedSymbols:
+    return StepPortion(
+        head, tail, is_final, Stage::Garbage,
+        [this](const char*& head_, const char* const tail_, std::size_t& line_number) {
+          Mijo::CMatchResults match;
+          if (!MatchRegex(head_, tail_, match, *re_linker_generated_symbols_header))
+            return ScanError::None;
+          line_number += 3u;
+          head_ = match[0].second;
+          auto& portion = m_map.m_linker_generated_symbols.emplace();
+          const ScanError error =
+              portion.Scan(head_, tail_, line_number, m_map.m_options, m_map.m_string_pool);
+          if (error != ScanError::None)
+            m_map.m_linker_generated_symbols.reset();
+          return error;
+        });
+  case Stage::Garbage:
+    if (!is_final)
+      return false;
+    m_error = m_map.ScanForGarbage(head, tail);
+    m_stage = Stage::Finished;
+    return true;
+  case Stage::WholeText:
+    if (!is_final)
+      return false;
+    m_error = m_map.Scan(head, tail, m_line_number);
+    head = tail;
+    m_stage = Stage::Finished;
+    return true;
+  case Stage::Finished:
+    return false;
+  }
+  return false;
+}
+
+bool Map::StreamScanner::StepSymbolClosure(const char*& head, const char* const tail,
+                                           const bool is_final,
+                                           std::optional<SymbolClosure>& portion,
+                                           const Stage next_stage)
+{
+  bool is_over;
+  const char* const piece_end = FindSymbolClosurePieceEnd(head, tail, is_over);
+  // Once nothing more is coming, the rest of the text is scanned just as Map::Scan would.
+  const char* const piece_tail = is_final ? tail : piece_end;
+  if (piece_tail == head && !is_over && !is_final)
+    return false;
+  const ScanError error =
+      portion->ScanNodes(head, piece_tail, m_line_number, m_map.m_unresolved_symbols,
+                         m_map.m_options, m_map.m_string_pool, m_map.m_diagnostics,
+                         m_symbol_closure_state, nullptr);
+  if (error != ScanError::None)
+  {
+    portion.reset();
+    m_error = error;
+    return false;
+  }
+  // Stopping short of the end of the piece means the symbol closure ended.
+  if (head == piece_tail && !is_over && !is_final)
+    return false;
+  portion->CloseSubtrees(m_symbol_closure_state.m_ancestors, 0);
+  m_symbol_closure_state = {};
+  if (&portion == &m_map.m_dwarf_symbol_closure && !portion->IsEmpty())
+    portion->SetVersionRange(Version::version_3_0_4, Version::Latest);
+  m_stage = next_stage;
+  return true;
+}
+
+bool Map::StreamScanner::StepSectionLayoutHeader(const char*& head, const char* const tail,
+                                                 const bool is_final)
+{
+  if (!is_final && !HasLines(head, tail, stream_lookahead_lines))
+    return false;
+  Mijo::CMatchResults match;
+  if (!MatchRegex(head, tail, match, *re_section_layout_header))
+  {
+    m_stage = Stage::MemoryMap;
+    return true;
+  }
+  const std::string_view name = match[1].view();
+  m_line_number += 3u;
+  head = match[0].second;
+  SectionLayout& portion = m_section_layout.emplace(SectionLayout::ToSectionKind(name),
+                                                    m_map.m_string_pool.Store(name));
+  const ScanError error = m_map.ScanSectionLayoutPrologue(head, tail, m_line_number, portion);
+  if (error != ScanError::None)
+  {
+    m_section_layout.reset();
+    m_error = error;
+    return false;
+  }
+  m_scanning_context.emplace(
+      SectionLayout::ScanningContext{m_map.m_diagnostics, portion, m_line_number, false, false,
+                                     nullptr, {}, {}});
+  m_stage = Stage::SectionLayoutUnits;
+  return true;
+}
+
+bool Map::StreamScanner::StepSectionLayoutUnits(const char*& head, const char* const tail,
+                                                const bool is_final)
+{
+  SectionLayout& portion = *m_section_layout;
+  ScanError error;
+  if (portion.GetMinVersion() < Version::version_3_0_4)
+    error = portion.Scan3Column(head, tail, m_line_number, m_map.m_options, m_map.m_string_pool,
+                                *m_scanning_context);
+  else
+    error = portion.Scan4Column(head, tail, m_line_number, m_map.m_options, m_map.m_string_pool,
+                                *m_scanning_context);
+  if (error != ScanError::None)
+  {
+    m_scanning_context.reset();
+    m_section_layout.reset();
+    m_error = error;
+    return false;
+  }
+  // Every unit is a single line, so stopping short of the last complete one means the section
+  // layout ended.
+  if (head == tail && !is_final)
+    return false;
+  m_scanning_context.reset();
+  m_map.m_section_layouts.push_back(std::move(portion));
+  m_section_layout.reset();
+  m_stage = Stage::SectionLayoutHeader;
+  return true;
+}
+
+// The portion is scanned from the beginning every time, with its strings kept apart until it is
+// known to be complete.
+template <class Func>
+bool Map::StreamScanner::StepPortion(const char*& head, const char* const tail,
+                                     const bool is_final, const Stage next_stage, Func&& scan)
+{
+  const auto size = static_cast<std::size_t>(tail - head);
+  if (!is_final && size < m_retry_size)
+    return false;
+  Mijo::StringPool string_pool{m_map.m_string_pool.GetMode()};
+  std::swap(string_pool, m_map.m_string_pool);
+  const char* portion_head = head;
+  std::size_t line_number = m_line_number;
+  const ScanError error = scan(portion_head, tail, line_number);
+  std::swap(string_pool, m_map.m_string_pool);
+  if (!is_final && !HasLines(portion_head, tail, stream_lookahead_lines))
+  {
+    ResetPortion();
+    m_retry_size = std::max<std::size_t>(size * 2u, 1u);
+    return false;
+  }
+  m_map.m_string_pool.Merge(std::move(string_pool));
+  head = portion_head;
+  m_line_number = line_number;
+  m_retry_size = 0;
+  if (error != ScanError::None)
+  {
+    m_error = error;
+    return false;
+  }
+  m_stage = next_stage;
+  return true;
+}
+
+void Map::StreamScanner::ResetPortion() noexcept
+{
+  switch (m_stage)
+  {
+  case Stage::EPPC_PatternMatching:
+    m_map.m_eppc_pattern_matching.reset();
+    break;
+  case Stage::LinkerOpts:
+    m_map.m_linker_opts.reset();
+    break;
+  case Stage::MixedModeIslands:
+    m_map.m_mixed_mode_islands.reset();
+    break;
+  case Stage::BranchIslands:
+    m_map.m_branch_islands.reset();
+    break;
+  case Stage::LinktimeSizeDecreasingOptimizations:
+    m_map.m_linktime_size_decreasing_optimizations.reset();
+    break;
+  case Stage::LinktimeSizeIncreasingOptimizations:
+    m_map.m_linktime_size_increasing_optimizations.reset();
+    break;
+  case Stage::MemoryMap:
+    m_map.m_memory_map.reset();
+    break;
+  case Stage::LinkerGeneratedSymbols:
+    m_map.m_linker_generated_symbols.reset();
+    break;
+  default:
+    break;
+  }
+}
+
+Map::ResumableScan::ResumableScan(const std::span<const char> span, const Options& options,
+                                  const std::size_t slice_size)
+    : m_span(span), m_slice_size(std::max<std::size_t>(slice_size, 1)), m_stream_scanner(options)
+{
+}
+
+bool Map::ResumableScan::Step()
+{
+  if (IsDone())
+    return false;
+  if (m_is_cancelled.load(std::memory_order_relaxed))
+  {
+    m_error = ScanError::Cancelled;
+  }
+  else if (m_pushed_size < m_span.size())
+  {
+    std::span<const char> slice =
+        m_span.subspan(m_pushed_size, std::min(m_slice_size, m_span.size() - m_pushed_size));
+    // Ending the slice after a line feed leaves no line for the next slice to complete.
+    if (m_pushed_size + slice.size() < m_span.size())
+    {
+      const std::size_t line_feed_pos = std::string_view{slice.data(), slice.size()}.rfind('\n');
+      if (line_feed_pos != std::string_view::npos)
+        slice = slice.first(line_feed_pos + 1);
+    }
+    m_error = m_stream_scanner.Push(slice);
+    m_pushed_size += slice.size();
+    m_scanned_size.store(m_pushed_size - m_stream_scanner.GetPendingSize(),
+                         std::memory_order_relaxed);
+    m_line_number.store(m_stream_scanner.GetLineNumber(), std::memory_order_relaxed);
+    if (m_error == ScanError::None)
+      return true;
+  }
+  else
+  {
+    m_error = m_stream_scanner.Finish();
+    m_scanned_size.store(m_span.size(), std::memory_order_relaxed);
+    m_line_number.store(m_stream_scanner.GetLineNumber(), std::memory_order_relaxed);
+  }
+  m_is_done.store(true, std::memory_order_release);
+  return false;
+}
+
+// A cache is this header, then the string table, then the body. The string table is the end offset
+// of every string within the string data that follows it, so string i spans from the end of string
+// i - 1 to its own end. String 0 is always the empty one. The body is every portion one after
+// another, in the order they appear in a linker map, with strings stored as their indices.
+struct CacheHeader
+{
+  char m_magic[8];
+  std::uint32_t m_format_version;
+  std::uint32_t m_byte_order_mark;
+  std::uint64_t m_text_hash;
+  std::uint64_t m_string_count;
+  std::uint64_t m_string_data_size;
+  std::uint64_t m_body_size;
+  // Catches a cache that was cut short or otherwise damaged.
+  std::uint64_t m_payload_hash;
+};
+static_assert(sizeof(CacheHeader) == 56);
+
+static constexpr char cache_magic[8] = {'M', 'W', 'L', 'D', 'M', 'A', 'P', '\x1a'};
+// Reads back differently on a host of the opposite byte order.
+static constexpr std::uint32_t cache_byte_order_mark = 0x01020304;
+
+class Map::CacheWriter
+{
+public:
+  CacheWriter() { m_string_ids.try_emplace({}, 0); }
+
+  template <class T>
+  void Write(const T value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    m_body.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void WriteBool(const bool value) { Write(std::uint8_t{value}); }
+  // Makes room ahead of time for about this many distinct strings.
+  void ReserveStrings(const std::size_t count)
+  {
+    m_string_ids.reserve(count);
+    m_string_ends.reserve(count);
+  }
+  void WriteCount(const std::size_t count) { Write(std::uint64_t{count}); }
+  void WriteString(const std::string_view str) { Write(GetStringId(str)); }
+  template <class T>
+  void WriteArray(const std::vector<T>& array)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    WriteCount(array.size());
+    m_body.append(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(T));
+  }
+  void WriteVersionRange(const PortionBase& portion)
+  {
+    Write(portion.m_min_version);
+    Write(portion.m_max_version);
+  }
+  template <class Portion>
+  void WriteOptional(const std::optional<Portion>& portion)
+  {
+    WriteBool(portion.has_value());
+    if (!portion)
+      return;
+    WriteVersionRange(*portion);
+    portion->SaveCache(*this);
+  }
+
+  void Finish(std::ostream& stream, const std::uint64_t text_hash) const
+  {
+    std::string payload;
+    payload.reserve(m_string_ends.size() * sizeof(std::uint64_t) + m_string_data.size() +
+                    m_body.size());
+    payload.append(reinterpret_cast<const char*>(m_string_ends.data()),
+                   m_string_ends.size() * sizeof(std::uint64_t));
+    payload.append(m_string_data);
+    payload.append(m_body);
+
+    CacheHeader header;
+    std::copy_n(cache_magic, sizeof(cache_magic), header.m_magic);
+    header.m_format_version = cache_format_version;
+    header.m_byte_order_mark = cache_byte_order_mark;
+    header.m_text_hash = text_hash;
+    header.m_string_count = m_string_ends.size();
+    header.m_string_data_size = m_string_data.size();
+    header.m_body_size = m_body.size();
+    header.m_payload_hash = Mijo::XXH64::Hash(payload);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+  }
+
+private:
+  // Names repeat a lot, so every one of them is only stored once. Module and source names tend to
+  // be the same as those written just before, which spares most lookups in the table.
+  std::uint32_t GetStringId(const std::string_view str)
+  {
+    for (const auto& [recent_str, recent_id] : m_recent_strings)
+      if (recent_str == str)
+        return recent_id;
+    const auto [iter, is_new] =
+        m_string_ids.try_emplace(str, static_cast<std::uint32_t>(m_string_ends.size()));
+    if (is_new)
+    {
+      m_string_data.append(str);
+      m_string_ends.push_back(m_string_data.size());
+    }
+    m_recent_strings[m_recent_strings_next] = *iter;
+    m_recent_strings_next = (m_recent_strings_next + 1) % m_recent_strings.size();
+    return iter->second;
+  }
+
+  std::string m_body;
+  std::string m_string_data;
+  std::vector<std::uint64_t> m_string_ends{0};
+  Mijo::FlatHashMap<std::string_view, std::uint32_t> m_string_ids;
+  std::array<std::pair<std::string_view, std::uint32_t>, 4> m_recent_strings{};
+  std::size_t m_recent_strings_next = 0;
+};
+
+// Nothing read is trusted. Once anything is out of place, the reader stops reading and everything
+// it hands back from then on is empty, so that there is only need to check for failure at the end.
+class Map::CacheReader
+{
+public:
+  explicit CacheReader(const std::span<const char> body, std::vector<std::string_view> strings)
+      : m_head(body.data()), m_tail(body.data() + body.size()), m_strings(std::move(strings))
+  {
+  }
+
+  bool IsGood() const noexcept { return m_is_good; }
+  bool IsAtEnd() const noexcept { return m_head == m_tail; }
+  void Fail() noexcept { m_is_good = false; }
+
+  template <class T>
+  T Read() noexcept
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value{};
+    if (!m_is_good || static_cast<std::size_t>(m_tail - m_head) < sizeof(T))
+    {
+      Fail();
+      return value;
+    }
+    std::memcpy(&value, m_head, sizeof(T));
+    m_head += sizeof(T);
+    return value;
+  }
+  bool ReadBool() noexcept { return Read<std::uint8_t>() != 0; }
+  // Every element takes up at least one byte, so a count can never be more than what is left.
+  std::size_t ReadCount(const std::size_t element_size = 1) noexcept
+  {
+    const std::uint64_t count = Read<std::uint64_t>();
+    if (count > static_cast<std::size_t>(m_tail - m_head) / element_size)
+    {
+      Fail();
+      return 0;
+    }
+    return static_cast<std::size_t>(count);
+  }
+  std::string_view ReadString() noexcept
+  {
+    const std::uint32_t id = Read<std::uint32_t>();
+    if (id >= m_strings.size())
+    {
+      Fail();
+      return {};
+    }
+    return m_strings[id];
+  }
+  template <class T>
+  void ReadArray(std::vector<T>& array)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const std::size_t count = ReadCount(sizeof(T));
+    array.resize(count);
+    if (count == 0)
+      return;
+    std::memcpy(array.data(), m_head, count * sizeof(T));
+    m_head += count * sizeof(T);
+  }
+  void ReadVersionRange(PortionBase& portion) noexcept
+  {
+    portion.m_min_version = ReadVersion();
+    portion.m_max_version = ReadVersion();
+  }
+  template <class Portion, class... Args>
+  void ReadOptional(std::optional<Portion>& portion, Args&&... args)
+  {
+    if (!ReadBool())
+      return;
+    ReadVersionRange(portion.emplace(std::forward<Args>(args)...));
+    portion->LoadCache(*this);
+  }
+
+private:
+  Version ReadVersion() noexcept
+  {
+    const Version version = Read<Version>();
+    if (version < Version::Unknown || version > Version::Latest)
+      Fail();
+    return version;
+  }
+
+  const char* m_head;
+  const char* m_tail;
+  std::vector<std::string_view> m_strings;
+  bool m_is_good = true;
+};
+
+void Map::SymbolClosure::SaveCache(CacheWriter& writer) const
+{
+  // The tree is already flat, so most of it can be written as-is.
+  writer.WriteArray(m_hierarchy_levels);
+  writer.WriteArray(m_kinds);
+  writer.WriteArray(m_name_ids);
+  writer.WriteArray(m_types);
+  writer.WriteArray(m_binds);
+  writer.WriteArray(m_module_ids);
+  writer.WriteArray(m_source_ids);
+  writer.WriteArray(m_parents);
+  writer.WriteArray(m_subtree_ends);
+  writer.WriteArray(m_unref_dup_begins);
+  writer.WriteCount(m_unref_dups.size());
+  for (const UnreferencedDuplicate& unref_dup : m_unref_dups)
+  {
+    writer.Write(unref_dup.m_type);
+    writer.Write(unref_dup.m_bind);
+    writer.WriteString(unref_dup.m_module_name);
+    writer.WriteString(unref_dup.m_source_name);
+  }
+  writer.WriteCount(m_strings.size());
+  for (const std::string_view str : m_strings)
+    writer.WriteString(str);
+}
+
+void Map::SymbolClosure::LoadCache(CacheReader& reader)
+{
+  reader.ReadArray(m_hierarchy_levels);
+  reader.ReadArray(m_kinds);
+  reader.ReadArray(m_name_ids);
+  reader.ReadArray(m_types);
+  reader.ReadArray(m_binds);
+  reader.ReadArray(m_module_ids);
+  reader.ReadArray(m_source_ids);
+  reader.ReadArray(m_parents);
+  reader.ReadArray(m_subtree_ends);
+  reader.ReadArray(m_unref_dup_begins);
+  const std::size_t unref_dup_count = reader.ReadCount();
+  m_unref_dups.reserve(unref_dup_count);
+  for (std::size_t i = 0; i < unref_dup_count; ++i)
+  {
+    const Type type = reader.Read<Type>();
+    const Bind bind = reader.Read<Bind>();
+    const std::string_view module_name = reader.ReadString();
+    m_unref_dups.emplace_back(type, bind, module_name, reader.ReadString());
+  }
+  const std::size_t string_count = reader.ReadCount();
+  m_strings.clear();
+  m_strings.reserve(string_count);
+  for (std::size_t i = 0; i < string_count; ++i)
+    m_strings.push_back(reader.ReadString());
+  if (!reader.IsGood())
+    return;
+
+  // Anything that navigating the tree relies on has to be checked.
+  const std::size_t node_count = m_kinds.size();
+  const auto is_string_id = [this](const std::uint32_t id) { return id < m_strings.size(); };
+  if (node_count >= no_node || m_hierarchy_levels.size() != node_count ||
+      m_name_ids.size() != node_count || m_types.size() != node_count ||
+      m_binds.size() != node_count || m_module_ids.size() != node_count ||
+      m_source_ids.size() != node_count || m_parents.size() != node_count ||
+      m_subtree_ends.size() != node_count || m_unref_dup_begins.size() != node_count + 1 ||
+      m_unref_dup_begins.front() != 0 || m_unref_dup_begins.back() != m_unref_dups.size() ||
+      !std::ranges::is_sorted(m_unref_dup_begins) ||
+      !std::ranges::all_of(m_name_ids, is_string_id) ||
+      !std::ranges::all_of(m_module_ids, is_string_id) ||
+      !std::ranges::all_of(m_source_ids, is_string_id))
+  {
+    reader.Fail();
+    return;
+  }
+  std::vector<NodeId> ancestors;
+  for (NodeId id = 0; id < node_count; ++id)
+  {
+    while (!ancestors.empty() && m_subtree_ends[ancestors.back()] <= id)
+      ancestors.pop_back();
+    const NodeId parent = ancestors.empty() ? no_node : ancestors.back();
+    const std::size_t parent_end = ancestors.empty() ? node_count : m_subtree_ends[parent];
+    if (m_parents[id] != parent || m_subtree_ends[id] <= id || m_subtree_ends[id] > parent_end ||
+        std::cmp_not_equal(m_hierarchy_levels[id], ancestors.size() + 1))
+    {
+      reader.Fail();
+      return;
+    }
+    ancestors.push_back(id);
+  }
+
+  // Compilation unit names are found by string ID rather than hashed once per node, and every
+  // lookup is given enough room up front to never need to grow.
+  const auto get_compilation_unit_id = [this](const NodeId id) {
+    return m_strings[m_source_ids[id]].empty() ? m_module_ids[id] : m_source_ids[id];
+  };
+  std::vector<std::size_t> node_counts(m_strings.size());
+  for (NodeId id = 0; id < node_count; ++id)
+  {
+    if (m_kinds[id] == NodeKind::Real)
+      ++node_counts[get_compilation_unit_id(id)];
+  }
+  // Adding a lookup can move every other one, so they are all added before any are pointed to.
+  for (std::uint32_t string_id = 0; string_id < m_strings.size(); ++string_id)
+  {
+    if (node_counts[string_id] != 0)
+      m_lookup.try_emplace(m_strings[string_id]);
+  }
+  std::vector<NodeLookup*> node_lookups(m_strings.size());
+  Mijo::FlatHashMap<NodeLookup*, std::size_t> lookup_sizes;
+  for (std::uint32_t string_id = 0; string_id < m_strings.size(); ++string_id)
+  {
+    if (node_counts[string_id] == 0)
+      continue;
+    node_lookups[string_id] = &m_lookup.find(m_strings[string_id])->second;
+    lookup_sizes[node_lookups[string_id]] += node_counts[string_id];
+  }
+  for (const auto& [node_lookup, size] : lookup_sizes)
+    node_lookup->reserve(size);
+  for (NodeId id = 0; id < node_count; ++id)
+  {
+    if (m_kinds[id] == NodeKind::Real)
+      node_lookups[get_compilation_unit_id(id)]->emplace(m_strings[m_name_ids[id]], id);
+  }
+}
+
+void Map::EPPC_PatternMatching::SaveCache(CacheWriter& writer) const
+{
+  writer.WriteCount(m_merging_units.size());
+  for (const MergingUnit& unit : m_merging_units)
+  {
+    writer.WriteString(unit.m_first_name);
+    writer.WriteString(unit.m_second_name);
+    writer.Write(unit.m_size);
+    writer.WriteBool(unit.m_will_be_replaced);
+    writer.WriteBool(unit.m_was_interchanged);
+  }
+  writer.WriteCount(m_folding_units.size());
+  for (const FoldingUnit& folding_unit : m_folding_units)
+  {
+    writer.WriteString(folding_unit.m_object_name);
+    writer.WriteCount(folding_unit.m_units.size());
+    for (const FoldingUnit::Unit& unit : folding_unit.m_units)
+    {
+      writer.WriteString(unit.m_first_name);
+      writer.WriteString(unit.m_second_name);
+      writer.Write(unit.m_size);
+      writer.WriteBool(unit.m_new_branch_function);
+    }
+  }
+}
+
+void Map::EPPC_PatternMatching::LoadCache(CacheReader& reader)
+{
+  for (std::size_t i = 0, count = reader.ReadCount(); i < count; ++i)
+  {
+    const std::string_view first_name = reader.ReadString(), second_name = reader.ReadString();
+    const Elf32_Word size = reader.Read<Elf32_Word>();
+    const bool will_be_replaced = reader.ReadBool();
+    const MergingUnit& unit = m_merging_units.emplace_back(first_name, second_name, size,
+                                                           will_be_replaced, reader.ReadBool());
+    m_merging_lookup.emplace(unit.m_first_name, unit);
+  }
+  for (std::size_t i = 0, count = reader.ReadCount(); i < count; ++i)
+  {
+    FoldingUnit& folding_unit = m_folding_units.emplace_back(reader.ReadString());
+    FoldingUnit::UnitLookup& curr_unit_lookup = m_folding_lookup[folding_unit.m_object_name];
+    for (std::size_t j = 0, unit_count = reader.ReadCount(); j < unit_count; ++j)
+    {
+      const std::string_view first_name = reader.ReadString(), second_name = reader.ReadString();
+      const Elf32_Word size = reader.Read<Elf32_Word>();
+      const FoldingUnit::Unit& unit =
+          folding_unit.m_units.emplace_back(first_name, second_name, size, reader.ReadBool());
+      curr_unit_lookup.emplace(unit.m_first_name, unit);
+    }
+  }
+}
+
+void Map::LinkerOpts::SaveCache(CacheWriter& writer) const
+{
+  writer.WriteCount(m_units.size());
+  for (const Unit& unit : m_units)
+  {
+    writer.Write(unit.m_unit_kind);
+    writer.WriteString(unit.m_module_name);
+    writer.WriteString(unit.m_name);
+    writer.WriteString(unit.m_reference_name);
+  }
+}
+
+void Map::LinkerOpts::LoadCache(CacheReader& reader)
+{
+  const std::size_t count = reader.ReadCount();
+  m_units.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const Unit::Kind unit_kind = reader.Read<Unit::Kind>();
+    const std::string_view module_name = reader.ReadString(), name = reader.ReadString();
+    m_units.emplace_back(unit_kind, module_name, name, reader.ReadString());
+  }
+}
+
+void Map::MixedModeIslands::SaveCache(CacheWriter& writer) const
+{
+  writer.WriteCount(m_units.size());
+  for (const Unit& unit : m_units)
+  {
+    writer.WriteString(unit.m_first_name);
+    writer.WriteString(unit.m_second_name);
+    writer.WriteBool(unit.m_is_safe);
+  }
+}
+
+void Map::MixedModeIslands::LoadCache(CacheReader& reader)
+{
+  const std::size_t count = reader.ReadCount();
+  m_units.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const std::string_view first_name = reader.ReadString(), second_name = reader.ReadString();
+    m_units.emplace_back(first_name, second_name, reader.ReadBool());
+  }
+}
+
+void Map::BranchIslands::SaveCache(CacheWriter& writer) const
+{
+  writer.WriteCount(m_units.size());
+  for (const Unit& unit : m_units)
+  {
+    writer.WriteString(unit.m_first_name);
+    writer.WriteString(unit.m_second_name);
+    writer.WriteBool(unit.m_is_safe);
+  }
+}
+
+void Map::BranchIslands::LoadCache(CacheReader& reader)
+{
+  const std::size_t count = reader.ReadCount();
+  m_units.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const std::string_view first_name = reader.ReadString(), second_name = reader.ReadString();
+    m_units.emplace_back(first_name, second_name, reader.ReadBool());
+  }
+}
+
+// Entry symbols refer to their host by its index, which always comes before theirs.
+static constexpr std::uint32_t no_entry_parent = static_cast<std::uint32_t>(-1);
+
+void Map::SectionLayout::SaveCache(CacheWriter& writer) const
+{
+  Mijo::FlatHashMap<const Unit*, std::uint32_t> entry_parent_ids;
+  writer.WriteCount(m_units.size());
+  for (std::uint32_t id = 0; const Unit& unit : m_units)
+  {
+    if (!unit.m_entry_children.empty())
+      entry_parent_ids.emplace(&unit, id);
+    writer.Write(unit.m_unit_kind);
+    writer.Write(unit.m_starting_address);
+    writer.Write(unit.m_size);
+    writer.Write(unit.m_virtual_address);
+    writer.Write(unit.m_file_offset);
+    writer.Write(unit.m_alignment);
+    writer.WriteString(unit.m_name);
+    writer.Write(unit.m_entry_parent != nullptr ? entry_parent_ids.at(unit.m_entry_parent) :
+                                                  no_entry_parent);
+    writer.WriteString(unit.m_module_name);
+    writer.WriteString(unit.m_source_name);
+    writer.Write(unit.m_unit_trait);
+    ++id;
+  }
+}
+
+void Map::SectionLayout::LoadCache(CacheReader& reader)
+{
+  for (std::size_t id = 0, count = reader.ReadCount(); id < count; ++id)
+  {
+    const Unit::Kind unit_kind = reader.Read<Unit::Kind>();
+    const std::uint32_t starting_address = reader.Read<std::uint32_t>();
+    const Elf32_Word size = reader.Read<Elf32_Word>();
+    const Elf32_Addr virtual_address = reader.Read<Elf32_Addr>();
+    const std::uint32_t file_offset = reader.Read<std::uint32_t>();
+    const int alignment = reader.Read<int>();
+    // Any constructor but this one would deduce the trait, which was already done.
+    Unit& unit = m_units.emplace_back(starting_address, size, virtual_address, file_offset,
+                                      alignment, Unit::Trait::None);
+    unit.m_unit_kind = unit_kind;
+    unit.m_name = reader.ReadString();
+    if (const std::uint32_t entry_parent_id = reader.Read<std::uint32_t>();
+        entry_parent_id != no_entry_parent)
+    {
+      if (entry_parent_id >= id)
+      {
+        reader.Fail();
+        return;
+      }
+      Unit& parent = m_units[entry_parent_id];
+      unit.m_entry_parent = &parent;
+      parent.m_entry_children.push_back(&unit);
+    }
+    unit.m_module_name = reader.ReadString();
+    unit.m_source_name = reader.ReadString();
+    unit.m_unit_trait = reader.Read<Unit::Trait>();
+    // Printing relies on these holding true of anything that came from scanning.
+    const bool is_fill =
+        unit.m_unit_trait == Unit::Trait::Fill1 || unit.m_unit_trait == Unit::Trait::Fill2;
+    if (unit_kind > Unit::Kind::Special || unit.m_unit_trait > Unit::Trait::Fill2 ||
+        (unit_kind == Unit::Kind::Entry) != (unit.m_entry_parent != nullptr) ||
+        (unit_kind == Unit::Kind::Special) != is_fill ||
+        (unit_kind == Unit::Kind::Special && GetMinVersion() < Version::version_3_0_4))
+    {
+      reader.Fail();
+      return;
+    }
+  }
+
+  // Scanning switches lookups whenever a new compilation unit begins, and entry symbols always
+  // belong to the same one as the symbol before them. Every lookup is given enough room up front
+  // to never need to grow. Adding a lookup can move every other one, so runs go by name at first.
+  std::vector<std::pair<std::string_view, std::size_t>> runs;
+  std::string_view curr_module_name, curr_source_name;
+  for (const Unit& unit : m_units)
+  {
+    if (unit.m_unit_kind == Unit::Kind::Special)
+      continue;
+    if (runs.empty() ||
+        (unit.m_unit_kind != Unit::Kind::Entry &&
+         (curr_module_name != unit.m_module_name || curr_source_name != unit.m_source_name)))
+    {
+      curr_module_name = unit.m_module_name;
+      curr_source_name = unit.m_source_name;
+      runs.emplace_back(GetCompilationUnitName(curr_module_name, curr_source_name), 0);
+      m_lookup.try_emplace(runs.back().first);
+    }
+    ++runs.back().second;
+  }
+  Mijo::FlatHashMap<std::string_view, std::size_t> lookup_sizes;
+  for (const auto& [compilation_unit_name, size] : runs)
+    lookup_sizes[compilation_unit_name] += size;
+  for (const auto& [compilation_unit_name, size] : lookup_sizes)
+    m_lookup.find(compilation_unit_name)->second.reserve(size);
+  auto unit = m_units.begin();
+  for (const auto& [compilation_unit_name, size] : runs)
+  {
+    UnitLookup& unit_lookup = m_lookup.find(compilation_unit_name)->second;
+    for (std::size_t i = 0; i < size; ++unit)
+    {
+      if (unit->m_unit_kind == Unit::Kind::Special)
+        continue;
+      unit_lookup.emplace(unit->m_name, *unit);
+      ++i;
+    }
+  }
+}
+
+void Map::MemoryMap::SaveCache(CacheWriter& writer) const
+{
+  writer.WriteBool(m_has_rom_ram);
+  writer.WriteBool(m_has_s_record);
+  writer.WriteBool(m_has_bin_file);
+  writer.WriteCount(m_normal_units.size());
+  for (const UnitNormal& unit : m_normal_units)
+  {
+    writer.WriteString(unit.m_name);
+    writer.Write(unit.m_starting_address);
+    writer.Write(unit.m_size);
+    writer.Write(unit.m_file_offset);
+    writer.Write(unit.m_rom_address);
+    writer.Write(unit.m_ram_buffer_address);
+    writer.Write(unit.m_srecord_line);
+    writer.Write(unit.m_bin_file_offset);
+    writer.WriteString(unit.m_bin_file_name);
+  }
+  writer.WriteCount(m_debug_units.size());
+  for (const UnitDebug& unit : m_debug_units)
+  {
+    writer.WriteString(unit.m_name);
+    writer.Write(unit.m_size);
+    writer.Write(unit.m_file_offset);
+  }
+}
+
+void Map::MemoryMap::LoadCache(CacheReader& reader)
+{
+  m_has_rom_ram = reader.ReadBool();
+  m_has_s_record = reader.ReadBool();
+  m_has_bin_file = reader.ReadBool();
+  const std::size_t normal_count = reader.ReadCount();
+  m_normal_units.reserve(normal_count);
+  for (std::size_t i = 0; i < normal_count; ++i)
+  {
+    const std::string_view name = reader.ReadString();
+    const Elf32_Addr starting_address = reader.Read<Elf32_Addr>();
+    const Elf32_Word size = reader.Read<Elf32_Word>();
+    const std::uint32_t file_offset = reader.Read<std::uint32_t>();
+    const std::uint32_t rom_address = reader.Read<std::uint32_t>();
+    const std::uint32_t ram_buffer_address = reader.Read<std::uint32_t>();
+    const int s_record_line = reader.Read<int>();
+    const std::uint32_t bin_file_offset = reader.Read<std::uint32_t>();
+    m_normal_units.emplace_back(name, starting_address, size, file_offset, rom_address,
+                                ram_buffer_address, s_record_line, bin_file_offset,
+                                reader.ReadString());
+  }
+  const std::size_t debug_count = reader.ReadCount();
+  m_debug_units.reserve(debug_count);
+  for (std::size_t i = 0; i < debug_count; ++i)
+  {
+    const std::string_view name = reader.ReadString();
+    const Elf32_Word size = reader.Read<Elf32_Word>();
+    m_debug_units.emplace_back(name, size, reader.Read<std::uint32_t>());
+  }
+}
+
+void Map::LinkerGeneratedSymbols::SaveCache(CacheWriter& writer) const
+{
+  writer.WriteCount(m_units.size());
+  for (const Unit& unit : m_units)
+  {
+    writer.WriteString(unit.m_name);
+    writer.Write(unit.m_value);
+  }
+}
+
+void Map::LinkerGeneratedSymbols::LoadCache(CacheReader& reader)
+{
+  const std::size_t count = reader.ReadCount();
+  m_units.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const std::string_view name = reader.ReadString();
+    m_units.emplace_back(name, reader.Read<Elf32_Addr>());
+  }
+}
+
+void Map::SaveCache(std::ostream& stream, const std::uint64_t text_hash) const
+{
+  // Symbol closures hold most of the distinct names there are, and section layouts hold the rest.
+  std::size_t string_count_estimate = 0;
+  if (const auto& normal_symbol_closure = GetNormalSymbolClosure())
+    string_count_estimate += normal_symbol_closure->m_strings.size();
+  if (const auto& dwarf_symbol_closure = GetDwarfSymbolClosure())
+    string_count_estimate += dwarf_symbol_closure->m_strings.size();
+  if (string_count_estimate == 0)
+    for (const SectionLayout& section_layout : m_section_layouts)
+      string_count_estimate += section_layout.m_units.size();
+  CacheWriter writer;
+  writer.ReserveStrings(string_count_estimate);
+  writer.WriteString(m_entry_point_name);
+  writer.WriteVersionRange(m_skipped_portions);
+  writer.WriteCount(m_unresolved_symbols.size());
+  for (const auto& [line_number, name] : m_unresolved_symbols)
+  {
+    writer.Write(std::uint64_t{line_number});
+    writer.WriteString(name);
+  }
+  writer.WriteOptional(GetNormalSymbolClosure());
+  writer.WriteOptional(m_eppc_pattern_matching);
+  writer.WriteOptional(GetDwarfSymbolClosure());
+  writer.WriteOptional(m_linker_opts);
+  writer.WriteOptional(m_mixed_mode_islands);
+  writer.WriteOptional(m_branch_islands);
+  writer.WriteOptional(m_linktime_size_decreasing_optimizations);
+  writer.WriteOptional(m_linktime_size_increasing_optimizations);
+  writer.WriteCount(m_section_layouts.size());
+  for (const SectionLayout& section_layout : m_section_layouts)
+  {
+    writer.Write(section_layout.m_section_kind);
+    writer.WriteString(section_layout.m_name);
+    writer.WriteVersionRange(section_layout);
+    section_layout.SaveCache(writer);
+  }
+  writer.WriteOptional(m_memory_map);
+  writer.WriteOptional(m_linker_generated_symbols);
+  writer.Finish(stream, text_hash);
+}
+
+Map::ScanError Map::LoadCache(const std::span<const char> span, const std::uint64_t text_hash)
+{
+  CacheHeader header;
+  if (span.size() < sizeof(header))
+    return ScanError::CacheBadHeader;
+  std::memcpy(&header, span.data(), sizeof(header));
+  if (!std::equal(std::begin(cache_magic), std::end(cache_magic), header.m_magic) ||
+      header.m_format_version != cache_format_version ||
+      header.m_byte_order_mark != cache_byte_order_mark)
+    return ScanError::CacheBadHeader;
+  if (header.m_text_hash != text_hash)
+    return ScanError::CacheStale;
+
+  const std::span<const char> payload = span.subspan(sizeof(header));
+  const std::size_t string_table_size = payload.size() / sizeof(std::uint64_t);
+  if (header.m_string_count == 0 || header.m_string_count > string_table_size ||
+      header.m_string_data_size > payload.size() ||
+      header.m_body_size > payload.size() ||
+      header.m_string_count * sizeof(std::uint64_t) + header.m_string_data_size +
+              header.m_body_size !=
+          payload.size() ||
+      Mijo::XXH64::Hash(payload) != header.m_payload_hash)
+    return ScanError::CacheCorrupt;
+
+  const auto string_count = static_cast<std::size_t>(header.m_string_count);
+  const auto string_data_size = static_cast<std::size_t>(header.m_string_data_size);
+  const std::span<const char> string_data_span =
+      payload.subspan(string_count * sizeof(std::uint64_t), string_data_size);
+  // Every name is stored at once, leaving only views into them to be made.
+  const std::string_view string_data =
+      m_string_pool.Store({string_data_span.data(), string_data_span.size()});
+  std::vector<std::string_view> strings;
+  strings.reserve(string_count);
+  for (std::size_t i = 0, begin = 0; i < string_count; ++i)
+  {
+    std::uint64_t end;
+    std::memcpy(&end, payload.data() + i * sizeof(end), sizeof(end));
+    if (end < begin || end > string_data_size)
+      return ScanError::CacheCorrupt;
+    strings.push_back(string_data.substr(begin, static_cast<std::size_t>(end) - begin));
+    begin = static_cast<std::size_t>(end);
+  }
+  if (!strings.front().empty())
+    return ScanError::CacheCorrupt;
+
+  CacheReader reader{payload.subspan(string_count * sizeof(std::uint64_t) + string_data_size),
+                     std::move(strings)};
+  m_entry_point_name = reader.ReadString();
+  reader.ReadVersionRange(m_skipped_portions);
+  const std::size_t unresolved_symbol_count = reader.ReadCount();
+  m_unresolved_symbols.reserve(unresolved_symbol_count);
+  for (std::size_t i = 0; i < unresolved_symbol_count; ++i)
+  {
+    const auto line_number = static_cast<std::size_t>(reader.Read<std::uint64_t>());
+    m_unresolved_symbols.emplace_back(line_number, reader.ReadString());
+  }
+  reader.ReadOptional(m_normal_symbol_closure);
+  reader.ReadOptional(m_eppc_pattern_matching);
+  reader.ReadOptional(m_dwarf_symbol_closure);
+  reader.ReadOptional(m_linker_opts);
+  reader.ReadOptional(m_mixed_mode_islands);
+  reader.ReadOptional(m_branch_islands);
+  reader.ReadOptional(m_linktime_size_decreasing_optimizations);
+  reader.ReadOptional(m_linktime_size_increasing_optimizations);
+  for (std::size_t i = 0, count = reader.ReadCount(); i < count && reader.IsGood(); ++i)
+  {
+    const auto section_kind = reader.Read<SectionLayout::Kind>();
+    SectionLayout& section_layout =
+        m_section_layouts.emplace_back(section_kind, reader.ReadString());
+    reader.ReadVersionRange(section_layout);
+    section_layout.LoadCache(reader);
+  }
+  // Which constructor is used does not matter, as the version range and flags are read over it.
+  reader.ReadOptional(m_memory_map, false, false, false);
+  reader.ReadOptional(m_linker_generated_symbols);
+  if (!reader.IsGood() || !reader.IsAtEnd())
+    return ScanError::CacheCorrupt;
+  return ScanError::None;
+}
+
+Map::ScanError Map::LoadCacheFile(const std::filesystem::path& path,
+                                  const std::uint64_t text_hash)
+{
+  Mijo::MappedFile mapped_file;
+  if (!mapped_file.Open(path))
+    return ScanError::FileUnreadable;
+  const ScanError error = LoadCache(mapped_file.GetSpan(), text_hash);
+  if (m_string_pool.GetMode() == StringStorage::Borrowed)
+    m_mapped_file = std::move(mapped_file);
+  return error;
+}
+
+// Caches are kept after the line number the scan they were made from ended on.
+using CachedLineNumber = std::uint64_t;
+static constexpr std::string_view temp_file_extension = ".tmp";
+// Temporary files this old were left behind by writers that are long gone.
+static constexpr std::chrono::hours stale_temp_file_age{1};
+
+Map::CacheDirectory::CacheDirectory(std::filesystem::path path, const std::uintmax_t size_limit)
+    : m_path(std::move(path)), m_size_limit(size_limit)
+{
+  std::error_code error_code;
+  std::filesystem::create_directories(m_path, error_code);
+  std::random_device random_device;
+  m_temp_file_salt = std::uint64_t{random_device()} << 32 | random_device();
+}
+
+Map::ScanError Map::CacheDirectory::Scan(Map& map, const std::span<const char> span,
+                                         std::size_t& line_number, const ScanFlavor flavor)
+{
+  return ScanCached(map, span, line_number, flavor, nullptr);
+}
+
+Map::ScanError Map::CacheDirectory::ScanFile(Map& map, const std::filesystem::path& path,
+                                             std::size_t& line_number, const ScanFlavor flavor)
+{
+  line_number = 0;
+  Mijo::MappedFile text_file;
+  if (!text_file.Open(path))
+    return ScanError::FileUnreadable;
+  return ScanCached(map, text_file.GetSpan(), line_number, flavor, &text_file);
+}
+
+void Map::CacheDirectory::Trim()
+{
+  const std::unique_lock lock(m_trim_mutex, std::try_to_lock);
+  if (!lock.owns_lock())
+    return;
+
+  struct CacheFile
+  {
+    std::filesystem::file_time_type m_last_write_time;
+    std::uintmax_t m_size;
+    std::filesystem::path m_path;
+  };
+  std::vector<CacheFile> cache_files;
+  std::uintmax_t total_size = 0;
+  const auto now = std::filesystem::file_time_type::clock::now();
+  // Files can vanish at any moment while others share the directory, so whatever cannot be looked
+  // at is passed over.
+  std::error_code error_code;
+  for (auto iter = std::filesystem::directory_iterator(m_path, error_code);
+       !error_code && iter != std::filesystem::directory_iterator(); iter.increment(error_code))
+  {
+    std::error_code file_error_code;
+    if (!iter->is_regular_file(file_error_code))
+      continue;
+    const auto last_write_time = iter->last_write_time(file_error_code);
+    if (file_error_code)
+      continue;
+    const std::filesystem::path& path = iter->path();
+    if (path.extension() == temp_file_extension)
+    {
+      if (now - last_write_time > stale_temp_file_age)
+        std::filesystem::remove(path, file_error_code);
+      continue;
+    }
+    if (path.extension() != extension)
+      continue;
+    const std::uintmax_t size = iter->file_size(file_error_code);
+    if (file_error_code)
+      continue;
+    total_size += size;
+    cache_files.emplace_back(last_write_time, size, path);
+  }
+  if (total_size <= m_size_limit)
+    return;
+
+  std::ranges::sort(cache_files, {}, &CacheFile::m_last_write_time);
+  for (const CacheFile& cache_file : cache_files)
+  {
+    if (total_size <= m_size_limit)
+      break;
+    // Someone else may have removed it first, or on some hosts it may still be in use.
+    std::error_code file_error_code;
+    if (!std::filesystem::remove(cache_file.m_path, file_error_code))
+      continue;
+    total_size -= cache_file.m_size;
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+Map::CacheDirectory::Stats Map::CacheDirectory::GetStats() const noexcept
+{
+  return {
+      .m_hits = m_hits.load(std::memory_order_relaxed),
+      .m_misses = m_misses.load(std::memory_order_relaxed),
+      .m_rejects = m_rejects.load(std::memory_order_relaxed),
+      .m_stores = m_stores.load(std::memory_order_relaxed),
+      .m_evictions = m_evictions.load(std::memory_order_relaxed),
+      .m_bytes_spared = m_bytes_spared.load(std::memory_order_relaxed),
+  };
+}
+
+Map::ScanError Map::CacheDirectory::ScanCached(Map& map, const std::span<const char> span,
+                                               std::size_t& line_number, const ScanFlavor flavor,
+                                               Mijo::MappedFile* const text_file)
+{
+  const std::uint64_t text_hash = HashText(span);
+  const std::filesystem::path cache_path =
+      m_path / fmt::format("{:016x}-{:d}-{:03x}-{:d}{:s}", text_hash, static_cast<int>(flavor),
+                           static_cast<std::uint32_t>(map.m_options.m_portions),
+                           cache_format_version, extension);
+  if (Load(map, cache_path, text_hash, line_number))
+  {
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    m_bytes_spared.fetch_add(span.size(), std::memory_order_relaxed);
+    return ScanError::None;
+  }
+  m_misses.fetch_add(1, std::memory_order_relaxed);
+  const ScanError error = map.ScanFlavored(span, line_number, flavor);
+  if (text_file != nullptr && map.m_string_pool.GetMode() == StringStorage::Borrowed)
+    map.m_mapped_file = std::move(*text_file);
+  // A lazy symbol closure can still turn out to be broken, where a scan that is not lazy would have
+  // failed, so a cache is only stored once every lazy one is known to have scanned cleanly. That
+  // way, scans that are and are not lazy can share caches.
+  const auto is_scanned_cleanly = [](const std::optional<LazySymbolClosure>& lazy_symbol_closure) {
+    return !lazy_symbol_closure || lazy_symbol_closure->GetScanError() == ScanError::None;
+  };
+  if (error == ScanError::None && is_scanned_cleanly(map.m_lazy_normal_symbol_closure) &&
+      is_scanned_cleanly(map.m_lazy_dwarf_symbol_closure))
+    Store(map, cache_path, text_hash, line_number);
+  return error;
+}
+
+bool Map::CacheDirectory::Load(Map& map, const std::filesystem::path& cache_path,
+                               const std::uint64_t text_hash, std::size_t& line_number)
+{
+  Mijo::MappedFile cache_file;
+  if (!cache_file.Open(cache_path))
+    return false;
+  const std::span<const char> span = cache_file.GetSpan();
+  CachedLineNumber cached_line_number;
+  if (span.size() >= sizeof(cached_line_number))
+  {
+    std::memcpy(&cached_line_number, span.data(), sizeof(cached_line_number));
+    if (map.LoadCache(span.subspan(sizeof(cached_line_number)), text_hash) == ScanError::None)
+    {
+      line_number = static_cast<std::size_t>(cached_line_number);
+      if (map.m_string_pool.GetMode() == StringStorage::Borrowed)
+        map.m_mapped_file = std::move(cache_file);
+      // This is what keeps a cache from being the next to go when trimming.
+      std::error_code error_code;
+      std::filesystem::last_write_time(cache_path, std::filesystem::file_time_type::clock::now(),
+                                       error_code);
+      return true;
+    }
+  }
+  // A damaged cache is of no use to anyone, and the Map is left in no state to be scanned into.
+  m_rejects.fetch_add(1, std::memory_order_relaxed);
+  cache_file.Close();
+  std::error_code error_code;
+  std::filesystem::remove(cache_path, error_code);
+  map = Map{Options{map.m_options}};
+  return false;
+}
+
+void Map::CacheDirectory::Store(const Map& map, const std::filesystem::path& cache_path,
+                                const std::uint64_t text_hash, const std::size_t line_number)
+{
+  std::filesystem::path temp_path = cache_path;
+  const std::uint64_t temp_file_id =
+      m_temp_file_salt + m_temp_file_count.fetch_add(1, std::memory_order_relaxed);
+  temp_path += fmt::format(".{:016x}{:s}", temp_file_id, temp_file_extension);
+  std::error_code error_code;
+  {
+    std::ofstream stream(temp_path, std::ios::binary);
+    const CachedLineNumber cached_line_number = line_number;
+    stream.write(reinterpret_cast<const char*>(&cached_line_number), sizeof(cached_line_number));
+    map.SaveCache(stream, text_hash);
+    stream.close();
+    if (!stream)
+    {
+      std::filesystem::remove(temp_path, error_code);
+      return;
+    }
+  }
+  // Readers only ever see a cache whole, as the rename replaces any that is already there at once.
+  std::filesystem::rename(temp_path, cache_path, error_code);
+  if (error_code)
+  {
+    std::filesystem::remove(temp_path, error_code);
+    return;
+  }
+  m_stores.fetch_add(1, std::memory_order_relaxed);
+  Trim();
+}
+
+template <class T>
+struct AddressRange
+{
+  std::uint64_t m_start;
+  std::uint64_t m_end;
+  T m_value;
+};
+
+// Cuts up ranges that may nest or overlap into ones that do not, each of which goes to whichever
+// range began last of those it lies within. Ranges that begin at the same place are narrower the
+// later they end, and after that the later they came.
+template <class T, class Emit>
+static void FlattenAddressRanges(std::vector<AddressRange<T>>& ranges, Emit&& emit)
+{
+  std::ranges::stable_sort(ranges, [](const AddressRange<T>& lhs, const AddressRange<T>& rhs) {
+    return lhs.m_start < rhs.m_start || (lhs.m_start == rhs.m_start && lhs.m_end > rhs.m_end);
+  });
+  std::vector<const AddressRange<T>*> open_ranges;
+  std::uint64_t position = 0;
+  const auto close_until = [&](const std::uint64_t until) {
+    for (; !open_ranges.empty() && open_ranges.back()->m_end <= until; open_ranges.pop_back())
+    {
+      const AddressRange<T>& range = *open_ranges.back();
+      if (position < range.m_end)
+        emit(position, range.m_end, range.m_value);
+      position = std::max(position, range.m_end);
+    }
+    if (!open_ranges.empty() && position < until)
+      emit(position, until, open_ranges.back()->m_value);
+    position = std::max(position, until);
+  };
+  for (const AddressRange<T>& range : ranges)
+  {
+    close_until(range.m_start);
+    open_ranges.push_back(&range);
+  }
+  close_until(std::numeric_limits<std::uint64_t>::max());
+}
+
+// Gives how many ranges begin at or before an address, knowing that at least the first so many do.
+// The search gallops ahead from there before narrowing down, so it is quickest for nearby ranges.
+static std::size_t SeekAddressRange(const std::vector<Elf32_Addr>& starts, std::size_t first,
+                                    const Elf32_Addr address) noexcept
+{
+  std::size_t last = first;
+  for (std::size_t step = 1; last < starts.size() && starts[last] <= address; step *= 2)
+  {
+    first = last + 1;
+    last += step;
+  }
+  last = std::min(last, starts.size());
+  return static_cast<std::size_t>(
+      std::upper_bound(starts.begin() + static_cast<std::ptrdiff_t>(first),
+                       starts.begin() + static_cast<std::ptrdiff_t>(last), address) -
+      starts.begin());
+}
+
+Map::AddressIndex::AddressIndex(const Map& map)
+{
+  using UnitValue = std::pair<const SectionLayout*, const SectionLayout::Unit*>;
+  std::vector<AddressRange<UnitValue>> unit_ranges;
+  for (const SectionLayout& section_layout : map.m_section_layouts)
+  {
+    if (section_layout.m_section_kind == SectionLayout::Kind::Debug)
+      continue;
+    for (const SectionLayout::Unit& unit : section_layout.m_units)
+    {
+      if ((unit.m_unit_kind != SectionLayout::Unit::Kind::Normal &&
+           unit.m_unit_kind != SectionLayout::Unit::Kind::Entry) ||
+          unit.m_size == 0)
+        continue;
+      unit_ranges.emplace_back(unit.m_virtual_address,
+                               std::uint64_t{unit.m_virtual_address} + unit.m_size,
+                               UnitValue{&section_layout, &unit});
+    }
+  }
+  FlattenAddressRanges(unit_ranges, [this](const std::uint64_t start, const std::uint64_t end,
+                                           const UnitValue& value) {
+    m_unit_range_starts.push_back(static_cast<Elf32_Addr>(start));
+    m_unit_ranges.emplace_back(end, value.first, value.second);
+  });
+
+  if (!map.m_memory_map)
+    return;
+  std::vector<AddressRange<const MemoryMap::UnitNormal*>> section_ranges;
+  for (const MemoryMap::UnitNormal& unit : map.m_memory_map->m_normal_units)
+  {
+    if (unit.m_size == 0)
+      continue;
+    section_ranges.emplace_back(unit.m_starting_address,
+                                std::uint64_t{unit.m_starting_address} + unit.m_size, &unit);
+  }
+  FlattenAddressRanges(section_ranges, [this](const std::uint64_t start, const std::uint64_t end,
+                                              const MemoryMap::UnitNormal* const section) {
+    m_section_range_starts.push_back(static_cast<Elf32_Addr>(start));
+    m_section_ranges.emplace_back(end, section);
+  });
+}
+
+Map::AddressIndex::Match Map::AddressIndex::Find(const Elf32_Addr address) const noexcept
+{
+  Match match;
+  Find({&address, 1}, {&match, 1});
+  return match;
+}
+
+void Map::AddressIndex::Find(const std::span<const Elf32_Addr> addresses,
+                             const std::span<Match> matches) const noexcept
+{
+  assert(addresses.size() <= matches.size());
+  assert(std::ranges::is_sorted(addresses));
+  std::size_t unit_range_count = 0, section_range_count = 0;
+  for (std::size_t i = 0; i < addresses.size(); ++i)
+  {
+    const Elf32_Addr address = addresses[i];
+    Match& match = matches[i];
+    match = {};
+    unit_range_count = SeekAddressRange(m_unit_range_starts, unit_range_count, address);
+    if (unit_range_count != 0)
+    {
+      const UnitRange& range = m_unit_ranges[unit_range_count - 1];
+      if (address < range.m_end)
+      {
+        match.m_section_layout = range.m_section_layout;
+        match.m_unit = range.m_unit;
+      }
+    }
+    section_range_count = SeekAddressRange(m_section_range_starts, section_range_count, address);
+    if (section_range_count != 0)
+    {
+      const SectionRange& range = m_section_ranges[section_range_count - 1];
+      if (address < range.m_end)
+        match.m_section = range.m_section;
+    }
+  }
+}
+
+// Everything the AddressIndex points to is held in containers that keep their elements in place
+// when moved, which the eager symbol closures are not.
+Map::Map(Map&& other)
+    : m_options(std::move(other.m_options)),
+      m_string_pool(std::move(other.m_string_pool)),
+      m_diagnostics(std::move(other.m_diagnostics)),
+      m_scan_profile(std::move(other.m_scan_profile)),
+      m_mapped_file(std::move(other.m_mapped_file)),
+      m_entry_point_name(std::move(other.m_entry_point_name)),
+      m_normal_symbol_closure(std::move(other.m_normal_symbol_closure)),
+      m_eppc_pattern_matching(std::move(other.m_eppc_pattern_matching)),
+      m_dwarf_symbol_closure(std::move(other.m_dwarf_symbol_closure)),
+      m_lazy_normal_symbol_closure(std::move(other.m_lazy_normal_symbol_closure)),
+      m_lazy_dwarf_symbol_closure(std::move(other.m_lazy_dwarf_symbol_closure)),
+      m_unresolved_symbols(std::move(other.m_unresolved_symbols)),
+      m_linker_opts(std::move(other.m_linker_opts)),
+      m_mixed_mode_islands(std::move(other.m_mixed_mode_islands)),
+      m_branch_islands(std::move(other.m_branch_islands)),
+      m_linktime_size_decreasing_optimizations(
+          std::move(other.m_linktime_size_decreasing_optimizations)),
+      m_linktime_size_increasing_optimizations(
+          std::move(other.m_linktime_size_increasing_optimizations)),
+      m_section_layouts(std::move(other.m_section_layouts)),
+      m_memory_map(std::move(other.m_memory_map)),
+      m_linker_generated_symbols(std::move(other.m_linker_generated_symbols)),
+      m_skipped_portions(std::move(other.m_skipped_portions)),
+      m_address_index(std::move(other.m_address_index))
+{
+  other.m_symbol_index.Reset();
+}
+
+Map& Map::operator=(Map&& other)
+{
+  if (this == &other)
+    return *this;
+  m_options = std::move(other.m_options);
+  m_string_pool = std::move(other.m_string_pool);
+  m_diagnostics = std::move(other.m_diagnostics);
+  m_scan_profile = std::move(other.m_scan_profile);
+  m_mapped_file = std::move(other.m_mapped_file);
+  m_entry_point_name = std::move(other.m_entry_point_name);
+  m_normal_symbol_closure = std::move(other.m_normal_symbol_closure);
+  m_eppc_pattern_matching = std::move(other.m_eppc_pattern_matching);
+  m_dwarf_symbol_closure = std::move(other.m_dwarf_symbol_closure);
+  m_lazy_normal_symbol_closure = std::move(other.m_lazy_normal_symbol_closure);
+  m_lazy_dwarf_symbol_closure = std::move(other.m_lazy_dwarf_symbol_closure);
+  m_unresolved_symbols = std::move(other.m_unresolved_symbols);
+  m_linker_opts = std::move(other.m_linker_opts);
+  m_mixed_mode_islands = std::move(other.m_mixed_mode_islands);
+  m_branch_islands = std::move(other.m_branch_islands);
+  m_linktime_size_decreasing_optimizations =
+      std::move(other.m_linktime_size_decreasing_optimizations);
+  m_linktime_size_increasing_optimizations =
+      std::move(other.m_linktime_size_increasing_optimizations);
+  m_section_layouts = std::move(other.m_section_layouts);
+  m_memory_map = std::move(other.m_memory_map);
+  m_linker_generated_symbols = std::move(other.m_linker_generated_symbols);
+  m_skipped_portions = std::move(other.m_skipped_portions);
+  m_address_index = std::move(other.m_address_index);
+  m_symbol_index.Reset();
+  other.m_symbol_index.Reset();
+  return *this;
+}
+
+const Map::AddressIndex& Map::GetAddressIndex() const
+{
+  return m_address_index.Get([this] { return AddressIndex(*this); });
+}
+
+template <class Func>
+void Map::SymbolIndex::ForEachOccurrence(const Map& map, Func&& func)
+{
+  const auto for_each_node = [&](const std::optional<SymbolClosure>& symbol_closure) {
+    if (!symbol_closure)
+      return;
+    for (const SymbolClosure::Node node : symbol_closure->GetNodes())
+      if (node.GetKind() != SymbolClosure::NodeKind::Dummy)
+        func(node.GetName(), Occurrence{node});
+  };
+  for_each_node(map.GetNormalSymbolClosure());
+  if (map.m_eppc_pattern_matching)
+  {
+    for (const auto& merging_unit : map.m_eppc_pattern_matching->m_merging_units)
+    {
+      func(merging_unit.m_first_name, Occurrence{&merging_unit});
+      func(merging_unit.m_second_name, Occurrence{&merging_unit});
+    }
+    for (const auto& folding_unit : map.m_eppc_pattern_matching->m_folding_units)
+    {
+      for (const auto& unit : folding_unit.GetUnits())
+      {
+        func(unit.m_first_name, Occurrence{FoldingUnitRef{&folding_unit, &unit}});
+        func(unit.m_second_name, Occurrence{FoldingUnitRef{&folding_unit, &unit}});
+      }
+    }
+  }
+  for_each_node(map.GetDwarfSymbolClosure());
+  for (const SectionLayout& section_layout : map.m_section_layouts)
+    for (const SectionLayout::Unit& unit : section_layout.m_units)
+      if (unit.m_unit_kind != SectionLayout::Unit::Kind::Special)
+        func(unit.m_name, Occurrence{SectionLayoutUnitRef{&section_layout, &unit}});
+  if (map.m_linker_generated_symbols)
+    for (const auto& unit : map.m_linker_generated_symbols->m_units)
+      func(unit.m_name, Occurrence{&unit});
+}
+
+Map::SymbolIndex::SymbolIndex(const Map& map)
+{
+  std::size_t occurrence_count = 0;
+  ForEachOccurrence(map, [&](const std::string_view name, const Occurrence&) {
+    occurrence_count += !name.empty();
+  });
+  if (occurrence_count == 0)
+    return;
+  // There are never more names than occurrences, so the table is never more than 80% full. In
+  // practice, most names appear in both a symbol closure and a section layout.
+  m_slots.resize(std::bit_ceil(occurrence_count + occurrence_count / 4 + 1));
+
+  // Names are counted up first, so that each one's occurrences can then be put right in place.
+  std::vector<std::uint32_t> name_ids;
+  name_ids.reserve(occurrence_count);
+  ForEachOccurrence(map, [&](const std::string_view name, const Occurrence&) {
+    if (name.empty())
+      return;
+    const std::uint64_t hash = Mijo::XXH64::Hash(name);
+    Slot& slot = m_slots[Probe(name, hash)];
+    if (slot.m_name_id_plus_one == 0)
+    {
+      m_names.push_back(name);
+      m_occurrence_begins.push_back(0);
+      slot = {static_cast<std::uint32_t>(hash >> 32), static_cast<std::uint32_t>(m_names.size())};
+    }
+    const std::uint32_t name_id = slot.m_name_id_plus_one - 1;
+    ++m_occurrence_begins[name_id];
+    name_ids.push_back(name_id);
+  });
+  m_occurrence_begins.push_back(0);
+  std::exclusive_scan(m_occurrence_begins.begin(), m_occurrence_begins.end(),
+                      m_occurrence_begins.begin(), std::uint32_t{0});
+
+  std::vector<std::uint32_t> occurrence_ends(m_occurrence_begins.begin(),
+                                             m_occurrence_begins.end() - 1);
+  m_occurrences.resize(occurrence_count,
+                       Occurrence{static_cast<const LinkerGeneratedSymbols::Unit*>(nullptr)});
+  auto name_id = name_ids.begin();
+  ForEachOccurrence(map, [&](const std::string_view name, const Occurrence& occurrence) {
+    if (!name.empty())
+      m_occurrences[occurrence_ends[*name_id++]++] = occurrence;
+  });
+}
+
+std::span<const Map::SymbolIndex::Occurrence>
+Map::SymbolIndex::Find(const std::string_view name) const noexcept
+{
+  if (m_slots.empty())
+    return {};
+  const Slot& slot = m_slots[Probe(name, Mijo::XXH64::Hash(name))];
+  if (slot.m_name_id_plus_one == 0)
+    return {};
+  const std::uint32_t name_id = slot.m_name_id_plus_one - 1;
+  const std::uint32_t begin = m_occurrence_begins[name_id], end = m_occurrence_begins[name_id + 1];
+  return std::span{m_occurrences}.subspan(begin, end - begin);
+}
+
+std::size_t Map::SymbolIndex::Probe(const std::string_view name,
+                                    const std::uint64_t hash) const noexcept
+{
+  // Linear probing, with the low bits of the hash choosing where to start and the high bits
+  // telling names apart.
+  const std::size_t mask = m_slots.size() - 1;
+  const auto hash_tag = static_cast<std::uint32_t>(hash >> 32);
+  for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask)
+  {
+    const Slot& slot = m_slots[i];
+    if (slot.m_name_id_plus_one == 0 ||
+        (slot.m_hash_tag == hash_tag && m_names[slot.m_name_id_plus_one - 1] == name))
+      return i;
+  }
+}
+
+const Map::SymbolIndex& Map::GetSymbolIndex() const
+{
+  return m_symbol_index.Get([this] { return SymbolIndex(*this); });
+}
+
+// Sorting these stably keeps repeated names in the order they appear in, so the nth of them on one
+// side is paired with the nth on the other.
+struct DiffSymbolKey
+{
+  std::string_view m_compilation_unit_name;
+  std::string_view m_name;
+  const Map::SectionLayout::Unit* m_unit;
+};
+
+static std::vector<DiffSymbolKey> GetDiffSymbolKeys(const Map::SectionLayout* const section_layout)
+{
+  std::vector<DiffSymbolKey> keys;
+  if (section_layout == nullptr)
+    return keys;
+  keys.reserve(section_layout->GetUnits().size());
+  for (const Map::SectionLayout::Unit& unit : section_layout->GetUnits())
+  {
+    if (unit.m_unit_kind == Map::SectionLayout::Unit::Kind::Special)
+      continue;
+    keys.push_back(
+        {GetCompilationUnitName(unit.m_module_name, unit.m_source_name), unit.m_name, &unit});
+  }
+  std::ranges::stable_sort(keys, [](const DiffSymbolKey& lhs, const DiffSymbolKey& rhs) {
+    return std::tie(lhs.m_compilation_unit_name, lhs.m_name) <
+           std::tie(rhs.m_compilation_unit_name, rhs.m_name);
+  });
+  return keys;
+}
+
+std::uint64_t Map::Diff::GetLinkedSize(const SectionLayout::Unit* const unit) noexcept
+{
+  if (unit == nullptr || unit->m_unit_kind != SectionLayout::Unit::Kind::Normal ||
+      unit->m_unit_trait == SectionLayout::Unit::Trait::Section)
+    return 0;
+  return unit->m_size;
+}
+
+static void CompareSectionLayouts(Map::Diff::SectionDiff& section_diff)
+{
+  const std::vector<DiffSymbolKey> old_keys = GetDiffSymbolKeys(section_diff.m_old_section_layout);
+  const std::vector<DiffSymbolKey> new_keys = GetDiffSymbolKeys(section_diff.m_new_section_layout);
+  auto old_iter = old_keys.begin(), new_iter = new_keys.begin();
+  while (old_iter != old_keys.end() || new_iter != new_keys.end())
+  {
+    // Whichever of the two compilation units coming up has the lesser name goes first.
+    std::string_view name;
+    if (new_iter == new_keys.end())
+      name = old_iter->m_compilation_unit_name;
+    else if (old_iter == old_keys.end())
+      name = new_iter->m_compilation_unit_name;
+    else
+      name = std::min(old_iter->m_compilation_unit_name, new_iter->m_compilation_unit_name);
+    section_diff.m_compilation_units.push_back({name, 0, 0, {}});
+    Map::Diff::CompilationUnitDiff& compilation_unit_diff = section_diff.m_compilation_units.back();
+    const auto is_old_in_unit = [&] {
+      return old_iter != old_keys.end() && old_iter->m_compilation_unit_name == name;
+    };
+    const auto is_new_in_unit = [&] {
+      return new_iter != new_keys.end() && new_iter->m_compilation_unit_name == name;
+    };
+    while (is_old_in_unit() || is_new_in_unit())
+    {
+      const Map::SectionLayout::Unit* old_unit = nullptr;
+      const Map::SectionLayout::Unit* new_unit = nullptr;
+      if (!is_new_in_unit() || (is_old_in_unit() && old_iter->m_name < new_iter->m_name))
+      {
+        old_unit = (old_iter++)->m_unit;
+      }
+      else if (!is_old_in_unit() || new_iter->m_name < old_iter->m_name)
+      {
+        new_unit = (new_iter++)->m_unit;
+      }
+      else
+      {
+        old_unit = (old_iter++)->m_unit;
+        new_unit = (new_iter++)->m_unit;
+      }
+      compilation_unit_diff.m_symbols.push_back(
+          {(old_unit ? old_unit : new_unit)->m_name, old_unit, new_unit});
+      compilation_unit_diff.m_old_size += Map::Diff::GetLinkedSize(old_unit);
+      compilation_unit_diff.m_new_size += Map::Diff::GetLinkedSize(new_unit);
+    }
+    section_diff.m_old_size += compilation_unit_diff.m_old_size;
+    section_diff.m_new_size += compilation_unit_diff.m_new_size;
+  }
+}
+
+Map::Diff::Diff(const Map& old_map, const Map& new_map, const unsigned thread_count)
+{
+  // Sections are paired up the same way symbols are, though there are few enough of them that the
+  // order they end up in can be sorted out afterward.
+  struct SectionKey
+  {
+    std::string_view m_name;
+    std::size_t m_index;
+    const SectionLayout* m_section_layout;
+  };
+  const auto get_section_keys = [](const Map& map) {
+    std::vector<SectionKey> keys;
+    for (const SectionLayout& section_layout : map.m_section_layouts)
+      keys.push_back({section_layout.m_name, keys.size(), &section_layout});
+    std::ranges::stable_sort(keys, {}, &SectionKey::m_name);
+    return keys;
+  };
+  const std::vector<SectionKey> old_keys = get_section_keys(old_map);
+  const std::vector<SectionKey> new_keys = get_section_keys(new_map);
+
+  std::vector<std::pair<std::size_t, SectionDiff>> ordered_sections;
+  auto old_iter = old_keys.begin(), new_iter = new_keys.begin();
+  while (old_iter != old_keys.end() || new_iter != new_keys.end())
+  {
+    if (new_iter == new_keys.end() ||
+        (old_iter != old_keys.end() && old_iter->m_name < new_iter->m_name))
+    {
+      ordered_sections.emplace_back(new_keys.size() + old_iter->m_index,
+                                    SectionDiff{old_iter->m_name, old_iter->m_section_layout,
+                                                nullptr, 0, 0, {}});
+      ++old_iter;
+    }
+    else if (old_iter == old_keys.end() || new_iter->m_name < old_iter->m_name)
+    {
+      ordered_sections.emplace_back(new_iter->m_index,
+                                    SectionDiff{new_iter->m_name, nullptr,
+                                                new_iter->m_section_layout, 0, 0, {}});
+      ++new_iter;
+    }
+    else
+    {
+      ordered_sections.emplace_back(new_iter->m_index,
+                                    SectionDiff{new_iter->m_name, old_iter->m_section_layout,
+                                                new_iter->m_section_layout, 0, 0, {}});
+      ++old_iter;
+      ++new_iter;
+    }
+  }
+  std::ranges::sort(ordered_sections, {}, &decltype(ordered_sections)::value_type::first);
+  m_sections.reserve(ordered_sections.size());
+  for (auto& ordered_section : ordered_sections)
+    m_sections.push_back(std::move(ordered_section.second));
+
+  // One section usually outweighs all the others put together, so the largest go first.
+  std::vector<std::pair<std::size_t, std::size_t>> unit_counts;
+  unit_counts.reserve(m_sections.size());
+  for (const SectionDiff& section_diff : m_sections)
+  {
+    const std::size_t unit_count =
+        (section_diff.m_old_section_layout ? section_diff.m_old_section_layout->m_units.size() :
+                                             0) +
+        (section_diff.m_new_section_layout ? section_diff.m_new_section_layout->m_units.size() :
+                                             0);
+    unit_counts.emplace_back(unit_count, unit_counts.size());
+  }
+  std::ranges::stable_sort(unit_counts, std::ranges::greater{},
+                           [](const auto& count_and_index) { return count_and_index.first; });
+  Mijo::ParallelForStealing(unit_counts.size(), thread_count, [&](const std::size_t i) {
+    CompareSectionLayouts(m_sections[unit_counts[i].second]);
+  });
+}
 }  // namespace MWLinker
@@ -4,17 +4,27 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
-#include <list>
-#include <memory>
+#include <deque>
+#include <filesystem>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <span>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
+#include <variant>
+#include <vector>
+
+#include "FileUtil.h"
+#include "HashUtil.h"
+#include "LineUtil.h"
+#include "StringUtil.h"
+#include "ThreadUtil.h"
 
 namespace MWLinker
 {
@@ -120,10 +130,198 @@ struct Map
     SectionLayoutSpecialNotFill,
 
     MemoryMapBadPrologue,
+
+    CacheBadHeader,
+    CacheStale,
+    CacheCorrupt,
+
+    Cancelled,
+
+    FileUnreadable,
+  };
+
+  using UnresolvedSymbols = std::vector<std::pair<std::size_t, std::string_view>>;
+
+  // The names held by the units of every portion are views into a Mijo::StringPool owned by the
+  // Map, so they live exactly as long as it does. Module, source, and object names repeat thousands
+  // of times in a large linker map, so StringStorage::Interned can save a lot of memory.
+  // With StringStorage::Borrowed, the views point straight into the text given to Scan instead.
+  // Nothing is copied, but that text must then outlive the Map and stay unmodified.
+  using StringStorage = Mijo::StringPool::Mode;
+
+  // The portions of a linker map, for telling Scan which of them to bother with.
+  enum class Portions : std::uint32_t
+  {
+    None = 0,
+    NormalSymbolClosure = 1u << 0,
+    EPPC_PatternMatching = 1u << 1,
+    DwarfSymbolClosure = 1u << 2,
+    LinkerOpts = 1u << 3,
+    MixedModeIslands = 1u << 4,
+    BranchIslands = 1u << 5,
+    LinktimeSizeDecreasingOptimizations = 1u << 6,
+    LinktimeSizeIncreasingOptimizations = 1u << 7,
+    SectionLayouts = 1u << 8,
+    MemoryMap = 1u << 9,
+    LinkerGeneratedSymbols = 1u << 10,
+    All = (1u << 11) - 1u,
+  };
+  friend constexpr Portions operator|(const Portions lhs, const Portions rhs) noexcept
+  {
+    return static_cast<Portions>(static_cast<std::uint32_t>(lhs) |
+                                 static_cast<std::uint32_t>(rhs));
+  }
+  friend constexpr Portions operator&(const Portions lhs, const Portions rhs) noexcept
+  {
+    return static_cast<Portions>(static_cast<std::uint32_t>(lhs) &
+                                 static_cast<std::uint32_t>(rhs));
+  }
+
+  // The warnings a scan can give, for telling it which of them to bother with. None of them stop
+  // the scan, and some of them can be false positives.
+  enum class Warnings : std::uint32_t
+  {
+    None = 0,
+    SymbolClosureOdrViolation = 1u << 0,
+    SymbolClosureSymOnFlag = 1u << 1,
+    MergingOdrViolation = 1u << 2,
+    FoldingRepeatObject = 1u << 3,
+    FoldingOdrViolation = 1u << 4,
+    SectionLayoutRepeatCompilationUnit = 1u << 5,
+    SectionLayoutOdrViolation = 1u << 6,
+    SectionLayoutSymOnFlag = 1u << 7,
+    SectionLayoutCommonOnFlag = 1u << 8,
+    SectionLayoutLCommAfterComm = 1u << 9,
+    All = (1u << 10) - 1u,
+  };
+  friend constexpr Warnings operator|(const Warnings lhs, const Warnings rhs) noexcept
+  {
+    return static_cast<Warnings>(static_cast<std::uint32_t>(lhs) |
+                                 static_cast<std::uint32_t>(rhs));
+  }
+  friend constexpr Warnings operator&(const Warnings lhs, const Warnings rhs) noexcept
+  {
+    return static_cast<Warnings>(static_cast<std::uint32_t>(lhs) &
+                                 static_cast<std::uint32_t>(rhs));
+  }
+
+  // A warning given while scanning. Which of the names are given depends on the kind of warning.
+  // Warnings about code folding give the object name in place of the compilation unit name.
+  struct Diagnostic
+  {
+    Warnings m_kind;
+    std::size_t m_line_number;
+    std::string_view m_symbol_name;
+    std::string_view m_compilation_unit_name;
+    std::string_view m_section_name;
+  };
+
+  // Collects warnings while scanning instead of printing them on the spot, so that giving them
+  // never holds up the scan. Names are copied in, and stay valid for as long as the collector does,
+  // even after being taken out of it.
+  class Diagnostics
+  {
+  public:
+    explicit Diagnostics(const Warnings enabled = Warnings::All) noexcept : m_enabled(enabled) {}
+
+    bool IsEnabled(const Warnings kind) const noexcept
+    {
+      return (m_enabled & kind) != Warnings::None;
+    }
+    // Does nothing for kinds of warnings that are not enabled.
+    void Add(Warnings kind, std::size_t line_number, std::string_view symbol_name = {},
+             std::string_view compilation_unit_name = {}, std::string_view section_name = {});
+    // Takes everything another collector has, placing it after everything this one already has.
+    void Merge(Diagnostics&& other);
+
+    std::span<const Diagnostic> Get() const noexcept { return m_diagnostics; }
+    std::vector<Diagnostic> Take() noexcept { return std::exchange(m_diagnostics, {}); }
+    // Prints warnings one per line, worded as they once were when they were given on the spot.
+    static void Print(std::ostream& stream, std::span<const Diagnostic> diagnostics);
+
+  private:
+    std::vector<Diagnostic> m_diagnostics;
+    Mijo::StringPool m_names;
+    Warnings m_enabled;
   };
 
-  using UnresolvedSymbols = std::list<std::pair<std::size_t, std::string>>;
+  // What scanning one portion took. Pattern attempts are every line pattern tried, whether by
+  // std::regex or by the scanners standing in for it, and hits are how many of them matched.
+  // Allocations are only counted if the program reports them with Mijo::CountAllocation. Section
+  // layouts are told apart by their section name, which is empty for every other portion.
+  struct PortionProfile
+  {
+    Portions m_portion;
+    std::string_view m_section_name;
+    std::chrono::nanoseconds m_time;
+    std::size_t m_byte_count;
+    std::size_t m_line_count;
+    std::size_t m_pattern_attempt_count;
+    std::size_t m_pattern_hit_count;
+    std::size_t m_allocation_count;
+    std::size_t m_allocated_size;
+  };
 
+  // A profile of every portion scanned, in the order they appear in. Nothing is recorded unless the
+  // library is built with MWLINKERMAP_PROFILING, as measuring is not free.
+  class ScanProfile
+  {
+  public:
+#ifdef MWLINKERMAP_PROFILING
+    static constexpr bool is_enabled = true;
+#else
+    static constexpr bool is_enabled = false;
+#endif
+
+    void Add(const PortionProfile& portion_profile);
+    // Takes everything another profile has, placing it after everything this one already has.
+    void Merge(ScanProfile&& other);
+
+    std::span<const PortionProfile> Get() const noexcept { return m_portion_profiles; }
+    // Prints an array with an object for each portion, its time given in nanoseconds.
+    void PrintJson(std::ostream& stream) const;
+
+  private:
+    std::vector<PortionProfile> m_portion_profiles;
+    Mijo::StringPool m_names;
+  };
+
+  struct Options
+  {
+    // Where the names held by each portion's units are stored.
+    StringStorage m_string_storage = StringStorage::Arena;
+    // Scan with the original std::regex patterns instead of the hand-written and compile-time
+    // scanners. Both are meant to produce identical results, so this mostly exists to check that
+    // they still do.
+    bool m_use_regex_fallback = false;
+    // How many threads Scan and Print may use for portions that are independent of one another,
+    // such as section layouts. Zero means as many as the hardware can run at once. Warnings from
+    // portions scanned this way are merged back in the order they appear in the linker map, so
+    // both they and printed text come out the same as with a single thread.
+    unsigned m_thread_count = 1;
+    // Portions left out are skipped over as quickly as possible rather than scanned, and whatever
+    // errors they have go unnoticed. Version clues that can be picked up along the way still count
+    // toward GetMinVersion and GetMaxVersion. Unresolved symbols go with the symbol closures. Only
+    // Scan and ScanFile pay attention to this.
+    Portions m_portions = Portions::All;
+    // Symbol closures are often larger than everything else put together, yet plenty of uses for a
+    // Map never look at them. With this, Scan only looks them over, and each is scanned in full the
+    // first time it is asked for. See LazySymbolClosure. Only Scan and ScanFile pay attention to
+    // this.
+    bool m_lazy_symbol_closures = false;
+    // Only the warnings given here are ever collected. Unlike a process-wide setting, this can
+    // differ between Maps scanning at the same time.
+    Warnings m_warnings = Warnings::All;
+  };
+
+private:
+  // Each portion writes and reads its own part of a cache with these. See Map::SaveCache.
+  class CacheWriter;
+  class CacheReader;
+  // Every portion prints its own part of a linker map with this. See Map::Print.
+  class Printer;
+
+public:
   struct PortionBase
   {
     friend Map;
@@ -154,138 +352,306 @@ struct Map
     //  - Changed behavior of the source name when linking static libs
     //  - Added _ctors$99 and _dtors$99, among other things.
 
-    struct NodeBase
-    {
-      friend SymbolClosure;
+    // Nodes are stored flat and in the order they are printed, which is a preorder traversal of the
+    // tree. A node's subtree is the contiguous run of nodes between it and its subtree end, so e.g.
+    // everything a symbol pulls in can be visited without chasing a single pointer.
+    using NodeId = std::uint32_t;
+    static constexpr NodeId no_node = static_cast<NodeId>(-1);
 
-      explicit NodeBase() : m_parent(nullptr) {}  // Necessary for root node
-      explicit NodeBase(NodeBase* parent) : m_parent(parent) {}
-      virtual ~NodeBase() = default;
-
-      NodeBase(const NodeBase&) = delete;
-      NodeBase& operator=(const NodeBase&) = delete;
-      NodeBase(NodeBase&&) = default;
-      NodeBase& operator=(NodeBase&&) = default;
-
-      const NodeBase* GetParent() const { return m_parent; }
-      const std::list<std::unique_ptr<NodeBase>>& GetChildren() const { return m_children; }
-      static constexpr std::string_view ToName(Type st_type) noexcept;
-      static constexpr std::string_view ToName(Bind st_bind) noexcept;
-
-    private:
-      NodeBase* GetParent() { return m_parent; }
-      std::list<std::unique_ptr<NodeBase>>& GetChildren() { return m_children; }
-      virtual void Print(std::ostream& stream, int hierarchy_level,
-                         UnresolvedSymbols::const_iterator& unresolved_head,
-                         UnresolvedSymbols::const_iterator unresolved_tail,
-                         std::size_t& line_number) const;
-      static void PrintPrefix(std::ostream& stream, int hierarchy_level);
-
-      NodeBase* m_parent;
-      std::list<std::unique_ptr<NodeBase>> m_children;
+    enum class NodeKind : std::uint8_t
+    {
+      Real,
+      LinkerGenerated,
+      // Stands in for the hierarchy level that _dtors$99 mysteriously skips.
+      Dummy,
     };
 
-    struct NodeReal final : NodeBase
+    struct UnreferencedDuplicate
     {
-      struct UnreferencedDuplicate
+      friend SymbolClosure;
+
+      explicit UnreferencedDuplicate(Type type, Bind bind, std::string_view module_name,
+                                     std::string_view source_name)
+          : m_type(type), m_bind(bind), m_module_name(module_name), m_source_name(source_name)
       {
-        friend NodeReal;
+      }
 
-        explicit UnreferencedDuplicate(Type type, Bind bind, std::string_view module_name,
-                                       std::string_view source_name)
-            : m_type(type), m_bind(bind), m_module_name(module_name), m_source_name(source_name)
-        {
-        }
+      Type m_type;
+      Bind m_bind;
+      std::string_view m_module_name;
+      std::string_view m_source_name;
 
-        Type m_type;
-        Bind m_bind;
-        std::string m_module_name;
-        std::string m_source_name;
+    private:
+      void Print(Printer& printer, int hierarchy_level, std::size_t& line_number) const;
+    };
 
-      private:
-        void Print(std::ostream& stream, int hierarchy_level, std::size_t& line_number) const;
-      };
+    template <bool SkipSubtrees>
+    class NodeRange;
 
-      explicit NodeReal(NodeBase* parent, std::string_view name, Type type, Bind bind,
-                        std::string_view module_name, std::string_view source_name,
-                        std::list<UnreferencedDuplicate> unref_dups)
-          : NodeBase(parent), m_name(name), m_type(type), m_bind(bind), m_module_name(module_name),
-            m_source_name(source_name), m_unref_dups(std::move(unref_dups))
+    // A lightweight handle for navigating the tree. It is only valid for as long as the symbol
+    // closure it came from.
+    class Node
+    {
+    public:
+      explicit Node(const SymbolClosure& closure, NodeId id) noexcept
+          : m_closure(&closure), m_id(id)
       {
       }
-      virtual ~NodeReal() override = default;
 
-      std::string m_name;
-      Type m_type;
-      Bind m_bind;
+      const SymbolClosure& GetClosure() const noexcept { return *m_closure; }
+      NodeId GetId() const noexcept { return m_id; }
+      NodeKind GetKind() const noexcept { return m_closure->m_kinds[m_id]; }
+      int GetHierarchyLevel() const noexcept { return m_closure->m_hierarchy_levels[m_id]; }
+      // Module, source name, type, and bind only mean something for real nodes.
+      std::string_view GetName() const noexcept { return String(m_closure->m_name_ids); }
+      Type GetType() const noexcept { return m_closure->m_types[m_id]; }
+      Bind GetBind() const noexcept { return m_closure->m_binds[m_id]; }
       // Static library or object name
-      std::string m_module_name;
+      std::string_view GetModuleName() const noexcept { return String(m_closure->m_module_ids); }
       // When linking a static library, this is either:
       // A) The name of the STT_FILE symbol from the relevant object in the static library.
       // B) The name of the relevant object in the static library (as early as CW for GCN 2.7).
-      std::string m_source_name;
-      std::list<UnreferencedDuplicate> m_unref_dups;
+      std::string_view GetSourceName() const noexcept { return String(m_closure->m_source_ids); }
+      std::span<const UnreferencedDuplicate> GetUnreferencedDuplicates() const noexcept
+      {
+        const auto& begins = m_closure->m_unref_dup_begins;
+        return std::span{m_closure->m_unref_dups}.subspan(begins[m_id],
+                                                          begins[m_id + 1] - begins[m_id]);
+      }
+
+      // Top-level nodes have no parent.
+      std::optional<Node> GetParent() const noexcept
+      {
+        const NodeId parent = m_closure->m_parents[m_id];
+        if (parent == no_node)
+          return std::nullopt;
+        return Node{*m_closure, parent};
+      }
+      // What this node's symbol refers to directly.
+      NodeRange<true> GetChildren() const noexcept
+      {
+        return NodeRange<true>{*m_closure, m_id + 1, m_closure->m_subtree_ends[m_id]};
+      }
+      // Everything this node's symbol pulls in, directly or not, in preorder.
+      NodeRange<false> GetDescendants() const noexcept
+      {
+        return NodeRange<false>{*m_closure, m_id + 1, m_closure->m_subtree_ends[m_id]};
+      }
+
+      bool operator==(const Node& other) const noexcept = default;
 
     private:
-      virtual void Print(std::ostream& stream, int hierarchy_level,
-                         UnresolvedSymbols::const_iterator& unresolved_head,
-                         UnresolvedSymbols::const_iterator unresolved_tail,
-                         std::size_t& line_number) const override;
+      std::string_view String(const std::vector<std::uint32_t>& ids) const noexcept
+      {
+        return m_closure->m_strings[ids[m_id]];
+      }
+
+      const SymbolClosure* m_closure;
+      NodeId m_id;
     };
 
-    struct NodeLinkerGenerated final : NodeBase
+    // Either every node in a range one after another, or only those at the top of it by skipping
+    // over each one's subtree.
+    template <bool SkipSubtrees>
+    class NodeRange
     {
-      explicit NodeLinkerGenerated(NodeBase* parent, std::string_view name)
-          : NodeBase(parent), m_name(name)
+    public:
+      class Iterator
+      {
+      public:
+        using value_type = Node;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        explicit Iterator(const SymbolClosure& closure, NodeId id) noexcept
+            : m_closure(&closure), m_id(id)
+        {
+        }
+
+        Node operator*() const noexcept { return Node{*m_closure, m_id}; }
+        Iterator& operator++() noexcept
+        {
+          m_id = SkipSubtrees ? m_closure->m_subtree_ends[m_id] : m_id + 1;
+          return *this;
+        }
+        Iterator operator++(int) noexcept
+        {
+          const Iterator old = *this;
+          ++*this;
+          return old;
+        }
+        bool operator==(const Iterator& other) const noexcept { return m_id == other.m_id; }
+
+      private:
+        const SymbolClosure* m_closure = nullptr;
+        NodeId m_id = 0;
+      };
+
+      explicit NodeRange(const SymbolClosure& closure, NodeId first, NodeId last) noexcept
+          : m_closure(&closure), m_first(first), m_last(last)
       {
       }
-      virtual ~NodeLinkerGenerated() override = default;
 
-      std::string m_name;
+      Iterator begin() const noexcept { return Iterator{*m_closure, m_first}; }
+      Iterator end() const noexcept { return Iterator{*m_closure, m_last}; }
+      bool empty() const noexcept { return m_first == m_last; }
 
     private:
-      virtual void Print(std::ostream& stream, int hierarchy_level,
-                         UnresolvedSymbols::const_iterator& unresolved_head,
-                         UnresolvedSymbols::const_iterator unresolved_tail,
-                         std::size_t& line_number) const override;
+      const SymbolClosure* m_closure;
+      NodeId m_first;
+      NodeId m_last;
     };
 
-    using NodeLookup = std::unordered_multimap<std::string_view, const NodeReal&>;
-    using ModuleLookup = std::unordered_map<std::string_view, NodeLookup>;
+    using NodeLookup = Mijo::FlatHashMultiMap<std::string_view, NodeId>;
+    using ModuleLookup = Mijo::FlatHashMap<std::string_view, NodeLookup>;
 
-    inline bool IsEmpty() const noexcept { return m_root.m_children.empty(); }
+    inline bool IsEmpty() const noexcept { return m_kinds.empty(); }
     const ModuleLookup& GetModuleLookup() { return m_lookup; }
 
-    struct Warn
+    std::size_t GetNodeCount() const noexcept { return m_kinds.size(); }
+    Node GetNode(NodeId id) const noexcept { return Node{*this, id}; }
+    // The nodes at hierarchy level 1.
+    NodeRange<true> GetRoots() const noexcept
     {
-      friend SymbolClosure;
+      return NodeRange<true>{*this, 0, static_cast<NodeId>(m_kinds.size())};
+    }
+    // Every node, in preorder.
+    NodeRange<false> GetNodes() const noexcept
+    {
+      return NodeRange<false>{*this, 0, static_cast<NodeId>(m_kinds.size())};
+    }
 
-      static void DisableAll() noexcept
-      {
-        do_warn_odr_violation = false;
-        do_warn_sym_on_flag_detected = false;
-      }
+    static constexpr std::string_view ToName(Type st_type) noexcept;
+    static constexpr std::string_view ToName(Bind st_bind) noexcept;
 
-      static bool do_warn_odr_violation;
-      static bool do_warn_sym_on_flag_detected;
+    struct Warn
+    {
+      friend SymbolClosure;
 
     private:
-      static void OneDefinitionRuleViolation(std::size_t line_number, std::string_view symbol_name,
+      static void OneDefinitionRuleViolation(Diagnostics& diagnostics, std::size_t line_number,
+                                             std::string_view symbol_name,
                                              std::string_view compilation_unit_name);
-      static void SymOnFlagDetected(std::size_t line_number,
+      static void SymOnFlagDetected(Diagnostics& diagnostics, std::size_t line_number,
                                     std::string_view compilation_unit_name);
     };
 
   private:
+    // What a chunk of a symbol closure scanned on its own leaves behind for when it is appended.
+    struct ChunkInfo
+    {
+      // The line number of every node.
+      std::vector<std::size_t> m_line_numbers;
+      // Nodes whose names were already seen earlier in the chunk and in the same compilation unit.
+      std::vector<NodeId> m_odr_violations;
+    };
+    // Line numbers and the nodes found on them.
+    using OdrViolations = std::vector<std::pair<std::size_t, NodeId>>;
+    using StringIds = Mijo::FlatHashMap<std::string_view, std::uint32_t>;
+    // Where scanning left off, so a symbol closure can be scanned a piece at a time. Subtrees are
+    // left open between pieces, and it is up to the caller to close them once the last one is in.
+    struct ScanState
+    {
+      // The nodes on the path to the most recently added one, one for each hierarchy level.
+      std::vector<NodeId> m_ancestors;
+      StringIds m_string_ids;
+      int m_curr_hierarchy_level = 0;
+    };
+    // The sink ScanNodes builds the tree with. Map::Visit scans with a sink of its own.
+    struct NodeBuilder;
+
     ScanError Scan(const char*& head, const char* tail, std::size_t& line_number,
-                   UnresolvedSymbols& unresolved_symbols);
-    void Print(std::ostream& stream, UnresolvedSymbols::const_iterator& unresolved_head,
+                   UnresolvedSymbols& unresolved_symbols, const Options& options,
+                   Mijo::StringPool& string_pool, Diagnostics& diagnostics);
+    ScanError ScanSerial(const char*& head, const char* tail, std::size_t& line_number,
+                         UnresolvedSymbols& unresolved_symbols, const Options& options,
+                         Mijo::StringPool& string_pool, Diagnostics& diagnostics);
+    ScanError ScanNodes(const char*& head, const char* tail, std::size_t& line_number,
+                        UnresolvedSymbols& unresolved_symbols, const Options& options,
+                        Mijo::StringPool& string_pool, Diagnostics& diagnostics,
+                        ScanState& state, ChunkInfo* chunk_info);
+    ScanError ScanParallel(const char*& head, const char* tail, std::size_t& line_number,
+                           UnresolvedSymbols& unresolved_symbols, const Options& options,
+                           Mijo::StringPool& string_pool, Diagnostics& diagnostics);
+    void Append(SymbolClosure&& chunk, const ChunkInfo& chunk_info, OdrViolations& odr_violations);
+    void Print(Printer& printer, UnresolvedSymbols::const_iterator& unresolved_head,
                UnresolvedSymbols::const_iterator unresolved_tail, std::size_t& line_number) const;
-
-    NodeBase m_root;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
+
+    NodeId AddNode(std::vector<NodeId>& ancestors, int hierarchy_level, NodeKind kind,
+                   std::uint32_t name_id, Type type, Bind bind, std::uint32_t module_id,
+                   std::uint32_t source_id);
+    void CloseSubtrees(std::vector<NodeId>& ancestors, std::size_t hierarchy_level) noexcept;
+    std::uint32_t AddString(std::string_view str);
+    std::uint32_t AddString(std::string_view str, StringIds& string_ids);
+    static void PrintPrefix(Printer& printer, int hierarchy_level);
+
+    std::vector<int> m_hierarchy_levels;
+    std::vector<NodeKind> m_kinds;
+    std::vector<std::uint32_t> m_name_ids;
+    std::vector<Type> m_types;
+    std::vector<Bind> m_binds;
+    std::vector<std::uint32_t> m_module_ids;
+    std::vector<std::uint32_t> m_source_ids;
+    std::vector<NodeId> m_parents;
+    // One past the last node of each node's subtree.
+    std::vector<NodeId> m_subtree_ends;
+    // The unreferenced duplicates of node i are [m_unref_dup_begins[i], m_unref_dup_begins[i + 1]).
+    std::vector<std::uint32_t> m_unref_dup_begins{0};
+    std::vector<UnreferencedDuplicate> m_unref_dups;
+    // The first string is always the empty one, for nodes without a name, module, or source.
+    std::vector<std::string_view> m_strings{std::string_view{}};
     ModuleLookup m_lookup;
   };
 
+  // A symbol closure that Scan has only looked over, which is enough to know where it ends, where
+  // each of its roots begins, and what unresolved symbols are printed along with it. Its text is
+  // kept so that it can be scanned in full the first time it is asked for, or a root's subtree can
+  // be scanned on its own without ever touching the rest.
+  struct LazySymbolClosure final : PortionBase
+  {
+    friend Map;
+
+    // Where a node at hierarchy level 1 begins.
+    struct Root
+    {
+      std::size_t m_offset;
+      std::size_t m_line_number;
+    };
+
+    std::string_view GetText() const noexcept { return m_text; }
+    std::size_t GetLineNumber() const noexcept { return m_line_number; }
+    std::span<const Root> GetRoots() const noexcept { return m_roots; }
+    // The first of these to be called scans the whole symbol closure. Anything wrong with it that
+    // looking it over did not catch leaves it empty, with the error saying why. Warnings given
+    // along the way are kept here rather than with those of the Map.
+    const std::optional<SymbolClosure>& Get() const { return GetScanned().m_symbol_closure; }
+    ScanError GetScanError() const { return GetScanned().m_error; }
+    const Diagnostics& GetDiagnostics() const { return GetScanned().m_diagnostics; }
+    // Scans the subtree of one root into a symbol closure of its own, whether or not the whole one
+    // has been scanned.
+    ScanError ScanRoot(std::size_t index, SymbolClosure& symbol_closure,
+                       Diagnostics& diagnostics) const;
+
+  private:
+    struct Scanned
+    {
+      std::optional<SymbolClosure> m_symbol_closure;
+      ScanError m_error;
+      Diagnostics m_diagnostics;
+    };
+
+    const Scanned& GetScanned() const;
+
+    Options m_options;
+    bool m_is_dwarf = false;
+    std::string_view m_text;
+    std::size_t m_line_number = 0;
+    std::vector<Root> m_roots;
+    Mijo::LazyValue<Scanned> m_scanned;
+  };
+
   struct EPPC_PatternMatching final : PortionBase
   {
     friend Map;
@@ -304,8 +670,8 @@ struct Map
       {
       }
 
-      std::string m_first_name;
-      std::string m_second_name;
+      std::string_view m_first_name;
+      std::string_view m_second_name;
       Elf32_Word m_size;
       // If the conditions are right (e.g. the function is more than just a BLR instruction), then
       // one function is replaced with a branch to the other function, saving space at the cost of a
@@ -317,7 +683,7 @@ struct Map
       bool m_was_interchanged;
 
     private:
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
     };
 
     struct FoldingUnit
@@ -335,31 +701,31 @@ struct Map
         {
         }
 
-        std::string m_first_name;
-        std::string m_second_name;
+        std::string_view m_first_name;
+        std::string_view m_second_name;
         Elf32_Word m_size;
         bool m_new_branch_function;
 
       private:
-        void Print(std::ostream& stream, std::size_t& line_number) const;
+        void Print(Printer& printer, std::size_t& line_number) const;
       };
 
-      using UnitLookup = std::unordered_multimap<std::string_view, const Unit&>;
-      using ModuleLookup = std::unordered_map<std::string_view, UnitLookup>;
+      using UnitLookup = Mijo::FlatHashMultiMap<std::string_view, const Unit&>;
+      using ModuleLookup = Mijo::FlatHashMap<std::string_view, UnitLookup>;
 
       explicit FoldingUnit(std::string_view object_name) : m_object_name(object_name) {}
 
-      const std::list<Unit>& GetUnits() { return m_units; }
+      const std::deque<Unit>& GetUnits() const noexcept { return m_units; }
 
-      std::string m_object_name;
+      std::string_view m_object_name;
 
     private:
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
 
-      std::list<Unit> m_units;
+      std::deque<Unit> m_units;
     };
 
-    using MergingUnitLookup = std::unordered_multimap<std::string_view, const MergingUnit&>;
+    using MergingUnitLookup = Mijo::FlatHashMultiMap<std::string_view, const MergingUnit&>;
 
     explicit EPPC_PatternMatching() noexcept
     {
@@ -370,8 +736,8 @@ struct Map
     {
       return m_merging_units.empty() || m_folding_units.empty();
     }
-    const std::list<MergingUnit>& GetMergingUnits() { return m_merging_units; }
-    const std::list<FoldingUnit>& GetFoldingUnits() { return m_folding_units; }
+    const std::deque<MergingUnit>& GetMergingUnits() { return m_merging_units; }
+    const std::deque<FoldingUnit>& GetFoldingUnits() { return m_folding_units; }
     const MergingUnitLookup& GetMergingLookup() { return m_merging_lookup; }
     const FoldingUnit::ModuleLookup& GetFoldingModuleLookup() { return m_folding_lookup; }
 
@@ -379,32 +745,27 @@ struct Map
     {
       friend EPPC_PatternMatching;
 
-      static void DisableAll() noexcept
-      {
-        do_warn_merging_odr_violation = false;
-        do_warn_folding_repeat_object = false;
-        do_warn_folding_odr_violation = false;
-      }
-
-      static bool do_warn_merging_odr_violation;
-      static bool do_warn_folding_repeat_object;
-      static bool do_warn_folding_odr_violation;
-
     private:
-      static void MergingOneDefinitionRuleViolation(std::size_t line_number,
+      static void MergingOneDefinitionRuleViolation(Diagnostics& diagnostics,
+                                                    std::size_t line_number,
                                                     std::string_view symbol_name);
-      static void FoldingRepeatObject(std::size_t line_number, std::string_view object_name);
-      static void FoldingOneDefinitionRuleViolation(std::size_t line_number,
+      static void FoldingRepeatObject(Diagnostics& diagnostics, std::size_t line_number,
+                                      std::string_view object_name);
+      static void FoldingOneDefinitionRuleViolation(Diagnostics& diagnostics,
+                                                    std::size_t line_number,
                                                     std::string_view symbol_name,
                                                     std::string_view object_name);
     };
 
   private:
-    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number,
+                   Mijo::StringPool& string_pool, Diagnostics& diagnostics);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
 
-    std::list<MergingUnit> m_merging_units;
-    std::list<FoldingUnit> m_folding_units;
+    std::deque<MergingUnit> m_merging_units;
+    std::deque<FoldingUnit> m_folding_units;
     MergingUnitLookup m_merging_lookup;
     FoldingUnit::ModuleLookup m_folding_lookup;
   };
@@ -440,12 +801,12 @@ struct Map
       }
 
       Kind m_unit_kind;
-      std::string m_module_name;
-      std::string m_name;
-      std::string m_reference_name;
+      std::string_view m_module_name;
+      std::string_view m_name;
+      std::string_view m_reference_name;
 
     private:
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
     };
 
     explicit LinkerOpts() noexcept
@@ -454,13 +815,16 @@ struct Map
     }
 
     inline bool IsEmpty() const noexcept { return m_units.empty(); }
-    const std::list<Unit>& GetUnits() { return m_units; }
+    const std::vector<Unit>& GetUnits() { return m_units; }
 
   private:
-    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number,
+                   Mijo::StringPool& string_pool);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
 
-    std::list<Unit> m_units;
+    std::vector<Unit> m_units;
   };
 
   struct BranchIslands final : PortionBase
@@ -479,12 +843,12 @@ struct Map
       {
       }
 
-      std::string m_first_name;
-      std::string m_second_name;
+      std::string_view m_first_name;
+      std::string_view m_second_name;
       bool m_is_safe;
 
     private:
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
     };
 
     explicit BranchIslands() noexcept
@@ -493,13 +857,16 @@ struct Map
     }
 
     inline bool IsEmpty() const noexcept { return m_units.empty(); }
-    const std::list<Unit>& GetUnits() { return m_units; }
+    const std::vector<Unit>& GetUnits() { return m_units; }
 
   private:
-    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number,
+                   Mijo::StringPool& string_pool);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
 
-    std::list<Unit> m_units;
+    std::vector<Unit> m_units;
   };
 
   struct MixedModeIslands final : PortionBase
@@ -518,12 +885,12 @@ struct Map
       {
       }
 
-      std::string m_first_name;
-      std::string m_second_name;
+      std::string_view m_first_name;
+      std::string_view m_second_name;
       bool m_is_safe;
 
     private:
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
     };
 
     explicit MixedModeIslands() noexcept
@@ -532,13 +899,16 @@ struct Map
     }
 
     inline bool IsEmpty() const noexcept { return m_units.empty(); }
-    const std::list<Unit>& GetUnits() { return m_units; }
+    const std::vector<Unit>& GetUnits() { return m_units; }
 
   private:
-    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number,
+                   Mijo::StringPool& string_pool);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
 
-    std::list<Unit> m_units;
+    std::vector<Unit> m_units;
   };
 
   struct LinktimeSizeDecreasingOptimizations final : PortionBase
@@ -547,7 +917,10 @@ struct Map
 
   private:
     ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    void Print(Printer& printer, std::size_t& line_number) const;
+    // There is nothing to these besides their version range.
+    void SaveCache(CacheWriter&) const {}
+    void LoadCache(CacheReader&) {}
   };
 
   struct LinktimeSizeIncreasingOptimizations final : PortionBase
@@ -556,7 +929,10 @@ struct Map
 
   private:
     ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    void Print(Printer& printer, std::size_t& line_number) const;
+    // There is nothing to these besides their version range.
+    void SaveCache(CacheWriter&) const {}
+    void LoadCache(CacheReader&) {}
   };
 
   struct SectionLayout final : PortionBase
@@ -586,12 +962,13 @@ struct Map
 
     struct Unit;
 
-    using UnitLookup = std::unordered_multimap<std::string_view, const Unit&>;
-    using ModuleLookup = std::unordered_map<std::string_view, UnitLookup>;
+    using UnitLookup = Mijo::FlatHashMultiMap<std::string_view, const Unit&>;
+    using ModuleLookup = Mijo::FlatHashMap<std::string_view, UnitLookup>;
 
   private:
     struct ScanningContext
     {
+      Diagnostics& m_diagnostics;
       SectionLayout& m_section_layout;
       std::size_t& m_line_number;
       // BSS: now in common symbols
@@ -654,17 +1031,7 @@ struct Map
             m_unit_trait(DeduceUsualSubtext(scanning_context))
       {
       }
-      // 3-column normal symbols
-      explicit Unit(std::uint32_t starting_address, Elf32_Word size, Elf32_Addr virtual_address,
-                    int alignment, std::string_view name, std::string_view module_name,
-                    std::string_view source_name, ScanningContext& scanning_context)
-          : m_unit_kind(Kind::Normal), m_starting_address(starting_address), m_size(size),
-            m_virtual_address(virtual_address), m_file_offset{}, m_alignment(alignment),
-            m_name(name), m_entry_parent(nullptr), m_module_name(module_name),
-            m_source_name(source_name), m_unit_trait(DeduceUsualSubtext(scanning_context))
-      {
-      }
-      // 4-column normal symbols
+      // Normal symbols. 3-column ones have a file offset of zero.
       explicit Unit(std::uint32_t starting_address, Elf32_Word size, Elf32_Addr virtual_address,
                     std::uint32_t file_offset, int alignment, std::string_view name,
                     std::string_view module_name, std::string_view source_name,
@@ -675,17 +1042,7 @@ struct Map
             m_source_name(source_name), m_unit_trait(DeduceUsualSubtext(scanning_context))
       {
       }
-      // 3-column entry symbols
-      explicit Unit(std::uint32_t starting_address, Elf32_Word size, Elf32_Addr virtual_address,
-                    std::string_view name, const Unit* entry_parent, std::string_view module_name,
-                    std::string_view source_name, ScanningContext& scanning_context)
-          : m_unit_kind(Kind::Entry), m_starting_address(starting_address), m_size(size),
-            m_virtual_address(virtual_address), m_file_offset{}, m_alignment{}, m_name(name),
-            m_entry_parent(entry_parent), m_module_name(module_name), m_source_name(source_name),
-            m_unit_trait(DeduceEntrySubtext(scanning_context))
-      {
-      }
-      // 4-column entry symbols
+      // Entry symbols. 3-column ones have a file offset of zero.
       explicit Unit(std::uint32_t starting_address, Elf32_Word size, Elf32_Addr virtual_address,
                     std::uint32_t file_offset, std::string_view name, const Unit* entry_parent,
                     std::string_view module_name, std::string_view source_name,
@@ -696,7 +1053,7 @@ struct Map
             m_source_name(source_name), m_unit_trait(DeduceEntrySubtext(scanning_context))
       {
       }
-      // 4-column special symbols
+      // Special symbols. 3-column ones have a file offset of zero.
       explicit Unit(std::uint32_t starting_address, Elf32_Word size, Elf32_Addr virtual_address,
                     std::uint32_t file_offset, int alignment, Trait unit_trait)
           : m_unit_kind(Kind::Special), m_starting_address(starting_address), m_size(size),
@@ -705,8 +1062,8 @@ struct Map
       {
       }
 
-      const Unit* GetEntryParent() { return m_entry_parent; }
-      const std::list<const Unit*>& GetEntryChildren() { return m_entry_children; }
+      const Unit* GetEntryParent() const noexcept { return m_entry_parent; }
+      const std::vector<const Unit*>& GetEntryChildren() const noexcept { return m_entry_children; }
       static constexpr std::string_view ToSpecialName(Trait unit_trait);
 
       Kind m_unit_kind;
@@ -715,26 +1072,26 @@ struct Map
       Elf32_Addr m_virtual_address;
       std::uint32_t m_file_offset;
       int m_alignment;
-      std::string m_name;
+      std::string_view m_name;
 
     private:
       // Doubly-linked relationship between entry symbols and their host.
       const Unit* m_entry_parent;
       // Doubly-linked relationship between entry symbols and their host.
-      std::list<const Unit*> m_entry_children;
+      std::vector<const Unit*> m_entry_children;
 
     public:
       // Static library or object name
-      std::string m_module_name;
+      std::string_view m_module_name;
       // When linking a static library, this is either:
       // A) The name of the STT_FILE symbol from the relevant object in the static library.
       // B) The name of the relevant object in the static library (as early as CW for GCN 2.7).
-      std::string m_source_name;
+      std::string_view m_source_name;
       Trait m_unit_trait;
 
     private:
-      void Print3Column(std::ostream& stream, std::size_t& line_number) const;
-      void Print4Column(std::ostream& stream, std::size_t& line_number) const;
+      void Print3Column(Printer& printer, std::size_t& line_number) const;
+      void Print4Column(Printer& printer, std::size_t& line_number) const;
       Unit::Trait DeduceUsualSubtext(ScanningContext& scanning_context);
       Unit::Trait DeduceEntrySubtext(ScanningContext& scanning_context);
     };
@@ -745,54 +1102,59 @@ struct Map
     }
 
     inline bool IsEmpty() const noexcept { return m_units.empty(); }
-    const std::list<Unit>& GetUnits() const noexcept { return m_units; }
+    const std::deque<Unit>& GetUnits() const noexcept { return m_units; }
     const ModuleLookup& GetModuleLookup() const noexcept { return m_lookup; }
     static Kind ToSectionKind(std::string_view section_name);
 
     Kind m_section_kind;
-    std::string m_name;
+    std::string_view m_name;
 
     struct Warn
     {
       friend SectionLayout;
 
-      static void DisableAll() noexcept
-      {
-        do_warn_repeat_compilation_unit = false;
-        do_warn_odr_violation = false;
-        do_warn_sym_on_flag_detected = false;
-        do_warn_common_on_flag_detected = false;
-        do_warn_lcomm_after_comm = false;
-      }
-
-      static bool do_warn_repeat_compilation_unit;
-      static bool do_warn_odr_violation;
-      static bool do_warn_sym_on_flag_detected;
-      static bool do_warn_common_on_flag_detected;
-      static bool do_warn_lcomm_after_comm;
-
     private:
-      static void RepeatCompilationUnit(std::size_t line_number,
+      static void RepeatCompilationUnit(Diagnostics& diagnostics, std::size_t line_number,
                                         std::string_view compilation_unit_name,
                                         std::string_view section_name);
-      static void OneDefinitionRuleViolation(std::size_t line_number, std::string_view symbol_name,
+      static void OneDefinitionRuleViolation(Diagnostics& diagnostics, std::size_t line_number,
+                                             std::string_view symbol_name,
                                              std::string_view compilation_unit_name,
                                              std::string_view section_name);
-      static void SymOnFlagDetected(std::size_t line_number, std::string_view compilation_unit_name,
+      static void SymOnFlagDetected(Diagnostics& diagnostics, std::size_t line_number,
+                                    std::string_view compilation_unit_name,
                                     std::string_view section_name);
-      static void CommonOnFlagDetected(std::size_t line_number,
+      static void CommonOnFlagDetected(Diagnostics& diagnostics, std::size_t line_number,
                                        std::string_view compilation_unit_name,
                                        std::string_view section_name);
-      static void LCommAfterComm(std::size_t line_number);
+      static void LCommAfterComm(Diagnostics& diagnostics, std::size_t line_number);
     };
 
   private:
-    ScanError Scan3Column(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError Scan4Column(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanTLOZTP(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
-
-    std::list<Unit> m_units;
+    // The sink Scan3Column and Scan4Column build the units with. Map::Visit scans with a sink of
+    // its own.
+    struct UnitBuilder;
+
+    ScanError Scan3Column(const char*& head, const char* tail, std::size_t& line_number,
+                          const Options& options, Mijo::StringPool& string_pool,
+                          Diagnostics& diagnostics);
+    ScanError Scan3Column(const char*& head, const char* tail, std::size_t& line_number,
+                          const Options& options, Mijo::StringPool& string_pool,
+                          ScanningContext& scanning_context);
+    ScanError Scan4Column(const char*& head, const char* tail, std::size_t& line_number,
+                          const Options& options, Mijo::StringPool& string_pool,
+                          Diagnostics& diagnostics);
+    ScanError Scan4Column(const char*& head, const char* tail, std::size_t& line_number,
+                          const Options& options, Mijo::StringPool& string_pool,
+                          ScanningContext& scanning_context);
+    ScanError ScanTLOZTP(const char*& head, const char* tail, std::size_t& line_number,
+                         const Options& options, Mijo::StringPool& string_pool,
+                         Diagnostics& diagnostics);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
+
+    std::deque<Unit> m_units;
     ModuleLookup m_lookup;
   };
 
@@ -880,7 +1242,7 @@ struct Map
       {
       }
 
-      std::string m_name;
+      std::string_view m_name;
       Elf32_Addr m_starting_address;
       Elf32_Word m_size;
       std::uint32_t m_file_offset;
@@ -888,19 +1250,19 @@ struct Map
       std::uint32_t m_ram_buffer_address;
       int m_srecord_line;
       std::uint32_t m_bin_file_offset;
-      std::string m_bin_file_name;
+      std::string_view m_bin_file_name;
 
     private:
-      void PrintSimple_old(std::ostream& stream, std::size_t& line_number) const;
-      void PrintRomRam_old(std::ostream& stream, std::size_t& line_number) const;
-      void PrintSimple(std::ostream& stream, std::size_t& line_number) const;
-      void PrintRomRam(std::ostream& stream, std::size_t& line_number) const;
-      void PrintSRecord(std::ostream& stream, std::size_t& line_number) const;
-      void PrintBinFile(std::ostream& stream, std::size_t& line_number) const;
-      void PrintRomRamSRecord(std::ostream& stream, std::size_t& line_number) const;
-      void PrintRomRamBinFile(std::ostream& stream, std::size_t& line_number) const;
-      void PrintSRecordBinFile(std::ostream& stream, std::size_t& line_number) const;
-      void PrintRomRamSRecordBinFile(std::ostream& stream, std::size_t& line_number) const;
+      void PrintSimple_old(Printer& printer, std::size_t& line_number) const;
+      void PrintRomRam_old(Printer& printer, std::size_t& line_number) const;
+      void PrintSimple(Printer& printer, std::size_t& line_number) const;
+      void PrintRomRam(Printer& printer, std::size_t& line_number) const;
+      void PrintSRecord(Printer& printer, std::size_t& line_number) const;
+      void PrintBinFile(Printer& printer, std::size_t& line_number) const;
+      void PrintRomRamSRecord(Printer& printer, std::size_t& line_number) const;
+      void PrintRomRamBinFile(Printer& printer, std::size_t& line_number) const;
+      void PrintSRecordBinFile(Printer& printer, std::size_t& line_number) const;
+      void PrintRomRamSRecordBinFile(Printer& printer, std::size_t& line_number) const;
     };
 
     struct UnitDebug
@@ -912,14 +1274,14 @@ struct Map
       {
       }
 
-      std::string m_name;
+      std::string_view m_name;
       Elf32_Word m_size;
       std::uint32_t m_file_offset;
 
     private:
-      void Print_older(std::ostream& stream, std::size_t& line_number) const;
-      void Print_old(std::ostream& stream, std::size_t& line_number) const;
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print_older(Printer& printer, std::size_t& line_number) const;
+      void Print_old(Printer& printer, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
     };
 
     explicit MemoryMap(bool has_rom_ram)  // ctor for old memory map
@@ -934,43 +1296,57 @@ struct Map
     }
 
     inline bool IsEmpty() const noexcept { return m_normal_units.empty() || m_debug_units.empty(); }
-    const std::list<UnitNormal>& GetNormalUnits() const noexcept { return m_normal_units; }
-    const std::list<UnitDebug>& GetDebugUnits() const noexcept { return m_debug_units; }
+    const std::vector<UnitNormal>& GetNormalUnits() const noexcept { return m_normal_units; }
+    const std::vector<UnitDebug>& GetDebugUnits() const noexcept { return m_debug_units; }
 
     bool m_has_rom_ram;   // Enabled by '-romaddr addr' and '-rambuffer addr' options
     bool m_has_s_record;  // Enabled by '-srec [filename]' option
     bool m_has_bin_file;  // Enabled by '-genbinary keyword' option
 
   private:
-    ScanError ScanSimple_old(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanRomRam_old(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanDebug_old(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanSimple(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanRomRam(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanSRecord(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanBinFile(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanRomRamSRecord(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanRomRamBinFile(const char*& head, const char* tail, std::size_t& line_number);
-    ScanError ScanSRecordBinFile(const char*& head, const char* tail, std::size_t& line_number);
+    ScanError ScanSimple_old(const char*& head, const char* tail, std::size_t& line_number,
+                             const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanRomRam_old(const char*& head, const char* tail, std::size_t& line_number,
+                             const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanDebug_old(const char*& head, const char* tail, std::size_t& line_number,
+                            const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanSimple(const char*& head, const char* tail, std::size_t& line_number,
+                         const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanRomRam(const char*& head, const char* tail, std::size_t& line_number,
+                         const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanSRecord(const char*& head, const char* tail, std::size_t& line_number,
+                          const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanBinFile(const char*& head, const char* tail, std::size_t& line_number,
+                          const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanRomRamSRecord(const char*& head, const char* tail, std::size_t& line_number,
+                                const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanRomRamBinFile(const char*& head, const char* tail, std::size_t& line_number,
+                                const Options& options, Mijo::StringPool& string_pool);
+    ScanError ScanSRecordBinFile(const char*& head, const char* tail, std::size_t& line_number,
+                                 const Options& options, Mijo::StringPool& string_pool);
     ScanError ScanRomRamSRecordBinFile(const char*& head, const char* tail,
-                                       std::size_t& line_number);
-    ScanError ScanDebug(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
-    void PrintSimple_old(std::ostream& stream, std::size_t& line_number) const;
-    void PrintRomRam_old(std::ostream& stream, std::size_t& line_number) const;
-    void PrintDebug_old(std::ostream& stream, std::size_t& line_number) const;
-    void PrintSimple(std::ostream& stream, std::size_t& line_number) const;
-    void PrintRomRam(std::ostream& stream, std::size_t& line_number) const;
-    void PrintSRecord(std::ostream& stream, std::size_t& line_number) const;
-    void PrintBinFile(std::ostream& stream, std::size_t& line_number) const;
-    void PrintRomRamSRecord(std::ostream& stream, std::size_t& line_number) const;
-    void PrintRomRamBinFile(std::ostream& stream, std::size_t& line_number) const;
-    void PrintSRecordBinFile(std::ostream& stream, std::size_t& line_number) const;
-    void PrintRomRamSRecordBinFile(std::ostream& stream, std::size_t& line_number) const;
-    void PrintDebug(std::ostream& stream, std::size_t& line_number) const;
-
-    std::list<UnitNormal> m_normal_units;
-    std::list<UnitDebug> m_debug_units;
+                                       std::size_t& line_number, const Options& options,
+                                       Mijo::StringPool& string_pool);
+    ScanError ScanDebug(const char*& head, const char* tail, std::size_t& line_number,
+                        const Options& options, Mijo::StringPool& string_pool);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void PrintSimple_old(Printer& printer, std::size_t& line_number) const;
+    void PrintRomRam_old(Printer& printer, std::size_t& line_number) const;
+    void PrintDebug_old(Printer& printer, std::size_t& line_number) const;
+    void PrintSimple(Printer& printer, std::size_t& line_number) const;
+    void PrintRomRam(Printer& printer, std::size_t& line_number) const;
+    void PrintSRecord(Printer& printer, std::size_t& line_number) const;
+    void PrintBinFile(Printer& printer, std::size_t& line_number) const;
+    void PrintRomRamSRecord(Printer& printer, std::size_t& line_number) const;
+    void PrintRomRamBinFile(Printer& printer, std::size_t& line_number) const;
+    void PrintSRecordBinFile(Printer& printer, std::size_t& line_number) const;
+    void PrintRomRamSRecordBinFile(Printer& printer, std::size_t& line_number) const;
+    void PrintDebug(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
+
+    std::vector<UnitNormal> m_normal_units;
+    std::vector<UnitDebug> m_debug_units;
   };
 
   struct LinkerGeneratedSymbols final : PortionBase
@@ -983,36 +1359,177 @@ struct Map
 
       explicit Unit(std::string_view name, Elf32_Addr value) : m_name(name), m_value(value) {}
 
-      std::string m_name;
+      std::string_view m_name;
       Elf32_Addr m_value;
 
     private:
-      void Print(std::ostream& stream, std::size_t& line_number) const;
+      void Print(Printer& printer, std::size_t& line_number) const;
     };
 
     inline bool IsEmpty() const noexcept { return m_units.empty(); }
-    const std::list<Unit>& GetUnits() const noexcept { return m_units; }
+    const std::vector<Unit>& GetUnits() const noexcept { return m_units; }
 
   private:
-    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number);
-    void Print(std::ostream& stream, std::size_t& line_number) const;
+    ScanError Scan(const char*& head, const char* tail, std::size_t& line_number,
+                   const Options& options, Mijo::StringPool& string_pool);
+    void Print(Printer& printer, std::size_t& line_number) const;
+    void SaveCache(CacheWriter& writer) const;
+    void LoadCache(CacheReader& reader);
+
+    std::vector<Unit> m_units;
+  };
+
+  // Receives what Map::Visit comes across, in the order it appears in the linker map. Views point
+  // into the text being scanned, while everything else only lasts for the duration of the call.
+  class Visitor
+  {
+  public:
+    struct ClosureNode
+    {
+      std::size_t m_line_number;
+      // Whether this node belongs to the DWARF symbol closure.
+      bool m_is_dwarf;
+      // Either Real or LinkerGenerated. Linker generated symbols have no type, bind, or names.
+      SymbolClosure::NodeKind m_kind;
+      int m_hierarchy_level;
+      std::string_view m_name;
+      Type m_type;
+      Bind m_bind;
+      std::string_view m_module_name;
+      std::string_view m_source_name;
+      std::span<const SymbolClosure::UnreferencedDuplicate> m_unreferenced_duplicates;
+    };
+
+    struct SectionLayoutUnit
+    {
+      std::size_t m_line_number;
+      std::string_view m_section_name;
+      SectionLayout::Kind m_section_kind;
+      SectionLayout::Unit::Kind m_unit_kind;
+      std::uint32_t m_starting_address;
+      Elf32_Word m_size;
+      Elf32_Addr m_virtual_address;
+      std::uint32_t m_file_offset;
+      int m_alignment;
+      std::string_view m_name;
+      // Only given for entry symbols.
+      std::string_view m_entry_parent_name;
+      std::string_view m_module_name;
+      std::string_view m_source_name;
+      // Only given for special symbols, which are either Fill1 or Fill2.
+      SectionLayout::Unit::Trait m_unit_trait;
+    };
 
-    std::list<Unit> m_units;
+    virtual ~Visitor() = default;
+
+    virtual void OnClosureNode(const ClosureNode&) {}
+    virtual void OnUnresolvedSymbol(std::size_t, std::string_view) {}
+    virtual void OnSectionLayoutUnit(const SectionLayoutUnit&) {}
+    virtual void OnMemoryMapUnit(const MemoryMap::UnitNormal&) {}
+    virtual void OnMemoryMapUnit(const MemoryMap::UnitDebug&) {}
   };
 
+  Map() = default;
+  explicit Map(const Options& options)
+      : m_options(options), m_string_pool(options.m_string_storage),
+        m_diagnostics(options.m_warnings)
+  {
+  }
+  // The eager symbol closures move along with the Map, so a SymbolIndex made beforehand would
+  // still point into the old one. It is made again the next time it is asked for.
+  Map(Map&& other);
+  Map& operator=(Map&& other);
+
   ScanError Scan(std::span<const char> span, std::size_t& line_number);
   ScanError Scan(const char* head, const char* tail, std::size_t& line_number);
   ScanError ScanTLOZTP(std::span<const char> span, std::size_t& line_number);
   ScanError ScanTLOZTP(const char* head, const char* tail, std::size_t& line_number);
   ScanError ScanSMGalaxy(std::span<const char> span, std::size_t& line_number);
   ScanError ScanSMGalaxy(const char* head, const char* tail, std::size_t& line_number);
+
+  // Which of the scan functions above to use.
+  enum class ScanFlavor
+  {
+    Normal,
+    TLOZTP,
+    SMGalaxy,
+  };
+  // Scans a memory-mapped file, so it is never copied into memory as a whole. Only when using
+  // StringStorage::Borrowed does the Map hold onto the mapping, as its names point straight into
+  // it. Null byte padding at the end of the file is tolerated, same as with any other text.
+  ScanError ScanFile(const std::filesystem::path& path, std::size_t& line_number,
+                     ScanFlavor flavor = ScanFlavor::Normal);
+  // What became of one of the files handed to ScanFiles. See below.
+  struct BatchResult;
+  // Scans many files with ScanFile at once, each into a new Map with the given options, on a pool
+  // of up to thread_count threads that steal work from one another. The largest files are started
+  // first so that none of them is left to finish alone at the end. As the scans already run side
+  // by side, an Options::m_thread_count of 1 is usually best. Results are in the order of paths.
+  static std::vector<BatchResult> ScanFiles(std::span<const std::filesystem::path> paths,
+                                            const Options& options, unsigned thread_count = 0,
+                                            ScanFlavor flavor = ScanFlavor::Normal);
+  // Scans text handed to it a piece at a time. See below.
+  class StreamScanner;
+  // Scans text a slice at a time, and can be stopped partway. See below.
+  class ResumableScan;
+
+  // Scans a linker map like Scan does, but hands symbol closure nodes, unresolved symbols, section
+  // layout units, and memory map units to a visitor instead of keeping them. The symbol closures
+  // and section layouts go through the same scanners as with Scan, but no tree or lookup is built
+  // from them, which makes this much cheaper when only a few facts are wanted from a linker map.
+  // Without the lookups, none of the warnings about repeat names are given for them, nor are the
+  // traits of section layout units deduced. What warnings are given for the other portions are not
+  // kept.
+  static ScanError Visit(std::span<const char> span, std::size_t& line_number, Visitor& visitor,
+                         const Options& options);
+  static ScanError Visit(const char* head, const char* tail, std::size_t& line_number,
+                         Visitor& visitor, const Options& options);
+
+  // Caches are tied to the text they were scanned from by this hash of it.
+  static std::uint64_t HashText(const std::span<const char> span) noexcept
+  {
+    return Mijo::XXH64::Hash(span);
+  }
+  // Caches written with any other version of the format are turned away. This also goes up when
+  // scanning changes what ends up in a Map, so caches never outlive the scanner that made them.
+  static constexpr std::uint32_t cache_format_version = 1;
+  // Writes everything a scan found to a compact binary cache, to be restored by LoadCache much
+  // faster than the linker map could be scanned again. The cache is tagged with the hash of the
+  // text that was scanned, which LoadCache checks so that a stale cache is never mistaken for a
+  // fresh one. Caches are in the byte order of the host that wrote them.
+  void SaveCache(std::ostream& stream, std::uint64_t text_hash) const;
+  // Restores a Map from a cache as if it had scanned the linker map itself, except that no warnings
+  // are given. Names are kept according to StringStorage for the cache text just as they would be
+  // for linker map text, though all of them are stored at once. Lookups and entry symbol links are
+  // rebuilt, and everything else is copied in as-is. Like with Scan, the Map must be new.
+  ScanError LoadCache(std::span<const char> span, std::uint64_t text_hash);
+  // Loads a memory-mapped cache file, holding onto the mapping under the same rules as ScanFile.
+  ScanError LoadCacheFile(const std::filesystem::path& path, std::uint64_t text_hash);
+  // Loads caches from a shared directory instead of scanning whenever it can. See below.
+  class CacheDirectory;
+
+  // Prints the linker map back out as text. All of it is formatted into a buffer first, then
+  // written to the stream a large chunk at a time.
   void Print(std::ostream& stream, std::size_t& line_number) const;
+  // Appends the printed linker map to a string.
+  void Print(std::string& string, std::size_t& line_number) const;
+  // Prints into a buffer the caller already has, such as a memory-mapped file of GetPrintSize
+  // bytes. The size of the whole linker map is returned, so if it comes out larger than the
+  // buffer, the linker map was cut short.
+  std::size_t Print(std::span<char> span, std::size_t& line_number) const;
+  // The exact number of bytes Print gives. Finding it out takes as long as printing does, only
+  // without anywhere to put the text.
+  std::size_t GetPrintSize() const;
   Version GetMinVersion() const noexcept
   {
     Version min_version = std::max({
         m_normal_symbol_closure ? m_normal_symbol_closure->GetMinVersion() : Version::Unknown,
+        m_lazy_normal_symbol_closure ? m_lazy_normal_symbol_closure->GetMinVersion() :
+                                       Version::Unknown,
         m_eppc_pattern_matching ? m_eppc_pattern_matching->GetMinVersion() : Version::Unknown,
         m_dwarf_symbol_closure ? m_dwarf_symbol_closure->GetMinVersion() : Version::Unknown,
+        m_lazy_dwarf_symbol_closure ? m_lazy_dwarf_symbol_closure->GetMinVersion() :
+                                      Version::Unknown,
         m_linker_opts ? m_linker_opts->GetMinVersion() : Version::Unknown,
         m_mixed_mode_islands ? m_mixed_mode_islands->GetMinVersion() : Version::Unknown,
         m_branch_islands ? m_branch_islands->GetMinVersion() : Version::Unknown,
@@ -1024,6 +1541,7 @@ struct Map
             Version::Unknown,
         m_memory_map ? m_memory_map->GetMinVersion() : Version::Unknown,
         m_linker_generated_symbols ? m_linker_generated_symbols->GetMinVersion() : Version::Unknown,
+        m_skipped_portions.GetMinVersion(),
     });
     for (const auto& section_layout : m_section_layouts)
       min_version = std::max((section_layout.GetMinVersion()), min_version);
@@ -1033,8 +1551,12 @@ struct Map
   {
     Version max_version = std::min({
         m_normal_symbol_closure ? m_normal_symbol_closure->GetMaxVersion() : Version::Latest,
+        m_lazy_normal_symbol_closure ? m_lazy_normal_symbol_closure->GetMaxVersion() :
+                                       Version::Latest,
         m_eppc_pattern_matching ? m_eppc_pattern_matching->GetMaxVersion() : Version::Latest,
         m_dwarf_symbol_closure ? m_dwarf_symbol_closure->GetMaxVersion() : Version::Latest,
+        m_lazy_dwarf_symbol_closure ? m_lazy_dwarf_symbol_closure->GetMaxVersion() :
+                                      Version::Latest,
         m_linker_opts ? m_linker_opts->GetMaxVersion() : Version::Latest,
         m_mixed_mode_islands ? m_mixed_mode_islands->GetMaxVersion() : Version::Latest,
         m_branch_islands ? m_branch_islands->GetMaxVersion() : Version::Latest,
@@ -1046,66 +1568,515 @@ struct Map
             Version::Latest,
         m_memory_map ? m_memory_map->GetMaxVersion() : Version::Latest,
         m_linker_generated_symbols ? m_linker_generated_symbols->GetMaxVersion() : Version::Latest,
+        m_skipped_portions.GetMaxVersion(),
     });
     for (const auto& section_layout : m_section_layouts)
       max_version = std::min(section_layout.GetMaxVersion(), max_version);
     return max_version;
   }
 
-  const std::string& GetEntryPointName() const noexcept { return m_entry_point_name; }
-  const std::optional<SymbolClosure>& GetNormalSymbolClosure() const noexcept
+  const Options& GetOptions() const noexcept { return m_options; }
+  // Warnings given while scanning, which can be taken out of here once scanning is done.
+  const Diagnostics& GetDiagnostics() const noexcept { return m_diagnostics; }
+  Diagnostics& GetDiagnostics() noexcept { return m_diagnostics; }
+  // How long each portion took to scan, and what it took. See ScanProfile.
+  const ScanProfile& GetScanProfile() const noexcept { return m_scan_profile; }
+  std::string_view GetEntryPointName() const noexcept { return m_entry_point_name; }
+  // A symbol closure scanned lazily is scanned in full here, the first time it is asked for.
+  const std::optional<SymbolClosure>& GetNormalSymbolClosure() const
   {
+    if (m_lazy_normal_symbol_closure)
+      return m_lazy_normal_symbol_closure->Get();
     return m_normal_symbol_closure;
   }
+  const std::optional<LazySymbolClosure>& GetLazyNormalSymbolClosure() const noexcept
+  {
+    return m_lazy_normal_symbol_closure;
+  }
   const std::optional<EPPC_PatternMatching>& GetEPPC_PatternMatching() const noexcept
   {
     return m_eppc_pattern_matching;
   }
-  const std::optional<SymbolClosure>& GetDwarfSymbolClosure() const noexcept
+  const std::optional<SymbolClosure>& GetDwarfSymbolClosure() const
   {
+    if (m_lazy_dwarf_symbol_closure)
+      return m_lazy_dwarf_symbol_closure->Get();
     return m_dwarf_symbol_closure;
   }
+  const std::optional<LazySymbolClosure>& GetLazyDwarfSymbolClosure() const noexcept
+  {
+    return m_lazy_dwarf_symbol_closure;
+  }
   const UnresolvedSymbols& GetUnresolvedSymbols() const noexcept { return m_unresolved_symbols; }
-  const std::list<SectionLayout>& GetSectionLayouts() const noexcept { return m_section_layouts; }
+  const std::deque<SectionLayout>& GetSectionLayouts() const noexcept { return m_section_layouts; }
   const std::optional<MemoryMap>& GetMemoryMap() const noexcept { return m_memory_map; }
   const std::optional<LinkerGeneratedSymbols>& GetLinkerGeneratedSymbols() const noexcept
   {
     return m_linker_generated_symbols;
   }
-
-  struct Warn
-  {
-    friend Map;
-
-    static void DisableAll() noexcept
-    {
-      SymbolClosure::Warn::DisableAll();
-      EPPC_PatternMatching::Warn::DisableAll();
-      SectionLayout::Warn::DisableAll();
-    }
-  };
+  // Finds what lies at virtual addresses. See below.
+  class AddressIndex;
+  // Made the first time it is asked for, so scanning must be done by then.
+  const AddressIndex& GetAddressIndex() const;
+  // Finds every place a symbol name appears. See below.
+  class SymbolIndex;
+  // Made the first time it is asked for, so scanning must be done by then.
+  const SymbolIndex& GetSymbolIndex() const;
+  // Compares the section layouts of two Maps, such as from two builds of one program. See below.
+  class Diff;
 
 private:
+  ScanError ScanSectionLayoutPrologue(const char*& head, const char* tail, std::size_t& line_number,
+                                      SectionLayout& section_layout) const;
   ScanError ScanPrologue_SectionLayout(const char*& head, const char* tail,
-                                       std::size_t& line_number, std::string_view name);
+                                       std::size_t& line_number, std::string_view name,
+                                       std::deque<SectionLayout>& section_layouts,
+                                       Mijo::StringPool& string_pool, Diagnostics& diagnostics,
+                                       ScanProfile& scan_profile) const;
+  ScanError ScanSectionLayoutsParallel(const char*& head, const char* tail,
+                                       std::size_t& line_number,
+                                       const Mijo::LineIndex& line_index);
   ScanError ScanPrologue_MemoryMap(const char*& head, const char* tail, std::size_t& line_number);
+  bool IsScanned(const Portions portions) const noexcept
+  {
+    return (m_options.m_portions & portions) != Portions::None;
+  }
+  void SkipToTrailingPortions(const char*& head, const char* tail, std::size_t& line_number,
+                              const Mijo::LineIndex& line_index);
+  void SkipSymbolClosure(const char*& head, const char* tail, std::size_t& line_number,
+                         bool is_dwarf);
+  ScanError LookOverSymbolClosure(const char*& head, const char* tail, std::size_t& line_number,
+                                  bool is_dwarf, std::optional<LazySymbolClosure>& portion);
+  ScanError SkipSectionLayout(const char*& head, const char* tail, std::size_t& line_number,
+                              const Mijo::LineIndex& line_index);
+  // Keeps nothing of a portion that was only scanned to get past it, save for its version clues.
+  template <class Portion>
+  void DiscardPortion(std::optional<Portion>& portion) noexcept
+  {
+    if (!portion)
+      return;
+    m_skipped_portions.SetVersionRange(portion->GetMinVersion(), portion->GetMaxVersion());
+    portion.reset();
+  }
   ScanError ScanForGarbage(const char* head, const char* tail);
-  static void PrintUnresolvedSymbols(std::ostream& stream, UnresolvedSymbols::const_iterator& head,
+  ScanError ScanFlavored(std::span<const char> span, std::size_t& line_number, ScanFlavor flavor);
+  void Print(Printer& printer, std::size_t& line_number) const;
+  static void PrintUnresolvedSymbols(Printer& printer, UnresolvedSymbols::const_iterator& head,
                                      UnresolvedSymbols::const_iterator tail,
                                      std::size_t& line_number);
 
-  std::string m_entry_point_name;
+  Options m_options;
+  Mijo::StringPool m_string_pool;
+  Diagnostics m_diagnostics;
+  ScanProfile m_scan_profile;
+  Mijo::MappedFile m_mapped_file;
+  std::string_view m_entry_point_name;
   std::optional<SymbolClosure> m_normal_symbol_closure;
   std::optional<EPPC_PatternMatching> m_eppc_pattern_matching;
   std::optional<SymbolClosure> m_dwarf_symbol_closure;
+  // At most one of each symbol closure and its lazy counterpart is ever there.
+  std::optional<LazySymbolClosure> m_lazy_normal_symbol_closure;
+  std::optional<LazySymbolClosure> m_lazy_dwarf_symbol_closure;
   UnresolvedSymbols m_unresolved_symbols;
   std::optional<LinkerOpts> m_linker_opts;
   std::optional<MixedModeIslands> m_mixed_mode_islands;
   std::optional<BranchIslands> m_branch_islands;
   std::optional<LinktimeSizeDecreasingOptimizations> m_linktime_size_decreasing_optimizations;
   std::optional<LinktimeSizeIncreasingOptimizations> m_linktime_size_increasing_optimizations;
-  std::list<SectionLayout> m_section_layouts;
+  std::deque<SectionLayout> m_section_layouts;
   std::optional<MemoryMap> m_memory_map;
   std::optional<LinkerGeneratedSymbols> m_linker_generated_symbols;
+  // Version clues from portions that were skipped.
+  PortionBase m_skipped_portions;
+  Mijo::LazyValue<AddressIndex> m_address_index;
+  Mijo::LazyValue<SymbolIndex> m_symbol_index;
+};
+
+struct Map::BatchResult
+{
+  std::filesystem::path m_path;
+  Map m_map;
+  ScanError m_error;
+  // Where the scan stopped, same as the line number given back by ScanFile.
+  std::size_t m_line_number;
+};
+
+// Scans a linker map handed to it a piece at a time, such as while it is still being written or
+// downloaded, and ends up with the same Map that Map::Scan would have. Symbol closures and section
+// layouts are scanned as their lines come in, so only the last few lines are held onto, while the
+// other portions are small enough to be held onto until they are complete. Linker maps that do not
+// begin with "Link map of", such as the trimmed ones Map::Scan recognizes, are held onto in full
+// and scanned by Map::Scan in the end. As the text does not outlive scanning,
+// StringStorage::Borrowed is treated as StringStorage::Arena. Save for that fallback, everything is
+// scanned on the calling thread.
+class Map::StreamScanner
+{
+public:
+  explicit StreamScanner(const Options& options = {});
+  StreamScanner(const StreamScanner&) = delete;
+  StreamScanner& operator=(const StreamScanner&) = delete;
+
+  // Scans as much of the text pushed so far as can be known to be complete. Once an error is
+  // returned, it is returned again by every call after, and nothing more is scanned.
+  ScanError Push(std::span<const char> span);
+  // Scans the rest of the text now that nothing more is coming. Nothing may be pushed after this.
+  ScanError Finish();
+
+  // Same as the line number given back by Map::Scan, though it only becomes final once finished.
+  std::size_t GetLineNumber() const noexcept { return m_line_number; }
+  // How much of the text pushed so far is yet to be scanned.
+  std::size_t GetPendingSize() const noexcept { return m_buffer.size() - m_buffer_head; }
+  // Portions appear as they are scanned, so the last of them may still be incomplete.
+  const Map& GetMap() const noexcept { return m_map; }
+  // Nothing may be pushed after this either.
+  Map TakeMap() noexcept { return std::move(m_map); }
+
+private:
+  enum class Stage
+  {
+    EntryPointName,
+    NormalSymbolClosure,
+    EPPC_PatternMatching,
+    DwarfSymbolClosure,
+    LinkerOpts,
+    MixedModeIslands,
+    BranchIslands,
+    LinktimeSizeDecreasingOptimizations,
+    LinktimeSizeIncreasingOptimizations,
+    SectionLayoutHeader,
+    SectionLayoutUnits,
+    MemoryMap,
+    LinkerGeneratedSymbols,
+    Garbage,
+    // The text is held onto in full, as described above.
+    WholeText,
+    Finished,
+  };
+
+  void Advance(bool is_final);
+  bool Step(const char*& head, const char* tail, bool is_final);
+  bool StepSymbolClosure(const char*& head, const char* tail, bool is_final,
+                         std::optional<SymbolClosure>& portion, Stage next_stage);
+  bool StepSectionLayoutHeader(const char*& head, const char* tail, bool is_final);
+  bool StepSectionLayoutUnits(const char*& head, const char* tail, bool is_final);
+  template <class Func>
+  bool StepPortion(const char*& head, const char* tail, bool is_final, Stage next_stage,
+                   Func&& scan);
+  void ResetPortion() noexcept;
+
+  Map m_map;
+  std::string m_buffer;
+  // Where the text that is yet to be scanned begins in the buffer.
+  std::size_t m_buffer_head = 0;
+  std::size_t m_line_number = 1;
+  // Portions that are only scanned once complete are not tried again until at least this much
+  // text is waiting, which keeps rescanning them from adding up.
+  std::size_t m_retry_size = 0;
+  Stage m_stage = Stage::EntryPointName;
+  ScanError m_error = ScanError::None;
+  SymbolClosure::ScanState m_symbol_closure_state;
+  std::optional<SectionLayout> m_section_layout;
+  std::optional<SectionLayout::ScanningContext> m_scanning_context;
+};
+
+// Scans a linker map already in memory a slice at a time, for callers that cannot be kept waiting
+// on Map::Scan, such as a viewer that must stay responsive while opening a large linker map. Each
+// Step pushes one more slice to a StreamScanner, so it picks up right where the last one left off
+// and is only ever as long as scanning that slice takes. The exception is a linker map that
+// StreamScanner must hold onto in full, which is all scanned by the last Step. Progress may be read
+// and the scan cancelled from any thread, even while another is stepping. The text must outlive
+// the scan.
+class Map::ResumableScan
+{
+public:
+  static constexpr std::size_t default_slice_size = 0x100000;
+
+  explicit ResumableScan(std::span<const char> span, const Options& options = {},
+                         std::size_t slice_size = default_slice_size);
+
+  // Scans one more slice, or finishes the scan once there are none left. Returns whether there is
+  // anything left to do, which there is not once the scan is finished, cancelled, or has failed.
+  bool Step();
+  // The scan stops before its next slice, failing with ScanError::Cancelled.
+  void Cancel() noexcept { m_is_cancelled.store(true, std::memory_order_relaxed); }
+
+  bool IsDone() const noexcept { return m_is_done.load(std::memory_order_acquire); }
+  std::size_t GetByteCount() const noexcept { return m_span.size(); }
+  // How many of the bytes have been scanned, and how many lines they made up.
+  std::size_t GetScannedSize() const noexcept
+  {
+    return m_scanned_size.load(std::memory_order_relaxed);
+  }
+  std::size_t GetLineNumber() const noexcept
+  {
+    return m_line_number.load(std::memory_order_relaxed);
+  }
+  // Same as what Map::Scan would have returned, once done.
+  ScanError GetError() const noexcept { return m_error; }
+  // Portions appear as they are scanned, so the last of them may still be incomplete. Neither of
+  // these may be called while another thread is stepping.
+  const Map& GetMap() const noexcept { return m_stream_scanner.GetMap(); }
+  Map TakeMap() noexcept { return m_stream_scanner.TakeMap(); }
+
+private:
+  std::span<const char> m_span;
+  std::size_t m_slice_size;
+  std::size_t m_pushed_size = 0;
+  StreamScanner m_stream_scanner;
+  ScanError m_error = ScanError::None;
+  std::atomic<std::size_t> m_scanned_size = 0;
+  std::atomic<std::size_t> m_line_number = 1;
+  std::atomic<bool> m_is_cancelled = false;
+  std::atomic<bool> m_is_done = false;
+};
+
+// Keeps caches of scanned linker maps in a directory so that a linker map anyone sharing the
+// directory has scanned before is loaded from its cache instead. Caches are named after everything
+// that decides what a scan ends up with: the hash of the text, the scan flavor, the portions that
+// were scanned, and the cache format version. Only scans that succeed are cached. Once the caches
+// add up to more than the size limit, those least recently used are removed until they fit again.
+// Any number of threads and processes may share a directory, as caches are written to a temporary
+// file that is renamed into place once complete, and a cache that goes missing or turns out to be
+// damaged is simply a miss. Trouble with the directory itself never fails a scan, either.
+class Map::CacheDirectory
+{
+public:
+  static constexpr std::string_view extension = ".mwcache";
+
+  struct Stats
+  {
+    // Scans that were spared by loading a cache.
+    std::uint64_t m_hits;
+    // Scans that had no usable cache.
+    std::uint64_t m_misses;
+    // Caches that were found but turned out to be damaged. These count as misses, too.
+    std::uint64_t m_rejects;
+    // Caches written after a miss.
+    std::uint64_t m_stores;
+    // Caches removed to stay under the size limit.
+    std::uint64_t m_evictions;
+    // How much linker map text hits spared from being scanned.
+    std::uint64_t m_bytes_spared;
+  };
+
+  // The directory is created if need be.
+  explicit CacheDirectory(std::filesystem::path path, std::uintmax_t size_limit);
+  CacheDirectory(const CacheDirectory&) = delete;
+  CacheDirectory& operator=(const CacheDirectory&) = delete;
+
+  // Same as Map::ScanFile, or one of the other scan functions for Scan, except when there is a
+  // cache to load instead. Options are taken from the Map, which must be new. On a hit, the line
+  // number is that of the scan the cache was made from.
+  ScanError Scan(Map& map, std::span<const char> span, std::size_t& line_number,
+                 ScanFlavor flavor = ScanFlavor::Normal);
+  ScanError ScanFile(Map& map, const std::filesystem::path& path, std::size_t& line_number,
+                     ScanFlavor flavor = ScanFlavor::Normal);
+
+  // Removes caches least recently used until the rest fit within the size limit. This happens
+  // after every cache written anyway. Temporary files left behind by writers that never finished
+  // are removed as well once they are old enough.
+  void Trim();
+
+  const std::filesystem::path& GetPath() const noexcept { return m_path; }
+  std::uintmax_t GetSizeLimit() const noexcept { return m_size_limit; }
+  // Only counts what happened through this object, not through anyone else sharing the directory.
+  Stats GetStats() const noexcept;
+
+private:
+  ScanError ScanCached(Map& map, std::span<const char> span, std::size_t& line_number,
+                       ScanFlavor flavor, Mijo::MappedFile* text_file);
+  bool Load(Map& map, const std::filesystem::path& cache_path, std::uint64_t text_hash,
+            std::size_t& line_number);
+  void Store(const Map& map, const std::filesystem::path& cache_path, std::uint64_t text_hash,
+             std::size_t line_number);
+
+  std::filesystem::path m_path;
+  std::uintmax_t m_size_limit;
+  // Only one thread trims at a time, as there is nothing to gain from more.
+  std::mutex m_trim_mutex;
+  // Distinguishes the temporary files of this object from those of any other.
+  std::uint64_t m_temp_file_salt;
+  std::atomic<std::uint64_t> m_temp_file_count = 0;
+  std::atomic<std::uint64_t> m_hits = 0;
+  std::atomic<std::uint64_t> m_misses = 0;
+  std::atomic<std::uint64_t> m_rejects = 0;
+  std::atomic<std::uint64_t> m_stores = 0;
+  std::atomic<std::uint64_t> m_evictions = 0;
+  std::atomic<std::uint64_t> m_bytes_spared = 0;
+};
+
+// Finds which section layout unit and which memory map section a virtual address lies within, in
+// logarithmic time. Where units overlap, the narrowest one wins, so an address is attributed to an
+// entry symbol before the symbol it is an entry of, and to a symbol before the section symbol of
+// its compilation unit. Unused units, fill, units of no size, and debug sections are left out.
+class Map::AddressIndex
+{
+public:
+  struct Match
+  {
+    // Both are null if no unit holds the address.
+    const SectionLayout* m_section_layout = nullptr;
+    const SectionLayout::Unit* m_unit = nullptr;
+    // Null if no memory map section holds the address, such as when there is no memory map.
+    const MemoryMap::UnitNormal* m_section = nullptr;
+  };
+
+  explicit AddressIndex(const Map& map);
+
+  Match Find(Elf32_Addr address) const noexcept;
+  // Addresses must be sorted in ascending order. Each one is matched in much less than the time it
+  // takes to Find it alone, as the search for one picks up where the search for the last left off.
+  void Find(std::span<const Elf32_Addr> addresses, std::span<Match> matches) const noexcept;
+
+private:
+  // The ranges of every unit are cut up into ranges that do not overlap, each of which belongs to
+  // the narrowest unit there.
+  struct UnitRange
+  {
+    std::uint64_t m_end;
+    const SectionLayout* m_section_layout;
+    const SectionLayout::Unit* m_unit;
+  };
+  struct SectionRange
+  {
+    std::uint64_t m_end;
+    const MemoryMap::UnitNormal* m_section;
+  };
+
+  // Kept apart from the ranges so that searching them touches as little memory as possible.
+  std::vector<Elf32_Addr> m_unit_range_starts;
+  std::vector<UnitRange> m_unit_ranges;
+  std::vector<Elf32_Addr> m_section_range_starts;
+  std::vector<SectionRange> m_section_ranges;
+};
+
+// Finds every place a symbol name appears throughout a Map, no matter the compilation unit: symbol
+// closure nodes, section layout units, EPPC_PatternMatching merging and folding units (by either of
+// their names), and linker generated symbols. Fill and dummy nodes are left out. Names are kept in
+// a flat open-addressing hash table that holds onto part of each name's hash, so most probes that
+// miss are turned away without comparing names, and every occurrence is kept in one array.
+class Map::SymbolIndex
+{
+public:
+  struct SectionLayoutUnitRef
+  {
+    const SectionLayout* m_section_layout;
+    const SectionLayout::Unit* m_unit;
+  };
+  struct FoldingUnitRef
+  {
+    const EPPC_PatternMatching::FoldingUnit* m_folding_unit;
+    const EPPC_PatternMatching::FoldingUnit::Unit* m_unit;
+  };
+  // Nodes say which of the two symbol closures they are from through GetClosure.
+  using Occurrence = std::variant<SymbolClosure::Node, SectionLayoutUnitRef,
+                                  const EPPC_PatternMatching::MergingUnit*, FoldingUnitRef,
+                                  const LinkerGeneratedSymbols::Unit*>;
+
+  explicit SymbolIndex(const Map& map);
+
+  // Occurrences are in the order the portions they are from appear in the linker map.
+  std::span<const Occurrence> Find(std::string_view name) const noexcept;
+  // Every distinct name, each once.
+  std::span<const std::string_view> GetNames() const noexcept { return m_names; }
+  std::size_t GetNameCount() const noexcept { return m_names.size(); }
+  std::size_t GetOccurrenceCount() const noexcept { return m_occurrences.size(); }
+
+private:
+  // An empty slot has no name id.
+  struct Slot
+  {
+    std::uint32_t m_hash_tag;
+    std::uint32_t m_name_id_plus_one;
+  };
+
+  template <class Func>
+  static void ForEachOccurrence(const Map& map, Func&& func);
+  // Gives the slot a name is in, or else the empty slot it would go in.
+  std::size_t Probe(std::string_view name, std::uint64_t hash) const noexcept;
+
+  std::vector<Slot> m_slots;
+  std::vector<std::string_view> m_names;
+  // The occurrences of name i are [m_occurrence_begins[i], m_occurrence_begins[i + 1]).
+  std::vector<std::uint32_t> m_occurrence_begins;
+  std::vector<Occurrence> m_occurrences;
+};
+
+// Matches up the section layouts of an old Map and a new one: sections by name, compilation units
+// in them by the name GetModuleLookup knows them by, and symbols in those by name. Where a name is
+// repeated, the first on one side goes with the first on the other, and so on. Each side is sorted
+// once and the two are walked together, so nothing is ever compared with everything else, and each
+// pair of sections can be compared on a thread of its own. Fill is left out. Both Maps must outlive
+// the Diff, as every name and unit refers back to them.
+class Map::Diff
+{
+public:
+  // What a unit takes up in the link, which is zero if it is null. Unused symbols and entry symbols
+  // take up nothing of their own, and neither do section symbols, as those span the symbols after
+  // them.
+  static std::uint64_t GetLinkedSize(const SectionLayout::Unit* unit) noexcept;
+
+  // One of the units is null if the symbol was added or removed.
+  struct SymbolDiff
+  {
+    std::string_view m_name;
+    const SectionLayout::Unit* m_old_unit;
+    const SectionLayout::Unit* m_new_unit;
+
+    std::int64_t GetSizeDelta() const noexcept
+    {
+      return static_cast<std::int64_t>(GetLinkedSize(m_new_unit)) -
+             static_cast<std::int64_t>(GetLinkedSize(m_old_unit));
+    }
+    // Zero if the symbol was added or removed.
+    std::int64_t GetAddressDelta() const noexcept
+    {
+      if (!m_old_unit || !m_new_unit)
+        return 0;
+      return std::int64_t{m_new_unit->m_virtual_address} -
+             std::int64_t{m_old_unit->m_virtual_address};
+    }
+  };
+
+  // The size of a compilation unit or section is what its symbols take up in the link.
+  struct CompilationUnitDiff
+  {
+    std::string_view m_name;
+    std::uint64_t m_old_size;
+    std::uint64_t m_new_size;
+    // In order of name.
+    std::vector<SymbolDiff> m_symbols;
+
+    std::int64_t GetSizeDelta() const noexcept
+    {
+      return static_cast<std::int64_t>(m_new_size) - static_cast<std::int64_t>(m_old_size);
+    }
+  };
+
+  // One of the section layouts is null if the section was added or removed.
+  struct SectionDiff
+  {
+    std::string_view m_name;
+    const SectionLayout* m_old_section_layout;
+    const SectionLayout* m_new_section_layout;
+    std::uint64_t m_old_size;
+    std::uint64_t m_new_size;
+    // In order of name. Repeat-name compilation units count as one.
+    std::vector<CompilationUnitDiff> m_compilation_units;
+
+    std::int64_t GetSizeDelta() const noexcept
+    {
+      return static_cast<std::int64_t>(m_new_size) - static_cast<std::int64_t>(m_old_size);
+    }
+  };
+
+  // A thread count of zero means as many as the hardware can run at once.
+  Diff(const Map& old_map, const Map& new_map, unsigned thread_count = 1);
+
+  // In the order of the new Map, followed by those only in the old Map in the order of the old Map.
+  std::span<const SectionDiff> GetSections() const noexcept { return m_sections; }
+
+private:
+  std::vector<SectionDiff> m_sections;
 };
 }  // namespace MWLinker
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "RegexUtil.h"
+
+// A tiny compile-time pattern engine for line-oriented text, in the spirit of CTRE. Patterns are
+// sequences of elements that get specialized into a matcher at compile time, so there is nothing
+// to build at static-init time and nothing to interpret at runtime. Matching follows the rules of
+// std::regex_search in ECMAScript mode with std::regex_constants::match_continuous, including the
+// backtracking order of greedy quantifiers, so a pattern yields the same captures its equivalent
+// regex would. Every pattern implicitly ends with "\r?\n", and nothing in it can match '\r' or '\n'.
+
+namespace Mijo
+{
+template <std::size_t N>
+struct FixedString
+{
+  constexpr FixedString(const char (&str)[N]) noexcept { std::copy_n(str, N, m_data); }
+  constexpr std::string_view view() const noexcept { return {m_data, N - 1}; }
+
+  char m_data[N];
+};
+
+// Finds the extent of the line beginning at head the same way "(.*)\r?\n" would. On success,
+// content is everything up to the line terminator and next is the beginning of the next line.
+inline bool ScanLine(const char* const head, const char* const tail, std::string_view& content,
+                     const char*& next) noexcept
+{
+  const char* iter = head;
+  while (iter != tail && *iter != '\r' && *iter != '\n')
+    ++iter;
+  if (iter == tail)
+    return false;
+  content = {head, iter};
+  if (*iter == '\r' && (++iter == tail || *iter != '\n'))
+    return false;
+  next = iter + 1;
+  return true;
+}
+
+namespace Pattern
+{
+// Exactly the given text.
+template <FixedString Text>
+struct Literal
+{
+  static constexpr std::size_t capture_count = 0;
+  static constexpr std::string_view text = Text.view();
+
+  template <std::size_t Index, class Next>
+  static bool Match(const char* head, const char* tail, std::span<CSubMatch>, Next&& next)
+  {
+    if (static_cast<std::size_t>(tail - head) < text.size() ||
+        !std::equal(text.begin(), text.end(), head))
+      return false;
+    return next(head + text.size());
+  }
+};
+
+// " {Min,Max}"
+template <std::size_t Min, std::size_t Max>
+struct Spaces
+{
+  static constexpr std::size_t capture_count = 0;
+
+  template <std::size_t Index, class Next>
+  static bool Match(const char* head, const char* tail, std::span<CSubMatch>, Next&& next)
+  {
+    std::size_t count = 0;
+    while (count < Max && head + count != tail && head[count] == ' ')
+      ++count;
+    for (; count >= Min; --count)
+    {
+      if (next(head + count))
+        return true;
+      if (count == 0)
+        break;
+    }
+    return false;
+  }
+};
+
+// "([0-9a-f]{Min,Max})" for lowercase hexadecimal numbers.
+template <std::size_t Min, std::size_t Max = Min>
+struct Hex
+{
+  static constexpr std::size_t capture_count = 1;
+
+  template <std::size_t Index, class Next>
+  static bool Match(const char* head, const char* tail, std::span<CSubMatch> captures,
+                    Next&& next)
+  {
+    constexpr auto is_hex = [](const char c) {
+      return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    };
+    std::size_t count = 0;
+    while (count < Max && head + count != tail && is_hex(head[count]))
+      ++count;
+    for (; count >= Min && count != 0; --count)
+    {
+      captures[Index].first = head, captures[Index].second = head + count;
+      captures[Index].matched = true;
+      if (next(head + count))
+        return true;
+    }
+    return false;
+  }
+};
+
+// "(\\d+)"
+struct Digits
+{
+  static constexpr std::size_t capture_count = 1;
+
+  template <std::size_t Index, class Next>
+  static bool Match(const char* head, const char* tail, std::span<CSubMatch> captures,
+                    Next&& next)
+  {
+    std::size_t count = 0;
+    while (head + count != tail && head[count] >= '0' && head[count] <= '9')
+      ++count;
+    for (; count != 0; --count)
+    {
+      captures[Index].first = head, captures[Index].second = head + count;
+      captures[Index].matched = true;
+      if (next(head + count))
+        return true;
+    }
+    return false;
+  }
+};
+
+// "(.*)"
+struct Any
+{
+  static constexpr std::size_t capture_count = 1;
+
+  // When a literal immediately follows, only the positions where that literal begins are worth
+  // trying, and std::string_view::rfind can skip straight to them from the greediest one.
+  template <std::size_t Index, class Next>
+  static bool Match(const char* head, const char* tail, std::span<CSubMatch> captures,
+                    Next&& next, const std::string_view anchor = {})
+  {
+    const std::string_view text{head, tail};
+    for (std::size_t count = text.size();; --count)
+    {
+      if (!anchor.empty())
+      {
+        count = text.rfind(anchor, count);
+        if (count == std::string_view::npos)
+          return false;
+      }
+      captures[Index].first = head, captures[Index].second = head + count;
+      captures[Index].matched = true;
+      if (next(head + count))
+        return true;
+      if (count == 0)
+        return false;
+    }
+  }
+};
+}  // namespace Pattern
+
+template <class... Elements>
+class StaticPattern
+{
+public:
+  static constexpr std::size_t capture_count = (std::size_t{0} + ... + Elements::capture_count);
+
+  // Like std::match_results, the first capture is the entire match, including the line terminator.
+  static bool Match(const char* const head, const char* const tail, std::span<CSubMatch> captures)
+  {
+    assert(captures.size() > capture_count);
+    std::string_view content;
+    const char* next;
+    if (!ScanLine(head, tail, content, next))
+      return false;
+    if (!MatchFrom<0, 1>(content.data(), content.data() + content.size(), captures))
+      return false;
+    captures[0].first = head, captures[0].second = next;
+    captures[0].matched = true;
+    return true;
+  }
+
+private:
+  template <std::size_t I>
+  using Element = std::tuple_element_t<I, std::tuple<Elements...>>;
+
+  template <std::size_t I, std::size_t Index>
+  static bool MatchFrom(const char* const head, const char* const tail,
+                        std::span<CSubMatch> captures)
+  {
+    if constexpr (I == sizeof...(Elements))
+    {
+      return head == tail;
+    }
+    else
+    {
+      const auto next = [tail, captures](const char* const next_head) {
+        return MatchFrom<I + 1, Index + Element<I>::capture_count>(next_head, tail, captures);
+      };
+      if constexpr (std::is_same_v<Element<I>, Pattern::Any> && I + 1 < sizeof...(Elements))
+      {
+        if constexpr (requires { Element<I + 1>::text; })
+          return Pattern::Any::Match<Index>(head, tail, captures, next, Element<I + 1>::text);
+        else
+          return Pattern::Any::Match<Index>(head, tail, captures, next);
+      }
+      else
+      {
+        return Element<I>::template Match<Index>(head, tail, captures, next);
+      }
+    }
+  }
+};
+}  // namespace Mijo
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <cstddef>
+
+namespace Mijo
+{
+// Running totals kept by each thread on its own, so whatever one thread does between two readings
+// is simply their difference.
+struct ProfileCounters
+{
+  std::size_t m_pattern_attempt_count = 0;
+  std::size_t m_pattern_hit_count = 0;
+  std::size_t m_allocation_count = 0;
+  std::size_t m_allocated_size = 0;
+
+  ProfileCounters& operator+=(const ProfileCounters& other) noexcept
+  {
+    m_pattern_attempt_count += other.m_pattern_attempt_count;
+    m_pattern_hit_count += other.m_pattern_hit_count;
+    m_allocation_count += other.m_allocation_count;
+    m_allocated_size += other.m_allocated_size;
+    return *this;
+  }
+  friend ProfileCounters operator-(const ProfileCounters& lhs, const ProfileCounters& rhs) noexcept
+  {
+    return {lhs.m_pattern_attempt_count - rhs.m_pattern_attempt_count,
+            lhs.m_pattern_hit_count - rhs.m_pattern_hit_count,
+            lhs.m_allocation_count - rhs.m_allocation_count,
+            lhs.m_allocated_size - rhs.m_allocated_size};
+  }
+};
+
+inline ProfileCounters& GetProfileCounters() noexcept
+{
+  thread_local ProfileCounters counters;
+  return counters;
+}
+
+// Allocations made with the global operator new cannot be seen without replacing it, which is for
+// a program to do and not a library. A replacement can call this to have them counted.
+inline void CountAllocation(const std::size_t size) noexcept
+{
+  ProfileCounters& counters = GetProfileCounters();
+  counters.m_allocation_count += 1;
+  counters.m_allocated_size += size;
+}
+}  // namespace Mijo
@@ -5,6 +5,8 @@
 #include <charconv>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <regex>
 #include <string>
 #include <string_view>
@@ -130,4 +132,36 @@ using SMatchResults = MatchResults<std::string::const_iterator>;
 using WSMatchResults = MatchResults<std::wstring::const_iterator>;
 using SVMatchResults = MatchResults<std::string_view::const_iterator>;
 using WSVMatchResults = MatchResults<std::wstring_view::const_iterator>;
+
+// Holds onto a pattern and only compiles it the first time it is used. Constructing one is a
+// constant expression, so a program pays for exactly the patterns it needs, when it needs them.
+template <class CharT, class Traits = std::regex_traits<CharT>>
+class BasicLazyRegex
+{
+public:
+  using regex_type = std::basic_regex<CharT, Traits>;
+  using flag_type = typename regex_type::flag_type;
+
+  constexpr explicit BasicLazyRegex(const CharT* pattern,
+                                    flag_type flags = std::regex_constants::ECMAScript) noexcept
+      : m_pattern(pattern), m_flags(flags)
+  {
+  }
+
+  const regex_type& get() const
+  {
+    std::call_once(m_once_flag, [this] { m_regex.emplace(m_pattern, m_flags); });
+    return *m_regex;
+  }
+  const regex_type& operator*() const { return get(); }
+
+private:
+  const CharT* m_pattern;
+  flag_type m_flags;
+  mutable std::once_flag m_once_flag;
+  mutable std::optional<regex_type> m_regex;
+};
+
+using LazyRegex = BasicLazyRegex<char>;
+using WLazyRegex = BasicLazyRegex<wchar_t>;
 }  // namespace Mijo
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Mijo
+{
+// An append-only arena of characters. Every string stored in it stays put until the pool itself is
+// destroyed, at which point all of them are freed at once.
+class StringPool
+{
+public:
+  static constexpr std::size_t block_size = 64 * 1024;
+
+  enum class Mode
+  {
+    // Every string is copied into the pool.
+    Arena,
+    // Like Arena, but identical strings are only ever stored once.
+    Interned,
+    // Nothing is copied, and Store hands back the very view it was given. This is for when the
+    // caller already guarantees that the underlying text outlives everything that refers to it.
+    Borrowed,
+  };
+
+  explicit StringPool(Mode mode = Mode::Arena) noexcept : m_mode(mode) {}
+  StringPool(const StringPool&) = delete;
+  StringPool(StringPool&& other) noexcept { *this = std::move(other); }
+  StringPool& operator=(const StringPool&) = delete;
+  StringPool& operator=(StringPool&& other) noexcept
+  {
+    m_blocks = std::move(other.m_blocks);
+    m_interned = std::move(other.m_interned);
+    m_block_head = std::exchange(other.m_block_head, nullptr);
+    m_block_remaining = std::exchange(other.m_block_remaining, 0);
+    m_bytes_stored = std::exchange(other.m_bytes_stored, 0);
+    m_mode = other.m_mode;
+    other.m_blocks.clear();
+    other.m_interned.clear();
+    return *this;
+  }
+
+  std::string_view Store(const std::string_view str)
+  {
+    if (m_mode == Mode::Borrowed)
+      return str;
+    if (str.empty())
+      return {};
+    if (m_mode == Mode::Interned)
+    {
+      if (const auto it = m_interned.find(str); it != m_interned.end())
+        return *it;
+      return *m_interned.insert(Copy(str)).first;
+    }
+    return Copy(str);
+  }
+
+  // Takes ownership of everything stored in another pool, so views into it remain valid for as long
+  // as this one lives. Strings interned by both pools are not deduplicated after the fact.
+  void Merge(StringPool&& other)
+  {
+    m_blocks.insert(m_blocks.end(), std::make_move_iterator(other.m_blocks.begin()),
+                    std::make_move_iterator(other.m_blocks.end()));
+    if (m_mode == Mode::Interned)
+      m_interned.insert(other.m_interned.begin(), other.m_interned.end());
+    m_bytes_stored += other.m_bytes_stored;
+    other = StringPool(other.m_mode);
+  }
+
+  Mode GetMode() const noexcept { return m_mode; }
+  std::size_t GetBytesStored() const noexcept { return m_bytes_stored; }
+  std::size_t GetBlockCount() const noexcept { return m_blocks.size(); }
+
+private:
+  std::string_view Copy(const std::string_view str)
+  {
+    // Strings that would waste too much of a fresh block get one of their own.
+    if (str.size() > block_size / 4)
+    {
+      char* const data = NewBlock(str.size());
+      m_bytes_stored += str.size();
+      return {data, std::copy(str.begin(), str.end(), data)};
+    }
+    if (str.size() > m_block_remaining)
+    {
+      m_block_head = NewBlock(block_size);
+      m_block_remaining = block_size;
+    }
+    char* const data = m_block_head;
+    m_block_head = std::copy(str.begin(), str.end(), data);
+    m_block_remaining -= str.size();
+    m_bytes_stored += str.size();
+    return {data, m_block_head};
+  }
+  char* NewBlock(const std::size_t size)
+  {
+    return m_blocks.emplace_back(std::make_unique_for_overwrite<char[]>(size)).get();
+  }
+
+  std::vector<std::unique_ptr<char[]>> m_blocks;
+  std::unordered_set<std::string_view> m_interned;
+  char* m_block_head = nullptr;
+  std::size_t m_block_remaining = 0;
+  std::size_t m_bytes_stored = 0;
+  Mode m_mode = Mode::Arena;
+};
+}  // namespace Mijo
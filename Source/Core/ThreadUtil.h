@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Mijo
+{
+// Zero means as many threads as the hardware can run at once.
+inline unsigned ResolveThreadCount(const unsigned thread_count) noexcept
+{
+  if (thread_count != 0)
+    return thread_count;
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// Calls func(i) for every i in [0, count) using up to thread_count threads, the calling thread
+// among them. Indices are handed out one at a time, so uneven workloads still balance out.
+template <class Func>
+void ParallelFor(const std::size_t count, const unsigned thread_count, Func&& func)
+{
+  std::atomic<std::size_t> next_index = 0;
+  const auto work = [&] {
+    for (std::size_t i; (i = next_index.fetch_add(1, std::memory_order_relaxed)) < count;)
+      func(i);
+  };
+  std::vector<std::jthread> threads;
+  const std::size_t used_thread_count =
+      std::min<std::size_t>(ResolveThreadCount(thread_count), count);
+  for (std::size_t i = 1; i < used_thread_count; ++i)
+    threads.emplace_back(work);
+  work();
+}
+
+// Like ParallelFor, but every thread is dealt its own share of the indices up front, in the order
+// they come, and takes from the front of it. A thread that runs out steals from the back of someone
+// else's share. Callers who know which work items are the heaviest should put them first.
+template <class Func>
+void ParallelForStealing(const std::size_t count, const unsigned thread_count, Func&& func)
+{
+  struct Share
+  {
+    std::optional<std::size_t> PopFront()
+    {
+      const std::scoped_lock lock{m_mutex};
+      if (m_indices.empty())
+        return std::nullopt;
+      const std::size_t i = m_indices.front();
+      m_indices.pop_front();
+      return i;
+    }
+    std::optional<std::size_t> PopBack()
+    {
+      const std::scoped_lock lock{m_mutex};
+      if (m_indices.empty())
+        return std::nullopt;
+      const std::size_t i = m_indices.back();
+      m_indices.pop_back();
+      return i;
+    }
+
+    std::mutex m_mutex;
+    std::deque<std::size_t> m_indices;
+  };
+
+  const std::size_t used_thread_count =
+      std::min<std::size_t>(ResolveThreadCount(thread_count), count);
+  if (used_thread_count == 0)
+    return;
+  std::vector<Share> shares(used_thread_count);
+  for (std::size_t i = 0; i < count; ++i)
+    shares[i % used_thread_count].m_indices.push_back(i);
+
+  // No new work is ever made, so once a thread finds every share empty, it is done.
+  const auto work = [&](const std::size_t thread_index) {
+    while (true)
+    {
+      std::optional<std::size_t> i = shares[thread_index].PopFront();
+      for (std::size_t j = 1; !i && j < used_thread_count; ++j)
+        i = shares[(thread_index + j) % used_thread_count].PopBack();
+      if (!i)
+        return;
+      func(*i);
+    }
+  };
+  std::vector<std::jthread> threads;
+  for (std::size_t i = 1; i < used_thread_count; ++i)
+    threads.emplace_back(work, i);
+  work(0);
+}
+
+// Holds onto a value that is only made the first time it is asked for. Any number of threads may
+// ask at once, though only one of them makes it while the rest wait, and once it is made, asking
+// for it takes no lock at all. Unlike std::once_flag, this can be moved, though not while anyone
+// is asking for the value.
+template <class T>
+class LazyValue
+{
+public:
+  LazyValue() noexcept = default;
+  LazyValue(const LazyValue&) = delete;
+  LazyValue(LazyValue&& other) noexcept : m_value(other.m_value.exchange(nullptr)) {}
+  LazyValue& operator=(const LazyValue&) = delete;
+  LazyValue& operator=(LazyValue&& other) noexcept
+  {
+    if (this != &other)
+      delete m_value.exchange(other.m_value.exchange(nullptr));
+    return *this;
+  }
+  ~LazyValue() { delete m_value.load(); }
+
+  template <class Func>
+  const T& Get(Func&& make) const
+  {
+    if (const T* const value = m_value.load(std::memory_order_acquire))
+      return *value;
+    const std::lock_guard lock{m_mutex};
+    if (const T* const value = m_value.load(std::memory_order_acquire))
+      return *value;
+    auto made = std::make_unique<T>(std::forward<Func>(make)());
+    m_value.store(made.get(), std::memory_order_release);
+    return *made.release();
+  }
+  void Reset() noexcept { delete m_value.exchange(nullptr); }
+
+private:
+  mutable std::atomic<T*> m_value = nullptr;
+  // Only held while the value is being made. It is never moved along with the value.
+  mutable std::mutex m_mutex;
+};
+}  // namespace Mijo
@@ -33,15 +33,16 @@ static void tempfunc(const char* name, int choice)
   sstream << infile.rdbuf();
   std::string temp = std::move(sstream).str();
 
-  MWLinker::Map linker_map;
-  MWLinker::Map::Warn::DisableAll();
+  MWLinker::Map::Options options;
+  options.m_warnings = MWLinker::Map::Warnings::None;
+  MWLinker::Map linker_map{options};
 
   std::size_t scan_line_number = 0;
   MWLinker::Map::ScanError error = MWLinker::Map::ScanError::None;
   std::array<std::chrono::milliseconds, TIME_ATTACK_COUNT> time_attack{};
   for (std::size_t i = 0; i < TIME_ATTACK_COUNT; ++i)
   {
-    linker_map = MWLinker::Map{};  // Reset linker map
+    linker_map = MWLinker::Map{options};  // Reset linker map
     const auto time_start = std::chrono::high_resolution_clock::now();
     switch (choice)
     {
@@ -0,0 +1,652 @@
+// SPDX-License-Identifier: CC0-1.0
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "FileUtil.h"
+#include "MWLinkerMap.h"
+
+// The columns of the Memory Map, which also decide which era of linker the rest of the linker map
+// is written like. The "_old" ones come with three-column section layouts.
+enum class MemoryMapVariant
+{
+  SimpleOld,
+  RomRamOld,
+  Simple,
+  RomRam,
+  SRecord,
+  BinFile,
+  RomRamSRecord,
+  RomRamBinFile,
+  SRecordBinFile,
+  RomRamSRecordBinFile,
+};
+
+static constexpr std::array<std::pair<std::string_view, MemoryMapVariant>, 10>
+    s_memory_map_variants = {{
+        {"simple_old", MemoryMapVariant::SimpleOld},
+        {"romram_old", MemoryMapVariant::RomRamOld},
+        {"simple", MemoryMapVariant::Simple},
+        {"romram", MemoryMapVariant::RomRam},
+        {"srecord", MemoryMapVariant::SRecord},
+        {"binfile", MemoryMapVariant::BinFile},
+        {"romram_srecord", MemoryMapVariant::RomRamSRecord},
+        {"romram_binfile", MemoryMapVariant::RomRamBinFile},
+        {"srecord_binfile", MemoryMapVariant::SRecordBinFile},
+        {"romram_srecord_binfile", MemoryMapVariant::RomRamSRecordBinFile},
+    }};
+
+static constexpr std::array<std::string_view, 13> s_section_names = {
+    ".init",   ".text",  ".ctors", ".dtors", ".rodata", ".data",      ".bss",
+    ".sdata",  ".sbss",  ".sdata2", ".sbss2", "extab",  "extabindex",
+};
+
+// What the generated linker map is made of.
+struct Shape
+{
+  std::size_t m_unit_count = 1000;
+  std::size_t m_symbol_count = 20;
+  int m_closure_depth = 4;
+  std::size_t m_section_count = 7;
+  unsigned m_unused_percent = 10;
+  MemoryMapVariant m_memory_map_variant = MemoryMapVariant::Simple;
+  // As if linked with -listdwarf, which adds a second symbol closure for the debug sections. Only
+  // the code merging of EPPC_PatternMatching tells it apart from the first, so that comes too.
+  bool m_has_dwarf_symbol_closure = false;
+  std::uint64_t m_seed = 0;
+};
+
+// Everything random about a symbol is drawn from a hash of where it is, so nothing needs to be
+// remembered between the portions that mention it.
+static std::uint64_t Mix(std::uint64_t value) noexcept
+{
+  value += 0x9e3779b97f4a7c15;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+  return value ^ (value >> 31);
+}
+
+struct Symbol
+{
+  std::uint32_t m_size;
+  std::size_t m_section;
+  bool m_is_unused;
+  bool m_is_local;
+};
+
+static Symbol GetSymbol(const Shape& shape, const std::size_t unit, const std::size_t index)
+{
+  const std::uint64_t bits = Mix(shape.m_seed ^ Mix(unit * shape.m_symbol_count + index));
+  return {
+      static_cast<std::uint32_t>((bits % 256 + 1) * 4),
+      index % shape.m_section_count,
+      (bits >> 16) % 100 < shape.m_unused_percent,
+      (bits >> 24) % 4 == 0,
+  };
+}
+
+static std::string GetSectionName(const std::size_t section)
+{
+  if (section < s_section_names.size())
+    return std::string{s_section_names[section]};
+  return fmt::format(".text{:d}", section - s_section_names.size() + 1);
+}
+
+static bool IsCodeSection(const std::size_t section)
+{
+  return section == 0 || section == 1 || section >= s_section_names.size();
+}
+
+// Names are mangled the way MWCC would mangle a member of a class, so they are as long as the real
+// thing and never the same twice.
+static void AppendSymbolName(fmt::memory_buffer& text, const std::size_t unit,
+                             const std::size_t index, const bool is_code)
+{
+  if (is_code)
+    fmt::format_to(std::back_inserter(text), "Function{:d}__7C{:06x}Fv", index, unit);
+  else
+    fmt::format_to(std::back_inserter(text), "s_Data{:d}__7C{:06x}", index, unit);
+}
+
+static void AppendCompilationUnitName(fmt::memory_buffer& text, const std::size_t unit)
+{
+  fmt::format_to(std::back_inserter(text), "lib{:d}.a unit{:d}.cpp", unit / 64, unit);
+}
+
+static void AppendSymbolClosure(fmt::memory_buffer& text, const Shape& shape)
+{
+  for (std::size_t unit = 0; unit < shape.m_unit_count; ++unit)
+  {
+    int node_count = 0;
+    for (std::size_t index = 0; index < shape.m_symbol_count; ++index)
+    {
+      const Symbol symbol = GetSymbol(shape, unit, index);
+      if (symbol.m_is_unused)
+        continue;
+      const bool is_code = IsCodeSection(symbol.m_section);
+      const int hierarchy_level = 1 + node_count++ % shape.m_closure_depth;
+      // "%i] " and "%s (%s,%s) found in %s %s\r\n"
+      fmt::format_to(std::back_inserter(text), "{:>{}s}{:d}] ", "", hierarchy_level + 1,
+                     hierarchy_level);
+      AppendSymbolName(text, unit, index, is_code);
+      fmt::format_to(std::back_inserter(text), " ({:s},{:s}) found in ",
+                     is_code ? "func" : "object", symbol.m_is_local ? "local" : "global");
+      AppendCompilationUnitName(text, unit);
+      fmt::format_to(std::back_inserter(text), "\r\n");
+    }
+  }
+}
+
+// Every sixteenth compilation unit has its first function duplicated by the next one's.
+static void AppendEPPC_PatternMatching(fmt::memory_buffer& text, const Shape& shape)
+{
+  for (std::size_t unit = 0; unit < shape.m_unit_count; unit += 16)
+  {
+    const std::size_t other_unit = unit + 1 < shape.m_unit_count ? unit + 1 : 0;
+    // "--> duplicated code: symbol %s is duplicated by %s, size = %d \r\n\r\n"
+    fmt::format_to(std::back_inserter(text), "--> duplicated code: symbol ");
+    AppendSymbolName(text, unit, 0, true);
+    fmt::format_to(std::back_inserter(text), " is duplicated by ");
+    AppendSymbolName(text, other_unit, 0, true);
+    fmt::format_to(std::back_inserter(text), ", size = {:d} \r\n\r\n",
+                   GetSymbol(shape, unit, 0).m_size);
+  }
+}
+
+static constexpr std::array<std::string_view, 4> s_debug_section_names = {
+    ".debug_srcinfo", ".debug_sfnames", ".debug", ".line"};
+
+// Each compilation unit brings its own part of every debug section.
+static void AppendDwarfSymbolClosure(fmt::memory_buffer& text, const Shape& shape)
+{
+  for (std::size_t unit = 0; unit < shape.m_unit_count; ++unit)
+  {
+    for (const std::string_view name : s_debug_section_names)
+    {
+      // "%i] " and "%s (%s,%s) found in %s %s\r\n"
+      fmt::format_to(std::back_inserter(text), "  1] {:s} (section,local) found in ", name);
+      AppendCompilationUnitName(text, unit);
+      fmt::format_to(std::back_inserter(text), "\r\n");
+    }
+  }
+}
+
+// Where each section ends up, for the Memory Map to say.
+struct SectionPlacement
+{
+  std::string m_name;
+  std::uint32_t m_address;
+  std::uint32_t m_size;
+  std::uint32_t m_file_offset;
+};
+
+static SectionPlacement AppendSectionLayout(fmt::memory_buffer& text, const Shape& shape,
+                                            const std::size_t section, const bool is_3column,
+                                            const std::uint32_t address,
+                                            const std::uint32_t file_offset)
+{
+  const std::string name = GetSectionName(section);
+  const bool is_code = IsCodeSection(section);
+  // "\r\n\r\n%s section layout\r\n"
+  fmt::format_to(std::back_inserter(text), "\r\n\r\n{:s} section layout\r\n", name);
+  if (is_3column)
+    fmt::format_to(std::back_inserter(text), "  Starting        Virtual\r\n"
+                                             "  address  Size   address\r\n"
+                                             "  -----------------------\r\n");
+  else
+    fmt::format_to(std::back_inserter(text), "  Starting        Virtual  File\r\n"
+                                             "  address  Size   address  offset\r\n"
+                                             "  ---------------------------------\r\n");
+  const auto append_row = [&](const std::uint32_t offset, const std::uint32_t size) {
+    if (is_3column)
+      // "  %08x %06x %08x %2i "
+      fmt::format_to(std::back_inserter(text), "  {:08x} {:06x} {:08x} {:2d} ", offset, size,
+                     address + offset, 4);
+    else
+      // "  %08x %06x %08x %08x %2i "
+      fmt::format_to(std::back_inserter(text), "  {:08x} {:06x} {:08x} {:08x} {:2d} ", offset,
+                     size, address + offset, file_offset + offset, 4);
+  };
+
+  std::uint32_t offset = 0;
+  for (std::size_t unit = 0; unit < shape.m_unit_count; ++unit)
+  {
+    // The section symbol comes first in each compilation unit, so its size is needed up front.
+    std::uint32_t unit_size = 0;
+    for (std::size_t index = section; index < shape.m_symbol_count;
+         index += shape.m_section_count)
+      if (const Symbol symbol = GetSymbol(shape, unit, index); !symbol.m_is_unused)
+        unit_size += symbol.m_size;
+    // With nothing used, there is no section symbol to begin the compilation unit with, which the
+    // linker only leaves out of a BSS section for "-common on". Its unused symbols go unlisted.
+    if (unit_size == 0)
+      continue;
+    append_row(offset, unit_size);
+    fmt::format_to(std::back_inserter(text), "{:s} \t", name);
+    AppendCompilationUnitName(text, unit);
+    fmt::format_to(std::back_inserter(text), "\r\n");
+    for (std::size_t index = section; index < shape.m_symbol_count;
+         index += shape.m_section_count)
+    {
+      const Symbol symbol = GetSymbol(shape, unit, index);
+      if (symbol.m_is_unused)
+      {
+        // "  UNUSED   %06x ........ ........    %s %s %s\r\n"
+        fmt::format_to(std::back_inserter(text), "  UNUSED   {:06x} ........ {:s}", symbol.m_size,
+                       is_3column ? "" : "........    ");
+        AppendSymbolName(text, unit, index, is_code);
+        fmt::format_to(std::back_inserter(text), " ");
+        AppendCompilationUnitName(text, unit);
+        fmt::format_to(std::back_inserter(text), "\r\n");
+        continue;
+      }
+      append_row(offset, symbol.m_size);
+      AppendSymbolName(text, unit, index, is_code);
+      fmt::format_to(std::back_inserter(text), " \t");
+      AppendCompilationUnitName(text, unit);
+      fmt::format_to(std::back_inserter(text), "\r\n");
+      offset += symbol.m_size;
+    }
+  }
+  return {name, address, offset, file_offset};
+}
+
+static void AppendMemoryMap(fmt::memory_buffer& text, const Shape& shape,
+                            const std::span<const SectionPlacement> placements,
+                            const std::uint32_t debug_file_offset)
+{
+  const auto out = std::back_inserter(text);
+  fmt::format_to(out, "\r\n\r\nMemory map:\r\n");
+  const MemoryMapVariant variant = shape.m_memory_map_variant;
+  switch (variant)
+  {
+  case MemoryMapVariant::SimpleOld:
+    fmt::format_to(out, "                   Starting Size     File\r\n"
+                        "                   address           Offset\r\n");
+    break;
+  case MemoryMapVariant::RomRamOld:
+    fmt::format_to(out, "                   Starting Size     File     ROM      RAM Buffer\r\n"
+                        "                   address           Offset   Address  Address\r\n");
+    break;
+  case MemoryMapVariant::Simple:
+    fmt::format_to(out, "                       Starting Size     File\r\n"
+                        "                       address           Offset\r\n");
+    break;
+  case MemoryMapVariant::RomRam:
+    fmt::format_to(out, "                       Starting Size     File     ROM      RAM Buffer\r\n"
+                        "                       address           Offset   Address  Address\r\n");
+    break;
+  case MemoryMapVariant::SRecord:
+    fmt::format_to(out, "                       Starting Size     File       S-Record\r\n"
+                        "                       address           Offset     Line\r\n");
+    break;
+  case MemoryMapVariant::BinFile:
+    fmt::format_to(out, "                       Starting Size     File     Bin File Bin File\r\n"
+                        "                       address           Offset   Offset   Name\r\n");
+    break;
+  // clang-format off
+  case MemoryMapVariant::RomRamSRecord:
+    fmt::format_to(out, "                       Starting Size     File     ROM      RAM Buffer  S-Record\r\n"
+                        "                       address           Offset   Address  Address     Line\r\n");
+    break;
+  case MemoryMapVariant::RomRamBinFile:
+    fmt::format_to(out, "                       Starting Size     File     ROM      RAM Buffer Bin File Bin File\r\n"
+                        "                       address           Offset   Address  Address    Offset   Name\r\n");
+    break;
+  case MemoryMapVariant::SRecordBinFile:
+    fmt::format_to(out, "                       Starting Size     File        S-Record Bin File Bin File\r\n"
+                        "                       address           Offset      Line     Offset   Name\r\n");
+    break;
+  case MemoryMapVariant::RomRamSRecordBinFile:
+    fmt::format_to(out, "                       Starting Size     File     ROM      RAM Buffer    S-Record Bin File Bin File\r\n"
+                        "                       address           Offset   Address  Address       Line     Offset   Name\r\n");
+    break;
+    // clang-format on
+  }
+
+  int srecord_line = 1;
+  for (const SectionPlacement& placement : placements)
+  {
+    const std::string_view name = placement.m_name;
+    const std::uint32_t address = placement.m_address, size = placement.m_size,
+                        file_offset = placement.m_file_offset;
+    switch (variant)
+    {
+    case MemoryMapVariant::SimpleOld:
+      fmt::format_to(out, "  {:>15s}  {:08x} {:08x} {:08x}\r\n", name, address, size,
+                     file_offset);
+      break;
+    case MemoryMapVariant::RomRamOld:
+      fmt::format_to(out, "  {:>15s}  {:08x} {:08x} {:08x} {:08x} {:08x}\r\n", name, address,
+                     size, file_offset, address, address);
+      break;
+    case MemoryMapVariant::Simple:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x}\r\n", name, address, size, file_offset);
+      break;
+    case MemoryMapVariant::RomRam:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}\r\n", name, address, size,
+                     file_offset, address, address);
+      break;
+    case MemoryMapVariant::SRecord:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x} {:10d}\r\n", name, address, size,
+                     file_offset, srecord_line);
+      break;
+    case MemoryMapVariant::BinFile:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:s}\r\n", name, address, size,
+                     file_offset, file_offset, "main.bin");
+      break;
+    case MemoryMapVariant::RomRamSRecord:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x} {:10d}\r\n", name,
+                     address, size, file_offset, address, address, srecord_line);
+      break;
+    case MemoryMapVariant::RomRamBinFile:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}   {:08x} {:s}\r\n", name,
+                     address, size, file_offset, address, address, file_offset, "main.bin");
+      break;
+    case MemoryMapVariant::SRecordBinFile:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x}  {:10d} {:08x} {:s}\r\n", name,
+                     address, size, file_offset, srecord_line, file_offset, "main.bin");
+      break;
+    case MemoryMapVariant::RomRamSRecordBinFile:
+      fmt::format_to(out, "  {:>20s} {:08x} {:08x} {:08x} {:08x} {:08x}    {:10d} {:08x} {:s}\r\n",
+                     name, address, size, file_offset, address, address, srecord_line,
+                     file_offset, "main.bin");
+      break;
+    }
+    srecord_line += static_cast<int>(size / 32u + 1u);
+  }
+
+  // The debug sections only have a size and a file offset.
+  const std::uint32_t debug_size = static_cast<std::uint32_t>(shape.m_unit_count * 16u);
+  const bool is_old = variant == MemoryMapVariant::SimpleOld ||
+                      variant == MemoryMapVariant::RomRamOld;
+  std::uint32_t debug_offset = debug_file_offset;
+  for (const std::string_view name : s_debug_section_names)
+  {
+    if (is_old)
+      fmt::format_to(out, "  {:>15s}           {:06x} {:08x}\r\n", name, debug_size & 0xffffff,
+                     debug_offset);
+    else
+      fmt::format_to(out, "  {:>20s}          {:08x} {:08x}\r\n", name, debug_size, debug_offset);
+    debug_offset += debug_size & 0xffffff;
+  }
+}
+
+static void AppendLinkerGeneratedSymbols(fmt::memory_buffer& text,
+                                         const std::span<const SectionPlacement> placements)
+{
+  const auto out = std::back_inserter(text);
+  fmt::format_to(out, "\r\n\r\nLinker generated symbols:\r\n");
+  fmt::format_to(out, "{:>25s} {:08x}\r\n", "_stack_addr", 0x80400000u);
+  fmt::format_to(out, "{:>25s} {:08x}\r\n", "_stack_end", 0x803f0000u);
+  fmt::format_to(out, "{:>25s} {:08x}\r\n", "_heap_addr", 0x80400000u);
+  fmt::format_to(out, "{:>25s} {:08x}\r\n", "_heap_end", 0x81800000u);
+  for (const SectionPlacement& placement : placements)
+  {
+    const std::string_view name = std::string_view{placement.m_name}.substr(1);
+    fmt::format_to(out, "{:>25s} {:08x}\r\n", fmt::format("_f_{:s}", name), placement.m_address);
+    fmt::format_to(out, "{:>25s} {:08x}\r\n", fmt::format("_e_{:s}", name),
+                   placement.m_address + placement.m_size);
+  }
+}
+
+static void AppendMap(fmt::memory_buffer& text, const Shape& shape)
+{
+  const bool is_old = shape.m_memory_map_variant == MemoryMapVariant::SimpleOld ||
+                      shape.m_memory_map_variant == MemoryMapVariant::RomRamOld;
+  fmt::format_to(std::back_inserter(text), "Link map of {:s}\r\n", "__start");
+  AppendSymbolClosure(text, shape);
+  if (shape.m_has_dwarf_symbol_closure)
+  {
+    AppendEPPC_PatternMatching(text, shape);
+    AppendDwarfSymbolClosure(text, shape);
+  }
+
+  std::vector<SectionPlacement> placements;
+  std::uint32_t address = 0x80003100, file_offset = 0x100;
+  for (std::size_t section = 0; section < shape.m_section_count; ++section)
+  {
+    const SectionPlacement& placement = placements.emplace_back(
+        AppendSectionLayout(text, shape, section, is_old, address, file_offset));
+    // Each section starts on its own 32-byte boundary, in memory and in the file.
+    address = (address + placement.m_size + 31u) & ~31u;
+    file_offset = (file_offset + placement.m_size + 31u) & ~31u;
+  }
+  AppendMemoryMap(text, shape, placements, file_offset);
+  AppendLinkerGeneratedSymbols(text, placements);
+}
+
+static void PrintUsage(std::ostream& stream)
+{
+  fmt::println(stream,
+               "Usage: mwlinkermap-generator [-u units] [-y symbols per unit] [-d closure depth]\n"
+               "                             [-s sections] [-r unused percent]\n"
+               "                             [-m memory map variant] [-M megabytes] [-x seed]\n"
+               "                             [-j threads] [-w] output");
+}
+
+// The whole argument must be a number, so that a typo is never taken for zero.
+static bool ParseNumber(const std::string_view text, unsigned long long& value)
+{
+  const char* const tail = text.data() + text.size();
+  const auto [ptr, ec] = std::from_chars(text.data(), tail, value);
+  return ec == std::errc{} && ptr == tail;
+}
+
+// The largest each option that takes a number can be given without overflowing what it sizes.
+static unsigned long long GetNumberLimit(const char option) noexcept
+{
+  switch (option)
+  {
+  case 'M':
+    // Megabytes are turned into bytes, with an eighth more than that reserved up front.
+    return (std::numeric_limits<std::size_t>::max() / 2) >> 20;
+  case 'j':
+    return std::numeric_limits<unsigned>::max();
+  case 'x':
+    return std::numeric_limits<unsigned long long>::max();
+  default:
+    return std::numeric_limits<std::size_t>::max();
+  }
+}
+
+// Every symbol is numbered by its compilation unit and its index in it, so there can be no more of
+// them than that number counts.
+static bool CheckSymbolCount(const std::size_t unit_count, const std::size_t symbol_count)
+{
+  if (unit_count <= std::numeric_limits<std::size_t>::max() / symbol_count)
+    return true;
+  fmt::println(std::cerr, "{:d} units of {:d} symbols each are too many", unit_count,
+               symbol_count);
+  return false;
+}
+
+// Writes a synthetic linker map of whatever size and shape is asked for, for measuring how scanning
+// scales far beyond the linker maps there are to be had. The text is scanned into a Map, and what
+// is written is the Map's own print, which is read back to make sure it is exactly as generated.
+int main(const int argc, const char** argv)
+{
+  Shape shape;
+  std::size_t target_size = 0;
+  unsigned thread_count = 1;
+  const char* output_name = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string_view arg = argv[i];
+    if (arg == "-h" || arg == "--help")
+    {
+      PrintUsage(std::cout);
+      return EXIT_SUCCESS;
+    }
+    if (arg == "-w")
+    {
+      shape.m_has_dwarf_symbol_closure = true;
+    }
+    else if (arg == "-m")
+    {
+      if (i + 1 == argc)
+      {
+        fmt::println(std::cerr, "-m needs a memory map variant");
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+      }
+      const std::string_view name = argv[++i];
+      const auto iter = std::ranges::find(s_memory_map_variants, name,
+                                          &decltype(s_memory_map_variants)::value_type::first);
+      if (iter == s_memory_map_variants.end())
+      {
+        fmt::println(std::cerr, "Unknown memory map variant \"{:s}\"", name);
+        return EXIT_FAILURE;
+      }
+      shape.m_memory_map_variant = iter->second;
+    }
+    else if (arg.starts_with('-'))
+    {
+      if (arg.size() != 2 || std::string_view{"uydsrMxj"}.find(arg[1]) == std::string_view::npos)
+      {
+        fmt::println(std::cerr, "Unknown option \"{:s}\"", arg);
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+      }
+      unsigned long long value;
+      if (i + 1 == argc || !ParseNumber(argv[++i], value))
+      {
+        fmt::println(std::cerr, "{:s} needs a number", arg);
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+      }
+      if (const unsigned long long limit = GetNumberLimit(arg[1]); value > limit)
+      {
+        fmt::println(std::cerr, "{:s} needs a number no greater than {:d}", arg, limit);
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+      }
+      switch (arg[1])
+      {
+      case 'u':
+        shape.m_unit_count = std::max<std::size_t>(1, value);
+        break;
+      case 'y':
+        shape.m_symbol_count = std::max<std::size_t>(1, value);
+        break;
+      case 'd':
+        shape.m_closure_depth = static_cast<int>(std::clamp<unsigned long long>(value, 1, 64));
+        break;
+      case 's':
+        shape.m_section_count = std::max<std::size_t>(1, value);
+        break;
+      case 'r':
+        shape.m_unused_percent = static_cast<unsigned>(std::min<unsigned long long>(value, 100));
+        break;
+      case 'M':
+        target_size = value << 20;
+        break;
+      case 'x':
+        shape.m_seed = value;
+        break;
+      case 'j':
+        thread_count = static_cast<unsigned>(value);
+        break;
+      }
+    }
+    else if (output_name != nullptr)
+    {
+      fmt::println(std::cerr, "Only one output name can be given");
+      PrintUsage(std::cerr);
+      return EXIT_FAILURE;
+    }
+    else
+      output_name = argv[i];
+  }
+  if (output_name == nullptr)
+  {
+    fmt::println(std::cerr, "Provide the output name");
+    PrintUsage(std::cerr);
+    return EXIT_FAILURE;
+  }
+
+  const auto time_start = std::chrono::steady_clock::now();
+  fmt::memory_buffer text;
+  if (target_size != 0)
+  {
+    // A small linker map of the same shape tells about how much each compilation unit adds, though
+    // names get longer as the numbers in them do.
+    Shape sample_shape = shape;
+    sample_shape.m_unit_count = 1024;
+    if (!CheckSymbolCount(sample_shape.m_unit_count, sample_shape.m_symbol_count))
+      return EXIT_FAILURE;
+    AppendMap(text, sample_shape);
+    shape.m_unit_count = std::max<std::size_t>(1, target_size / (text.size() / 1024));
+    text.clear();
+    // Growing a buffer this large by doubling would ask for far more memory than it ends up using.
+    text.reserve(target_size + target_size / 8);
+  }
+  if (!CheckSymbolCount(shape.m_unit_count, shape.m_symbol_count))
+    return EXIT_FAILURE;
+  AppendMap(text, shape);
+  const auto time_generated = std::chrono::steady_clock::now();
+
+  MWLinker::Map::Options options;
+  options.m_warnings = MWLinker::Map::Warnings::None;
+  options.m_thread_count = thread_count;
+  MWLinker::Map linker_map{options};
+  std::size_t line_number = 0;
+  const MWLinker::Map::ScanError error =
+      linker_map.Scan(std::span<const char>{text.data(), text.size()}, line_number);
+  const auto time_scanned = std::chrono::steady_clock::now();
+  if (error != MWLinker::Map::ScanError::None)
+  {
+    fmt::println(std::cerr, "The generated linker map failed to scan.   line: {:d}   err: {:d}",
+                 line_number, static_cast<int>(error));
+    return EXIT_FAILURE;
+  }
+  std::ofstream outfile{output_name, std::ios_base::binary};
+  std::size_t print_line_number = 0;
+  linker_map.Print(outfile, print_line_number);
+  outfile.close();
+  const auto time_printed = std::chrono::steady_clock::now();
+  if (!outfile)
+  {
+    fmt::println(std::cerr, "Could not write \"{:s}\"", output_name);
+    return EXIT_FAILURE;
+  }
+  // Mapping what was written compares it without holding a second copy of it in memory.
+  Mijo::MappedFile written;
+  if (!written.Open(output_name) ||
+      !std::ranges::equal(written.GetSpan(), std::span<const char>{text.data(), text.size()}))
+  {
+    fmt::println(std::cerr, "The generated linker map does not print back the same");
+    return EXIT_FAILURE;
+  }
+  written.Close();
+
+  const auto to_ms = [](const auto duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+  };
+  fmt::println(std::cout, "{:s}   {:d} bytes   {:d} lines   units: {:d}   symbols: {:d}",
+               output_name, text.size(), line_number, shape.m_unit_count,
+               shape.m_unit_count * shape.m_symbol_count);
+  fmt::println(std::cout, "generate: {:d}ms   scan: {:d}ms   print: {:d}ms",
+               to_ms(time_generated - time_start), to_ms(time_scanned - time_generated),
+               to_ms(time_printed - time_scanned));
+
+  return EXIT_SUCCESS;
+}